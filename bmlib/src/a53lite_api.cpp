@@ -649,7 +649,7 @@ std::mutex kernel_launch_mtx;
 typedef int (*f_ptr)(void *, unsigned int);
 tpu_kernel_function_t tpu_kernel_get_function_from_core(bm_handle_t handle, tpu_kernel_module_t module, const char *function, int core_id)
 {
-#ifdef USING_CMODEL
+#if defined(USING_CMODEL) && !defined(USING_FAKE_DEVICE)
     unsigned int core_num = 0;
     (void)bm_get_tpu_core_num(handle, &core_num);
     if(core_num == 1){
@@ -710,7 +710,7 @@ typedef struct
 
 bm_status_t tpu_kernel_launch_from_core(bm_handle_t handle, tpu_kernel_function_t function, void *args, size_t size, int core_id)
 {
-#ifdef USING_CMODEL
+#if defined(USING_CMODEL) && !defined(USING_FAKE_DEVICE)
     unsigned int core_num = 0;
     (void)bm_get_tpu_core_num(handle, &core_num);
     if(core_num == 1){
@@ -748,7 +748,7 @@ bm_status_t tpu_kernel_launch_from_core(bm_handle_t handle, tpu_kernel_function_
 
 bm_status_t tpu_kernel_launch_async_from_core(bm_handle_t handle, tpu_kernel_function_t function, void *args, size_t size, int core_id)
 {
-#ifdef USING_CMODEL
+#if defined(USING_CMODEL) && !defined(USING_FAKE_DEVICE)
     unsigned int core_num = 0;
     (void)bm_get_tpu_core_num(handle, &core_num);
     if(core_num == 1){
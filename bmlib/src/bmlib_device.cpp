@@ -46,6 +46,10 @@ unsigned long long get_global_mem_size()
 void *cmodel_so_handle_ = NULL;
 void bm_device::cmodel_setup(void)
 {
+#ifdef USING_FAKE_DEVICE
+  bm_fake_device_setup(this);
+  return;
+#endif
   get_global_memaddr_    =  (t_get_global_memaddr)dlsym(NULL,    "get_global_memaddr");
   cmodel_init_  =  (t_cmodel_init)dlsym(NULL,  "cmodel_init");
   set_cur_nodechip_idx_ =  (t_set_cur_nodechip_idx)dlsym(NULL, "set_cur_nodechip_idx");
@@ -198,9 +202,11 @@ bm_device::~bm_device() {
     bm_free_sys_tvgen_multi_core_reserved();
   }
 
+#ifndef USING_FAKE_DEVICE
   for (int core_idx = 0; core_idx < core_num; ++core_idx) {
     bm_send_quit_message(core_idx);
   }
+#endif
   for (int core_idx = 0; core_idx < core_num; ++core_idx) {
     pthread_mutex_destroy(&api_locks[core_idx]);
   }
@@ -333,6 +339,9 @@ bm_status_t bm_device::bm_device_sync() {
     pending_api_queues[core_idx].push({DEVICE_SYNC_MARKER, 0, dev_sync_last});
     //printf("SYNC DEVICE API: device (core_idx=%d) last seq %d\n", core_idx, device_sync_last[core_idx]);
     pthread_mutex_unlock(&api_locks[core_idx]);
+#ifdef USING_FAKE_DEVICE
+    bm_fake_device_notify(core_idx);
+#endif
   }
 
   while (true) {
@@ -528,6 +537,9 @@ void *bm_device::bm_msg_done_poll(void *arg) {
   bm_device *bm_dev = _param->dev;
   int core_idx = _param->core_idx;
   while (1) {
+#ifdef USING_FAKE_DEVICE
+    u64 events = bm_fake_device_events(core_idx);
+#endif
     while (!bm_dev->pending_api_queues[core_idx].empty()) {
       api_queue_entry api_front = bm_dev->pending_api_queues[core_idx].front();
       if (api_front.thd_id == DEVICE_SYNC_MARKER) {
@@ -558,7 +570,10 @@ void *bm_device::bm_msg_done_poll(void *arg) {
       }
     }
 // busy waiting sleep 200ms, reduce cpu usage
-#if defined(USING_CMODEL) && !defined(USING_MULTI_THREAD_ENGINE)
+#if defined(USING_FAKE_DEVICE)
+    // wake on the next api or device sync, so sync latency stays host-only
+    bm_fake_device_wait(core_idx, events);
+#elif defined(USING_CMODEL) && !defined(USING_MULTI_THREAD_ENGINE)
     usleep(200000);
 #endif
     pthread_testcancel();
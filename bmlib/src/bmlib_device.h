@@ -198,6 +198,14 @@ extern "C"
     static pthread_mutex_t init_lock;
   };
 
+#ifdef USING_FAKE_DEVICE
+  /* host-only stand-in for libcmodel.so, see bmlib_fake_device.cpp */
+  void bm_fake_device_setup(bm_device *dev);
+  u64 bm_fake_device_events(int core_idx);
+  void bm_fake_device_notify(int core_idx);
+  void bm_fake_device_wait(int core_idx, u64 seen);
+#endif
+
   class bm_device_manager_control
   {
   public:
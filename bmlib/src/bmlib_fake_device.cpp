@@ -0,0 +1,235 @@
+#if defined(USING_CMODEL) && defined(USING_FAKE_DEVICE)
+#include "bmlib_internal.h"
+#include "bmlib_device.h"
+#include <sys/mman.h>
+#include <unistd.h>
+#include <string.h>
+#include <sched.h>
+
+/*
+ * Host-only device behind the cmodel bm_device: global memory is an anonymous
+ * host mapping, s2d/d2s are memcpy and every api is consumed as soon as it is
+ * signaled. Api payloads are not executed, so this flavor measures the host
+ * side only (bmodel loading, relocation, scheduling, memory pools).
+ *
+ * BMLIB_FAKE_CHIP_ID       chip id reported to the runtime, default 0x1686
+ * BMLIB_FAKE_CORE_NUM      tpu core number, default 1
+ * BMLIB_FAKE_API_DELAY_US  synthetic execution time of each api, default 0
+ * CMODEL_GLOBAL_MEM_SIZE   global memory size, as for cmodel
+ */
+#define FAKE_MAX_CORE_NUM           8
+#define FAKE_SHARE_REG_MESSAGE_WP   0
+#define FAKE_SHARE_REG_MESSAGE_RP   1
+#define FAKE_SHARE_REG_FW_STATUS    2
+#define FAKE_SHARE_REG_NUM          4
+#define FAKE_SHAREMEM_SIZE          (1 << 11)
+#define FAKE_FW_INIT_DONE           0x76125438
+
+struct fake_core_t {
+  std::atomic<u32> share_reg[FAKE_SHARE_REG_NUM];
+  u32 share_mem[FAKE_SHAREMEM_SIZE];
+  std::atomic<int> last_func_id;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  u64 events;
+};
+
+static fake_core_t fake_cores[FAKE_MAX_CORE_NUM];
+static u8 *fake_gmem = NULL;
+static u64 fake_gmem_size = 0;
+static u64 fake_gmem_start = 0;
+static u32 fake_chip_id = 0x1686;
+static int fake_core_num = 1;
+static u32 fake_api_delay_us = 0;
+
+static u64 fake_getenv(const char *name, u64 default_val) {
+  const char *env = getenv(name);
+  if (!env || !env[0]) return default_val;
+  char *end = NULL;
+  u64 val = strtoull(env, &end, 0);
+  if (*end != '\0') {
+    printf("invalid %s \"%s\", use default 0x%llx\n", name, env,
+           (unsigned long long)default_val);
+    return default_val;
+  }
+  return val;
+}
+
+static u8 *fake_host_addr(u64 dev_addr, u64 size) {
+  if (dev_addr < fake_gmem_start ||
+      dev_addr - fake_gmem_start + size > fake_gmem_size) {
+    printf("BM: fake device address 0x%llx size 0x%llx out of global memory\n",
+           (unsigned long long)dev_addr, (unsigned long long)size);
+    ASSERT(0);
+  }
+  return fake_gmem + (dev_addr - fake_gmem_start);
+}
+
+static void *fake_get_global_memaddr(int) {
+  return fake_gmem;
+}
+
+static int fake_cmodel_init(int core_idx, unsigned long long size) {
+  if (core_idx >= FAKE_MAX_CORE_NUM) return BM_ERR_PARAM;
+  if (!fake_gmem) {
+    // only the touched pages are backed, so the default 4GB is cheap
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem == MAP_FAILED) {
+      printf("BM: fake device can not map 0x%llx bytes global memory\n", size);
+      return BM_ERR_NOMEM;
+    }
+    fake_gmem = (u8 *)mem;
+    fake_gmem_size = size;
+  }
+  fake_core_t *core = &fake_cores[core_idx];
+  core->share_reg[FAKE_SHARE_REG_MESSAGE_WP] = 0;
+  core->share_reg[FAKE_SHARE_REG_MESSAGE_RP] = 0;
+  core->share_reg[FAKE_SHARE_REG_FW_STATUS] = FAKE_FW_INIT_DONE;
+  core->last_func_id = 0;
+  core->events = 0;
+  pthread_mutex_init(&core->lock, nullptr);
+  pthread_cond_init(&core->cond, nullptr);
+  return BM_SUCCESS;
+}
+
+static void fake_cmodel_deinit(int core_idx) {
+  pthread_mutex_destroy(&fake_cores[core_idx].lock);
+  pthread_cond_destroy(&fake_cores[core_idx].cond);
+  if (fake_gmem) {
+    munmap(fake_gmem, fake_gmem_size);
+    fake_gmem = NULL;
+    fake_gmem_size = 0;
+  }
+}
+
+static void fake_core_noop(int) {}
+
+static u32 *fake_get_share_memory_addr(u32 offset, int core_idx) {
+  return &fake_cores[core_idx].share_mem[offset & (FAKE_SHAREMEM_SIZE - 1)];
+}
+
+static void fake_write_share_reg(u32 idx, u32 data, int core_idx) {
+  fake_cores[core_idx].share_reg[idx] = data;
+}
+
+static void fake_write_share_memory(u32 offset, u32 data, int core_idx) {
+  *fake_get_share_memory_addr(offset, core_idx) = data;
+}
+
+static u32 fake_read_share_reg(u32 idx, int core_idx) {
+  return fake_cores[core_idx].share_reg[idx];
+}
+
+static void fake_dma_copy_s2d(u64 dst, void *src, u64 size, u32) {
+  memcpy(fake_host_addr(dst, size), src, size);
+}
+
+static void fake_dma_copy_d2s(void *dst, u64 src, u64 size, u32) {
+  memcpy(dst, fake_host_addr(src, size), size);
+}
+
+/* called by the msg poll thread once for each pending api */
+static void fake_api_poll(int) {
+  if (fake_api_delay_us) usleep(fake_api_delay_us);
+}
+
+/* the whole message fifo is consumed at once, nothing is executed */
+static void fake_api_signal(int core_idx) {
+  fake_core_t *core = &fake_cores[core_idx];
+  core->share_reg[FAKE_SHARE_REG_MESSAGE_RP] =
+      core->share_reg[FAKE_SHARE_REG_MESSAGE_WP].load();
+  bm_fake_device_notify(core_idx);
+}
+
+static u32 fake_get_chip_id(void) { return fake_chip_id; }
+static u32 fake_share_reg_message_wp() { return FAKE_SHARE_REG_MESSAGE_WP; }
+static u32 fake_share_reg_message_rp() { return FAKE_SHARE_REG_MESSAGE_RP; }
+static u32 fake_share_reg_fw_status() { return FAKE_SHARE_REG_FW_STATUS; }
+
+static void fake_wait_share_reg_equal(u32 idx, int val, int, int, int core_idx) {
+  while (fake_cores[core_idx].share_reg[idx] != (u32)val) {
+    sched_yield();
+  }
+}
+
+static int fake_get_total_nodechip_num(void) { return fake_core_num; }
+static u64 fake_get_gmem_start_addr() { return fake_gmem_start; }
+
+/* tpu_kernel_get_function just needs distinct ids per core */
+static int fake_get_last_func_id(int core_idx) {
+  return ++fake_cores[core_idx].last_func_id;
+}
+
+void bm_fake_device_setup(bm_device *dev) {
+  fake_chip_id = (u32)fake_getenv("BMLIB_FAKE_CHIP_ID", 0x1686);
+  fake_core_num = (int)fake_getenv("BMLIB_FAKE_CORE_NUM", 1);
+  if (fake_core_num < 1 || fake_core_num > FAKE_MAX_CORE_NUM) {
+    printf("BMLIB_FAKE_CORE_NUM %d out of [1, %d], use 1\n", fake_core_num,
+           FAKE_MAX_CORE_NUM);
+    fake_core_num = 1;
+  }
+  fake_api_delay_us = (u32)fake_getenv("BMLIB_FAKE_API_DELAY_US", 0);
+  // same global memory base as the real chip, bmodel addresses stay valid
+  fake_gmem_start = (fake_chip_id == 0x1690 || fake_chip_id == 0x2380) ? 0 : 0x100000000;
+  printf("BM: fake device chip 0x%x, %d core(s), api delay %uus\n",
+         fake_chip_id, fake_core_num, fake_api_delay_us);
+
+  dev->get_global_memaddr_ = fake_get_global_memaddr;
+  dev->cmodel_init_ = fake_cmodel_init;
+  dev->set_cur_nodechip_idx_ = fake_core_noop;
+  dev->cmodel_nodechip_runtime_init_ = fake_core_noop;
+  dev->cmodel_nodechip_runtime_exit_ = fake_core_noop;
+  dev->cmodel_deinit_ = fake_cmodel_deinit;
+  dev->cmodel_get_share_memory_addr_ = fake_get_share_memory_addr;
+  dev->cmodel_write_share_reg_ = fake_write_share_reg;
+  dev->cmodel_write_share_memory_ = fake_write_share_memory;
+  dev->cmodel_read_share_reg_ = fake_read_share_reg;
+  dev->host_dma_copy_s2d_cmodel_ = fake_dma_copy_s2d;
+  dev->host_dma_copy_d2s_cmodel_ = fake_dma_copy_d2s;
+
+  dev->cmodel_share_reg_message_rp_ = fake_share_reg_message_rp;
+  dev->cmodel_share_reg_message_wp_ = fake_share_reg_message_wp;
+  dev->cmodel_share_reg_fw_status_ = fake_share_reg_fw_status;
+  dev->cmodel_wait_share_reg_equal_ = fake_wait_share_reg_equal;
+
+  dev->cmodel_api_poll_ = fake_api_poll;
+  dev->cmodel_api_signal_ = fake_api_signal;
+  dev->cmodel_api_signal_begin_ = fake_core_noop;
+  dev->cmodel_get_chip_id_ = fake_get_chip_id;
+  dev->cmodel_get_total_nodechip_num_ = fake_get_total_nodechip_num;
+  dev->cmodel_get_gmem_start_addr_ = fake_get_gmem_start_addr;
+  dev->cmodel_get_last_func_id = fake_get_last_func_id;
+}
+
+u64 bm_fake_device_events(int core_idx) {
+  fake_core_t *core = &fake_cores[core_idx];
+  pthread_mutex_lock(&core->lock);
+  u64 events = core->events;
+  pthread_mutex_unlock(&core->lock);
+  return events;
+}
+
+void bm_fake_device_notify(int core_idx) {
+  fake_core_t *core = &fake_cores[core_idx];
+  pthread_mutex_lock(&core->lock);
+  core->events++;
+  pthread_mutex_unlock(&core->lock);
+  pthread_cond_signal(&core->cond);
+}
+
+static void fake_unlock(void *lock) {
+  pthread_mutex_unlock((pthread_mutex_t *)lock);
+}
+
+/* the poll thread is cancelled while waiting here when the device is freed */
+void bm_fake_device_wait(int core_idx, u64 seen) {
+  fake_core_t *core = &fake_cores[core_idx];
+  pthread_mutex_lock(&core->lock);
+  pthread_cleanup_push(fake_unlock, &core->lock);
+  while (core->events == seen) {
+    pthread_cond_wait(&core->cond, &core->lock);
+  }
+  pthread_cleanup_pop(1);
+}
+#endif
@@ -1,6 +1,7 @@
 #include "bmlib_runtime.h"
 #include "bmlib_internal.h"
 #include "bmlib_mmpool.h"
+#include "bmlib_memory.h"
 
 #ifdef USING_CMODEL
 // #define MEM_POOL_DEBUG
@@ -12,33 +13,120 @@ void mem_pool_init(mem_pool_t *pool) {
   P->slot_avail.push_back(make_pair(0, pool->total_size));
 }
 */
-/* look for the smallest yet sufficient memory slot for the demanding size */
+static int slot_bin_index(pool_size_t size) {
+  pool_size_t slot_num = size / MIN_SLOT_SIZE;
+  if (slot_num == 0)
+    return 0;
+  int index = 63 - __builtin_clzll(slot_num);
+  return index < MEM_POOL_BIN_NUM ? index : MEM_POOL_BIN_NUM - 1;
+}
+
+static void bin_insert(struct pool_struct *P, struct pool_block *block) {
+  int index = slot_bin_index(block->size);
+  struct rb_node **p = &P->slot_bin[index].rb_node;
+  struct rb_node *parent = NULL;
+  while (*p) {
+    struct pool_block *entry = rb_entry(*p, struct pool_block, size_node);
+    parent = *p;
+    if (block->size < entry->size ||
+        (block->size == entry->size && block->offset < entry->offset))
+      p = &(*p)->rb_left;
+    else
+      p = &(*p)->rb_right;
+  }
+  rb_link_node(&block->size_node, parent, p);
+  rb_insert_color(&block->size_node, &P->slot_bin[index]);
+  P->bin_mask |= 1ull << index;
+}
+
+static void bin_erase(struct pool_struct *P, struct pool_block *block) {
+  int index = slot_bin_index(block->size);
+  rb_erase(&block->size_node, &P->slot_bin[index]);
+  if (RB_EMPTY_ROOT(&P->slot_bin[index]))
+    P->bin_mask &= ~(1ull << index);
+}
+
+static void avail_insert(struct pool_struct *P, struct pool_block *block) {
+  struct rb_node **p = &P->slot_avail.rb_node;
+  struct rb_node *parent = NULL;
+  while (*p) {
+    struct pool_block *entry = rb_entry(*p, struct pool_block, addr_node);
+    parent = *p;
+    ASSERT(block->offset != entry->offset);
+    if (block->offset < entry->offset)
+      p = &(*p)->rb_left;
+    else
+      p = &(*p)->rb_right;
+  }
+  rb_link_node(&block->addr_node, parent, p);
+  rb_insert_color(&block->addr_node, &P->slot_avail);
+  P->num_slots_avail++;
+}
+
+static void avail_erase(struct pool_struct *P, struct pool_block *block) {
+  rb_erase(&block->addr_node, &P->slot_avail);
+  P->num_slots_avail--;
+}
+
+/* the free slots right before and after offset, NULL if none */
+static void find_neighbours(struct pool_struct *P, pool_addr_t offset,
+                            struct pool_block **prev, struct pool_block **next) {
+  struct rb_node *n = P->slot_avail.rb_node;
+  *prev = NULL;
+  *next = NULL;
+  while (n) {
+    struct pool_block *entry = rb_entry(n, struct pool_block, addr_node);
+    if (offset < entry->offset) {
+      *next = entry;
+      n = n->rb_left;
+    } else {
+      *prev = entry;
+      n = n->rb_right;
+    }
+  }
+}
+
+/* look for the smallest yet sufficient memory slot for the demanding size,
+ * the lowest one among slots of the same size */
 static pool_addr_t find_slot(struct pool_struct *P, pool_size_t size) {
   ASSERT(size % MIN_SLOT_SIZE == 0);
 
-  vector < pool_pair_t>::iterator it, it_min = P->slot_avail.end();
-  pool_size_t min_size_among_sufficient = 0;
-  for (it = P->slot_avail.begin(); it != P->slot_avail.end(); it++) {
-    if ((*it).second >= size) {
-      if (min_size_among_sufficient == 0 ||
-              (*it).second < min_size_among_sufficient) {
-        it_min = it;
-        min_size_among_sufficient = (*it).second;
-      }
+  struct pool_block *found = NULL;
+  int index = slot_bin_index(size);
+  /* only the first bin may hold slots smaller than size */
+  struct rb_node *n = P->slot_bin[index].rb_node;
+  while (n) {
+    struct pool_block *entry = rb_entry(n, struct pool_block, size_node);
+    if (entry->size >= size) {
+      found = entry;
+      n = n->rb_left;
+    } else {
+      n = n->rb_right;
+    }
+  }
+  if (!found && index + 1 < MEM_POOL_BIN_NUM) {
+    u64 mask = P->bin_mask & (~0ull << (index + 1));
+    if (mask) {
+      struct rb_node *first = rb_first(&P->slot_bin[__builtin_ctzll(mask)]);
+      found = rb_entry(first, struct pool_block, size_node);
     }
   }
 
-  if (it_min == P->slot_avail.end() || (*it_min).second == 0) {
+  if (!found) {
     printf("Memory exhausted: cannot find a slot.\n");
     return MEM_POOL_ADDR_INVALID;
   }
-  pool_addr_t addr = (*it_min).first;
+  pool_addr_t addr = found->offset;
 
-  if ((*it_min).second == size) {
-    P->slot_avail.erase(it_min);
+  bin_erase(P, found);
+  if (found->size == size) {
+    avail_erase(P, found);
+    delete found;
   } else {
-    (*it_min).first = addr + size;
-    (*it_min).second -= size;
+    /* the rest keeps its place in the address order */
+    found->offset = addr + size;
+    found->size -= size;
+    bin_insert(P, found);
   }
 
   P->slot_in_use.insert(make_pair(addr, size));
@@ -52,6 +140,8 @@ pool_addr_t bm_mem_pool::bm_mem_pool_alloc(pool_size_t size) {
   ASSERT(P->num_slots_in_use < MEM_POOL_SLOT_NUM);
   pool_size_t size_to_alloc = (size + MIN_SLOT_SIZE - 1) / MIN_SLOT_SIZE
                               * MIN_SLOT_SIZE;
+  if (size_to_alloc == 0)
+    size_to_alloc = MIN_SLOT_SIZE;
   pool_addr_t addr_to_alloc = find_slot(P, size_to_alloc);
 
   if (addr_to_alloc == MEM_POOL_ADDR_INVALID) {
@@ -71,6 +161,9 @@ pool_addr_t bm_mem_pool::bm_mem_pool_alloc(pool_size_t size) {
   P->num_slots_in_use++;
   P->mem_in_use += size_to_alloc;
   ASSERT(P->mem_in_use <= _total_size);
+  if (P->mem_in_use > P->peak_mem_in_use)
+    P->peak_mem_in_use = P->mem_in_use;
+  P->alloc_count++;
 
 #ifdef MEM_POOL_DEBUG
   printf("mem_pool: alloc addr 0x%llx with size of 0x%llx; \n", addr_to_alloc, size_to_alloc);
@@ -91,31 +184,44 @@ void bm_mem_pool::bm_mem_pool_free(pool_addr_t addr_to_free) {
   P->num_slots_in_use--;
   ASSERT(P->mem_in_use >= size_to_free);
   P->mem_in_use -= size_to_free;
+  P->free_count++;
 
-  pool_addr_t addr_next = addr_to_free + size_to_free;
-  vector < pool_pair_t>::iterator it_prev_slot = find_if (P->slot_avail.begin(),
-      P->slot_avail.end(), offset_prev_finder(addr_to_free));
-  vector < pool_pair_t>::iterator it_next_slot = find_if (P->slot_avail.begin(),
-      P->slot_avail.end(), offset_next_finder(addr_next));
-
-  if (it_prev_slot == P->slot_avail.end() &&
-          it_next_slot == P->slot_avail.end()) {
-    P->slot_avail.push_back(make_pair(addr_to_free, size_to_free));
-  } else if (it_prev_slot == P->slot_avail.end()) {
-    (*it_next_slot).first = addr_to_free;
-    (*it_next_slot).second += size_to_free;
-#ifdef DEBUG
-    CHECK_FREED_MEM((*it_next_slot).first, (*it_next_slot).second, P);
-#endif
-  } else if (it_next_slot == P->slot_avail.end()) {
-    (*it_prev_slot).second += size_to_free;
-#ifdef DEBUG
-    CHECK_FREED_MEM((*it_prev_slot).first, (*it_prev_slot).second, P);
-#endif
+  struct pool_block *prev_slot, *next_slot;
+  find_neighbours(P, addr_to_free, &prev_slot, &next_slot);
+  ASSERT(!prev_slot || prev_slot->offset + prev_slot->size <= addr_to_free);
+  ASSERT(!next_slot || addr_to_free + size_to_free <= next_slot->offset);
+  if (prev_slot && prev_slot->offset + prev_slot->size != addr_to_free)
+    prev_slot = NULL;
+  if (next_slot && addr_to_free + size_to_free != next_slot->offset)
+    next_slot = NULL;
+
+  struct pool_block *merged;
+  if (!prev_slot && !next_slot) {
+    merged = new pool_block;
+    merged->offset = addr_to_free;
+    merged->size = size_to_free;
+    avail_insert(P, merged);
+  } else if (!prev_slot) {
+    bin_erase(P, next_slot);
+    next_slot->offset = addr_to_free;
+    next_slot->size += size_to_free;
+    merged = next_slot;
+  } else if (!next_slot) {
+    bin_erase(P, prev_slot);
+    prev_slot->size += size_to_free;
+    merged = prev_slot;
   } else {
-    (*it_prev_slot).second += (size_to_free + (*it_next_slot).second);
-    P->slot_avail.erase(it_next_slot);
+    bin_erase(P, prev_slot);
+    bin_erase(P, next_slot);
+    avail_erase(P, next_slot);
+    prev_slot->size += size_to_free + next_slot->size;
+    delete next_slot;
+    merged = prev_slot;
   }
+  bin_insert(P, merged);
+#ifdef DEBUG
+  CHECK_FREED_MEM(merged->offset, merged->size, P);
+#endif
 
 #ifdef MEM_POOL_DEBUG
   printf("mem_pool_free: addr_to_free = 0x%llx; size_to_free = 0x%llx\n",
@@ -141,26 +247,66 @@ void mem_pool_create(mem_pool_t **pool, u64 total_size) {
 }
 */
 
+void bm_mem_pool::bm_mem_pool_get_stat(bm_mem_pool_stat_t *stat) {
+  struct pool_struct *P = &_mem_pool_list[0];
+  pthread_mutex_lock(&P->mem_pool_lock);
+  stat->total_size = _total_size;
+  stat->mem_in_use = P->mem_in_use;
+  stat->peak_mem_in_use = P->peak_mem_in_use;
+  stat->num_slots_in_use = P->num_slots_in_use;
+  stat->num_slots_avail = P->num_slots_avail;
+  stat->alloc_count = P->alloc_count;
+  stat->free_count = P->free_count;
+  stat->largest_free_slot = 0;
+  if (P->bin_mask) {
+    int index = 63 - __builtin_clzll(P->bin_mask);
+    struct rb_node *last = rb_last(&P->slot_bin[index]);
+    stat->largest_free_slot = rb_entry(last, struct pool_block, size_node)->size;
+  }
+  pool_size_t mem_free = _total_size - P->mem_in_use;
+  stat->fragmentation = mem_free ? 1.0 - (double)stat->largest_free_slot / mem_free : 0;
+  pthread_mutex_unlock(&P->mem_pool_lock);
+}
+
 bm_mem_pool::bm_mem_pool(u64 total_size)
   : _total_size(total_size),
     _mem_pool_count(1) {
   struct pool_struct *P = &_mem_pool_list[0];
   pthread_mutex_init(&P->mem_pool_lock, NULL);
-  P->slot_avail.clear();
+  P->slot_avail.rb_node = NULL;
+  for (int i = 0; i < MEM_POOL_BIN_NUM; i++)
+    P->slot_bin[i].rb_node = NULL;
+  P->bin_mask = 0;
+  P->num_slots_avail = 0;
   P->slot_in_use.clear();
-  P->slot_avail.push_back(make_pair(0, _total_size));
   P->num_slots_in_use = 0;
   P->mem_in_use = 0;
+  P->peak_mem_in_use = 0;
+  P->alloc_count = 0;
+  P->free_count = 0;
+  struct pool_block *block = new pool_block;
+  block->offset = 0;
+  block->size = _total_size;
+  avail_insert(P, block);
+  bin_insert(P, block);
 }
 
 bm_mem_pool::~bm_mem_pool() {
   /* sanity checking */
   struct pool_struct *P = &_mem_pool_list[0];
-  ASSERT(P->slot_avail[0].first == 0);
-  ASSERT(P->slot_avail[0].second == _total_size);
+#ifdef MEM_POOL_DEBUG
+  printf("mem_pool: peak 0x%llx, %llu allocs, %llu frees\n",
+         P->peak_mem_in_use, P->alloc_count, P->free_count);
+#endif
+  ASSERT(P->num_slots_avail == 1);
+  struct pool_block *block = rb_entry(P->slot_avail.rb_node, struct pool_block, addr_node);
+  ASSERT(block->offset == 0);
+  ASSERT(block->size == _total_size);
   ASSERT(P->slot_in_use.empty());
   ASSERT(P->num_slots_in_use == 0);
   ASSERT(P->mem_in_use == 0);
+  delete block;
+  pthread_mutex_destroy(&P->mem_pool_lock);
 }
 #endif
 
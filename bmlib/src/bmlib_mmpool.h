@@ -10,6 +10,7 @@
 #include <map>
 #include <algorithm>
 #include <pthread.h>
+#include "rbtree.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -38,40 +39,52 @@ typedef u64 pool_size_t;
 typedef pair < pool_addr_t, pool_size_t> pool_pair_t;
 typedef map < pool_addr_t, pool_size_t> pool_map_t;
 
-class offset_prev_finder {
-public:
-  offset_prev_finder(pool_addr_t offset_prev) : offset_prev_(offset_prev) {}
-  bool operator () (const pool_pair_t pair_) {
-    return pair_.first + pair_.second == offset_prev_;
-  }
-private:
-  pool_addr_t offset_prev_;
-};
+/* free slots are binned by floor(log2(size / MIN_SLOT_SIZE)) */
+#define MEM_POOL_BIN_NUM (64)
 
-class offset_next_finder {
-public:
-  offset_next_finder(pool_addr_t offset_next) : offset_next_(offset_next) {}
-  bool operator () (const pool_pair_t pair_) {
-    return pair_.first == offset_next_;
-  }
-private:
-  pool_addr_t offset_next_;
+/* a free slot, linked both in the address ordered tree for coalescing
+ * and in the tree of its size class, ordered by (size, offset) */
+struct pool_block {
+  struct rb_node addr_node;
+  struct rb_node size_node;
+  pool_addr_t offset;
+  pool_size_t size;
 };
 
 struct pool_struct {
   pthread_mutex_t mem_pool_lock;
   int num_slots_in_use;
   pool_size_t mem_in_use;
-  vector < pool_pair_t> slot_avail;  // (offset, size)
+  struct rb_root slot_avail;  // pool_block by offset
+  struct rb_root slot_bin[MEM_POOL_BIN_NUM];  // pool_block by (size, offset)
+  u64 bin_mask;  // bit i set if slot_bin[i] is not empty
+  int num_slots_avail;
   pool_map_t slot_in_use; // offset -> size
+  pool_size_t peak_mem_in_use;
+  u64 alloc_count;
+  u64 free_count;
 };
 
+typedef struct bm_mem_pool_stat {
+  pool_size_t total_size;
+  pool_size_t mem_in_use;
+  pool_size_t peak_mem_in_use;
+  pool_size_t largest_free_slot;
+  int num_slots_in_use;
+  int num_slots_avail;
+  u64 alloc_count;
+  u64 free_count;
+  /* 1 - largest_free_slot / free memory, 0 when free memory is contiguous */
+  double fragmentation;
+} bm_mem_pool_stat_t;
+
 class bm_mem_pool {
  public:
   bm_mem_pool(u64 total_size);
   ~bm_mem_pool();
   pool_addr_t bm_mem_pool_alloc(pool_size_t size);
   void bm_mem_pool_free(pool_addr_t addr);
+  void bm_mem_pool_get_stat(bm_mem_pool_stat_t *stat);
 
  private:
   u64                  _total_size;
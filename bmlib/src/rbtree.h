@@ -127,6 +127,9 @@ static inline void rb_set_color(struct rb_node *rb, int color)
 // extern void rb_insert_color(struct rb_node *, struct rb_root *);
 // extern void rb_erase(struct rb_node *, struct rb_root *);
 
+#ifdef __cplusplus
+extern "C" {
+#endif
 /* Find logical next and previous nodes in a tree */
 extern struct rb_node *rb_next(const struct rb_node *);
 extern struct rb_node *rb_prev(const struct rb_node *);
@@ -136,6 +139,9 @@ extern struct rb_node *rb_last(const struct rb_root *);
 /* Fast replacement of a single node without remove/rebalance/add/rebalance */
 extern void rb_replace_node(struct rb_node *victim, struct rb_node *new_root,
 			    struct rb_root *root);
+#ifdef __cplusplus
+}
+#endif
 
 static inline void rb_link_node(struct rb_node * node, struct rb_node * parent,
 				struct rb_node ** rb_link)
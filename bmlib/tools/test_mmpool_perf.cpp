@@ -0,0 +1,174 @@
+/*
+ * Stress test of the cmodel device memory pool (bm_mem_pool), no device needed.
+ * The same random alloc/free trace runs on bm_mem_pool and on a linear best
+ * fit pool like the one it replaced, the addresses must be the same.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <random>
+#include "bmlib_runtime.h"
+#include "bmlib_internal.h"
+#include "bmlib_mmpool.h"
+
+/* best fit over a vector of free slots, the lowest slot wins a tie */
+class linear_pool {
+public:
+  linear_pool(pool_size_t total_size) { slot_avail.push_back(make_pair(0, total_size)); }
+
+  pool_addr_t alloc(pool_size_t size) {
+    size = (size + MIN_SLOT_SIZE - 1) / MIN_SLOT_SIZE * MIN_SLOT_SIZE;
+    if (size == 0)
+      size = MIN_SLOT_SIZE;
+    vector<pool_pair_t>::iterator it, it_min = slot_avail.end();
+    for (it = slot_avail.begin(); it != slot_avail.end(); it++) {
+      if (it->second >= size &&
+          (it_min == slot_avail.end() || it->second < it_min->second ||
+           (it->second == it_min->second && it->first < it_min->first)))
+        it_min = it;
+    }
+    if (it_min == slot_avail.end())
+      return MEM_POOL_ADDR_INVALID;
+    pool_addr_t addr = it_min->first;
+    if (it_min->second == size) {
+      slot_avail.erase(it_min);
+    } else {
+      it_min->first += size;
+      it_min->second -= size;
+    }
+    slot_in_use[addr] = size;
+    return addr;
+  }
+
+  void free(pool_addr_t addr) {
+    pool_size_t size = slot_in_use[addr];
+    slot_in_use.erase(addr);
+    vector<pool_pair_t>::iterator prev = slot_avail.end(), next = slot_avail.end(), it;
+    for (it = slot_avail.begin(); it != slot_avail.end(); it++) {
+      if (it->first + it->second == addr) prev = it;
+      if (it->first == addr + size) next = it;
+    }
+    if (prev == slot_avail.end() && next == slot_avail.end()) {
+      slot_avail.push_back(make_pair(addr, size));
+    } else if (prev == slot_avail.end()) {
+      next->first = addr;
+      next->second += size;
+    } else if (next == slot_avail.end()) {
+      prev->second += size;
+    } else {
+      prev->second += size + next->second;
+      slot_avail.erase(next);
+    }
+  }
+
+private:
+  vector<pool_pair_t> slot_avail;
+  pool_map_t slot_in_use;
+};
+
+struct pool_op {
+  bool is_alloc;
+  pool_size_t size;  // alloc
+  size_t index;      // free: which live buffer
+};
+
+/* a mix of small tensors and some big neuron buffers, freed in random order */
+static vector<pool_op> build_trace(int op_num, int max_live, unsigned seed) {
+  std::mt19937 rng(seed);
+  vector<pool_op> trace;
+  size_t live = 0;
+  for (int i = 0; i < op_num; i++) {
+    pool_op op;
+    op.is_alloc = live == 0 || (live < (size_t)max_live && rng() % 8 < 5);
+    if (op.is_alloc) {
+      op.size = (rng() % 16 == 0) ? (rng() % 64 + 1) << 20 : (rng() % 256 + 1) << 10;
+      live++;
+    } else {
+      op.index = rng() % live;
+      live--;
+    }
+    trace.push_back(op);
+  }
+  return trace;
+}
+
+static double now_us() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+template <typename POOL, typename ALLOC, typename FREE>
+static double run_trace(const vector<pool_op> &trace, POOL *pool, ALLOC alloc_fn, FREE free_fn,
+                        vector<pool_addr_t> &addr_log, vector<pool_addr_t> &live) {
+  double start = now_us();
+  for (size_t i = 0; i < trace.size(); i++) {
+    const pool_op &op = trace[i];
+    if (op.is_alloc) {
+      pool_addr_t addr = alloc_fn(pool, op.size);
+      addr_log.push_back(addr);
+      live.push_back(addr);
+    } else {
+      free_fn(pool, live[op.index]);
+      live[op.index] = live.back();
+      live.pop_back();
+    }
+  }
+  return now_us() - start;
+}
+
+int main(int argc, char *argv[]) {
+  int op_num = argc > 1 ? atoi(argv[1]) : 200000;
+  int max_live = argc > 2 ? atoi(argv[2]) : 4000;
+  unsigned seed = argc > 3 ? atoi(argv[3]) : 1;
+  pool_size_t total_size = 1ull << 40;  // only bookkeeping, nothing is allocated
+  if (op_num <= 0 || max_live <= 0) {
+    printf("usage: %s [op_num] [max_live] [seed]\n", argv[0]);
+    return -1;
+  }
+
+  vector<pool_op> trace = build_trace(op_num, max_live, seed);
+  vector<pool_addr_t> mm_addr, linear_addr, live;
+  bm_mem_pool_stat_t stat, stat_end;
+  double mm_us, linear_us;
+  {
+    bm_mem_pool pool(total_size);
+    mm_us = run_trace(trace, &pool,
+        [](bm_mem_pool *p, pool_size_t size) { return p->bm_mem_pool_alloc(size); },
+        [](bm_mem_pool *p, pool_addr_t addr) { p->bm_mem_pool_free(addr); },
+        mm_addr, live);
+    pool.bm_mem_pool_get_stat(&stat);
+    for (size_t i = 0; i < live.size(); i++)
+      pool.bm_mem_pool_free(live[i]);
+    pool.bm_mem_pool_get_stat(&stat_end);
+  }
+  {
+    linear_pool pool(total_size);
+    live.clear();
+    linear_us = run_trace(trace, &pool,
+        [](linear_pool *p, pool_size_t size) { return p->alloc(size); },
+        [](linear_pool *p, pool_addr_t addr) { p->free(addr); },
+        linear_addr, live);
+  }
+
+  printf("ops=%d, max live buffers=%d, seed=%u\n", op_num, max_live, seed);
+  printf("linear best fit : %8.3f us/op\n", linear_us / op_num);
+  printf("bm_mem_pool     : %8.3f us/op\n", mm_us / op_num);
+  printf("speedup         : %8.2fx\n", mm_us > 0 ? linear_us / mm_us : 0.0);
+  printf("at the end of the trace: %d buffers, %d free slots, in use 0x%llx, peak 0x%llx, fragmentation %.3f\n",
+         stat.num_slots_in_use, stat.num_slots_avail, stat.mem_in_use, stat.peak_mem_in_use,
+         stat.fragmentation);
+  if (mm_addr != linear_addr) {
+    size_t i = 0;
+    while (mm_addr[i] == linear_addr[i]) i++;
+    printf("mismatch at alloc %zu: 0x%llx vs 0x%llx\n", i, mm_addr[i], linear_addr[i]);
+    return -1;
+  }
+  if (stat_end.mem_in_use != 0 || stat_end.num_slots_avail != 1 || stat_end.fragmentation != 0 ||
+      stat_end.alloc_count != stat_end.free_count) {
+    printf("pool is not whole after all buffers are freed\n");
+    return -1;
+  }
+  return 0;
+}
@@ -396,6 +396,55 @@ DECL_EXPORT bm_status_t bm_image_get_contiguous_device_mem(int              imag
                                                bm_image *       images,
                                                bm_device_mem_t *mem);
 
+/** bm_image_pool
+ * @brief Keeps released images attached to their device memory and hands
+ * them out again for the same width, height, format, data type and heap
+ * mask, so a per frame create / alloc / destroy loop stops going to the
+ * device allocator. At most max_idle released images are kept, the least
+ * recently released ones are freed first. An acquired image has the default
+ * stride and stale content, and must be given back with
+ * bm_image_pool_release while still attached to the memory it came with.
+ * allocator may be NULL for bm_malloc_device_byte_heap_mask / bm_free_device,
+ * tests can pass a host memory stand-in.
+ */
+typedef struct bm_image_pool *bm_image_pool_t;
+
+typedef struct {
+    bm_status_t (*alloc)(void *ctx, bm_handle_t handle, int heap_mask,
+                         unsigned int size, bm_device_mem_t *mem);
+    void        (*free)(void *ctx, bm_handle_t handle, bm_device_mem_t mem);
+    void        *ctx;
+} bm_image_pool_allocator_t;
+
+typedef struct {
+    unsigned long long acquire_num;     // bm_image_pool_acquire calls
+    unsigned long long hit_num;         // of them served from released images
+    unsigned long long release_num;
+    unsigned long long trim_num;        // released images freed to stay in bound
+    int                in_use_num;
+    int                idle_num;
+    int                peak_in_use_num;
+    unsigned long long idle_bytes;
+    unsigned long long total_bytes;     // device memory held, in use and idle
+    unsigned long long peak_bytes;
+} bm_image_pool_stat_t;
+
+DECL_EXPORT bm_status_t bm_image_pool_create(bm_handle_t                      handle,
+                                             int                              max_idle,
+                                             const bm_image_pool_allocator_t *allocator,
+                                             bm_image_pool_t *                pool);
+DECL_EXPORT bm_status_t bm_image_pool_destroy(bm_image_pool_t pool);
+DECL_EXPORT bm_status_t bm_image_pool_acquire(bm_image_pool_t          pool,
+                                              int                      img_h,
+                                              int                      img_w,
+                                              bm_image_format_ext      image_format,
+                                              bm_image_data_format_ext data_type,
+                                              int                      heap_mask,
+                                              bm_image *               image);
+DECL_EXPORT bm_status_t bm_image_pool_release(bm_image_pool_t pool, bm_image image);
+DECL_EXPORT bm_status_t bm_image_pool_trim(bm_image_pool_t pool, int max_idle);
+DECL_EXPORT bm_status_t bm_image_pool_get_stat(bm_image_pool_t pool, bm_image_pool_stat_t *stat);
+
 DECL_EXPORT bm_status_t bmcv_image_yuv2bgr_ext(bm_handle_t handle,
                                    int         image_num,
                                    bm_image *  input,
@@ -1272,6 +1321,16 @@ DECL_EXPORT bm_status_t bmcv_image_put_text(
         float fontScale,
         int thickness);
 
+DECL_EXPORT bm_status_t bmcv_image_put_text_batch(
+        bm_handle_t handle,
+        bm_image image,
+        const char* const* texts,
+        const bmcv_point_t* orgs,
+        int text_num,
+        bmcv_color_t color,
+        float fontScale,
+        int thickness);
+
 DECL_EXPORT bm_device_mem_t bmcv_get_structuring_element(
         bm_handle_t handle,
         bmcv_morph_shape_t shape,
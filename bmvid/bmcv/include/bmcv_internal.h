@@ -560,6 +560,40 @@ bm_status_t bmcv_base64_codec(bm_handle_t     handle,
                     bool            direction
                     );
 
+bool bmcv_faiss_use_cpu(bm_handle_t handle, const bm_device_mem_t *mems, int mem_num,
+                        long long in_bytes, long long work);
+bm_status_t bmcv_faiss_indexflat_cpu(bm_handle_t handle,
+                    bm_device_mem_t input_data_global_addr,
+                    bm_device_mem_t db_data_global_addr,
+                    const bm_device_mem_t *query_L2norm_global_addr,
+                    const bm_device_mem_t *db_L2norm_global_addr,
+                    bm_device_mem_t output_sorted_similarity_global_addr,
+                    bm_device_mem_t output_sorted_index_global_addr,
+                    int vec_dims, int query_vecs_num, int database_vecs_num,
+                    int sort_cnt, int is_transpose, int input_dtype, int output_dtype);
+bm_status_t bmcv_faiss_indexPQ_ADC_cpu(bm_handle_t handle,
+                    bm_device_mem_t centroids_input_dev,
+                    bm_device_mem_t nxquery_input_dev,
+                    bm_device_mem_t nycodes_input_dev,
+                    bm_device_mem_t distance_output_dev,
+                    bm_device_mem_t index_output_dev,
+                    int vec_dims, int slice_num, int centroids_num, int database_num,
+                    int query_num, int sort_cnt, int IP_metric, int in_dtype, int out_dtype);
+bm_status_t bmcv_faiss_indexPQ_SDC_cpu(bm_handle_t handle,
+                    bm_device_mem_t sdc_table_input_dev,
+                    bm_device_mem_t nxcodes_input_dev,
+                    bm_device_mem_t nycodes_input_dev,
+                    bm_device_mem_t distance_output_dev,
+                    bm_device_mem_t index_output_dev,
+                    int slice_num, int centroids_num, int database_num,
+                    int query_num, int sort_cnt, int IP_metric, int in_dtype, int out_dtype);
+bm_status_t bmcv_faiss_indexPQ_encode_cpu(bm_handle_t handle,
+                    bm_device_mem_t vector_input_dev,
+                    bm_device_mem_t centroids_input_dev,
+                    bm_device_mem_t nvcodes_output_dev,
+                    int encode_vec_num, int vec_dims, int slice_num,
+                    int centroids_num, int IP_metric, int input_dtype);
+
 layout::plane_layout* bm_image_get_layout(bm_image input_image, int plane_idx);
 void data_type_conversion(bm_image_data_format_ext bmcv_data_type, int *tpu_data_type);
 
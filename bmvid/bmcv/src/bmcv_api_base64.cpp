@@ -3,6 +3,8 @@
 #include <sys/types.h> // windows is same
 #include <fcntl.h>
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
 #include "bmcv_api_ext.h"
 #include "bmcv_api.h"
 #include "bmcv_internal.h"
@@ -17,10 +19,18 @@
   #include <windows.h>
 #endif
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define BASE64_AVX2 1
+  #include <immintrin.h>
+#elif defined(__aarch64__)
+  #define BASE64_NEON 1
+  #include <arm_neon.h>
+#endif
+
 #define S2D 0
 #define D2S 1
-#define MAX_LEN 178956972  //128M/3*4
-#define MAX_LOOP_LEN 3145728 //3M
+#define MAX_LOOP_LEN 3145728 //3M, a multiple of 12 so chunks need no padding
+#define HOST_MAX_DEVICE_LEN 16384 //device to device below this is done on host
 #define BASE64_ENC 1
 #define BASE64_DEC 0
 
@@ -55,7 +65,306 @@ static unsigned long int base64_compute_dstlen(unsigned long int len, bool enc)
 
 #ifndef USING_CMODEL
 
+/*
+ * host codec. When either buffer is in system memory the engine path has to
+ * bring the data over to the device and back anyway, for the small payloads
+ * this is used for (json results, thumbnails) that costs more than the
+ * encoding. Both buffers in device memory go to the engine unless len is
+ * below HOST_MAX_DEVICE_LEN, where the ioctl costs more than the two copies,
+ * and BMCV_BASE64_ENGINE=1 sends everything there.
+ */
+static const unsigned char base64_enc_table[65] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+struct base64_dec_table_t {
+    unsigned char t[256];   // 0xff for characters outside the alphabet
+    base64_dec_table_t() {
+        memset(t, 0xff, sizeof(t));
+        for (int i = 0; i < 64; i++)
+            t[base64_enc_table[i]] = (unsigned char)i;
+    }
+};
+static const base64_dec_table_t base64_dec_table;
+
+static void base64_enc_scalar(const unsigned char *s, unsigned long len, unsigned char *d) {
+    unsigned long i = 0;
+    for (; i + 3 <= len; i += 3, d += 4) {
+        unsigned int v = (s[i] << 16) | (s[i + 1] << 8) | s[i + 2];
+        d[0] = base64_enc_table[v >> 18];
+        d[1] = base64_enc_table[(v >> 12) & 0x3f];
+        d[2] = base64_enc_table[(v >> 6) & 0x3f];
+        d[3] = base64_enc_table[v & 0x3f];
+    }
+    if (i < len) {
+        unsigned int v = s[i] << 16;
+        if (i + 1 < len)
+            v |= s[i + 1] << 8;
+        d[0] = base64_enc_table[v >> 18];
+        d[1] = base64_enc_table[(v >> 12) & 0x3f];
+        d[2] = i + 1 < len ? base64_enc_table[(v >> 6) & 0x3f] : '=';
+        d[3] = '=';
+    }
+}
+
+/* returns the bytes written, or -1 on a character outside the alphabet.
+ * '=' is only taken in the last quartet of the last chunk. */
+static long base64_dec_scalar(const unsigned char *s, unsigned long len,
+                              unsigned char *d, bool last) {
+    const unsigned char *t = base64_dec_table.t;
+    unsigned char *d0 = d;
+    unsigned long quads = len / 4;
+    for (unsigned long q = 0; q < quads; q++, s += 4) {
+        unsigned int a = t[s[0]], b = t[s[1]], c = t[s[2]], e = t[s[3]];
+        if ((a | b | c | e) < 64) {
+            unsigned int v = (a << 18) | (b << 12) | (c << 6) | e;
+            d[0] = v >> 16;
+            d[1] = (v >> 8) & 0xff;
+            d[2] = v & 0xff;
+            d += 3;
+            continue;
+        }
+        if (!last || q != quads - 1 || (a | b) >= 64 || s[3] != '=' ||
+            (c >= 64 && s[2] != '='))
+            return -1;
+        d[0] = (a << 2) | (b >> 4);
+        d += 1;
+        if (c < 64) {
+            d[0] = ((b & 0xf) << 4) | (c >> 2);
+            d += 1;
+        }
+    }
+    return d - d0;
+}
+
+#ifdef BASE64_AVX2
+/* 24 bytes to 32 characters per step, each lane takes 12 bytes */
+__attribute__((target("avx2")))
+static unsigned long base64_enc_avx2(const unsigned char *s, unsigned long len, unsigned char *d) {
+    const __m256i shuf = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                          1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i shift_lut = _mm256_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    unsigned long i = 0;
+    // the upper lane loads 16 bytes from i + 12
+    for (; i + 28 <= len; i += 24, d += 32) {
+        __m256i in = _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm_loadu_si128((const __m128i *)(s + i))),
+            _mm_loadu_si128((const __m128i *)(s + i + 12)), 1);
+        in = _mm256_shuffle_epi8(in, shuf);
+        __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0fc0fc00)),
+                                        _mm256_set1_epi32(0x04000040));
+        __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003f03f0)),
+                                        _mm256_set1_epi32(0x01000010));
+        __m256i idx = _mm256_or_si256(t0, t1);
+        __m256i r = _mm256_subs_epu8(idx, _mm256_set1_epi8(51));
+        __m256i less = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), idx);
+        r = _mm256_or_si256(r, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+        r = _mm256_add_epi8(_mm256_shuffle_epi8(shift_lut, r), idx);
+        _mm256_storeu_si256((__m256i *)d, r);
+    }
+    return i;
+}
+
+/* 32 characters to 24 bytes per step, stops at the first block holding a
+ * character outside the alphabet ('=' included) and leaves it to the
+ * scalar loop. Returns the characters consumed. */
+__attribute__((target("avx2")))
+static unsigned long base64_dec_avx2(const unsigned char *s, unsigned long len, unsigned char *d) {
+    const __m256i lut_lo = _mm256_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a,
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m256i lut_hi = _mm256_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+    const __m256i pack = _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                          2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, -1, -1);
+    unsigned long i = 0;
+    // the store writes 32 bytes for 24, the 16 characters kept back make room
+    for (; i + 48 <= len; i += 32, d += 24) {
+        __m256i in = _mm256_loadu_si256((const __m256i *)(s + i));
+        __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(in, 4), mask_2f);
+        __m256i lo = _mm256_shuffle_epi8(lut_lo, _mm256_and_si256(in, mask_2f));
+        __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        if (!_mm256_testz_si256(lo, hi))
+            break;
+        __m256i eq_2f = _mm256_cmpeq_epi8(in, mask_2f);
+        __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+        in = _mm256_add_epi8(in, roll);
+        __m256i merged = _mm256_maddubs_epi16(in, _mm256_set1_epi32(0x01400140));
+        merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        merged = _mm256_shuffle_epi8(merged, pack);
+        merged = _mm256_permutevar8x32_epi32(merged, lanes);
+        _mm256_storeu_si256((__m256i *)d, merged);
+    }
+    return i;
+}
+
+static bool base64_has_avx2() {
+    static const bool has = __builtin_cpu_supports("avx2");
+    return has;
+}
+#endif
+
+#ifdef BASE64_NEON
+static inline uint8x16x4_t base64_load_table(const unsigned char *p) {
+    uint8x16x4_t table;
+    for (int k = 0; k < 4; k++)
+        table.val[k] = vld1q_u8(p + 16 * k);
+    return table;
+}
+
+/* 48 bytes to 64 characters per step */
+static unsigned long base64_enc_neon(const unsigned char *s, unsigned long len, unsigned char *d) {
+    uint8x16x4_t table = base64_load_table(base64_enc_table);
+    const uint8x16_t mask = vdupq_n_u8(0x3f);
+    unsigned long i = 0;
+    for (; i + 48 <= len; i += 48, d += 64) {
+        uint8x16x3_t in = vld3q_u8(s + i);
+        uint8x16x4_t out;
+        out.val[0] = vshrq_n_u8(in.val[0], 2);
+        out.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(in.val[0], 4), vshrq_n_u8(in.val[1], 4)), mask);
+        out.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(in.val[1], 2), vshrq_n_u8(in.val[2], 6)), mask);
+        out.val[3] = vandq_u8(in.val[2], mask);
+        for (int k = 0; k < 4; k++)
+            out.val[k] = vqtbl4q_u8(table, out.val[k]);
+        vst4q_u8(d, out);
+    }
+    return i;
+}
 
+/* 64 characters to 48 bytes per step, stops like base64_dec_avx2 */
+static unsigned long base64_dec_neon(const unsigned char *s, unsigned long len, unsigned char *d) {
+    uint8x16x4_t table_lo = base64_load_table(base64_dec_table.t);
+    uint8x16x4_t table_hi = base64_load_table(base64_dec_table.t + 64);
+    unsigned long i = 0;
+    for (; i + 64 <= len; i += 64, d += 48) {
+        uint8x16x4_t in = vld4q_u8(s + i);
+        uint8x16_t bad = vdupq_n_u8(0);
+        for (int k = 0; k < 4; k++) {
+            // out of range indices look up 0, characters >= 128 are marked here
+            uint8x16_t c = in.val[k];
+            in.val[k] = vorrq_u8(vqtbl4q_u8(table_lo, c),
+                                 vqtbl4q_u8(table_hi, veorq_u8(c, vdupq_n_u8(0x40))));
+            in.val[k] = vorrq_u8(in.val[k], vcgeq_u8(c, vdupq_n_u8(0x80)));
+            bad = vorrq_u8(bad, in.val[k]);
+        }
+        if (vmaxvq_u8(bad) >= 64)
+            break;
+        uint8x16x3_t out;
+        out.val[0] = vorrq_u8(vshlq_n_u8(in.val[0], 2), vshrq_n_u8(in.val[1], 4));
+        out.val[1] = vorrq_u8(vshlq_n_u8(in.val[1], 4), vshrq_n_u8(in.val[2], 2));
+        out.val[2] = vorrq_u8(vshlq_n_u8(in.val[2], 6), in.val[3]);
+        vst3q_u8(d, out);
+    }
+    return i;
+}
+#endif
+
+static void base64_enc_host(const unsigned char *s, unsigned long len, unsigned char *d) {
+    unsigned long i = 0;
+#if defined(BASE64_AVX2)
+    if (base64_has_avx2())
+        i = base64_enc_avx2(s, len, d);
+#elif defined(BASE64_NEON)
+    i = base64_enc_neon(s, len, d);
+#endif
+    base64_enc_scalar(s + i, len - i, d + i / 3 * 4);
+}
+
+static long base64_dec_host(const unsigned char *s, unsigned long len, unsigned char *d, bool last) {
+    unsigned long i = 0;
+#if defined(BASE64_AVX2)
+    if (base64_has_avx2())
+        i = base64_dec_avx2(s, len, d);
+#elif defined(BASE64_NEON)
+    i = base64_dec_neon(s, len, d);
+#endif
+    long tail = base64_dec_scalar(s + i, len - i, d + i / 4 * 3, last);
+    return tail < 0 ? -1 : (long)(i / 4 * 3) + tail;
+}
+
+/* system memory is used in place, device memory goes through a staging
+ * buffer one MAX_LOOP_LEN chunk at a time */
+static bm_status_t base64_host_codec(bm_handle_t handle, bm_device_mem_t src,
+    bm_device_mem_t dst, unsigned long len, bool direction) {
+    bool src_sys = bm_mem_get_type(src) == BM_MEM_TYPE_SYSTEM;
+    bool dst_sys = bm_mem_get_type(dst) == BM_MEM_TYPE_SYSTEM;
+    unsigned char *src_addr = (unsigned char *)bm_mem_get_system_addr(src);
+    unsigned char *dst_addr = (unsigned char *)bm_mem_get_system_addr(dst);
+    unsigned long chunk = (src_sys && dst_sys) ? len : MAX_LOOP_LEN;
+    unsigned char *src_buf = NULL;
+    unsigned char *dst_buf = NULL;
+    bm_status_t ret = BM_SUCCESS;
+
+    if (!direction && len % 4 != 0) {
+        bmlib_log("BASE64", BMLIB_LOG_ERROR, "decode len %lu is not a multiple of 4!\r\n", len);
+        return BM_ERR_PARAM;
+    }
+    if (!src_sys && (src_buf = (unsigned char *)malloc(chunk)) == NULL) {
+        return BM_ERR_NOMEM;
+    }
+    if (!dst_sys &&
+        (dst_buf = (unsigned char *)malloc(base64_compute_dstlen(chunk, direction))) == NULL) {
+        free(src_buf);
+        return BM_ERR_NOMEM;
+    }
+    unsigned long src_off = 0;
+    unsigned long dst_off = 0;
+    while (src_off < len) {
+        unsigned long loop_len = (std::min)(chunk, len - src_off);
+        unsigned long out_len;
+        unsigned char *in = src_sys ? src_addr + src_off : src_buf;
+        unsigned char *out = dst_sys ? dst_addr + dst_off : dst_buf;
+        if (!src_sys && BM_SUCCESS != bm_memcpy_d2s_partial_offset(
+                handle, in, src, loop_len, src_off)) {
+            BMCV_ERR_LOG("bm_memcpy_d2s_partial_offset error\r\n");
+            ret = BM_ERR_FAILURE;
+            break;
+        }
+        if (direction) {
+            base64_enc_host(in, loop_len, out);
+            out_len = base64_compute_dstlen(loop_len, direction);
+        } else {
+            long n = base64_dec_host(in, loop_len, out, src_off + loop_len == len);
+            if (n < 0) {
+                bmlib_log("BASE64", BMLIB_LOG_ERROR, "invalid base64 input!\r\n");
+                ret = BM_ERR_DATA;
+                break;
+            }
+            out_len = (unsigned long)n;
+        }
+        if (!dst_sys && out_len > 0 && BM_SUCCESS != bm_memcpy_s2d_partial_offset(
+                handle, dst, out, out_len, dst_off)) {
+            BMCV_ERR_LOG("bm_memcpy_s2d_partial_offset error\r\n");
+            ret = BM_ERR_FAILURE;
+            break;
+        }
+        src_off += loop_len;
+        dst_off += out_len;
+    }
+    free(src_buf);
+    free(dst_buf);
+    return ret;
+}
+
+static bm_status_t base64_engine_codec(bm_handle_t handle, bm_device_mem_t src,
+    bm_device_mem_t dst, unsigned long len, bool direction);
+
+static bool base64_use_engine(bm_device_mem_t src, bm_device_mem_t dst, unsigned long len) {
+    char *engine = getenv("BMCV_BASE64_ENGINE");
+    if (engine != NULL && atoi(engine) == 1)
+        return true;
+    return bm_mem_get_type(src) == BM_MEM_TYPE_DEVICE &&
+           bm_mem_get_type(dst) == BM_MEM_TYPE_DEVICE && len >= HOST_MAX_DEVICE_LEN;
+}
 
 bm_status_t bmcv_base64_enc(bm_handle_t handle, bm_device_mem_t src,
     bm_device_mem_t dst, unsigned long len[2])
@@ -103,10 +412,21 @@ bm_status_t bmcv_base64_dec(bm_handle_t handle, bm_device_mem_t src,
 bm_status_t bmcv_base64_codec(bm_handle_t handle, bm_device_mem_t src,
     bm_device_mem_t dst, unsigned long len, bool direction) {
 
-    if (handle == NULL) {
+    bool on_host = !base64_use_engine(src, dst, len);
+    if (handle == NULL && !(on_host && bm_mem_get_type(src) == BM_MEM_TYPE_SYSTEM &&
+                            bm_mem_get_type(dst) == BM_MEM_TYPE_SYSTEM)) {
         bmlib_log("BASE64", BMLIB_LOG_ERROR, "Can not get handle!\r\n");
         return BM_ERR_DEVNOTREADY;
     }
+    if (on_host)
+        return base64_host_codec(handle, src, dst, len, direction);
+    return base64_engine_codec(handle, src, dst, len, direction);
+}
+
+/* len is cut into MAX_LOOP_LEN chunks, system memory is staged through
+ * device memory and device memory is used at an offset */
+static bm_status_t base64_engine_codec(bm_handle_t handle, bm_device_mem_t src,
+    bm_device_mem_t dst, unsigned long len, bool direction) {
     struct ce_base base;
     int fd;
     int ret;
@@ -133,20 +453,14 @@ bm_status_t bmcv_base64_codec(bm_handle_t handle, bm_device_mem_t src,
         return BM_ERR_DEVNOTREADY;
     }
 
-    if (len > MAX_LEN) {
-        printf("base64 lenth should be less than 128M!\n");
-        return BM_ERR_PARAM;
-    }
-
     if (bm_mem_get_type(src) == BM_MEM_TYPE_SYSTEM)
         src_addr = (unsigned long long)bm_mem_get_system_addr(src);
+    else
+        src_addr = bm_mem_get_device_addr(src);
     if (bm_mem_get_type(dst) == BM_MEM_TYPE_SYSTEM)
         dst_addr = (unsigned long long)bm_mem_get_system_addr(dst);
-    if ((bm_mem_get_type(src) == BM_MEM_TYPE_DEVICE) &&
-        len > MAX_LOOP_LEN) {
-        printf("len of device_mem should be less than 3M!\n");
-        return BM_ERR_PARAM;
-    }
+    else
+        dst_addr = bm_mem_get_device_addr(dst);
 
     while (len > 0) {
         if (len > MAX_LOOP_LEN) {
@@ -178,7 +492,7 @@ bm_status_t bmcv_base64_codec(bm_handle_t handle, bm_device_mem_t src,
 
             }
         } else {
-            src_buf_device = src;
+            src_buf_device = bm_mem_from_device(src_addr, loop_len);
         }
         if (bm_mem_get_type(dst) == BM_MEM_TYPE_SYSTEM) {
             if(BM_SUCCESS !=bm_malloc_device_byte(
@@ -206,7 +520,8 @@ bm_status_t bmcv_base64_codec(bm_handle_t handle, bm_device_mem_t src,
 
             }*/
         } else {
-            dst_buf_device = dst;
+            dst_buf_device = bm_mem_from_device(
+                dst_addr, base64_compute_dstlen(loop_len, direction));
         }
 
 #ifndef SOC_MODE
@@ -1,5 +1,8 @@
 #include <memory>
 #include <vector>
+#include <list>
+#include <mutex>
+#include <algorithm>
 #include <iostream>
 #ifdef __linux__
   #include <sys/time.h>
@@ -7,6 +10,7 @@
   #include <time.h>
 #endif
 #include <float.h>
+#include <limits.h>
 #include <stdio.h>
 #include <math.h>
 #include "bmcv_api_ext.h"
@@ -487,6 +491,114 @@ void poly_line(
     }
 }
 
+/* The glyph strings of one font at one scale, parsed into polylines that are
+ * already scaled and relative to the pen, so a string only offsets them. */
+#define PUT_TEXT_FACE_CACHE_NUM 8
+
+typedef struct {
+    int left;                           // the pen moves back by this before the glyph
+    int advance;                        // and forward by this after it
+    int top;                            // y range of the strokes, top > bottom
+    int bottom;                         // when the glyph has none
+    std::vector<bmcv_point_t> points;
+    std::vector<int> stroke_end;        // end of each polyline in points
+} bmHersheyGlyph;
+
+typedef struct {
+    int font_face;
+    int scale;
+    int base_line;
+    std::vector<bmHersheyGlyph> glyphs; // indexed by c - ' '
+} bmHersheyFace;
+
+static std::mutex face_cache_lock;
+static std::list<std::shared_ptr<const bmHersheyFace>> face_cache;
+
+static std::shared_ptr<const bmHersheyFace> build_face(int fontFace, int scale) {
+    const int* ascii = get_font_data(fontFace);
+    if (ascii == NULL) {
+        return nullptr;
+    }
+    // read_check only lets the cyrillic range through for FONT_HERSHEY_COMPLEX
+    int glyph_num = (fontFace == FONT_HERSHEY_COMPLEX ? 191 : 127) - ' ';
+    std::shared_ptr<bmHersheyFace> face = std::make_shared<bmHersheyFace>();
+    face->font_face = fontFace;
+    face->scale = scale;
+    face->base_line = -(ascii[0] & 15);
+    face->glyphs.resize(glyph_num);
+    for (int k = 0; k < glyph_num; k++) {
+        bmHersheyGlyph& g = face->glyphs[k];
+        const char* ptr = g_HersheyGlyphs[ascii[k + 1]];
+        g.left = ((unsigned char)ptr[0] - 'R') * scale;
+        g.advance = ((unsigned char)ptr[1] - 'R') * scale;
+        g.top = INT_MAX;
+        g.bottom = INT_MIN;
+        size_t stroke_begin = 0;
+        for (ptr += 2;; ) {
+            if (*ptr == ' ' || !*ptr) {
+                // a single point draws nothing
+                if (g.points.size() - stroke_begin > 1) {
+                    g.stroke_end.push_back(g.points.size());
+                } else {
+                    g.points.resize(stroke_begin);
+                }
+                if (!*ptr++)
+                    break;
+                stroke_begin = g.points.size();
+            } else {
+                bmcv_point_t p = {((unsigned char)ptr[0] - 'R') * scale,
+                                  ((unsigned char)ptr[1] - 'R') * scale};
+                ptr += 2;
+                g.points.push_back(p);
+            }
+        }
+        for (size_t i = 0; i < g.points.size(); i++) {
+            g.top = (std::min)(g.top, g.points[i].y);
+            g.bottom = (std::max)(g.bottom, g.points[i].y);
+        }
+    }
+    return face;
+}
+
+static std::shared_ptr<const bmHersheyFace> get_face(int fontFace, int scale) {
+    std::lock_guard<std::mutex> lock(face_cache_lock);
+    for (auto it = face_cache.begin(); it != face_cache.end(); it++) {
+        if ((*it)->font_face == fontFace && (*it)->scale == scale) {
+            face_cache.splice(face_cache.begin(), face_cache, it);
+            return face_cache.front();
+        }
+    }
+    std::shared_ptr<const bmHersheyFace> face = build_face(fontFace, scale);
+    if (face == nullptr) {
+        return nullptr;
+    }
+    face_cache.push_front(face);
+    if (face_cache.size() > PUT_TEXT_FACE_CACHE_NUM) {
+        face_cache.pop_back();
+    }
+    return face;
+}
+
+/* f(glyph, pen x, pen y) for every character of text, positions in XY_SHIFT fixed point */
+template <typename F>
+static void for_each_glyph(
+        const bmHersheyFace& face,
+        const char* text,
+        bmcv_point_t org,
+        F f) {
+    int view_x = org.x << XY_SHIFT;
+    int view_y = (org.y << XY_SHIFT) + face.base_line * face.scale;
+    int len = (int)strlen(text);
+    for (int i = 0; i < len; i++) {
+        int c = (unsigned char)text[i];
+        read_check(c, i, text, face.font_face);
+        const bmHersheyGlyph& g = face.glyphs[c - ' '];
+        view_x -= g.left;
+        f(g, view_x, view_y);
+        view_x += g.advance;
+    }
+}
+
 void put_text(
         bmMat mat,
         const char* text,
@@ -498,49 +610,122 @@ void put_text(
     if (text == NULL) {
         return;
     }
-    const int* ascii = get_font_data(fontFace);
-
-    int base_line = -(ascii[0] & 15);
-    int hscale = round(fontScale * XY_ONE), vscale = hscale;
-
-    int view_x = org.x << XY_SHIFT;
-    int view_y = (org.y << XY_SHIFT) + base_line * vscale;
+    std::shared_ptr<const bmHersheyFace> face = get_face(fontFace, round(fontScale * XY_ONE));
+    if (face == nullptr) {
+        return;
+    }
     std::vector<bmcv_point_t> pts;
     pts.reserve(1 << 10);
-    const char **faces = g_HersheyGlyphs;
+    for_each_glyph(*face, text, org, [&](const bmHersheyGlyph& g, int x, int y) {
+        int begin = 0;
+        for (size_t s = 0; s < g.stroke_end.size(); s++) {
+            int end = g.stroke_end[s];
+            pts.resize(end - begin);
+            for (int i = begin; i < end; i++) {
+                pts[i - begin].x = g.points[i].x + x;
+                pts[i - begin].y = g.points[i].y + y;
+            }
+            poly_line(mat, &pts[0], (int)pts.size(), false, color, thickness);
+            begin = end;
+        }
+    });
+    return;
+}
 
-    for(int i = 0; i < (int)strlen(text); i++) {
-        int c = (unsigned char)text[i];
-        bmcv_point_t p;
-        read_check(c, i, text, fontFace);
+/* Luma rows [y0, y1) that drawing text can touch, empty when it has no
+ * strokes. Lines reach at most thickness / 2 + 1 rows past their end
+ * points, the rest of the margin covers rounding in put_line. */
+static void get_text_rows(
+        const bmHersheyFace& face,
+        const char* text,
+        bmcv_point_t org,
+        int thickness,
+        int height,
+        int& y0,
+        int& y1) {
+    int top = INT_MAX, bottom = INT_MIN;
+    for_each_glyph(face, text, org, [&](const bmHersheyGlyph& g, int, int y) {
+        if (g.top <= g.bottom) {
+            top = (std::min)(top, g.top + y);
+            bottom = (std::max)(bottom, g.bottom + y);
+        }
+    });
+    if (top > bottom) {
+        y0 = y1 = 0;
+        return;
+    }
+    // put_line clips the points to the image the same way
+    top = SATURATE(top, 0, (height - 1) << XY_SHIFT);
+    bottom = SATURATE(bottom, 0, (height - 1) << XY_SHIFT);
+    int margin = thickness + 2;
+    y0 = (std::max)(0, (top >> XY_SHIFT) - margin);
+    y1 = (std::min)(height, (bottom >> XY_SHIFT) + margin + 1);
+    // keep whole 4:2:0 chroma rows
+    y0 &= ~1;
+    y1 = (std::min)(height, (y1 + 1) & ~1);
+}
 
-        const char* ptr = faces[ascii[(c-' ')+1]];
-        p.x = (unsigned char)ptr[0] - 'R';
-        p.y = (unsigned char)ptr[1] - 'R';
-        int dx = p.y * hscale;
-        view_x -= p.x * hscale;
-        pts.resize(0);
+static bool is_chroma_half_height(bm_image_format_ext format) {
+    return format == FORMAT_YUV420P || format == FORMAT_NV12 || format == FORMAT_NV21;
+}
 
-        for (ptr += 2;; ) {
-            if (*ptr == ' ' || !*ptr) {
-                if (pts.size() > 1 ) {
-                    poly_line(mat, &pts[0], (int)pts.size(), false, color, thickness);
-                }
-                if (!*ptr++)
-                    break;
-                pts.resize(0);
-            } else {
-                p.x = (unsigned char)ptr[0] - 'R';
-                p.y = (unsigned char)ptr[1] - 'R';
-                ptr += 2;
-                bmcv_point_t point = {p.x * hscale + view_x, p.y * vscale + view_y};
-                pts.push_back(point);
-            }
+/* Copy luma rows [y0, y1) and the chroma rows under them to host, draw the
+ * texts which all fall inside, and copy the rows back. */
+static bm_status_t put_text_rows(
+        bm_handle_t handle,
+        bm_image image,
+        int y0,
+        int y1,
+        const char* const* texts,
+        const bmcv_point_t* orgs,
+        const std::vector<int>& text_ids,
+        bmcv_color_t color,
+        float fontScale,
+        int thickness) {
+    int plane_num = bm_image_get_plane_num(image);
+    int str[3];
+    bm_image_get_stride(image, str);
+    bm_device_mem_t mem[3];
+    bm_image_get_device_mem(image, mem);
+    unsigned int offset[3], size[3], total = 0;
+    for (int i = 0; i < plane_num; i++) {
+        bool half = i > 0 && is_chroma_half_height(image.image_format);
+        int row_begin = half ? y0 / 2 : y0;
+        int row_end = half ? (y1 + 1) / 2 : y1;
+        offset[i] = (unsigned int)row_begin * str[i];
+        size[i] = (unsigned int)(row_end - row_begin) * str[i];
+        total += size[i];
+    }
+    std::vector<unsigned char> host_buf(total);
+    unsigned char* in_ptr[3] = {host_buf.data(), NULL, NULL};
+    for (int i = 1; i < plane_num; i++) {
+        in_ptr[i] = in_ptr[i - 1] + size[i - 1];
+    }
+    for (int i = 0; i < plane_num; i++) {
+        if (BM_SUCCESS != bm_memcpy_d2s_partial_offset(handle, in_ptr[i], mem[i], size[i], offset[i])) {
+            bmlib_log("PUT_TEXT", BMLIB_LOG_ERROR, "bm_memcpy_d2s_partial_offset error!\r\n");
+            return BM_ERR_FAILURE;
         }
-        view_x += dx;
     }
-    return;
+    bmMat mat;
+    mat.width = image.width;
+    mat.height = y1 - y0;
+    mat.format = image.image_format;
+    mat.step = &str[0];
+    mat.data = (void**)in_ptr;
+    for (size_t k = 0; k < text_ids.size(); k++) {
+        bmcv_point_t org = {orgs[text_ids[k]].x, orgs[text_ids[k]].y - y0};
+        put_text(mat, texts[text_ids[k]], org, FONT_HERSHEY_SIMPLEX, fontScale, color, thickness);
+    }
+    for (int i = 0; i < plane_num; i++) {
+        if (BM_SUCCESS != bm_memcpy_s2d_partial_offset(handle, mem[i], in_ptr[i], size[i], offset[i])) {
+            bmlib_log("PUT_TEXT", BMLIB_LOG_ERROR, "bm_memcpy_s2d_partial_offset error!\r\n");
+            return BM_ERR_FAILURE;
+        }
+    }
+    return BM_SUCCESS;
 }
+
 static bm_status_t bmcv_put_text_check(
         bm_handle_t handle,
         bm_image image,
@@ -560,11 +745,12 @@ static bm_status_t bmcv_put_text_check(
     return BM_SUCCESS;
 }
 
-bm_status_t bmcv_image_put_text(
+bm_status_t bmcv_image_put_text_batch(
         bm_handle_t handle,
         bm_image image,
-        const char* text,
-        bmcv_point_t org,
+        const char* const* texts,
+        const bmcv_point_t* orgs,
+        int text_num,
         bmcv_color_t color,
         float fontScale,
         int thickness) {
@@ -573,22 +759,54 @@ bm_status_t bmcv_image_put_text(
     if (BM_SUCCESS != bmcv_put_text_check(handle, image, thickness)) {
         return BM_ERR_FAILURE;
     }
-    int w = image.width;
-    int h = image.height;
-    unsigned char* host_buf = new unsigned char [w * h * 3];
-    unsigned char* in_ptr[3] = {host_buf, host_buf + w * h, host_buf + w * h * 2};
-    bm_image_copy_device_to_host(image, (void **)in_ptr);
-    int str[3];
-    bm_image_get_stride(image, str);
-    bmMat mat;
-    mat.width = image.width;
-    mat.height = image.height;
-    mat.format = image.image_format;
-    mat.step = &str[0];
-    mat.data = (void**)in_ptr;
-    put_text(mat, text, org, FONT_HERSHEY_SIMPLEX, fontScale, color, thickness);
-    bm_image_copy_host_to_device(image, (void **)in_ptr);
-    delete [] host_buf;
+    if (texts == NULL || orgs == NULL) {
+        bmlib_log("PUT_TEXT", BMLIB_LOG_ERROR, "texts or orgs is NULL!\r\n");
+        return BM_ERR_PARAM;
+    }
+    if (text_num < 0) {
+        bmlib_log("PUT_TEXT", BMLIB_LOG_ERROR, "text_num(%d) should not be negative!\r\n", text_num);
+        return BM_ERR_PARAM;
+    }
+    std::shared_ptr<const bmHersheyFace> face = get_face(FONT_HERSHEY_SIMPLEX, round(fontScale * XY_ONE));
+    // rows each text touches, texts sharing rows go in one round trip
+    std::vector<int> y0(text_num), y1(text_num), ids;
+    for (int i = 0; i < text_num; i++) {
+        y0[i] = y1[i] = 0;
+        if (texts[i] != NULL) {
+            get_text_rows(*face, texts[i], orgs[i], thickness, image.height, y0[i], y1[i]);
+        }
+        if (y0[i] < y1[i]) {
+            ids.push_back(i);
+        }
+    }
+    std::stable_sort(ids.begin(), ids.end(), [&](int a, int b) { return y0[a] < y0[b]; });
+    for (size_t k = 0; k < ids.size(); ) {
+        int band_begin = y0[ids[k]], band_end = y1[ids[k]];
+        size_t next = k + 1;
+        while (next < ids.size() && y0[ids[next]] <= band_end) {
+            band_end = (std::max)(band_end, y1[ids[next]]);
+            next++;
+        }
+        // overlapping texts draw in the order they were given
+        std::vector<int> band_ids(ids.begin() + k, ids.begin() + next);
+        std::sort(band_ids.begin(), band_ids.end());
+        bm_status_t ret = put_text_rows(handle, image, band_begin, band_end, texts, orgs, band_ids,
+                                        color, fontScale, thickness);
+        if (ret != BM_SUCCESS) {
+            return ret;
+        }
+        k = next;
+    }
     return BM_SUCCESS;
 }
 
+bm_status_t bmcv_image_put_text(
+        bm_handle_t handle,
+        bm_image image,
+        const char* text,
+        bmcv_point_t org,
+        bmcv_color_t color,
+        float fontScale,
+        int thickness) {
+    return bmcv_image_put_text_batch(handle, image, &text, &org, 1, color, fontScale, thickness);
+}
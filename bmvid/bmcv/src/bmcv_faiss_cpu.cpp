@@ -0,0 +1,651 @@
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <vector>
+#include "bmcv_api_ext.h"
+#include "bmcv_internal.h"
+#include "pcie_cpu/bmcv_worker_pool.h"
+
+/*
+ * Host backend of the faiss operators. Distances are computed a tile of
+ * database vectors at a time into a small buffer and every tile is pushed
+ * straight into a per query top-k heap, the [nq, ndb] distance matrix is
+ * never built. Work is split across threads by query block, and by
+ * database range as well when there are fewer query blocks than threads.
+ */
+
+#define FAISS_TILE        128       // database vectors per tile
+#define FAISS_QUERY_BLOCK 8         // queries sharing one packed tile
+#define FAISS_CPU_MAX_BYTES (1 << 20)
+#define FAISS_CPU_MAX_WORK  (1LL << 24)
+
+static int faiss_dtype_size(int dtype) {
+    switch (dtype) {
+        case DT_FP32:
+        case DT_INT32:
+        case DT_UINT32: return 4;
+        case DT_FP16:
+        case DT_BFP16:
+        case DT_INT16:
+        case DT_UINT16: return 2;
+        case DT_INT8:
+        case DT_UINT8:  return 1;
+        default:        return 0;
+    }
+}
+
+static inline float faiss_fp16_to_fp32(unsigned short h) {
+    unsigned int sign = (h & 0x8000u) << 16;
+    unsigned int exp = (h >> 10) & 0x1f;
+    unsigned int mant = h & 0x3ff;
+    unsigned int bits;
+    if (exp == 0x1f) {
+        bits = sign | 0x7f800000u | (mant << 13);
+    } else if (exp != 0) {
+        bits = sign | ((exp + 112) << 23) | (mant << 13);
+    } else if (mant == 0) {
+        bits = sign;
+    } else {
+        // subnormal, normalize the mantissa
+        exp = 113;
+        while ((mant & 0x400) == 0) {
+            mant <<= 1;
+            exp--;
+        }
+        bits = sign | (exp << 23) | ((mant & 0x3ff) << 13);
+    }
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+/* round to nearest even, overflow goes to inf */
+static inline unsigned short faiss_fp32_to_fp16(float f) {
+    unsigned int bits;
+    memcpy(&bits, &f, sizeof(bits));
+    unsigned int sign = (bits >> 16) & 0x8000u;
+    unsigned int abs = bits & 0x7fffffffu;
+    if (abs >= 0x7f800000u)
+        return sign | 0x7c00 | (abs > 0x7f800000u ? 0x200 : 0);
+    if (abs >= 0x477ff000u)
+        return sign | 0x7c00;
+    if (abs < 0x38800000u) {
+        // subnormal half, let the fp32 adder do the rounding
+        float magic;
+        unsigned int magic_bits = 0x3f000000u;   // 0.5
+        memcpy(&magic, &magic_bits, sizeof(magic));
+        float a;
+        memcpy(&a, &abs, sizeof(a));
+        a += magic;
+        memcpy(&abs, &a, sizeof(abs));
+        return sign | (unsigned short)(abs - magic_bits);
+    }
+    unsigned int odd = (abs >> 13) & 1;
+    abs += 0xc8000fffu + odd;   // rebias the exponent and round
+    return sign | (unsigned short)(abs >> 13);
+}
+
+static inline float faiss_load(const void *p, size_t i, int dtype) {
+    switch (dtype) {
+        case DT_FP16: return faiss_fp16_to_fp32(((const unsigned short *)p)[i]);
+        case DT_INT8: return ((const signed char *)p)[i];
+        default:      return ((const float *)p)[i];
+    }
+}
+
+/* a bm_device_mem_t seen from the host: system memory is used in place,
+ * device memory is copied in for inputs and out for outputs */
+class faiss_host_mem {
+public:
+    faiss_host_mem(bm_handle_t handle, bm_device_mem_t mem, size_t size)
+        : handle_(handle), mem_(mem), size_(size), ptr_(NULL) {}
+    bm_status_t fetch() {
+        if (bm_mem_get_type(mem_) == BM_MEM_TYPE_SYSTEM) {
+            ptr_ = bm_mem_get_system_addr(mem_);
+            return BM_SUCCESS;
+        }
+        buf_.resize(size_);
+        ptr_ = buf_.data();
+        if (size_ == 0)
+            return BM_SUCCESS;
+        return bm_memcpy_d2s_partial(handle_, ptr_, mem_, size_);
+    }
+    bm_status_t alloc() {
+        if (bm_mem_get_type(mem_) == BM_MEM_TYPE_SYSTEM) {
+            ptr_ = bm_mem_get_system_addr(mem_);
+        } else {
+            buf_.resize(size_);
+            ptr_ = buf_.data();
+        }
+        return BM_SUCCESS;
+    }
+    bm_status_t flush() {
+        if (bm_mem_get_type(mem_) == BM_MEM_TYPE_SYSTEM || size_ == 0)
+            return BM_SUCCESS;
+        return bm_memcpy_s2d_partial(handle_, mem_, ptr_, size_);
+    }
+    void *ptr() const { return ptr_; }
+
+private:
+    bm_handle_t handle_;
+    bm_device_mem_t mem_;
+    size_t size_;
+    void *ptr_;
+    std::vector<unsigned char> buf_;
+};
+
+/* the k best (value, index) pairs seen so far, the worst one on top.
+ * Ties go to the smaller index, so the result matches a stable sort. */
+class faiss_topk {
+public:
+    faiss_topk(int k, bool descending) : k_(k), descending_(descending) {
+        heap_.reserve(k);
+    }
+    inline void push(float v, int i) {
+        if ((int)heap_.size() < k_) {
+            heap_.push_back(std::make_pair(v, i));
+            std::push_heap(heap_.begin(), heap_.end(), worse_first(descending_));
+        } else if (better(v, i, heap_[0])) {
+            std::pop_heap(heap_.begin(), heap_.end(), worse_first(descending_));
+            heap_.back() = std::make_pair(v, i);
+            std::push_heap(heap_.begin(), heap_.end(), worse_first(descending_));
+        }
+    }
+    /* best first */
+    void sorted(std::vector<std::pair<float, int>> &out) {
+        out = heap_;
+        std::sort(out.begin(), out.end(), worse_first(descending_));
+    }
+
+private:
+    inline bool better(float v, int i, const std::pair<float, int> &b) const {
+        if (v != b.first)
+            return descending_ ? v > b.first : v < b.first;
+        return i < b.second;
+    }
+    struct worse_first {
+        bool descending;
+        explicit worse_first(bool d) : descending(d) {}
+        bool operator()(const std::pair<float, int> &a, const std::pair<float, int> &b) const {
+            if (a.first != b.first)
+                return descending ? a.first > b.first : a.first < b.first;
+            return a.second < b.second;
+        }
+    };
+    int k_;
+    bool descending_;
+    std::vector<std::pair<float, int>> heap_;
+};
+
+static void faiss_parallel_for(int n, int thread_num, const std::function<void(int)> &fn) {
+    if (thread_num <= 1) {
+        for (int i = 0; i < n; i++)
+            fn(i);
+        return;
+    }
+    BmcvWorkerPool::instance().run(n, fn);
+}
+
+static int faiss_thread_num() {
+    return BmcvWorkerPool::instance().size();
+}
+
+/*
+ * Runs tile_fn(q0, qn, j0, jn, dist) over every query block and database
+ * tile, dist is [qn][jn]. values/indices get the top k per query, best
+ * first.
+ */
+template <typename TileFn>
+static void faiss_search(int nq, int ndb, int k, bool descending, int query_block,
+                         TileFn tile_fn, std::vector<float> &values,
+                         std::vector<int> &indices) {
+    int thread_num = faiss_thread_num();
+    int qblocks = (nq + query_block - 1) / query_block;
+    int tiles = (ndb + FAISS_TILE - 1) / FAISS_TILE;
+    // split the database only when the query blocks alone leave threads idle
+    int parts = 1;
+    if (qblocks < thread_num)
+        parts = std::min(tiles, (thread_num + qblocks - 1) / qblocks);
+    int tiles_per_part = (tiles + parts - 1) / parts;
+    parts = (tiles + tiles_per_part - 1) / tiles_per_part;
+
+    std::vector<std::vector<std::pair<float, int>>> partial((size_t)parts * nq);
+    faiss_parallel_for(qblocks * parts, thread_num, [&](int task) {
+        int qb = task / parts, part = task % parts;
+        int q0 = qb * query_block;
+        int qn = std::min(query_block, nq - q0);
+        int j_begin = part * tiles_per_part * FAISS_TILE;
+        int j_end = std::min(ndb, j_begin + tiles_per_part * FAISS_TILE);
+        std::vector<faiss_topk> heaps(qn, faiss_topk(k, descending));
+        std::vector<float> dist((size_t)query_block * FAISS_TILE);
+        for (int j0 = j_begin; j0 < j_end; j0 += FAISS_TILE) {
+            int jn = std::min(FAISS_TILE, j_end - j0);
+            tile_fn(q0, qn, j0, jn, dist.data());
+            for (int q = 0; q < qn; q++) {
+                const float *d = dist.data() + (size_t)q * jn;
+                for (int j = 0; j < jn; j++)
+                    heaps[q].push(d[j], j0 + j);
+            }
+        }
+        for (int q = 0; q < qn; q++)
+            heaps[q].sorted(partial[(size_t)part * nq + q0 + q]);
+    });
+
+    values.assign((size_t)nq * k, 0.f);
+    indices.assign((size_t)nq * k, -1);
+    faiss_parallel_for(nq, parts > 1 ? thread_num : 1, [&](int q) {
+        faiss_topk merged(k, descending);
+        for (int part = 0; part < parts; part++)
+            for (auto &c : partial[(size_t)part * nq + q])
+                merged.push(c.first, c.second);
+        std::vector<std::pair<float, int>> best;
+        merged.sorted(best);
+        for (size_t i = 0; i < best.size(); i++) {
+            values[(size_t)q * k + i] = best[i].first;
+            indices[(size_t)q * k + i] = best[i].second;
+        }
+    });
+}
+
+static void faiss_store_values(const std::vector<float> &values, void *out, int out_dtype) {
+    for (size_t i = 0; i < values.size(); i++) {
+        switch (out_dtype) {
+            case DT_FP16: ((unsigned short *)out)[i] = faiss_fp32_to_fp16(values[i]); break;
+            case DT_INT32: ((int *)out)[i] = (int)values[i]; break;
+            default: ((float *)out)[i] = values[i]; break;
+        }
+    }
+}
+
+static inline float faiss_value(float v) { return v; }
+static inline float faiss_value(unsigned short v) { return faiss_fp16_to_fp32(v); }
+static inline int faiss_value(signed char v) { return v; }
+
+/*
+ * Flat index tile: query rows are [nq][d]; the database is [d][ndb] when
+ * transpose is 0 and [ndb][d] when it is 1, the layout the TPU kernel
+ * takes. The tile is packed to [d][jn] in the accumulator type, so the
+ * inner loop is an axpy over contiguous memory for every layout and dtype.
+ * fp32 [d][ndb] is read in place.
+ */
+template <typename In, typename Acc>
+struct faiss_flat_tile {
+    const In *query;
+    const In *db;
+    const In *query_norm;       // NULL for inner product
+    const In *db_norm;
+    int d, ndb, transpose;
+
+    void operator()(int q0, int qn, int j0, int jn, float *dist) const {
+        std::vector<Acc> pack;
+        std::vector<Acc> acc((size_t)qn * jn, 0);
+        const Acc *tile;
+        size_t ld;
+        if (!transpose && std::is_same<In, Acc>::value) {
+            tile = (const Acc *)(const void *)(db + j0);
+            ld = ndb;
+        } else {
+            pack.resize((size_t)d * jn);
+            if (transpose) {
+                for (int j = 0; j < jn; j++) {
+                    const In *row = db + (size_t)(j0 + j) * d;
+                    for (int kk = 0; kk < d; kk++)
+                        pack[(size_t)kk * jn + j] = faiss_value(row[kk]);
+                }
+            } else {
+                for (int kk = 0; kk < d; kk++) {
+                    const In *row = db + (size_t)kk * ndb + j0;
+                    for (int j = 0; j < jn; j++)
+                        pack[(size_t)kk * jn + j] = faiss_value(row[j]);
+                }
+            }
+            tile = pack.data();
+            ld = jn;
+        }
+        for (int kk = 0; kk < d; kk++) {
+            const Acc *p = tile + (size_t)kk * ld;
+            for (int q = 0; q < qn; q++) {
+                Acc x = faiss_value(query[(size_t)(q0 + q) * d + kk]);
+                Acc *a = acc.data() + (size_t)q * jn;
+                for (int j = 0; j < jn; j++)
+                    a[j] += x * p[j];
+            }
+        }
+        for (int q = 0; q < qn; q++) {
+            const Acc *a = acc.data() + (size_t)q * jn;
+            float *out = dist + (size_t)q * jn;
+            if (query_norm != NULL) {
+                float qv = faiss_value(query_norm[q0 + q]);
+                for (int j = 0; j < jn; j++)
+                    out[j] = qv + faiss_value(db_norm[j0 + j]) - 2 * (float)a[j];
+            } else if (sizeof(In) == 1) {
+                // the TPU saturates the int8 inner product to int16
+                for (int j = 0; j < jn; j++)
+                    out[j] = (float)std::max<Acc>(-0x8000, std::min<Acc>(0x7fff, a[j]));
+            } else {
+                for (int j = 0; j < jn; j++)
+                    out[j] = (float)a[j];
+            }
+        }
+    }
+};
+
+template <typename In, typename Acc>
+static void faiss_flat_search(const faiss_flat_tile<In, Acc> &tile, int nq, int k, bool descending,
+                              std::vector<float> &values, std::vector<int> &indices) {
+    faiss_search(nq, tile.ndb, k, descending, FAISS_QUERY_BLOCK, tile, values, indices);
+}
+
+bm_status_t bmcv_faiss_indexflat_cpu(bm_handle_t handle,
+                                     bm_device_mem_t input_data_global_addr,
+                                     bm_device_mem_t db_data_global_addr,
+                                     const bm_device_mem_t *query_L2norm_global_addr,
+                                     const bm_device_mem_t *db_L2norm_global_addr,
+                                     bm_device_mem_t output_sorted_similarity_global_addr,
+                                     bm_device_mem_t output_sorted_index_global_addr,
+                                     int vec_dims,
+                                     int query_vecs_num,
+                                     int database_vecs_num,
+                                     int sort_cnt,
+                                     int is_transpose,
+                                     int input_dtype,
+                                     int output_dtype) {
+    bool L2 = query_L2norm_global_addr != NULL;
+    if ((input_dtype != DT_FP32 && input_dtype != DT_FP16 && !(input_dtype == DT_INT8 && !L2)) ||
+        (output_dtype != DT_FP32 && output_dtype != DT_FP16 && output_dtype != DT_INT32) ||
+        vec_dims <= 0 || query_vecs_num <= 0 || sort_cnt <= 0 || database_vecs_num < sort_cnt) {
+        bmlib_log(BMCV_LOG_TAG, BMLIB_LOG_ERROR, "faiss_indexflat cpu param error, %s: %s: %d\n",
+                  filename(__FILE__), __func__, __LINE__);
+        return BM_ERR_PARAM;
+    }
+    int in_size = faiss_dtype_size(input_dtype);
+    faiss_host_mem query(handle, input_data_global_addr, (size_t)query_vecs_num * vec_dims * in_size);
+    faiss_host_mem db(handle, db_data_global_addr, (size_t)database_vecs_num * vec_dims * in_size);
+    faiss_host_mem query_norm(handle, L2 ? *query_L2norm_global_addr : bm_mem_null(),
+                              (size_t)query_vecs_num * in_size);
+    faiss_host_mem db_norm(handle, L2 ? *db_L2norm_global_addr : bm_mem_null(),
+                           (size_t)database_vecs_num * in_size);
+    faiss_host_mem similarity(handle, output_sorted_similarity_global_addr,
+                              (size_t)query_vecs_num * sort_cnt * faiss_dtype_size(output_dtype));
+    faiss_host_mem index(handle, output_sorted_index_global_addr,
+                         (size_t)query_vecs_num * sort_cnt * sizeof(int));
+    if (BM_SUCCESS != query.fetch() || BM_SUCCESS != db.fetch() ||
+        (L2 && (BM_SUCCESS != query_norm.fetch() || BM_SUCCESS != db_norm.fetch()))) {
+        BMCV_ERR_LOG("faiss_indexflat cpu bm_memcpy_d2s error\r\n");
+        return BM_ERR_FAILURE;
+    }
+    similarity.alloc();
+    index.alloc();
+
+    std::vector<float> values;
+    std::vector<int> indices;
+    if (input_dtype == DT_INT8) {
+        faiss_flat_tile<signed char, int> tile = {(const signed char *)query.ptr(),
+                                                  (const signed char *)db.ptr(), NULL, NULL,
+                                                  vec_dims, database_vecs_num, is_transpose};
+        faiss_flat_search(tile, query_vecs_num, sort_cnt, true, values, indices);
+    } else if (input_dtype == DT_FP16) {
+        faiss_flat_tile<unsigned short, float> tile = {
+            (const unsigned short *)query.ptr(), (const unsigned short *)db.ptr(),
+            L2 ? (const unsigned short *)query_norm.ptr() : NULL,
+            L2 ? (const unsigned short *)db_norm.ptr() : NULL,
+            vec_dims, database_vecs_num, is_transpose};
+        faiss_flat_search(tile, query_vecs_num, sort_cnt, !L2, values, indices);
+    } else {
+        faiss_flat_tile<float, float> tile = {
+            (const float *)query.ptr(), (const float *)db.ptr(),
+            L2 ? (const float *)query_norm.ptr() : NULL, L2 ? (const float *)db_norm.ptr() : NULL,
+            vec_dims, database_vecs_num, is_transpose};
+        faiss_flat_search(tile, query_vecs_num, sort_cnt, !L2, values, indices);
+    }
+    faiss_store_values(values, similarity.ptr(), output_dtype);
+    memcpy(index.ptr(), indices.data(), indices.size() * sizeof(int));
+    if (BM_SUCCESS != similarity.flush() || BM_SUCCESS != index.flush()) {
+        BMCV_ERR_LOG("faiss_indexflat cpu bm_memcpy_s2d error\r\n");
+        return BM_ERR_FAILURE;
+    }
+    return BM_SUCCESS;
+}
+
+/*
+ * PQ scan tile: every query has a [m][ksub] distance table, a database
+ * vector costs m lookups. ADC builds the table from the query and the
+ * centroids, SDC takes the row of the sdc table picked by the query code.
+ */
+struct faiss_pq_tile {
+    const float *tables;            // [nq][m][ksub]
+    const unsigned char *codes;     // [ndb][m]
+    int m, ksub;
+
+    void operator()(int q0, int qn, int j0, int jn, float *dist) const {
+        for (int q = 0; q < qn; q++) {
+            const float *table = tables + (size_t)(q0 + q) * m * ksub;
+            float *out = dist + (size_t)q * jn;
+            for (int j = 0; j < jn; j++) {
+                const unsigned char *code = codes + (size_t)(j0 + j) * m;
+                float s0 = 0.f, s1 = 0.f, s2 = 0.f, s3 = 0.f;
+                int i = 0;
+                for (; i + 4 <= m; i += 4) {
+                    s0 += table[(size_t)i * ksub + code[i]];
+                    s1 += table[(size_t)(i + 1) * ksub + code[i + 1]];
+                    s2 += table[(size_t)(i + 2) * ksub + code[i + 2]];
+                    s3 += table[(size_t)(i + 3) * ksub + code[i + 3]];
+                }
+                for (; i < m; i++)
+                    s0 += table[(size_t)i * ksub + code[i]];
+                out[j] = (s0 + s1) + (s2 + s3);
+            }
+        }
+    }
+};
+
+/* table[i][c] = distance of the i-th sub vector of x to centroid c */
+static void faiss_pq_table(const void *x, size_t x_off, const void *centroids, int d, int m,
+                           int ksub, int IP_metric, int dtype, float *table) {
+    int dsub = d / m;
+    std::vector<float> sub(dsub);
+    for (int i = 0; i < m; i++) {
+        for (int t = 0; t < dsub; t++)
+            sub[t] = faiss_load(x, x_off + (size_t)i * dsub + t, dtype);
+        for (int c = 0; c < ksub; c++) {
+            size_t base = ((size_t)i * ksub + c) * dsub;
+            float s = 0.f;
+            if (IP_metric) {
+                for (int t = 0; t < dsub; t++)
+                    s += sub[t] * faiss_load(centroids, base + t, dtype);
+            } else {
+                for (int t = 0; t < dsub; t++) {
+                    float diff = sub[t] - faiss_load(centroids, base + t, dtype);
+                    s += diff * diff;
+                }
+            }
+            table[(size_t)i * ksub + c] = s;
+        }
+    }
+}
+
+static bool faiss_pq_param_ok(int m, int ksub, int ny, int nx, int k, int in_dtype, int out_dtype) {
+    return m > 0 && ksub > 0 && ksub <= 256 && ny >= k && nx > 0 && k > 0 &&
+           (in_dtype == DT_FP32 || in_dtype == DT_FP16) &&
+           (out_dtype == DT_FP32 || out_dtype == DT_FP16);
+}
+
+static bm_status_t faiss_pq_search(bm_handle_t handle, const std::vector<float> &tables,
+                                   faiss_host_mem &nycodes, bm_device_mem_t distance_output_dev,
+                                   bm_device_mem_t index_output_dev, int m, int ksub, int ny,
+                                   int nx, int k, int IP_metric, int out_dtype) {
+    faiss_host_mem distance(handle, distance_output_dev,
+                            (size_t)nx * k * faiss_dtype_size(out_dtype));
+    faiss_host_mem index(handle, index_output_dev, (size_t)nx * k * sizeof(int));
+    distance.alloc();
+    index.alloc();
+    faiss_pq_tile tile = {tables.data(), (const unsigned char *)nycodes.ptr(), m, ksub};
+    std::vector<float> values;
+    std::vector<int> indices;
+    // one table per query is already cache sized, queries are not blocked
+    faiss_search(nx, ny, k, IP_metric != 0, 1, tile, values, indices);
+    faiss_store_values(values, distance.ptr(), out_dtype);
+    memcpy(index.ptr(), indices.data(), indices.size() * sizeof(int));
+    if (BM_SUCCESS != distance.flush() || BM_SUCCESS != index.flush()) {
+        BMCV_ERR_LOG("faiss_indexPQ cpu bm_memcpy_s2d error\r\n");
+        return BM_ERR_FAILURE;
+    }
+    return BM_SUCCESS;
+}
+
+bm_status_t bmcv_faiss_indexPQ_ADC_cpu(bm_handle_t handle,
+                                       bm_device_mem_t centroids_input_dev,
+                                       bm_device_mem_t nxquery_input_dev,
+                                       bm_device_mem_t nycodes_input_dev,
+                                       bm_device_mem_t distance_output_dev,
+                                       bm_device_mem_t index_output_dev,
+                                       int vec_dims,
+                                       int slice_num,
+                                       int centroids_num,
+                                       int database_num,
+                                       int query_num,
+                                       int sort_cnt,
+                                       int IP_metric,
+                                       int in_dtype,
+                                       int out_dtype) {
+    if (!faiss_pq_param_ok(slice_num, centroids_num, database_num, query_num, sort_cnt,
+                           in_dtype, out_dtype) || vec_dims % slice_num != 0) {
+        bmlib_log(BMCV_LOG_TAG, BMLIB_LOG_ERROR, "faiss_indexPQ_ADC cpu param error, %s: %s: %d\n",
+                  filename(__FILE__), __func__, __LINE__);
+        return BM_ERR_PARAM;
+    }
+    int in_size = faiss_dtype_size(in_dtype);
+    faiss_host_mem centroids(handle, centroids_input_dev, (size_t)centroids_num * vec_dims * in_size);
+    faiss_host_mem query(handle, nxquery_input_dev, (size_t)query_num * vec_dims * in_size);
+    faiss_host_mem nycodes(handle, nycodes_input_dev, (size_t)database_num * slice_num);
+    if (BM_SUCCESS != centroids.fetch() || BM_SUCCESS != query.fetch() ||
+        BM_SUCCESS != nycodes.fetch()) {
+        BMCV_ERR_LOG("faiss_indexPQ_ADC cpu bm_memcpy_d2s error\r\n");
+        return BM_ERR_FAILURE;
+    }
+    std::vector<float> tables((size_t)query_num * slice_num * centroids_num);
+    faiss_parallel_for(query_num, faiss_thread_num(), [&](int q) {
+        faiss_pq_table(query.ptr(), (size_t)q * vec_dims, centroids.ptr(), vec_dims, slice_num,
+                       centroids_num, IP_metric, in_dtype,
+                       tables.data() + (size_t)q * slice_num * centroids_num);
+    });
+    return faiss_pq_search(handle, tables, nycodes, distance_output_dev, index_output_dev,
+                           slice_num, centroids_num, database_num, query_num, sort_cnt,
+                           IP_metric, out_dtype);
+}
+
+bm_status_t bmcv_faiss_indexPQ_SDC_cpu(bm_handle_t handle,
+                                       bm_device_mem_t sdc_table_input_dev,
+                                       bm_device_mem_t nxcodes_input_dev,
+                                       bm_device_mem_t nycodes_input_dev,
+                                       bm_device_mem_t distance_output_dev,
+                                       bm_device_mem_t index_output_dev,
+                                       int slice_num,
+                                       int centroids_num,
+                                       int database_num,
+                                       int query_num,
+                                       int sort_cnt,
+                                       int IP_metric,
+                                       int in_dtype,
+                                       int out_dtype) {
+    if (!faiss_pq_param_ok(slice_num, centroids_num, database_num, query_num, sort_cnt,
+                           in_dtype, out_dtype)) {
+        bmlib_log(BMCV_LOG_TAG, BMLIB_LOG_ERROR, "faiss_indexPQ_SDC cpu param error, %s: %s: %d\n",
+                  filename(__FILE__), __func__, __LINE__);
+        return BM_ERR_PARAM;
+    }
+    size_t table_size = (size_t)slice_num * centroids_num * centroids_num;
+    faiss_host_mem sdc_table(handle, sdc_table_input_dev, table_size * faiss_dtype_size(in_dtype));
+    faiss_host_mem nxcodes(handle, nxcodes_input_dev, (size_t)query_num * slice_num);
+    faiss_host_mem nycodes(handle, nycodes_input_dev, (size_t)database_num * slice_num);
+    if (BM_SUCCESS != sdc_table.fetch() || BM_SUCCESS != nxcodes.fetch() ||
+        BM_SUCCESS != nycodes.fetch()) {
+        BMCV_ERR_LOG("faiss_indexPQ_SDC cpu bm_memcpy_d2s error\r\n");
+        return BM_ERR_FAILURE;
+    }
+    const unsigned char *xcodes = (const unsigned char *)nxcodes.ptr();
+    std::vector<float> tables((size_t)query_num * slice_num * centroids_num);
+    for (int q = 0; q < query_num; q++) {
+        for (int i = 0; i < slice_num; i++) {
+            size_t row = ((size_t)i * centroids_num + xcodes[(size_t)q * slice_num + i]) * centroids_num;
+            float *table = tables.data() + ((size_t)q * slice_num + i) * centroids_num;
+            for (int c = 0; c < centroids_num; c++)
+                table[c] = faiss_load(sdc_table.ptr(), row + c, in_dtype);
+        }
+    }
+    return faiss_pq_search(handle, tables, nycodes, distance_output_dev, index_output_dev,
+                           slice_num, centroids_num, database_num, query_num, sort_cnt,
+                           IP_metric, out_dtype);
+}
+
+bm_status_t bmcv_faiss_indexPQ_encode_cpu(bm_handle_t handle,
+                                          bm_device_mem_t vector_input_dev,
+                                          bm_device_mem_t centroids_input_dev,
+                                          bm_device_mem_t nvcodes_output_dev,
+                                          int encode_vec_num,
+                                          int vec_dims,
+                                          int slice_num,
+                                          int centroids_num,
+                                          int IP_metric,
+                                          int input_dtype) {
+    if (encode_vec_num <= 0 || slice_num <= 0 || vec_dims % slice_num != 0 ||
+        centroids_num <= 0 || centroids_num > 256 ||
+        (input_dtype != DT_FP32 && input_dtype != DT_FP16)) {
+        bmlib_log(BMCV_LOG_TAG, BMLIB_LOG_ERROR, "faiss_indexPQ_encode cpu param error, %s: %s: %d\n",
+                  filename(__FILE__), __func__, __LINE__);
+        return BM_ERR_PARAM;
+    }
+    int in_size = faiss_dtype_size(input_dtype);
+    faiss_host_mem vectors(handle, vector_input_dev, (size_t)encode_vec_num * vec_dims * in_size);
+    faiss_host_mem centroids(handle, centroids_input_dev, (size_t)centroids_num * vec_dims * in_size);
+    faiss_host_mem codes(handle, nvcodes_output_dev, (size_t)encode_vec_num * slice_num);
+    if (BM_SUCCESS != vectors.fetch() || BM_SUCCESS != centroids.fetch()) {
+        BMCV_ERR_LOG("faiss_indexPQ_encode cpu bm_memcpy_d2s error\r\n");
+        return BM_ERR_FAILURE;
+    }
+    codes.alloc();
+    unsigned char *out = (unsigned char *)codes.ptr();
+    faiss_parallel_for(encode_vec_num, faiss_thread_num(), [&](int v) {
+        std::vector<float> table((size_t)slice_num * centroids_num);
+        faiss_pq_table(vectors.ptr(), (size_t)v * vec_dims, centroids.ptr(), vec_dims, slice_num,
+                       centroids_num, IP_metric, input_dtype, table.data());
+        for (int i = 0; i < slice_num; i++) {
+            const float *t = table.data() + (size_t)i * centroids_num;
+            int best = 0;
+            for (int c = 1; c < centroids_num; c++)
+                if (IP_metric ? t[c] > t[best] : t[c] < t[best])
+                    best = c;
+            out[(size_t)v * slice_num + i] = (unsigned char)best;
+        }
+    });
+    if (BM_SUCCESS != codes.flush()) {
+        BMCV_ERR_LOG("faiss_indexPQ_encode cpu bm_memcpy_s2d error\r\n");
+        return BM_ERR_FAILURE;
+    }
+    return BM_SUCCESS;
+}
+
+/*
+ * The TPU kernels only read device memory and only exist on BM1684X. Past
+ * that the host wins while the launch dominates: little data to copy over
+ * and little arithmetic. BMCV_FAISS_BACKEND=cpu or tpu overrides this.
+ */
+bool bmcv_faiss_use_cpu(bm_handle_t handle, const bm_device_mem_t *mems, int mem_num,
+                        long long in_bytes, long long work) {
+    const char *backend = getenv("BMCV_FAISS_BACKEND");
+    if (backend != NULL && strcmp(backend, "cpu") == 0)
+        return true;
+    bool all_device = true;
+    for (int i = 0; i < mem_num; i++)
+        all_device = all_device && bm_mem_get_type(mems[i]) == BM_MEM_TYPE_DEVICE;
+    if (!all_device)
+        return true;
+    if (backend != NULL && strcmp(backend, "tpu") == 0)
+        return false;
+    unsigned int chipid;
+    if (handle == NULL || BM_SUCCESS != bm_get_chipid(handle, &chipid) || chipid != BM1684X)
+        return true;
+    return in_bytes <= FAISS_CPU_MAX_BYTES && work <= FAISS_CPU_MAX_WORK;
+}
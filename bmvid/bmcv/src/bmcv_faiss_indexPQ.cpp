@@ -92,6 +92,18 @@ bm_status_t bmcv_faiss_indexPQ_ADC_ext(bm_handle_t handle,
     faiss_api_indexPQ_ADC_t api;
     bm_device_mem_t distance_output_dev_fp32;
 
+    bm_device_mem_t mems[] = {centroids_input_dev, nxquery_input_dev, nycodes_input_dev,
+                              distance_output_dev, index_output_dev};
+    long long in_bytes = (long long)(centroids_num + query_num) * vec_dims * dtype_size((data_type_t)in_dtype) +
+                         (long long)database_num * slice_num;
+    if (bmcv_faiss_use_cpu(handle, mems, 5, in_bytes,
+                           (long long)query_num * (centroids_num * vec_dims + database_num * slice_num))) {
+        return bmcv_faiss_indexPQ_ADC_cpu(handle, centroids_input_dev, nxquery_input_dev,
+                                          nycodes_input_dev, distance_output_dev, index_output_dev,
+                                          vec_dims, slice_num, centroids_num, database_num,
+                                          query_num, sort_cnt, IP_metric, in_dtype, out_dtype);
+    }
+
     if (bm_mem_get_type(distance_output_dev) == BM_MEM_TYPE_DEVICE) {
         if (BM_SUCCESS !=
             bm_malloc_device_byte(handle, &distance_output_dev_fp32, query_num * database_num * sizeof(float))) {
@@ -193,6 +205,17 @@ bm_status_t bmcv_faiss_indexPQ_SDC_ext(bm_handle_t handle,
     faiss_api_indexPQ_SDC_t api;
     bm_device_mem_t distance_output_dev_fp32;
 
+    bm_device_mem_t mems[] = {sdc_table_input_dev, nxcodes_input_dev, nycodes_input_dev,
+                              distance_output_dev, index_output_dev};
+    long long in_bytes = (long long)slice_num * centroids_num * centroids_num * dtype_size((data_type_t)in_dtype) +
+                         (long long)(database_num + query_num) * slice_num;
+    if (bmcv_faiss_use_cpu(handle, mems, 5, in_bytes, (long long)query_num * database_num * slice_num)) {
+        return bmcv_faiss_indexPQ_SDC_cpu(handle, sdc_table_input_dev, nxcodes_input_dev,
+                                          nycodes_input_dev, distance_output_dev, index_output_dev,
+                                          slice_num, centroids_num, database_num, query_num,
+                                          sort_cnt, IP_metric, in_dtype, out_dtype);
+    }
+
     if (bm_mem_get_type(distance_output_dev) == BM_MEM_TYPE_DEVICE) {
         if (BM_SUCCESS !=
             bm_malloc_device_byte(handle, &distance_output_dev_fp32, query_num * database_num * sizeof(float))) {
@@ -289,6 +312,15 @@ bm_status_t bmcv_faiss_indexPQ_encode_ext(bm_handle_t handle,
     faiss_api_indexPQ_encode_t api;
     bm_device_mem_t buffer_table_dev_32byte;
 
+    bm_device_mem_t mems[] = {vector_input_dev, centroids_input_dev, nvcodes_output_dev};
+    long long in_bytes = (long long)(encode_vec_num + centroids_num) * vec_dims * dtype_size((data_type_t)input_dtype);
+    if (bmcv_faiss_use_cpu(handle, mems, 3, in_bytes, (long long)encode_vec_num * centroids_num * vec_dims)) {
+        // the CPU path keeps the distance table to itself, buffer_table_dev is left untouched
+        return bmcv_faiss_indexPQ_encode_cpu(handle, vector_input_dev, centroids_input_dev,
+                                             nvcodes_output_dev, encode_vec_num, vec_dims,
+                                             slice_num, centroids_num, IP_metric, input_dtype);
+    }
+
     if (bm_mem_get_type(buffer_table_dev) == BM_MEM_TYPE_DEVICE) {
         if (BM_SUCCESS !=
             bm_malloc_device_byte(handle, &buffer_table_dev_32byte, encode_vec_num * slice_num * centroids_num * sizeof(float))) {
@@ -31,6 +31,19 @@ bm_status_t bmcv_faiss_indexflatIP(bm_handle_t handle,
                                    int is_transpose,
                                    int input_dtype,
                                    int output_dtype) {
+    bm_device_mem_t mems[] = {input_data_global_addr, db_data_global_addr,
+                              output_sorted_similarity_global_addr, output_sorted_index_global_addr};
+    long long in_bytes = (long long)(query_vecs_num + database_vecs_num) * vec_dims *
+                         (input_dtype == DT_INT8 ? 1 : input_dtype == DT_FP16 ? 2 : 4);
+    if (bmcv_faiss_use_cpu(handle, mems, 4, in_bytes,
+                           (long long)query_vecs_num * database_vecs_num * vec_dims)) {
+        return bmcv_faiss_indexflat_cpu(handle, input_data_global_addr, db_data_global_addr,
+                                        NULL, NULL, output_sorted_similarity_global_addr,
+                                        output_sorted_index_global_addr, vec_dims, query_vecs_num,
+                                        database_vecs_num, sort_cnt, is_transpose, input_dtype,
+                                        output_dtype);
+    }
+
     faiss_api_indexflatIP_t api;
     api.input_query_global_addr = bm_mem_get_device_addr(input_data_global_addr);
     api.database_global_addr = bm_mem_get_device_addr(db_data_global_addr);
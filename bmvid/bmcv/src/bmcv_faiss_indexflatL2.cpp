@@ -57,6 +57,21 @@ bm_status_t bmcv_faiss_indexflatL2(bm_handle_t handle,
         return BM_NOT_SUPPORTED;
     }
 
+    bm_device_mem_t mems[] = {input_data_global_addr, db_data_global_addr,
+                              query_L2norm_global_addr, db_L2norm_global_addr,
+                              output_sorted_similarity_global_addr, output_sorted_index_global_addr};
+    long long in_bytes = (long long)(query_vecs_num + database_vecs_num) * (vec_dims + 1) *
+                         (input_dtype == DT_FP16 ? 2 : 4);
+    if (bmcv_faiss_use_cpu(handle, mems, 6, in_bytes,
+                           (long long)query_vecs_num * database_vecs_num * vec_dims)) {
+        return bmcv_faiss_indexflat_cpu(handle, input_data_global_addr, db_data_global_addr,
+                                        &query_L2norm_global_addr, &db_L2norm_global_addr,
+                                        output_sorted_similarity_global_addr,
+                                        output_sorted_index_global_addr, vec_dims, query_vecs_num,
+                                        database_vecs_num, sort_cnt, is_transpose, input_dtype,
+                                        output_dtype);
+    }
+
     bm_status_t ret = BM_SUCCESS;
     unsigned int chipid;
     ret = bm_get_chipid(handle, &chipid);
@@ -2,6 +2,11 @@
 #include <cstdlib>
 #include <cstring>
 #include <vector>
+#include <list>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <mutex>
 #include <stdio.h>
 #include "bmcv_api_ext.h"
 #include "bmcv_internal.h"
@@ -1374,6 +1379,246 @@ bm_status_t bm_image_get_contiguous_device_mem(int              image_num,
     return BM_SUCCESS;
 }
 
+typedef std::tuple<int, int, int, int, int> bm_image_pool_key;
+
+typedef struct {
+    bm_image_pool_key key;
+    bm_image          image;
+    bm_device_mem_t   dmem;     // the one allocation all planes live in
+} bm_image_pool_entry;
+
+struct bm_image_pool {
+    bm_handle_t               handle;
+    bm_image_pool_allocator_t allocator;
+    int                       max_idle;
+    std::mutex                lock;
+    // released images, most recently released first, and where each key's are
+    std::list<bm_image_pool_entry> idle;
+    std::multimap<bm_image_pool_key, std::list<bm_image_pool_entry>::iterator> idle_index;
+    std::unordered_map<bm_image_private *, bm_image_pool_entry> in_use;
+    bm_image_pool_stat_t      stat;
+};
+
+static bm_status_t pool_device_alloc(void *ctx, bm_handle_t handle, int heap_mask,
+                                     unsigned int size, bm_device_mem_t *mem) {
+    UNUSED(ctx);
+    return bm_malloc_device_byte_heap_mask(handle, mem, heap_mask, size);
+}
+
+static void pool_device_free(void *ctx, bm_handle_t handle, bm_device_mem_t mem) {
+    UNUSED(ctx);
+    bm_free_device(handle, mem);
+}
+
+static bm_status_t pool_new_entry(bm_image_pool_t pool, const bm_image_pool_key &key,
+                                  bm_image_pool_entry *entry) {
+    bm_image image;
+    bm_status_t ret = bm_image_create(pool->handle,
+                                      std::get<0>(key),
+                                      std::get<1>(key),
+                                      (bm_image_format_ext)std::get<2>(key),
+                                      (bm_image_data_format_ext)std::get<3>(key),
+                                      &image);
+    CHECK_RET(ret);
+    int plane_num = image.image_private->plane_num;
+    unsigned int total_size = 0;
+    for (int i = 0; i < plane_num; i++) {
+        total_size += image.image_private->memory_layout[i].size;
+    }
+    bm_device_mem_t dmem;
+    if (BM_SUCCESS != pool->allocator.alloc(pool->allocator.ctx, pool->handle,
+                                            std::get<4>(key), total_size, &dmem)) {
+        BMCV_ERR_LOG("image pool alloc %u bytes error\r\n", total_size);
+        bm_image_destroy(image);
+        return BM_ERR_NOMEM;
+    }
+    // planes back to back, as bm_image_alloc_dev_mem lays them out
+    bm_device_mem_t mem[MAX_bm_image_CHANNEL];
+    u64 base_addr = bm_mem_get_device_addr(dmem);
+    for (int i = 0; i < plane_num; i++) {
+        mem[i] = bm_mem_from_device(base_addr, image.image_private->memory_layout[i].size);
+        base_addr += image.image_private->memory_layout[i].size;
+    }
+    mem[0].flags.u.gmem_heapid  = dmem.flags.u.gmem_heapid;
+    mem[0].u.device.dmabuf_fd   = dmem.u.device.dmabuf_fd;
+    bm_image_attach(image, mem);
+    entry->key   = key;
+    entry->image = image;
+    entry->dmem  = dmem;
+    return BM_SUCCESS;
+}
+
+static void pool_free_entry(bm_image_pool_t pool, bm_image_pool_entry &entry) {
+    bm_image_detach(entry.image);
+    pool->allocator.free(pool->allocator.ctx, pool->handle, entry.dmem);
+    bm_image_destroy(entry.image);
+}
+
+/* takes idle images past max_idle off the pool, the caller frees them
+ * after dropping the lock */
+static void pool_take_over_bound(bm_image_pool_t pool, int max_idle,
+                                 std::vector<bm_image_pool_entry> &trimmed) {
+    while ((int)pool->idle.size() > max_idle) {
+        auto it = std::prev(pool->idle.end());
+        auto range = pool->idle_index.equal_range(it->key);
+        for (auto index = range.first; index != range.second; index++) {
+            if (index->second == it) {
+                pool->idle_index.erase(index);
+                break;
+            }
+        }
+        pool->stat.idle_bytes  -= it->dmem.size;
+        pool->stat.total_bytes -= it->dmem.size;
+        pool->stat.trim_num++;
+        trimmed.push_back(*it);
+        pool->idle.erase(it);
+    }
+    pool->stat.idle_num = pool->idle.size();
+}
+
+bm_status_t bm_image_pool_create(bm_handle_t                      handle,
+                                 int                              max_idle,
+                                 const bm_image_pool_allocator_t *allocator,
+                                 bm_image_pool_t *                pool) {
+    if (pool == NULL || max_idle < 0 ||
+        (allocator != NULL && (allocator->alloc == NULL || allocator->free == NULL))) {
+        BMCV_ERR_LOG("image pool param error\r\n");
+        return BM_ERR_PARAM;
+    }
+    bm_image_pool_t res = new bm_image_pool;
+    res->handle   = handle;
+    res->max_idle = max_idle;
+    if (allocator != NULL) {
+        res->allocator = *allocator;
+    } else {
+        res->allocator.alloc = pool_device_alloc;
+        res->allocator.free  = pool_device_free;
+        res->allocator.ctx   = NULL;
+    }
+    memset(&res->stat, 0, sizeof(res->stat));
+    *pool = res;
+    return BM_SUCCESS;
+}
+
+bm_status_t bm_image_pool_destroy(bm_image_pool_t pool) {
+    if (pool == NULL) {
+        return BM_SUCCESS;
+    }
+    if (!pool->in_use.empty()) {
+        bmlib_log("BMCV",
+                  BMLIB_LOG_WARNING,
+                  "image pool destroyed with %d images not released\n",
+                  (int)pool->in_use.size());
+    }
+    for (auto &entry : pool->idle) {
+        pool_free_entry(pool, entry);
+    }
+    for (auto &entry : pool->in_use) {
+        pool_free_entry(pool, entry.second);
+    }
+    delete pool;
+    return BM_SUCCESS;
+}
+
+bm_status_t bm_image_pool_acquire(bm_image_pool_t          pool,
+                                  int                      img_h,
+                                  int                      img_w,
+                                  bm_image_format_ext      image_format,
+                                  bm_image_data_format_ext data_type,
+                                  int                      heap_mask,
+                                  bm_image *               image) {
+    if (pool == NULL || image == NULL) {
+        return BM_ERR_PARAM;
+    }
+    if (image_format == FORMAT_COMPRESSED) {
+        BMCV_ERR_LOG("compressed format only support attached device memory\r\n");
+        return BM_ERR_DATA;
+    }
+    bm_image_pool_key key(img_h, img_w, image_format, data_type, heap_mask);
+    bm_image_pool_entry entry;
+    {
+        std::lock_guard<std::mutex> lock(pool->lock);
+        pool->stat.acquire_num++;
+        // of the idle images with this key, the last released one
+        auto index = pool->idle_index.upper_bound(key);
+        if (index != pool->idle_index.begin() && (--index)->first == key) {
+            entry = *index->second;
+            pool->idle.erase(index->second);
+            pool->idle_index.erase(index);
+            pool->stat.hit_num++;
+            pool->stat.idle_num = pool->idle.size();
+            pool->stat.idle_bytes -= entry.dmem.size;
+            pool->in_use[entry.image.image_private] = entry;
+            pool->stat.in_use_num = pool->in_use.size();
+            pool->stat.peak_in_use_num = (std::max)(pool->stat.peak_in_use_num,
+                                                    pool->stat.in_use_num);
+            *image = entry.image;
+            return BM_SUCCESS;
+        }
+    }
+    // a miss allocates without holding the pool
+    bm_status_t ret = pool_new_entry(pool, key, &entry);
+    CHECK_RET(ret);
+    std::lock_guard<std::mutex> lock(pool->lock);
+    pool->in_use[entry.image.image_private] = entry;
+    pool->stat.in_use_num = pool->in_use.size();
+    pool->stat.peak_in_use_num = (std::max)(pool->stat.peak_in_use_num, pool->stat.in_use_num);
+    pool->stat.total_bytes += entry.dmem.size;
+    pool->stat.peak_bytes = (std::max)(pool->stat.peak_bytes, pool->stat.total_bytes);
+    *image = entry.image;
+    return BM_SUCCESS;
+}
+
+bm_status_t bm_image_pool_release(bm_image_pool_t pool, bm_image image) {
+    if (pool == NULL) {
+        return BM_ERR_PARAM;
+    }
+    std::vector<bm_image_pool_entry> trimmed;
+    {
+        std::lock_guard<std::mutex> lock(pool->lock);
+        auto it = pool->in_use.find(image.image_private);
+        if (it == pool->in_use.end()) {
+            BMCV_ERR_LOG("image was not acquired from this pool\r\n");
+            return BM_ERR_PARAM;
+        }
+        pool->idle.push_front(it->second);
+        pool->idle_index.insert(std::make_pair(it->second.key, pool->idle.begin()));
+        pool->stat.idle_bytes += it->second.dmem.size;
+        pool->in_use.erase(it);
+        pool->stat.release_num++;
+        pool->stat.in_use_num = pool->in_use.size();
+        pool_take_over_bound(pool, pool->max_idle, trimmed);
+    }
+    for (auto &entry : trimmed) {
+        pool_free_entry(pool, entry);
+    }
+    return BM_SUCCESS;
+}
+
+bm_status_t bm_image_pool_trim(bm_image_pool_t pool, int max_idle) {
+    if (pool == NULL || max_idle < 0) {
+        return BM_ERR_PARAM;
+    }
+    std::vector<bm_image_pool_entry> trimmed;
+    {
+        std::lock_guard<std::mutex> lock(pool->lock);
+        pool_take_over_bound(pool, max_idle, trimmed);
+    }
+    for (auto &entry : trimmed) {
+        pool_free_entry(pool, entry);
+    }
+    return BM_SUCCESS;
+}
+
+bm_status_t bm_image_pool_get_stat(bm_image_pool_t pool, bm_image_pool_stat_t *stat) {
+    if (pool == NULL || stat == NULL) {
+        return BM_ERR_PARAM;
+    }
+    std::lock_guard<std::mutex> lock(pool->lock);
+    *stat = pool->stat;
+    return BM_SUCCESS;
+}
+
 bm_status_t bm_image_to_bmcv_image(bm_image *src, bmcv_image *dst)
 {
     if (!src->image_private)
@@ -0,0 +1,349 @@
+/*
+ *  This file is used both HOST and A53
+*/
+#ifndef BMCV_MORPH_H
+#define BMCV_MORPH_H
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include <mutex>
+#include <functional>
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+#include "bmcv_worker_pool.h"
+
+/* scratch memory kept across calls, morph_cpu serializes on morph_mutex */
+inline std::mutex& morph_mutex() {
+    static std::mutex mtx;
+    return mtx;
+}
+
+inline unsigned char* morph_arena_get(size_t size) {
+    static std::vector<unsigned char> arena;
+    if (arena.size() < size)
+        arena.resize(size);
+    return arena.data();
+}
+
+/* splits [0, n) into about as many bands as there are threads */
+static inline void morph_parallel_bands(int n, const std::function<void(int, int, int)>& fn) {
+    BmcvWorkerPool& pool = BmcvWorkerPool::instance();
+    int band_num = (std::min)(n, pool.size());
+    int lines = (n + band_num - 1) / band_num;
+    band_num = (n + lines - 1) / lines;
+    pool.run(band_num, [&](int band) {
+        int start = band * lines;
+        fn(band, start, (std::min)(lines, n - start));
+    });
+}
+
+static inline void morph_pad_const(
+        const unsigned char* in,
+        unsigned char* out,
+        int c,
+        int w,
+        int h,
+        int srcstep,
+        int pad_w_l,
+        int pad_w_r,
+        int pad_h_t,
+        int pad_h_b,
+        unsigned char val
+        ) {
+    int count = (w + pad_w_l + pad_w_r) * c;
+    morph_parallel_bands(h, [&](int, int start, int lines) {
+        for (int i = start; i < start + lines; i++) {
+            unsigned char* row = out + (size_t)(i + pad_h_t) * count;
+            memset(row, val, pad_w_l * c);
+            memcpy(row + pad_w_l * c, in + (size_t)i * srcstep, w * c);
+            memset(row + (pad_w_l + w) * c, val, pad_w_r * c);
+        }
+    });
+    // add top and bottom pad
+    memset(out, val, (size_t)pad_h_t * count);
+    memset(out + (size_t)(h + pad_h_t) * count, val, (size_t)pad_h_b * count);
+}
+
+template<typename T>
+struct MaxOp {
+    T operator ()(const T a, const T b) const { return (std::max)(a, b); }
+#if defined(__ARM_NEON)
+    uint8x16_t operator ()(const uint8x16_t a, const uint8x16_t b) const { return vmaxq_u8(a, b); }
+#endif
+    int val = 0;
+};
+
+template<typename T>
+struct MinOp {
+    T operator ()(const T a, const T b) const { return (std::min)(a, b); }
+#if defined(__ARM_NEON)
+    uint8x16_t operator ()(const uint8x16_t a, const uint8x16_t b) const { return vminq_u8(a, b); }
+#endif
+    int val = 255;
+};
+
+/* dst[i] = op(a[i], b[i]) */
+template<class Op>
+static inline void morph_row_op(
+        unsigned char* dst,
+        const unsigned char* a,
+        const unsigned char* b,
+        int n) {
+    Op op;
+    int i = 0;
+#if defined(__ARM_NEON)
+    for (; i <= n - 16; i += 16)
+        vst1q_u8(dst + i, op(vld1q_u8(a + i), vld1q_u8(b + i)));
+#endif
+    for (; i < n; i++)
+        dst[i] = op(a[i], b[i]);
+}
+
+/*
+ * van Herk/Gil-Werman running min/max over a window of k items spaced
+ * step bytes apart: split the input into blocks of k items, take prefix
+ * results forward and suffix results backward inside every block, then
+ * any window is op(suffix at its first item, prefix at its last item).
+ * Three ops per output whatever k is. in holds (n + k - 1) items.
+ * Short windows are cheaper as k - 1 plain vector passes.
+ */
+#define MORPH_HGW_MIN_KW 32   // the row scans are serial, vector passes win longer
+#define MORPH_HGW_MIN_KH 3
+template<class Op>
+static void morph_hgw_row(
+        const unsigned char* in,
+        unsigned char* out,
+        unsigned char* prefix,
+        unsigned char* suffix,
+        int n,
+        int k,
+        int step) {
+    Op op;
+    if (k <= MORPH_HGW_MIN_KW) {
+        // a few vector passes beat the serial prefix/suffix scans
+        morph_row_op<Op>(out, in, in + (k > 1 ? step : 0), n * step);
+        for (int j = 2; j < k; j++)
+            morph_row_op<Op>(out, out, in + j * step, n * step);
+        return;
+    }
+    int len = n + k - 1;
+    for (int b = 0; b < len; b += k) {
+        int e = (std::min)(b + k, len);
+        for (int c = 0; c < step; c++) {
+            unsigned char acc = in[b * step + c];
+            for (int i = b; i < e; i++) {
+                acc = op(acc, in[i * step + c]);
+                prefix[i * step + c] = acc;
+            }
+            acc = in[(e - 1) * step + c];
+            for (int i = e - 1; i >= b; i--) {
+                acc = op(acc, in[i * step + c]);
+                suffix[i * step + c] = acc;
+            }
+        }
+    }
+    morph_row_op<Op>(out, suffix, prefix + (k - 1) * step, n * step);
+}
+
+/* same over rows: rows[0, lines + k - 1) are width bytes each, buffers
+ * hold lines + k - 1 rows */
+template<class Op>
+static void morph_hgw_rows(
+        const unsigned char* const* rows,
+        unsigned char* const* out,
+        unsigned char* prefix,
+        unsigned char* suffix,
+        int lines,
+        int k,
+        int width) {
+    if (k <= MORPH_HGW_MIN_KH) {
+        for (int i = 0; i < lines; i++) {
+            morph_row_op<Op>(out[i], rows[i], rows[i + (k > 1 ? 1 : 0)], width);
+            for (int j = 2; j < k; j++)
+                morph_row_op<Op>(out[i], out[i], rows[i + j], width);
+        }
+        return;
+    }
+    int len = lines + k - 1;
+    for (int b = 0; b < len; b += k) {
+        int e = (std::min)(b + k, len);
+        memcpy(prefix + (size_t)b * width, rows[b], width);
+        for (int i = b + 1; i < e; i++)
+            morph_row_op<Op>(prefix + (size_t)i * width, prefix + (size_t)(i - 1) * width, rows[i], width);
+        memcpy(suffix + (size_t)(e - 1) * width, rows[e - 1], width);
+        for (int i = e - 2; i >= b; i--)
+            morph_row_op<Op>(suffix + (size_t)i * width, suffix + (size_t)(i + 1) * width, rows[i], width);
+    }
+    for (int i = 0; i < lines; i++)
+        morph_row_op<Op>(out[i], suffix + (size_t)i * width, prefix + (size_t)(i + k - 1) * width, width);
+}
+
+/*
+ * Cross: a kw wide pass over every row and a kh tall pass over every
+ * column, both on the source, then their min/max. The anchor is the
+ * kernel center. Rectangles are all-ones kernels and run on the TPU, so
+ * only the cross is worth a separable path here.
+ */
+template<class Op>
+static void morph_cross(
+        const unsigned char* src,
+        unsigned char* dst,
+        int kw,
+        int kh,
+        int srcstep,
+        int dststep,
+        int width,
+        int height,
+        int cn) {
+    Op op;
+    BmcvWorkerPool& pool = BmcvWorkerPool::instance();
+    int pad_w_l = kw / 2;
+    int pad_h_t = kh / 2;
+    int line = width * cn;
+    int pad_line = (width + kw - 1) * cn;
+    int band_max = (height + pool.size() - 1) / pool.size();
+    // in place, the column pass of a band reads rows that other bands write
+    bool overlap = dst < src + (size_t)(height - 1) * srcstep + line &&
+                   src < dst + (size_t)(height - 1) * dststep + line;
+    size_t hsize = (size_t)height * line;
+    size_t ssize = overlap ? hsize : 0;
+    size_t band_size = 3 * (size_t)pad_line + 2 * (size_t)(band_max + kh - 1) * line;
+    unsigned char* hbuf = morph_arena_get(hsize + ssize + line + band_size * pool.size());
+    unsigned char* sbuf = hbuf + hsize;
+    unsigned char* pad_row = sbuf + ssize;
+    memset(pad_row, op.val, line);
+    const unsigned char* vsrc = overlap ? sbuf : src;
+    size_t vstep = overlap ? line : srcstep;
+
+    // row pass, src row i -> hbuf row i, and sbuf row i if in place
+    morph_parallel_bands(height, [&](int band, int start, int lines) {
+        unsigned char* tmp = pad_row + line + band * band_size;
+        unsigned char* prefix = tmp + pad_line;
+        unsigned char* suffix = prefix + pad_line;
+        memset(tmp, op.val, pad_w_l * cn);
+        memset(tmp + (pad_w_l + width) * cn, op.val, (kw - 1 - pad_w_l) * cn);
+        for (int i = start; i < start + lines; i++) {
+            memcpy(tmp + pad_w_l * cn, src + (size_t)i * srcstep, line);
+            if (overlap)
+                memcpy(sbuf + (size_t)i * line, src + (size_t)i * srcstep, line);
+            morph_hgw_row<Op>(tmp, hbuf + (size_t)i * line, prefix, suffix, width, kw, cn);
+        }
+    });
+
+    // column pass, combined with the row pass into dst
+    morph_parallel_bands(height, [&](int band, int start, int lines) {
+        unsigned char* prefix = pad_row + line + band * band_size + 3 * pad_line;
+        unsigned char* suffix = prefix + (size_t)(band_max + kh - 1) * line;
+        std::vector<const unsigned char*> rows(lines + kh - 1);
+        std::vector<unsigned char*> out(lines);
+        for (int i = 0; i < lines + kh - 1; i++) {
+            int r = start + i - pad_h_t;
+            rows[i] = (r < 0 || r >= height) ? pad_row : vsrc + r * vstep;
+        }
+        for (int i = 0; i < lines; i++)
+            out[i] = dst + (size_t)(start + i) * dststep;
+        morph_hgw_rows<Op>(rows.data(), out.data(), prefix, suffix, lines, kh, line);
+        for (int i = 0; i < lines; i++)
+            morph_row_op<Op>(out[i], out[i], hbuf + (size_t)(start + i) * line, line);
+    });
+}
+
+static inline bool morph_is_cross(
+        const unsigned char* kernel,
+        int kw,
+        int kh) {
+    for (int i = 0; i < kh; i++) {
+        for (int j = 0; j < kw; j++) {
+            if ((kernel[i * kw + j] != 0) != (i == kh / 2 || j == kw / 2))
+                return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Erode (MinOp) or dilate (MaxOp) of one plane with cn interleaved
+ * channels, the anchor is the kernel center and the border is the
+ * neutral value of op. src and dst may be the same image.
+ */
+template<class Op>
+static void morph_cpu(
+        const unsigned char* src,
+        const unsigned char* kernel,
+        unsigned char* dst,
+        int kw,
+        int kh,
+        int srcstep,
+        int dststep,
+        int width,
+        int height,
+        int cn) {
+    Op op;
+    std::lock_guard<std::mutex> lock(morph_mutex());
+    if (morph_is_cross(kernel, kw, kh)) {
+        morph_cross<Op>(src, dst, kw, kh, srcstep, dststep, width, height, cn);
+        return;
+    }
+    int pad_w_l = kw / 2;
+    int pad_w_r = kw - 1 - pad_w_l;
+    int pad_h_t = kh / 2;
+    int pad_h_b = kh - 1 - pad_h_t;
+    int sw = width + pad_w_l + pad_w_r;
+    int sh = height + pad_h_t + pad_h_b;
+    unsigned char* src_padded = morph_arena_get((size_t)sw * sh * cn);
+    morph_pad_const(
+            src,
+            src_padded,
+            cn,
+            width,
+            height,
+            srcstep,
+            pad_w_l,
+            pad_w_r,
+            pad_h_t,
+            pad_h_b,
+            op.val);
+    std::vector<std::pair<int, int>> coords;
+    for (int i = 0; i < kh; i++) {
+        for (int j = 0; j < kw; j++) {
+            if (kernel[i * kw + j])
+                coords.push_back(std::make_pair(j, i));
+        }
+    }
+    int nz = (int)coords.size();
+    width *= cn;
+    morph_parallel_bands(height, [&](int, int start, int lines) {
+        std::vector<const unsigned char*> kp(nz);
+        const unsigned char* S = src_padded + (size_t)start * sw * cn;
+        unsigned char* D = dst + (size_t)start * dststep;
+        while (lines--) {
+            for (int k = 0; k < nz; k++) {
+                kp[k] = S + coords[k].second * sw * cn + coords[k].first * cn;
+            }
+            int i = 0;
+            for (; i <= width - 4; i += 4) {
+                const unsigned char* sptr = kp[0] + i;
+                unsigned char s0 = sptr[0], s1 = sptr[1], s2 = sptr[2], s3 = sptr[3];
+                for (int k = 1; k < nz; k++ ) {
+                    sptr = kp[k] + i;
+                    s0 = op(s0, sptr[0]); s1 = op(s1, sptr[1]);
+                    s2 = op(s2, sptr[2]); s3 = op(s3, sptr[3]);
+                }
+                D[i] = s0; D[i+1] = s1;
+                D[i+2] = s2; D[i+3] = s3;
+            }
+            for (; i < width; i++) {
+                unsigned char s0 = kp[0][i];
+                for (int k = 1; k < nz; k++)
+                    s0 = op(s0, kp[k][i]);
+                D[i] = s0;
+            }
+            S += sw * cn;
+            D += dststep;
+        }
+    });
+}
+
+#endif
@@ -0,0 +1,109 @@
+/*
+ *  This file is used both HOST and A53
+*/
+#ifndef BMCV_WORKER_POOL_H
+#define BMCV_WORKER_POOL_H
+
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+/*
+ * Worker threads stay alive between calls, spawning hardware_concurrency
+ * threads per call cost more than a small operator itself. run() hands
+ * task ids to the workers and the caller, and returns when all of them
+ * are done. Runs from several threads take turns; a run from inside a
+ * task is done by the calling thread alone.
+ */
+class BmcvWorkerPool {
+public:
+    static BmcvWorkerPool& instance() {
+        static BmcvWorkerPool pool;
+        return pool;
+    }
+    int size() const { return (int)workers.size() + 1; }
+    void run(int task_num, const std::function<void(int)>& fn) {
+        if (task_num <= 1 || workers.empty() || in_task()) {
+            for (int i = 0; i < task_num; i++)
+                fn(i);
+            return;
+        }
+        std::lock_guard<std::mutex> run_lock(run_mtx);
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            job = &fn;
+            job_num = task_num;
+            next = 0;
+            busy = (int)workers.size();
+            generation++;
+        }
+        cv.notify_all();
+        work(fn, task_num);
+        std::unique_lock<std::mutex> lock(mtx);
+        done_cv.wait(lock, [this] { return busy == 0; });
+        job = NULL;
+    }
+
+private:
+    BmcvWorkerPool() {
+        int n = (int)std::thread::hardware_concurrency();
+        for (int i = 1; i < n; i++)
+            workers.push_back(std::thread(&BmcvWorkerPool::loop, this));
+    }
+    ~BmcvWorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stop = true;
+        }
+        cv.notify_all();
+        for (auto& t : workers)
+            t.join();
+    }
+    static bool& in_task() {
+        static thread_local bool flag = false;
+        return flag;
+    }
+    void work(const std::function<void(int)>& fn, int task_num) {
+        in_task() = true;
+        for (int i = next++; i < task_num; i = next++)
+            fn(i);
+        in_task() = false;
+    }
+    void loop() {
+        unsigned long long seen = 0;
+        while (true) {
+            const std::function<void(int)>* fn;
+            int task_num;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [&] { return stop || generation != seen; });
+                if (stop)
+                    return;
+                seen = generation;
+                fn = job;
+                task_num = job_num;
+            }
+            work(*fn, task_num);
+            std::lock_guard<std::mutex> lock(mtx);
+            if (--busy == 0)
+                done_cv.notify_one();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::mutex run_mtx;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::condition_variable done_cv;
+    const std::function<void(int)>* job = NULL;
+    int job_num = 0;
+    std::atomic<int> next{0};
+    int busy = 0;
+    unsigned long long generation = 0;
+    bool stop = false;
+};
+
+#endif
@@ -0,0 +1,163 @@
+#include <iostream>
+#include "bmcv_api_ext.h"
+#include "bmlib_runtime.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#ifdef __linux__
+#include <sys/time.h>
+#endif
+#include <vector>
+
+using namespace std;
+
+typedef struct {
+    int alloc_num;
+    int free_num;
+} count_ctx_t;
+
+static bm_status_t count_alloc(void *ctx, bm_handle_t handle, int heap_mask,
+                               unsigned int size, bm_device_mem_t *mem) {
+    ((count_ctx_t *)ctx)->alloc_num++;
+    return bm_malloc_device_byte_heap_mask(handle, mem, heap_mask, size);
+}
+
+static void count_free(void *ctx, bm_handle_t handle, bm_device_mem_t mem) {
+    ((count_ctx_t *)ctx)->free_num++;
+    bm_free_device(handle, mem);
+}
+
+#define POOL_CHECK(cond)                                                       \
+    do {                                                                       \
+        if (!(cond)) {                                                         \
+            printf("check failed: %s, line %d\n", #cond, __LINE__);            \
+            return -1;                                                         \
+        }                                                                      \
+    } while (0)
+
+static int test_pool_reuse(bm_handle_t handle, int height, int width, int format) {
+    count_ctx_t count = {0, 0};
+    bm_image_pool_allocator_t allocator = {count_alloc, count_free, &count};
+    bm_image_pool_t pool;
+    POOL_CHECK(BM_SUCCESS == bm_image_pool_create(handle, 2, &allocator, &pool));
+
+    bm_image img[3];
+    for (int i = 0; i < 3; i++) {
+        POOL_CHECK(BM_SUCCESS == bm_image_pool_acquire(pool, height, width,
+                   (bm_image_format_ext)format, DATA_TYPE_EXT_1N_BYTE, BMCV_HEAP_ANY, &img[i]));
+        POOL_CHECK(bm_image_is_attached(img[i]));
+        POOL_CHECK(img[i].height == height && img[i].width == width);
+    }
+    POOL_CHECK(count.alloc_num == 3);
+    // the first two released stay idle, the third goes past max_idle
+    for (int i = 0; i < 3; i++) {
+        POOL_CHECK(BM_SUCCESS == bm_image_pool_release(pool, img[i]));
+    }
+    POOL_CHECK(count.free_num == 1);
+    // released twice is rejected
+    POOL_CHECK(BM_SUCCESS != bm_image_pool_release(pool, img[2]));
+
+    // same geometry comes back without allocation, usable by an operator
+    bm_image again;
+    POOL_CHECK(BM_SUCCESS == bm_image_pool_acquire(pool, height, width,
+               (bm_image_format_ext)format, DATA_TYPE_EXT_1N_BYTE, BMCV_HEAP_ANY, &again));
+    POOL_CHECK(count.alloc_num == 3);
+    POOL_CHECK(again.image_private == img[2].image_private);
+    POOL_CHECK(again.height == height && again.width == width);
+    bm_image dst;
+    POOL_CHECK(BM_SUCCESS == bm_image_pool_acquire(pool, height, width,
+               (bm_image_format_ext)format, DATA_TYPE_EXT_1N_BYTE, BMCV_HEAP_ANY, &dst));
+    POOL_CHECK(dst.image_private == img[1].image_private);
+    POOL_CHECK(dst.height == height && dst.width == width);
+    int size[4] = {0};
+    POOL_CHECK(BM_SUCCESS == bm_image_get_byte_size(dst, size));
+    int total = size[0] + size[1] + size[2] + size[3];
+    vector<unsigned char> src_data(total), dst_data(total);
+    for (int i = 0; i < total; i++) src_data[i] = rand() % 256;
+    void* src_ptr[4] = {&src_data[0], &src_data[size[0]], &src_data[size[0] + size[1]],
+                        &src_data[size[0] + size[1] + size[2]]};
+    void* dst_ptr[4] = {&dst_data[0], &dst_data[size[0]], &dst_data[size[0] + size[1]],
+                        &dst_data[size[0] + size[1] + size[2]]};
+    POOL_CHECK(BM_SUCCESS == bm_image_copy_host_to_device(dst, src_ptr));
+    POOL_CHECK(BM_SUCCESS == bm_image_copy_device_to_host(dst, dst_ptr));
+    POOL_CHECK(src_data == dst_data);
+
+    // another geometry or heap does not take an idle image of this one
+    bm_image other;
+    POOL_CHECK(BM_SUCCESS == bm_image_pool_acquire(pool, height / 2, width / 2,
+               (bm_image_format_ext)format, DATA_TYPE_EXT_1N_BYTE, BMCV_HEAP_ANY, &other));
+    POOL_CHECK(count.alloc_num == 4);
+    POOL_CHECK(other.height == height / 2 && other.width == width / 2);
+    POOL_CHECK(BM_SUCCESS == bm_image_pool_release(pool, other));
+
+    bm_image_pool_stat_t stat;
+    POOL_CHECK(BM_SUCCESS == bm_image_pool_get_stat(pool, &stat));
+    POOL_CHECK(stat.acquire_num == 6 && stat.hit_num == 2);
+    POOL_CHECK(stat.release_num == 4 && stat.trim_num == 1);
+    POOL_CHECK(stat.in_use_num == 2 && stat.idle_num == 1);
+    POOL_CHECK(stat.peak_in_use_num == 3);
+
+    POOL_CHECK(BM_SUCCESS == bm_image_pool_release(pool, again));
+    POOL_CHECK(BM_SUCCESS == bm_image_pool_release(pool, dst));
+    POOL_CHECK(BM_SUCCESS == bm_image_pool_trim(pool, 0));
+    POOL_CHECK(BM_SUCCESS == bm_image_pool_get_stat(pool, &stat));
+    POOL_CHECK(stat.idle_num == 0 && stat.idle_bytes == 0 && stat.total_bytes == 0);
+    POOL_CHECK(count.free_num == 4);
+    POOL_CHECK(BM_SUCCESS == bm_image_pool_destroy(pool));
+    POOL_CHECK(count.free_num == count.alloc_num);
+    return 0;
+}
+
+static int test_pool_perf(bm_handle_t handle, int height, int width, int format, int loop) {
+    bm_image_pool_t pool;
+    POOL_CHECK(BM_SUCCESS == bm_image_pool_create(handle, 4, NULL, &pool));
+    struct timeval t1, t2, t3;
+    bm_image img;
+    gettimeofday(&t1, NULL);
+    for (int i = 0; i < loop; i++) {
+        bm_image_create(handle, height, width, (bm_image_format_ext)format,
+                        DATA_TYPE_EXT_1N_BYTE, &img);
+        POOL_CHECK(BM_SUCCESS == bm_image_alloc_dev_mem(img, BMCV_HEAP_ANY));
+        bm_image_destroy(img);
+    }
+    gettimeofday(&t2, NULL);
+    for (int i = 0; i < loop; i++) {
+        POOL_CHECK(BM_SUCCESS == bm_image_pool_acquire(pool, height, width,
+                   (bm_image_format_ext)format, DATA_TYPE_EXT_1N_BYTE, BMCV_HEAP_ANY, &img));
+        POOL_CHECK(img.height == height && img.width == width);
+        bm_image_pool_release(pool, img);
+    }
+    gettimeofday(&t3, NULL);
+    cout << "create/alloc/destroy: "
+         << ((t2.tv_sec - t1.tv_sec) * 1000000 + t2.tv_usec - t1.tv_usec) / loop << "us, "
+         << "pool acquire/release: "
+         << ((t3.tv_sec - t2.tv_sec) * 1000000 + t3.tv_usec - t2.tv_usec) / loop << "us" << endl;
+    bm_image_pool_destroy(pool);
+    return 0;
+}
+
+int main(int argc, char* args[]) {
+    int loop = 100;
+    int height = 1080;
+    int width = 1920;
+    int format = FORMAT_YUV420P;
+    if (argc > 1) loop = atoi(args[1]);
+    if (argc > 2) height = atoi(args[2]);
+    if (argc > 3) width = atoi(args[3]);
+    if (argc > 4) format = atoi(args[4]);
+    bm_handle_t handle;
+    bm_status_t ret = bm_dev_request(&handle, 0);
+    if (ret != BM_SUCCESS) {
+        printf("Create bm handle failed. ret = %d\n", ret);
+        return -1;
+    }
+    if (test_pool_reuse(handle, height, width, format) ||
+        test_pool_perf(handle, height, width, format, loop)) {
+        cout << "test image pool failed" << endl;
+        bm_dev_free(handle);
+        return -1;
+    }
+    bm_dev_free(handle);
+    cout << "test image pool successfully!" << endl;
+    return 0;
+}
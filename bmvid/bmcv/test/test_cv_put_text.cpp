@@ -294,6 +294,63 @@ static int test_put_text_random(
     return ret;
 }
 
+static int test_put_text_batch(
+        int height,
+        int width,
+        int format) {
+    const char* texts[4] = {"cam 03", "2023-01-01 12:00:00", "person 0.98", "car 0.75"};
+    bmcv_point_t orgs[4] = {{20, 40}, {width / 2, 40}, {width / 3, height / 2}, {width / 3, height / 2 + 20}};
+    bmcv_color_t color = {0, 255, 0};
+    float fontScale = 1.5;
+    int thickness = 2;
+    vector<int> img_size = get_image_size(format, width, height);
+    int total_sz = 0;
+    for (auto sz : img_size) {
+        total_sz += sz;
+    }
+    unsigned char* data_cpu = new unsigned char [width * height * 3];
+    unsigned char* data_bmcv = new unsigned char [width * height * 3];
+    fill(data_cpu, width, height);
+    memcpy(data_bmcv, data_cpu, width * height * 3);
+
+    // cpu: one string after another on the whole image
+    unsigned char* cpu_ptr[3] = {data_cpu, data_cpu + img_size[0], data_cpu + img_size[0] + img_size[1]};
+    int step[3];
+    get_image_default_step(format, width, step);
+    bmMat mat;
+    mat.width = width;
+    mat.height = height;
+    mat.format = (bm_image_format_ext)format;
+    mat.step = step;
+    mat.data = (void**)cpu_ptr;
+    for (int i = 0; i < 4; i++) {
+        put_text(mat, texts[i], orgs[i], 0, fontScale, color, thickness);
+    }
+
+    bm_handle_t handle;
+    bm_status_t ret = bm_dev_request(&handle, 0);
+    if (ret != BM_SUCCESS) {
+        printf("Create bm handle failed. ret = %d\n", ret);
+        delete [] data_cpu;
+        delete [] data_bmcv;
+        return -1;
+    }
+    bm_image input_img;
+    bm_image_create(handle, height, width, (bm_image_format_ext)format, DATA_TYPE_EXT_1N_BYTE, &input_img);
+    bm_image_alloc_dev_mem(input_img);
+    unsigned char* in_ptr[3] = {data_bmcv, data_bmcv + img_size[0], data_bmcv + img_size[0] + img_size[1]};
+    bm_image_copy_host_to_device(input_img, (void **)in_ptr);
+    ret = bmcv_image_put_text_batch(handle, input_img, texts, orgs, 4, color, fontScale, thickness);
+    bm_image_copy_device_to_host(input_img, (void **)in_ptr);
+    bm_image_destroy(input_img);
+    bm_dev_free(handle);
+
+    int cmp_ret = ret == BM_SUCCESS ? cmp(data_bmcv, data_cpu, total_sz) : -1;
+    delete [] data_cpu;
+    delete [] data_bmcv;
+    return cmp_ret;
+}
+
 int main(int argc, char* args[]) {
     int random = 1;
     int loop = 1;
@@ -314,6 +371,11 @@ int main(int argc, char* args[]) {
             cout << "test put_text failed" << endl;
             return ret;
         }
+        ret = test_put_text_batch(height, width, format);
+        if (ret) {
+            cout << "test put_text batch failed" << endl;
+            return ret;
+        }
     }
     cout << "Compare TPU result with CPU successfully!" << endl;
     return 0;
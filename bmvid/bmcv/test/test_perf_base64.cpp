@@ -0,0 +1,73 @@
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <vector>
+#include "bmcv_api_ext.h"
+#include "bmlib_runtime.h"
+
+using namespace std;
+
+/* host codec vs the engine (BMCV_BASE64_ENGINE=1) on system memory
+ * usage: test_perf_base64 [loop] */
+static long run_us(bm_handle_t handle, bool engine, bool enc, int loop,
+                   unsigned char* src, unsigned char* dst, unsigned long len) {
+    setenv("BMCV_BASE64_ENGINE", engine ? "1" : "0", 1);
+    struct timeval t1, t2;
+    gettimeofday(&t1, NULL);
+    for (int i = 0; i < loop; i++) {
+        unsigned long lenth[2] = {len, 0};
+        bm_status_t ret = enc ? bmcv_base64_enc(handle, bm_mem_from_system(src),
+                                                bm_mem_from_system(dst), lenth)
+                              : bmcv_base64_dec(handle, bm_mem_from_system(src),
+                                                bm_mem_from_system(dst), lenth);
+        if (ret != BM_SUCCESS) {
+            printf("base64 %s failed, ret = %d\n", engine ? "engine" : "host", ret);
+            return -1;
+        }
+    }
+    gettimeofday(&t2, NULL);
+    return ((t2.tv_sec - t1.tv_sec) * 1000000 + t2.tv_usec - t1.tv_usec) / loop;
+}
+
+int main(int argc, char* argv[]) {
+    int loop = argc > 1 ? atoi(argv[1]) : 10;
+    bm_handle_t handle;
+    bm_status_t ret = bm_dev_request(&handle, 0);
+    if (ret != BM_SUCCESS) {
+        printf("Create bm handle failed. ret = %d\n", ret);
+        return -1;
+    }
+    unsigned long sizes[] = {1 << 10, 4 << 10, 16 << 10, 64 << 10, 256 << 10,
+                             1 << 20, 3 << 20, 16 << 20};
+    int res = 0;
+    for (unsigned long len : sizes) {
+        unsigned long enc_len = (len + 2) / 3 * 4;
+        vector<unsigned char> src(len), enc_host(enc_len), enc_engine(enc_len);
+        vector<unsigned char> dec_host(len + 3), dec_engine(len + 3);
+        for (unsigned long i = 0; i < len; i++) src[i] = rand() % 256;
+
+        long enc_host_us = run_us(handle, false, true, loop, src.data(), enc_host.data(), len);
+        long enc_engine_us = run_us(handle, true, true, loop, src.data(), enc_engine.data(), len);
+        long dec_host_us = run_us(handle, false, false, loop, enc_host.data(), dec_host.data(), enc_len);
+        long dec_engine_us = run_us(handle, true, false, loop, enc_host.data(), dec_engine.data(), enc_len);
+        if (enc_host_us < 0 || enc_engine_us < 0 || dec_host_us < 0 || dec_engine_us < 0) {
+            res = -1;
+            break;
+        }
+        if (enc_host != enc_engine || memcmp(dec_host.data(), src.data(), len) ||
+            memcmp(dec_engine.data(), src.data(), len)) {
+            printf("len %lu: host and engine results differ\n", len);
+            res = -1;
+            break;
+        }
+        printf("len %8lu: enc host %6ldus engine %6ldus, dec host %6ldus engine %6ldus\n",
+               len, enc_host_us, enc_engine_us, dec_host_us, dec_engine_us);
+    }
+    unsetenv("BMCV_BASE64_ENGINE");
+    bm_dev_free(handle);
+    if (res == 0)
+        cout << "test base64 perf successfully!" << endl;
+    return res;
+}
@@ -0,0 +1,150 @@
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <vector>
+#include "bmcv_api_ext.h"
+#include "bmlib_runtime.h"
+#include "test_misc.h"
+
+using namespace std;
+
+/* host backend vs TPU (BMCV_FAISS_BACKEND=cpu/tpu) for indexflatL2 and
+ * indexPQ_ADC on device memory, over growing database sizes
+ * usage: test_perf_faiss [loop] [query_num] */
+struct dev_buf {
+    bm_handle_t handle;
+    bm_device_mem_t mem;
+    dev_buf(bm_handle_t h, size_t size) : handle(h) {
+        if (BM_SUCCESS != bm_malloc_device_byte(h, &mem, size)) {
+            printf("bm_malloc_device_byte %zu failed\n", size);
+            exit(-1);
+        }
+    }
+    ~dev_buf() { bm_free_device(handle, mem); }
+};
+
+static long time_us(const char* backend, int loop, bm_status_t (*fn)(void*), void* ctx) {
+    setenv("BMCV_FAISS_BACKEND", backend, 1);
+    struct timeval t1, t2;
+    gettimeofday(&t1, NULL);
+    for (int i = 0; i < loop; i++) {
+        if (BM_SUCCESS != fn(ctx)) {
+            printf("faiss %s failed\n", backend);
+            return -1;
+        }
+    }
+    gettimeofday(&t2, NULL);
+    return ((t2.tv_sec - t1.tv_sec) * 1000000 + t2.tv_usec - t1.tv_usec) / loop;
+}
+
+struct flat_ctx {
+    bm_handle_t handle;
+    dev_buf *query, *db, *query_norm, *db_norm, *buffer, *dist, *index;
+    int d, nq, ndb, k;
+};
+
+static bm_status_t run_flat(void* p) {
+    flat_ctx* c = (flat_ctx*)p;
+    return bmcv_faiss_indexflatL2(c->handle, c->query->mem, c->db->mem, c->query_norm->mem,
+                                  c->db_norm->mem, c->buffer->mem, c->dist->mem, c->index->mem,
+                                  c->d, c->nq, c->ndb, c->k, 1, DT_FP32, DT_FP32);
+}
+
+struct adc_ctx {
+    bm_handle_t handle;
+    dev_buf *centroids, *query, *codes, *dist, *index;
+    int d, m, ksub, ny, nx, k;
+};
+
+static bm_status_t run_adc(void* p) {
+    adc_ctx* c = (adc_ctx*)p;
+    return bmcv_faiss_indexPQ_ADC(c->handle, c->centroids->mem, c->query->mem, c->codes->mem,
+                                  c->dist->mem, c->index->mem, c->d, c->m, c->ksub, c->ny,
+                                  c->nx, c->k, 0);
+}
+
+static void fill_device(bm_handle_t handle, dev_buf& buf, size_t size, bool bytes) {
+    vector<unsigned char> host(size);
+    if (bytes) {
+        for (size_t i = 0; i < size; i++) host[i] = rand() % 256;
+    } else {
+        float* f = (float*)host.data();
+        for (size_t i = 0; i < size / sizeof(float); i++) f[i] = (float)rand() / RAND_MAX;
+    }
+    bm_memcpy_s2d(handle, buf.mem, host.data());
+}
+
+/* the two backends may order equal distances differently, count index mismatches */
+static int index_diff(bm_handle_t handle, void* ctx, bm_status_t (*fn)(void*), dev_buf& index, int n) {
+    vector<int> cpu(n), tpu(n);
+    setenv("BMCV_FAISS_BACKEND", "cpu", 1);
+    fn(ctx);
+    bm_memcpy_d2s(handle, cpu.data(), index.mem);
+    setenv("BMCV_FAISS_BACKEND", "tpu", 1);
+    fn(ctx);
+    bm_memcpy_d2s(handle, tpu.data(), index.mem);
+    int diff = 0;
+    for (int i = 0; i < n; i++) diff += cpu[i] != tpu[i];
+    return diff;
+}
+
+int main(int argc, char* argv[]) {
+    int loop = argc > 1 ? atoi(argv[1]) : 5;
+    int nq = argc > 2 ? atoi(argv[2]) : 16;
+    bm_handle_t handle;
+    bm_status_t ret = bm_dev_request(&handle, 0);
+    if (ret != BM_SUCCESS) {
+        printf("Create bm handle failed. ret = %d\n", ret);
+        return -1;
+    }
+    int res = 0;
+    int d = 256, k = 100;
+    int db_sizes[] = {1000, 10000, 100000, 500000};
+    for (int ndb : db_sizes) {
+        dev_buf query(handle, (size_t)nq * d * 4), db(handle, (size_t)ndb * d * 4);
+        dev_buf query_norm(handle, (size_t)nq * 4), db_norm(handle, (size_t)ndb * 4);
+        dev_buf buffer(handle, (size_t)nq * ndb * 4);
+        dev_buf dist(handle, (size_t)nq * k * 4), index(handle, (size_t)nq * k * 4);
+        fill_device(handle, query, (size_t)nq * d * 4, false);
+        fill_device(handle, db, (size_t)ndb * d * 4, false);
+        fill_device(handle, query_norm, (size_t)nq * 4, false);
+        fill_device(handle, db_norm, (size_t)ndb * 4, false);
+        flat_ctx ctx = {handle, &query, &db, &query_norm, &db_norm, &buffer, &dist, &index, d, nq, ndb, k};
+        long cpu_us = time_us("cpu", loop, run_flat, &ctx);
+        long tpu_us = time_us("tpu", loop, run_flat, &ctx);
+        if (cpu_us < 0 || tpu_us < 0) {
+            res = -1;
+            break;
+        }
+        printf("indexflatL2 d %d nq %d ndb %7d: cpu %8ldus tpu %8ldus, index diff %d\n", d, nq, ndb,
+               cpu_us, tpu_us, index_diff(handle, &ctx, run_flat, index, nq * k));
+    }
+    int m = 32, ksub = 256;
+    int ny_sizes[] = {10000, 100000, 1000000};
+    for (int ny : ny_sizes) {
+        if (res != 0)
+            break;
+        dev_buf centroids(handle, (size_t)ksub * d * 4), query(handle, (size_t)nq * d * 4);
+        dev_buf codes(handle, (size_t)ny * m);
+        dev_buf dist(handle, (size_t)nq * k * 4), index(handle, (size_t)nq * k * 4);
+        fill_device(handle, centroids, (size_t)ksub * d * 4, false);
+        fill_device(handle, query, (size_t)nq * d * 4, false);
+        fill_device(handle, codes, (size_t)ny * m, true);
+        adc_ctx ctx = {handle, &centroids, &query, &codes, &dist, &index, d, m, ksub, ny, nq, k};
+        long cpu_us = time_us("cpu", loop, run_adc, &ctx);
+        long tpu_us = time_us("tpu", loop, run_adc, &ctx);
+        if (cpu_us < 0 || tpu_us < 0) {
+            res = -1;
+            break;
+        }
+        printf("indexPQ_ADC m %d ksub %d nx %d ny %7d: cpu %8ldus tpu %8ldus, index diff %d\n", m,
+               ksub, nq, ny, cpu_us, tpu_us, index_diff(handle, &ctx, run_adc, index, nq * k));
+    }
+    unsetenv("BMCV_FAISS_BACKEND");
+    bm_dev_free(handle);
+    if (res == 0)
+        cout << "test faiss perf successfully!" << endl;
+    return res;
+}
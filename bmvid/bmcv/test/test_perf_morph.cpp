@@ -0,0 +1,136 @@
+#include <iostream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <vector>
+#include <algorithm>
+#include "bmcv_api_ext.h"
+#include "bmlib_runtime.h"
+
+using namespace std;
+
+/* erode/dilate over growing kernel sizes against a host loop over every
+ * kernel point, the way the ARM side computed it before, then in place
+ * usage: test_perf_morph [loop] [height] [width] */
+static void morph_ref(const unsigned char* src, unsigned char* dst, const vector<unsigned char>& kernel,
+                      int kw, int kh, int width, int height, int op) {
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int v = op ? 0 : 255;
+            for (int i = 0; i < kh; i++) {
+                for (int j = 0; j < kw; j++) {
+                    if (!kernel[i * kw + j]) continue;
+                    int sy = y + i - kh / 2, sx = x + j - kw / 2;
+                    int s = (sy < 0 || sy >= height || sx < 0 || sx >= width) ? v : src[sy * width + sx];
+                    v = op ? max(v, s) : min(v, s);
+                }
+            }
+            dst[y * width + x] = v;
+        }
+    }
+}
+
+static vector<unsigned char> make_kernel(int shape, int k) {
+    vector<unsigned char> kernel(k * k);
+    for (int i = 0; i < k; i++)
+        for (int j = 0; j < k; j++)
+            kernel[i * k + j] = shape == BM_MORPH_RECT || i == k / 2 || j == k / 2;
+    return kernel;
+}
+
+int main(int argc, char* argv[]) {
+    int loop = argc > 1 ? atoi(argv[1]) : 5;
+    int height = argc > 2 ? atoi(argv[2]) : 1080;
+    int width = argc > 3 ? atoi(argv[3]) : 1920;
+    bm_handle_t handle;
+    bm_status_t ret = bm_dev_request(&handle, 0);
+    if (ret != BM_SUCCESS) {
+        printf("Create bm handle failed. ret = %d\n", ret);
+        return -1;
+    }
+    ret = bmcv_open_cpu_process(handle);
+    if (ret != BM_SUCCESS) {
+        printf("BMCV enable CPU failed. ret = %d\n", ret);
+        bm_dev_free(handle);
+        return -1;
+    }
+    // a binary mask, the usual input of large kernels
+    vector<unsigned char> src(width * height), dst(width * height), ref(width * height);
+    for (int i = 0; i < width * height; i++) src[i] = (rand() % 16 == 0) ? 255 : 0;
+    bm_image img_i, img_o;
+    bm_image_create(handle, height, width, FORMAT_GRAY, DATA_TYPE_EXT_1N_BYTE, &img_i);
+    bm_image_create(handle, height, width, FORMAT_GRAY, DATA_TYPE_EXT_1N_BYTE, &img_o);
+    bm_image_alloc_dev_mem(img_i);
+    bm_image_alloc_dev_mem(img_o);
+    unsigned char* in_ptr[1] = {src.data()};
+    bm_image_copy_host_to_device(img_i, (void**)in_ptr);
+
+    int res = 0;
+    const char* shape_str[] = {"rect", "cross"};
+    int shapes[] = {BM_MORPH_RECT, BM_MORPH_CROSS};
+    for (int s = 0; s < 2 && res == 0; s++) {
+        vector<int> sizes = {3, 5, 7, 9, 15, 21, 31};
+        // cross rows wider than 32 take the van Herk/Gil-Werman scans
+        if (shapes[s] == BM_MORPH_CROSS) {
+            sizes.push_back(45);
+            sizes.push_back(63);
+        }
+        for (int k : sizes) {
+            bm_device_mem_t kmem = bmcv_get_structuring_element(handle, (bmcv_morph_shape_t)shapes[s], k, k);
+            for (int op = 0; op < 2 && res == 0; op++) {
+                struct timeval t1, t2, t3;
+                gettimeofday(&t1, NULL);
+                for (int i = 0; i < loop; i++) {
+                    ret = op ? bmcv_image_dilate(handle, img_i, img_o, k, k, kmem)
+                             : bmcv_image_erode(handle, img_i, img_o, k, k, kmem);
+                    if (ret != BM_SUCCESS) {
+                        printf("morph %s %dx%d failed, ret = %d\n", shape_str[s], k, k, ret);
+                        res = -1;
+                        break;
+                    }
+                }
+                gettimeofday(&t2, NULL);
+                morph_ref(src.data(), ref.data(), make_kernel(shapes[s], k), k, k, width, height, op);
+                gettimeofday(&t3, NULL);
+                if (res != 0)
+                    break;
+                unsigned char* out_ptr[1] = {dst.data()};
+                bm_image_copy_device_to_host(img_o, (void**)out_ptr);
+                if (dst != ref) {
+                    printf("morph %s %dx%d op %d: result differs from reference\n", shape_str[s], k, k, op);
+                    res = -1;
+                    break;
+                }
+                printf("%-5s %2dx%-2d %-6s: bmcv %8ldus, per point reference %8ldus\n",
+                       shape_str[s], k, k, op ? "dilate" : "erode",
+                       ((t2.tv_sec - t1.tv_sec) * 1000000 + t2.tv_usec - t1.tv_usec) / loop,
+                       (t3.tv_sec - t2.tv_sec) * 1000000 + t3.tv_usec - t2.tv_usec);
+            }
+            bm_free_device(handle, kmem);
+        }
+    }
+    // output image is the input image
+    for (int k : {3, 45}) {
+        if (res != 0)
+            break;
+        bm_device_mem_t kmem = bmcv_get_structuring_element(handle, BM_MORPH_CROSS, k, k);
+        bm_image_copy_host_to_device(img_o, (void**)in_ptr);
+        ret = bmcv_image_erode(handle, img_o, img_o, k, k, kmem);
+        bm_free_device(handle, kmem);
+        morph_ref(src.data(), ref.data(), make_kernel(BM_MORPH_CROSS, k), k, k, width, height, 0);
+        unsigned char* out_ptr[1] = {dst.data()};
+        bm_image_copy_device_to_host(img_o, (void**)out_ptr);
+        if (ret != BM_SUCCESS || dst != ref) {
+            printf("in place cross %dx%d erode failed, ret = %d\n", k, k, ret);
+            res = -1;
+        }
+    }
+    bm_image_destroy(img_i);
+    bm_image_destroy(img_o);
+    bmcv_close_cpu_process(handle);
+    bm_dev_free(handle);
+    if (res == 0)
+        cout << "test morph perf successfully!" << endl;
+    return res;
+}
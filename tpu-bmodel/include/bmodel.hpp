@@ -10,6 +10,8 @@
 #include <stdint.h>
 #include <fstream>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 #include "model_generated.h"
@@ -140,10 +142,15 @@ private:
   uint32_t bmodel_type_; // 0: bmodel coeff do not combine; 1: bmodel coeff has been combine
 };
 
+// read-only mapping of a bmodel file, shared by all ModelCtx of the same file
+struct MappedFile;
+
 class ModelCtx {
  public:
+  // use_mmap: map the file instead of reading it through fstream, binaries are
+  // served from the mapping. Not supported with decrypt, falls back to fstream.
   ModelCtx(const std::string &filename, const std::string &decrypt_lib = "",
-           decrypt_func f = nullptr);
+           decrypt_func f = nullptr, bool use_mmap = false);
   ModelCtx(const void *bmodel_data, size_t size);
   virtual ~ModelCtx();
   operator bool();
@@ -162,9 +169,18 @@ class ModelCtx {
   void write_binary(const bmodel::Binary *binary, uint64_t offset,
                     uint8_t *buffer, uint64_t size);
   uint8_t *decrypt_file(const std::string &filename, uint64_t *out_size);
+  // pointer to binary data without copy, NULL if bmodel is read from file stream
+  const uint8_t *binary_data(const bmodel::Binary *binary, uint64_t offset = 0) const;
+  // hint that binary will be read sequentially, only takes effect on mmap bmodel
+  void advise_sequential(const bmodel::Binary *binary);
+  // hint that [offset, offset + size) of binary will be read soon, only takes effect on mmap bmodel
+  void prefetch_binary(const bmodel::Binary *binary, uint64_t offset, uint64_t size);
+  bool is_mmap() const;
 
   // model buffer data for parse
   const void *data() const;
+  // bytes held by data(), differs from header().flatbuffers_size if decrypted
+  uint64_t data_size() const;
 
   const MODEL_HEADER_T &header() const;
 
@@ -182,15 +198,20 @@ class ModelCtx {
   void decrypt_bmodel(const std::string &filename);
   uint8_t *decrypt_buffer_from_file(uint64_t file_start, uint64_t size,
                                     uint64_t *out_size);
+  bool map_bmodel(const std::string &filename);
+  void advise_range(uint64_t file_start, uint64_t size, int advice);
 
  private:
   MODEL_HEADER_T header_;
   ModelGen *model_gen_;
   const Model *model_;
   void *model_buffer_;
+  uint64_t model_buffer_size_;
   uint64_t binary_offset_;
   std::fstream file_;          // bmodel in file
+  std::mutex file_mutex_;      // read_binary may be called from several threads
   const void *bmodel_pointer_;  // bmodel in buffer
+  std::shared_ptr<MappedFile> mapping_; // bmodel in mmap, bmodel_pointer_ points to it
   // decrypt
   std::string decrypt_lib_; // lib path by user, such as libcipher.so to decrypt
   void *decrypt_handle_;    // handle of decrypt lib
@@ -8,10 +8,17 @@
 #include "bmodel.hpp"
 #include <memory.h>
 #include <stdlib.h>
+#include <algorithm>
 #include <ctime>
 #include <iostream>
+#include <mutex>
+#include <tuple>
 #ifdef __linux__
 #include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 using bmodel::Binary;
@@ -495,10 +502,73 @@ uint64_t ModelGen::BufferSize() {
 //===------------------------------------------------------------===//
 // ModelCtx
 //===------------------------------------------------------------===//
-ModelCtx::ModelCtx(const string &filename, const string &decrypt_lib, decrypt_func f)
-  : model_gen_(NULL), model_(NULL), bmodel_pointer_(NULL),
+namespace bmodel {
+struct MappedFile {
+  void *addr;
+  size_t size;
+  MappedFile(void *addr, size_t size) : addr(addr), size(size) {}
+  ~MappedFile() {
+#ifdef __linux__
+    munmap(addr, size);
+#endif
+  }
+};
+}  // namespace bmodel
+
+#ifdef __linux__
+// the same file(device, inode, size, mtime) is mapped only once in a process
+typedef std::tuple<dev_t, ino_t, off_t, time_t, long> mapping_key_t;
+static std::mutex mapping_mutex;
+static std::map<mapping_key_t, std::weak_ptr<bmodel::MappedFile>> mapping_dict;
+
+static std::shared_ptr<bmodel::MappedFile> get_file_mapping(const string &filename)
+{
+  int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    close(fd);
+    return nullptr;
+  }
+  mapping_key_t key(st.st_dev, st.st_ino, st.st_size, st.st_mtim.tv_sec, st.st_mtim.tv_nsec);
+
+  std::lock_guard<std::mutex> guard(mapping_mutex);
+  auto iter = mapping_dict.find(key);
+  if (iter != mapping_dict.end()) {
+    auto mapping = iter->second.lock();
+    if (mapping) {
+      close(fd);
+      return mapping;
+    }
+  }
+  void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (addr == MAP_FAILED) {
+    return nullptr;
+  }
+  auto mapping = std::make_shared<bmodel::MappedFile>(addr, st.st_size);
+  for (auto it = mapping_dict.begin(); it != mapping_dict.end();) {
+    it = it->second.expired() ? mapping_dict.erase(it) : std::next(it);
+  }
+  mapping_dict[key] = mapping;
+  return mapping;
+}
+#endif
+
+ModelCtx::ModelCtx(const string &filename, const string &decrypt_lib, decrypt_func f, bool use_mmap)
+  : model_gen_(NULL), model_(NULL), model_buffer_(NULL), model_buffer_size_(0), binary_offset_(0),
+    bmodel_pointer_(NULL),
     decrypt_lib_(decrypt_lib), decrypt_handle_(nullptr), decrypt_func_(f)
 {
+  if (use_mmap) {
+    if (!decrypt_lib_.empty() || decrypt_func_ != nullptr) {
+      BMODEL_LOG(WARNING) << "File[" << filename << "] is encrypted, read it instead of mmap." << std::endl;
+    } else if (map_bmodel(filename)) {
+      return;
+    }
+  }
   // read file
   // when read encrypted bmodel, only to read, not to write
   if (!decrypt_lib_.empty() || decrypt_func_ != nullptr) {
@@ -541,6 +611,7 @@ ModelCtx::ModelCtx(const string &filename, const string &decrypt_lib, decrypt_fu
   binary_offset_ = header_.header_size + header_.flatbuffers_size;
   model_buffer_ = (void *)malloc(header_.flatbuffers_size);
   ASSERT(model_buffer_ != NULL);
+  model_buffer_size_ = header_.flatbuffers_size;
   file_.read((char *)model_buffer_, header_.flatbuffers_size);
   flatbuffers::Verifier v((uint8_t *)model_buffer_, header_.flatbuffers_size);
   if (!bmodel::VerifyModelBuffer(v)) {
@@ -601,6 +672,7 @@ uint8_t *ModelCtx::decrypt_buffer_from_file(uint64_t file_start, uint64_t size,
     BMODEL_LOG(FATAL) << "out_size is null" << std::endl;
     return nullptr;
   }
+  std::lock_guard<std::mutex> guard(file_mutex_);
   file_.seekg(file_start, std::ios::beg);
   if (file_.fail()) {
     BMODEL_LOG(FATAL) << "Failed to seek to the specified position." << std::endl;
@@ -680,6 +752,7 @@ void ModelCtx::decrypt_bmodel(const std::string &filename) {
     throw std::runtime_error("failed to load bmodel");
   }
   memcpy(model_buffer_, decrypted_flat_data, decrypted_flat_size);
+  model_buffer_size_ = decrypted_flat_size;
 
   // free
   free(decrypted_header_data);
@@ -749,8 +822,103 @@ uint8_t *ModelCtx::read_binary_with_decrypt(const Binary *binary,
   return output;
 }
 
+// map bmodel file and verify flatbuffers in place, false to fall back to fstream
+bool ModelCtx::map_bmodel(const string &filename)
+{
+#ifdef __linux__
+  auto mapping = get_file_mapping(filename);
+  if (!mapping) {
+    BMODEL_LOG(WARNING) << "File[" << filename << "] mmap failed, read it instead." << std::endl;
+    return false;
+  }
+  auto base = (const uint8_t *)mapping->addr;
+  if (mapping->size <= sizeof(header_)) {
+    BMODEL_LOG(FATAL) << "File[" << filename << "] is broken ." << std::endl;
+    throw std::runtime_error("failed to construct");
+  }
+
+  // read header and check
+  memcpy(&header_, base, sizeof(header_));
+  if (header_.magic != BMODEL_MAGIC) {
+    BMODEL_LOG(FATAL) << "File[" << filename << "] is broken .." << std::endl;
+    throw std::runtime_error("failed to construct");
+  }
+  if (mapping->size < header_.header_size + header_.flatbuffers_size + header_.binary_size) {
+    BMODEL_LOG(FATAL) << "File[" << filename << "] is broken ..." << std::endl;
+    throw std::runtime_error("failed to construct");
+  }
+  const uint8_t *flat_buffer = base + header_.header_size;
+  if ((uintptr_t)flat_buffer % sizeof(uint64_t) != 0) {
+    BMODEL_LOG(WARNING) << "File[" << filename << "] flatbuffers is not aligned, read it instead." << std::endl;
+    return false;
+  }
+  flatbuffers::Verifier v(flat_buffer, header_.flatbuffers_size);
+  if (!bmodel::VerifyModelBuffer(v)) {
+    BMODEL_LOG(FATAL) << "Model file[" << filename << "] is broken." << std::endl;
+    throw std::runtime_error("failed to construct");
+  }
+  binary_offset_ = header_.header_size + header_.flatbuffers_size;
+  model_ = bmodel::GetModel(flat_buffer);
+  mapping_ = mapping;
+  bmodel_pointer_ = base;
+  update_bmodel();
+  return true;
+#else
+  BMODEL_LOG(WARNING) << "mmap is only supported on linux, read file[" << filename << "] instead." << std::endl;
+  return false;
+#endif
+}
+
+bool ModelCtx::is_mmap() const
+{
+  return mapping_ != nullptr;
+}
+
+const uint8_t *ModelCtx::binary_data(const Binary *binary, uint64_t offset) const
+{
+  ASSERT(binary != NULL);
+  ASSERT(offset <= binary->size());
+  if (bmodel_pointer_ == NULL) {
+    return NULL;
+  }
+  return (const uint8_t *)bmodel_pointer_ + binary_offset_ + binary->start() + offset;
+}
+
+void ModelCtx::advise_range(uint64_t file_start, uint64_t size, int advice)
+{
+#ifdef __linux__
+  if (!mapping_ || size == 0) {
+    return;
+  }
+  uintptr_t page_size = sysconf(_SC_PAGESIZE);
+  uintptr_t start = (uintptr_t)bmodel_pointer_ + file_start;
+  uintptr_t aligned_start = start & ~(page_size - 1);
+  madvise((void *)aligned_start, start + size - aligned_start, advice);
+#endif
+}
+
+void ModelCtx::advise_sequential(const Binary *binary)
+{
+  ASSERT(binary != NULL);
+#ifdef __linux__
+  advise_range(binary_offset_ + binary->start(), binary->size(), MADV_SEQUENTIAL);
+#endif
+}
+
+void ModelCtx::prefetch_binary(const Binary *binary, uint64_t offset, uint64_t size)
+{
+  ASSERT(binary != NULL);
+  if (offset >= binary->size()) {
+    return;
+  }
+  size = std::min(size, binary->size() - offset);
+#ifdef __linux__
+  advise_range(binary_offset_ + binary->start() + offset, size, MADV_WILLNEED);
+#endif
+}
+
 ModelCtx::ModelCtx(const void *bmodel_data, size_t size)
-    : model_gen_(NULL), model_(NULL), model_buffer_(NULL),
+    : model_gen_(NULL), model_(NULL), model_buffer_(NULL), model_buffer_size_(0),
       bmodel_pointer_(NULL), decrypt_handle_(NULL) {
   ASSERT(bmodel_data != NULL);
   if (size <= sizeof(header_)) {
@@ -772,6 +940,7 @@ ModelCtx::ModelCtx(const void *bmodel_data, size_t size)
   binary_offset_ = header_.header_size + header_.flatbuffers_size;
   model_buffer_ = (void *)malloc(header_.flatbuffers_size);
   ASSERT(model_buffer_ != NULL);
+  model_buffer_size_ = header_.flatbuffers_size;
   memcpy(model_buffer_, (uint8_t *)bmodel_data + header_.header_size,
          header_.flatbuffers_size);
   flatbuffers::Verifier v((uint8_t *)model_buffer_, header_.flatbuffers_size);
@@ -820,9 +989,20 @@ ModelCtx::~ModelCtx()
 
 const void *ModelCtx::data() const
 {
+  if (model_buffer_ == NULL && mapping_) {
+    return (const uint8_t *)bmodel_pointer_ + header_.header_size;
+  }
   return model_buffer_;
 }
 
+uint64_t ModelCtx::data_size() const
+{
+  if (model_buffer_ == NULL && mapping_) {
+    return header_.flatbuffers_size;
+  }
+  return model_buffer_size_;
+}
+
 const bmodel::MODEL_HEADER_T &ModelCtx::header() const
 {
     return header_;
@@ -840,6 +1020,7 @@ void ModelCtx::read_binary(const Binary *binary, uint64_t offset, uint8_t *buffe
   ASSERT(buffer != NULL);
   ASSERT(size + offset <= binary->size());
   if (bmodel_pointer_ == NULL) {  // from file
+    std::lock_guard<std::mutex> guard(file_mutex_);
     file_.seekg(binary_offset_ + binary->start() + offset, std::ios::beg);
     if (file_.fail()) {
       BMODEL_LOG(FATAL) << "Failed to read in read_binary" << std::endl;
@@ -866,6 +1047,10 @@ void ModelCtx::write_binary(const Binary *binary, uint64_t offset,
   ASSERT(buffer != NULL);
   ASSERT(size + offset <= binary->size());
   auto offset_file = binary_offset_ + binary->start() + offset;
+  if (mapping_) {
+    BMODEL_LOG(FATAL) << "Failed to write binary, bmodel is mapped read-only" << std::endl;
+    throw std::runtime_error("Failed to write in write_binary");
+  }
   if (bmodel_pointer_ == NULL) { // from file
     file_.seekg(offset_file, std::ios::beg);
     if (file_.fail()) {
@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <cmath>  // for std::fabs and std::signbit
 #include <map>
+#include <set>
 #include <string>
 #include <utility>
 #include <vector>
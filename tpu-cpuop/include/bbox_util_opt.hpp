@@ -48,9 +48,93 @@ void DecodeBBoxesAll_opt(const NormalizedBBoxOpt* all_loc_preds,
 void GetPriorBBoxes_opt(const float* prior_data, const int num_priors,
     float* &prior_bboxes, float* &prior_variances);
 
+/* decodes priors [0, num_priors) of one image and label, the NEON path works
+ * on 4 priors at a time, so a range starting at a multiple of 4 gives the
+ * same boxes as decoding all priors at once */
+void DecodeBBox_opt(const float* prior_bboxes,
+    const float* prior_variances, const int num_priors,
+    const CodeType code_type, const bool variance_encoded_in_target,
+    const bool clip_bbox, const NormalizedBBoxOpt* bboxes,
+    NormalizedBBoxOpt* decode_bboxes, float* bboxes_area);
+
 template <class T>
 void insert_sort(T begin, T end);
 
+/* Greedy nms shared by the nms layers. The kept boxes live in separate
+ * x1/y1/x2/y2/area arrays with the corners ordered when a box is loaded, so
+ * a candidate is tested against 8 kept boxes per step and every step gives
+ * a suppression bitmask. Each iou type keeps the overlap rule of the layer
+ * it came from, the results are the same as the old per layer loops. */
+typedef enum {
+  NMS_IOU_CAFFE = 0,    /* ssd [x1 y1 x2 y2]: overlap needs w > 0 && h > 0, iou > thr suppresses */
+  NMS_IOU_PADDLE,       /* paddle [x1 y1 x2 y2] + offset, iou > thr suppresses */
+  NMS_IOU_TF,           /* tensorflow [y1 x1 y2 x2] in any corner order, iou >= thr suppresses */
+  NMS_IOU_ONNX,         /* as tensorflow, but iou > thr suppresses */
+  NMS_IOU_CAFFE2,       /* caffe2 [x1 y1 x2 y2] + offset, boxes without overlap never suppress */
+  NMS_IOU_MXNET,        /* mxnet [x1 y1 x2 y2], iou > thr suppresses */
+  NMS_IOU_MXNET_CENTER, /* mxnet [cx cy w h], half sizes truncated to int */
+  NMS_IOU_YOLO,         /* darknet [cx cy w h], iou >= thr suppresses */
+} NmsIouType;
+
+typedef enum {
+  NMS_HARD = 0,
+  NMS_SOFT_LINEAR,      /* score *= 1 - iou when iou > thr */
+  NMS_SOFT_GAUSSIAN,    /* score *= exp(-0.5 * iou^2 / sigma), iou >= thr still suppresses */
+} NmsMode;
+
+typedef struct {
+  NmsIouType type;
+  float iou_threshold;
+  float eta;            /* adaptive threshold as in caffe ssd, 1 to disable */
+  float offset;         /* added to widths and heights of unnormalized boxes */
+  bool class_aware;     /* boxes of different ids never suppress each other */
+} NmsParam;
+
+typedef struct {
+  float x1, y1, x2, y2, area;
+  int id;
+} NmsBox;
+
+class NmsKernel {
+public:
+  explicit NmsKernel(const NmsParam& param);
+
+  /* orders the corners of a raw layer box and computes its area,
+   * or takes an area the caller already has */
+  NmsBox load(const float* box, int id = 0) const;
+  NmsBox load(const float* box, float area, int id) const;
+  /* hard nms step: keeps the box unless a kept box suppresses it */
+  bool offer(const NmsBox& box);
+  /* keeps the box without any test */
+  void keep(const NmsBox& box);
+  /* iou of the box with the kept boxes [begin, end) */
+  void iou(const NmsBox& box, int begin, int end, float* out) const;
+  int kept_num() const { return num_; }
+  float threshold() const { return threshold_; }
+  void clear();
+  /* clear() that also switches to another param */
+  void reset(const NmsParam& param);
+
+private:
+  template <class T> bool suppressed(const NmsBox& box) const;
+  template <class T> void iou_range(const NmsBox& box, int begin, int end, float* out) const;
+
+  NmsParam param_;
+  float threshold_;
+  int num_;
+  /* padded with zeros, so a step never reads past the end */
+  vector<float> x1_, y1_, x2_, y2_, area_;
+  vector<int> id_;
+};
+
+/* tensorflow style nms: candidates pop from a score heap, and in the soft
+ * modes a candidate only decays against the boxes kept since it was last
+ * popped. boxes are [num, 4], selected_scores may be NULL. */
+void ApplyNMSQueue_opt(const NmsParam& param, const NmsMode mode,
+    const float sigma, const float* boxes, const float* scores,
+    const int num, const float score_threshold, const int max_output,
+    vector<int>* selected, vector<float>* selected_scores);
+
 }  // namespace bmnetc
 
 #endif  // bmnetc_UTIL_BBOX_UTIL_OPT_H_
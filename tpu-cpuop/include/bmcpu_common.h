@@ -328,6 +328,7 @@ typedef struct {
 
 typedef struct cpu_embedding_param {
     int* padding_idx;
+    CPU_DATA_TYPE_T dtype;      /* of weight, FP32 when not given */
 } cpu_embedding_param_t;
 
 typedef enum {
@@ -340,6 +341,7 @@ typedef struct {
     int num_embeddings;
     int embedding_dim;
     EMB_MODE_T mode;
+    CPU_DATA_TYPE_T dtype;      /* of weight and output, FP32, FP16 or BFP16, FP32 when not given */
 } cpu_embedding_bag_param_t;
 
 typedef struct cpu_gathernd {
@@ -0,0 +1,92 @@
+#ifndef BMCPU_DETECT_HPP
+#define BMCPU_DETECT_HPP
+
+#include <vector>
+#include "bbox_util_opt.hpp"
+#include "bmcpu_utils.hpp"
+
+namespace bmcpu {
+
+struct DetectParam {
+  NmsParam nms;         /* class_aware is not used, see class_agnostic */
+  int num_classes;      /* labels are in [0, num_classes) */
+  int top_k;            /* candidates of a label kept before nms, -1 for all */
+  int keep_top_k;       /* detections of an image kept after nms, -1 for all */
+  bool class_agnostic;  /* one nms over all labels as darknet does, otherwise
+                         * per label as caffe ssd does */
+  bool caffe_sort;      /* scores within FLT_EPSILON tie as in caffe ssd,
+                         * otherwise exact, both sorts are stable */
+};
+
+/* Candidates of one image that passed the confidence threshold. The layer
+ * thresholds first and decodes only those boxes. Boxes, areas, scores and
+ * labels go to separate arrays, a box stays 4 floats so the nms loads it
+ * with one read. The storage only grows and there is one arena per thread,
+ * so a detection layer called again does not allocate. */
+class DetectArena {
+public:
+  static DetectArena& local();
+
+  void clear();
+  /* box is in the layout of the layer output, which must be the layout the
+   * nms iou type loads. area < 0 lets the nms kernel compute it. */
+  void push(const float* box, float area, float score, int label) {
+    box_.insert(box_.end(), box, box + 4);
+    area_.push_back(area);
+    score_.push_back(score);
+    label_.push_back(label);
+  }
+  int num() const { return (int)score_.size(); }
+
+  /* free for the layer, e.g. to keep decoded priors while it fills */
+  std::vector<float> cache;
+  std::vector<unsigned char> flags;
+  std::vector<int> index;
+
+private:
+  friend void DetectNms(const DetectParam& param, DetectArena& arena,
+                        int image, std::vector<float>* rows);
+  std::vector<float> box_, area_, score_;
+  std::vector<int> label_;
+  /* candidates grouped by label, then per label results */
+  std::vector<int> order_, label_begin_;
+  std::vector<std::vector<std::pair<float, int> > > label_keep_;
+  std::vector<NmsKernel> kernels_;
+};
+
+/* Writes the positions in [0, num) whose score is > threshold to index,
+ * in ascending order. 8 scores are compared at a time, so the mostly empty
+ * score maps of a detection layer cost little more than reading them. */
+void DetectAboveThreshold(const float* scores, int num, float threshold,
+                          std::vector<int>* index);
+
+/* Sorts the candidates of every label by score, keeps top_k and runs nms,
+ * the labels in parallel. Then keeps keep_top_k detections: the first ones
+ * for class_agnostic, the best ones regrouped by label otherwise. Appends a
+ * [image, label, score, box] row per detection, labels in ascending order. */
+void DetectNms(const DetectParam& param, DetectArena& arena, int image,
+               std::vector<float>* rows);
+
+/* Writes the rows of all images to top_data as [1, 1, rows, 7]. When no
+ * image has a detection, every image gets a [image, -1, ..., -1] row. */
+void DetectWriteOutput(const std::vector<std::vector<float> >& rows,
+                       float* top_data, std::vector<int>& top_shape);
+
+/* fill(image, arena) puts the candidates of an image in a cleared arena,
+ * the images of the batch run in parallel */
+template <typename Fill>
+void DetectOutput(const DetectParam& param, int num, Fill fill,
+                  float* top_data, std::vector<int>& top_shape) {
+  std::vector<std::vector<float> > rows(num);
+  parallel_for(0, num, [&](int i) {
+    DetectArena& arena = DetectArena::local();
+    arena.clear();
+    fill(i, arena);
+    DetectNms(param, arena, i, &rows[i]);
+  });
+  DetectWriteOutput(rows, top_data, top_shape);
+}
+
+}  // namespace bmcpu
+
+#endif  // BMCPU_DETECT_HPP
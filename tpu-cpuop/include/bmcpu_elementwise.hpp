@@ -0,0 +1,41 @@
+#ifndef BMCPU_ELEMENTWISE_HPP
+#define BMCPU_ELEMENTWISE_HPP
+
+#include <stdint.h>
+#include "bmcpu_common.h"
+
+namespace bmcpu {
+
+/* Numpy style broadcast, shapes are aligned at the last dim and a dim of 1
+ * follows the other input. Adjacent dims broadcast the same way are merged,
+ * so the inner loop always runs over contiguous data or a repeated value. */
+#define BROADCAST_MAX_DIM 16
+struct broadcast_plan_t {
+    int dim;                                /* dims after merging, at least 1 */
+    int shape[BROADCAST_MAX_DIM];
+    int64_t stride0[BROADCAST_MAX_DIM];     /* 0 where input 0 is broadcast */
+    int64_t stride1[BROADCAST_MAX_DIM];
+    int64_t out_num;
+};
+
+/* writes max(in_dim0, in_dim1) dims to out_shape and returns that number */
+int broadcast_shape(const int* in_shape0, int in_dim0,
+                    const int* in_shape1, int in_dim1, int* out_shape);
+void broadcast_plan(const int* in_shape0, int in_dim0,
+                    const int* in_shape1, int in_dim1, broadcast_plan_t* plan);
+
+/* dst = in0 op in1 with broadcast, dtype is CPU_DTYPE_INT32, FP32 or FP16.
+ * MOD and DIV truncate both inputs to int first, as the layer always did. */
+void broadcast_binary(BINARY_OP_CODE_T op, CPU_DATA_TYPE_T dtype,
+                      const void* in0, const int* in_shape0, int in_dim0,
+                      const void* in1, const int* in_shape1, int in_dim1,
+                      void* dst);
+
+void elementwise_unary(UNARY_OP_CODE_T op, const float* in, float* out, int64_t len);
+
+float fp16_to_fp32(uint16_t h);
+uint16_t fp32_to_fp16(float f);     /* round to nearest even */
+
+}
+
+#endif // BMCPU_ELEMENTWISE_HPP
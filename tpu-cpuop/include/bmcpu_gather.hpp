@@ -0,0 +1,36 @@
+#ifndef BMCPU_GATHER_HPP
+#define BMCPU_GATHER_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+#include "bmcpu_common.h"
+
+namespace bmcpu {
+
+/* src viewed as [outer, axis_len, row], dst as [outer, index_num, row]:
+ * dst[o][j] = src[o][index[j]]. Rows are row_bytes long and copied whole,
+ * the next row is prefetched while one is copied. index must be in
+ * [0, axis_len), the caller checks it. */
+void gather_rows(const void* src, int outer, int axis_len,
+                 const int* index, int index_num, size_t row_bytes, void* dst);
+
+/* torch.gather: dst has the shape of index and takes src at the same
+ * position, except along axis where the position is the index value.
+ * index_shape[d] <= src_shape[d] for the other dims. elem_bytes is 1, 2,
+ * 4 or 8. */
+void gather_elements(const void* src, const int* src_shape,
+                     const int* index, const int* index_shape, int dims, int axis,
+                     int elem_bytes, void* dst);
+
+/* torch.nn.EmbeddingBag over a [num_embeddings, dim] table of dtype
+ * CPU_DTYPE_FP32, FP16 or BFP16, out is [num_bags, dim] of the same dtype.
+ * Bag i holds indices[offsets[i], offsets[i + 1]), the last one runs to
+ * num_indices. Indices out of the table count as a row of zeros. Rows are
+ * reduced in fp32 in index order and an empty bag gives zeros. */
+void embedding_bag(CPU_DATA_TYPE_T dtype, const void* weight, int num_embeddings, int dim,
+                   const int* indices, int num_indices, const int* offsets, int num_bags,
+                   EMB_MODE_T mode, void* out);
+
+}
+
+#endif // BMCPU_GATHER_HPP
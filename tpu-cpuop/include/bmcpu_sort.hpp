@@ -0,0 +1,27 @@
+#ifndef BMCPU_SORT_HPP
+#define BMCPU_SORT_HPP
+
+#include <stdint.h>
+
+namespace bmcpu {
+
+/* Sorts every lane of a tensor viewed as [outer, len, inner] along len, the
+ * lane of (o, i) being in[o * len * inner + j * inner + i] for j in [0, len).
+ * index gets the position of each sorted element inside its lane and out,
+ * when not NULL, the sorted values, both with the layout of in.
+ * Equal values keep their input order and -0.f equals 0.f, which is what
+ * stable_sort with operator< (or operator> when descending) gives. */
+void strided_sort(const float* in, int outer, int len, int inner, bool descending,
+                  int* index, float* out);
+void strided_sort(const int* in, int outer, int len, int inner, bool descending,
+                  int* index, int* out);
+/* same with the positions stored as float, for layers with a float index output */
+void strided_argsort(const float* in, int outer, int len, int inner, bool descending,
+                     float* index);
+
+/* splits shape at axis into the [outer, len, inner] view used above */
+void sort_view(const int* shape, int dims, int axis, int* outer, int* len, int* inner);
+
+}
+
+#endif // BMCPU_SORT_HPP
@@ -0,0 +1,23 @@
+#ifndef BMCPU_TOPK_HPP
+#define BMCPU_TOPK_HPP
+
+#include <stdint.h>
+#include "bmcpu_common.h"
+
+namespace bmcpu {
+
+/* Top k along len of every lane of a tensor viewed as [outer, len, inner],
+ * see strided_sort. dtype is any CPU_DTYPE_* and the values are compared in
+ * that type without converting them, -0 equals 0 for the float types.
+ * values (dtype) and indices (index_dtype, CPU_DTYPE_INT32 or FP32) are laid
+ * out as [outer, k, inner] and hold min(k, len) entries per lane: the best
+ * first when sorted, in input order otherwise. Equal values prefer the lower
+ * index. mask, shaped like in, gets 1 for the selected elements and 0 for
+ * the others. Any of the three outputs may be NULL. */
+void topk(CPU_DATA_TYPE_T dtype, const void* in, int outer, int len, int inner,
+          int k, bool largest, bool sorted,
+          void* values, void* indices, CPU_DATA_TYPE_T index_dtype, void* mask);
+
+}
+
+#endif // BMCPU_TOPK_HPP
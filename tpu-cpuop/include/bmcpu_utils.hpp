@@ -5,6 +5,11 @@
 #include<vector>
 #include<atomic>
 #include<queue>
+#include<mutex>
+#include<condition_variable>
+#include<functional>
+#include<exception>
+#include<algorithm>
 
 #include "bmcpu_common.h"
 
@@ -12,24 +17,83 @@ namespace bmcpu {
 
 int cpu_get_type_len(CPU_DATA_TYPE_T dtype);
 int using_thread_num(int N);
+
+/* Threads kept alive across process() calls. The calling thread works too,
+ * so a pool of thread_num runs thread_num - 1 workers, and a pool of 1 runs
+ * everything inline. Idle threads take the next chunk of a running job, so
+ * uneven chunks still keep every thread busy. */
+class ThreadPool {
+public:
+    explicit ThreadPool(int thread_num);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int thread_num() const { return (int)workers_.size() + 1; }
+    /* run task(0) ... task(task_num - 1) and return when all are done.
+     * Nested calls, or calls while another thread owns the pool, run inline. */
+    void run(int task_num, const std::function<void(int)>& task);
+
+private:
+    void worker_loop();
+
+    std::vector<std::thread> workers_;
+    std::mutex run_mutex_;      /* one job at a time */
+    std::mutex mutex_;
+    std::condition_variable job_cv_;
+    std::condition_variable done_cv_;
+    const std::function<void(int)>* task_ = nullptr;
+    int task_num_ = 0;
+    std::atomic<int> next_task_{0};
+    int done_num_ = 0;
+    int active_num_ = 0;        /* workers inside the current job */
+    unsigned long job_id_ = 0;
+    bool stop_ = false;
+    std::exception_ptr error_;
+};
+
+/* pool of the bmcpu handle running the current layer, or a process wide one
+ * sized by BM_CPU_LAYER_NUM_THREAD when a layer is used on its own */
+ThreadPool* current_thread_pool();
+
+/* makes pool the current one of this thread while in scope */
+class ThreadPoolScope {
+public:
+    explicit ThreadPoolScope(ThreadPool* pool);
+    ~ThreadPoolScope();
+private:
+    ThreadPool* prev_;
+};
+
+/* func(start, end) over [begin, end) in chunks of at least grain items */
+template<typename Func>
+void parallel_for(int begin, int end, int grain, Func func) {
+    if (end <= begin) return;
+    if (grain < 1) grain = 1;
+    int chunk_num = (end - begin + grain - 1) / grain;
+    ThreadPool* pool = current_thread_pool();
+    if (chunk_num == 1 || pool->thread_num() == 1) {
+        func(begin, end);
+        return;
+    }
+    pool->run(chunk_num, [&](int chunk) {
+        int start = begin + chunk * grain;
+        func(start, std::min(start + grain, end));
+    });
+}
+
+/* func(i) for every i in [begin, end), one task each */
+template<typename Func>
+void parallel_for(int begin, int end, Func func) {
+    parallel_for(begin, end, 1, [&](int start, int stop) {
+        for (int i = start; i < stop; i++) func(i);
+    });
+}
+
 struct BlockExecutor {
     template<typename Func, typename... ArgTypes>
     static void run(Func functor, const int N, ArgTypes... args){
-        int nthreads = using_thread_num(N);
-        int nblocks = (N+nthreads-1)/nthreads;
-
-        for(int b=0; b<nblocks; b++){
-            std::vector<std::thread> threads;
-            for(int i=0; i<nthreads; i++){
-                int idx = b*nthreads + i;
-                if(idx<N){
-                    threads.emplace_back(functor,idx, args...);
-                }
-            }
-            for(auto& t: threads){
-                t.join();
-            }
-        }
+        parallel_for(0, N, [&](int idx) { functor(idx, args...); });
     }
 };
 
@@ -1,8 +1,6 @@
 #ifndef _CPU_ARG_SORT_LAYER_H
 #define _CPU_ARG_SORT_LAYER_H
 #include "cpu_layer.h"
-#include <algorithm>
-#include <vector>
 
 namespace bmcpu{
 
@@ -31,19 +29,6 @@ public:
       output_dtypes.push_back(input_dtypes[0]);
       return 0;
     }
-
-private:
-    //argsort implementation in c++11 for 1-dim vector 
-    template<typename T>
-    std::vector<float> argsort(const std::vector<T>& array, bool ascend);
-
-    //calculate the offset using the indice
-    int calc_offset(int* base_offset, int *index, int dim);
-    //calculate the indice using the offset
-    int* calc_dim(int dims, int* base_offset, int offset);
-    int* base_offset;
-    int* base_offset_trans;
-    int len;
 };
 
 }/* namespace bmcpu */
@@ -16,18 +16,6 @@ public:
     virtual ~cpu_gatherlayer() {}
 
     int process(void* param, int param_size);
-    inline int get_shape_index(int*     shape,
-                               int*     index,
-                               int      size);
-    int git_all_index(int                indices_val,
-                      int                indices_idx,
-                      int                axis_shape,       //axis's shape
-                      std::vector<int>*  src_offset,     //source offest array
-                      std::vector<int>*  dest_offset);   //dest offest array
-    int gather_inner(float*         output_tensor,
-                     const float*   input_tensor,
-                     const int*     indices,
-                     int            axis_shape);
 
     int reshape(void* param, int param_size,
                 const vector<vector<int>>& input_shapes,
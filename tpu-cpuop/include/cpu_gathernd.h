@@ -25,9 +25,6 @@ public:
         output_dtypes.assign(1, input_dtypes[0]);
         return 0;
     }
-private:
-    int extract_from_indice(const int* ptr, vector<int> shape, int i0, int i1);
-
 };
 
 }/* namespace bmcpu */
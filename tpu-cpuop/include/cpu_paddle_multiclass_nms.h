@@ -32,8 +32,6 @@ protected:
 
     void GetMaxScoreIndex(const float* scores, 
             std::vector<std::pair<float,  int>>* sorted_indices);   
-    float BBoxArea(const float* box);
-    float JaccardOverlap(const float* box1,  const float* box2);
     void NMSFast(float* box,  float* score, 
             std::vector<int>* selected_indices);                   
     void MultiClassOutput(float* box, 
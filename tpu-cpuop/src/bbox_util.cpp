@@ -11,6 +11,7 @@
 #include <limits>
 
 #include "bbox_util.hpp"
+#include "bbox_util_opt.hpp"
 
 namespace bmcpu {
 
@@ -1025,28 +1026,40 @@ void ApplyNMSFast(const vector<NormalizedBBox>& bboxes,
   GetMaxScoreIndex(scores, score_threshold, top_k, &score_index_vec);
 
   // Do nms.
-  float adaptive_threshold = nms_threshold;
+  NmsParam param = {NMS_IOU_CAFFE, nms_threshold, eta, 0.f, false};
+  NmsKernel kernel(param);
   indices->clear();
-  while (score_index_vec.size() != 0) {
-    const int idx = score_index_vec.front().second;
-    bool keep = true;
-    for (int k = 0; k < indices->size(); ++k) {
-      if (keep) {
-        const int kept_idx = (*indices)[k];
-        float overlap = JaccardOverlap(bboxes[idx], bboxes[kept_idx]);
-        keep = overlap <= adaptive_threshold;
-      } else {
-        break;
-      }
+  for (int i = 0; i < score_index_vec.size(); ++i) {
+    const NormalizedBBox& bbox = bboxes[score_index_vec[i].second];
+    const float box[4] = {bbox.xmin(), bbox.ymin(), bbox.xmax(), bbox.ymax()};
+    if (kernel.offer(kernel.load(box, BBoxSize(bbox), 0))) {
+      indices->push_back(score_index_vec[i].second);
     }
-    if (keep) {
+  }
+}
+
+// float boxes go through the shared nms kernel, double keeps the plain loop.
+template <typename Dtype>
+static bool ApplyNMSKernel(const Dtype* bboxes,
+      const vector<pair<Dtype, int> >& score_index_vec,
+      const float nms_threshold, const float eta, vector<int>* indices) {
+  return false;
+}
+
+template <>
+bool ApplyNMSKernel(const float* bboxes,
+      const vector<pair<float, int> >& score_index_vec,
+      const float nms_threshold, const float eta, vector<int>* indices) {
+  NmsParam param = {NMS_IOU_PADDLE, nms_threshold, eta, 0.f, false};
+  NmsKernel kernel(param);
+  indices->clear();
+  for (int i = 0; i < score_index_vec.size(); ++i) {
+    const int idx = score_index_vec[i].second;
+    if (kernel.offer(kernel.load(bboxes + idx * 4))) {
       indices->push_back(idx);
     }
-    score_index_vec.erase(score_index_vec.begin());
-    if (keep && eta < 1 && adaptive_threshold > 0.5) {
-      adaptive_threshold *= eta;
-    }
   }
+  return true;
 }
 
 template <typename Dtype>
@@ -1056,6 +1069,8 @@ void ApplyNMSFast(const Dtype* bboxes, const Dtype* scores, const int num,
   // Get top_k scores (with corresponding indices).
   vector<pair<Dtype, int> > score_index_vec;
   GetMaxScoreIndex(scores, num, score_threshold, top_k, &score_index_vec);
+  if (ApplyNMSKernel(bboxes, score_index_vec, nms_threshold, eta, indices))
+    return;
 
   // Do nms.
   float adaptive_threshold = nms_threshold;
@@ -1,8 +1,10 @@
 #include <algorithm>
+#include <cmath>
 #include <csignal>
 #include <ctime>
 #include <functional>
 #include <map>
+#include <queue>
 #include <set>
 #include <string>
 #include <utility>
@@ -84,6 +86,11 @@
 #endif
 #endif
 
+#if !defined(USE_NEON) && (defined(__SSE2__) || defined(_M_X64))
+#include <emmintrin.h>
+#define USE_SSE2
+#endif
+
 namespace bmcpu {
 
 void GetLocPredictions_opt(const float* loc_data, const int num,
@@ -151,46 +158,6 @@ void GetMaxScoreIndex_opt(const float* scores, const int num, const float thresh
   }
 }
 
-static void IntersectBBoxOpt(const NormalizedBBoxOpt& bbox1,
-    const NormalizedBBoxOpt& bbox2, NormalizedBBoxOpt* intersect_bbox)
-{
-  if (bbox2.xmin > bbox1.xmax || bbox2.xmax < bbox1.xmin ||
-      bbox2.ymin > bbox1.ymax || bbox2.ymax < bbox1.ymin) {
-    // Return [0, 0, 0, 0] if there is no intersection.
-    intersect_bbox->xmin = 0;
-    intersect_bbox->ymin = 0;
-    intersect_bbox->xmax = 0;
-    intersect_bbox->ymax = 0;
-  } else {
-    intersect_bbox->xmin = std::max(bbox1.xmin, bbox2.xmin);
-    intersect_bbox->ymin = std::max(bbox1.ymin, bbox2.ymin);
-    intersect_bbox->xmax = std::min(bbox1.xmax, bbox2.xmax);
-    intersect_bbox->ymax = std::min(bbox1.ymax, bbox2.ymax);
-  }
-}
-
-static float JaccardOverlapOpt(const NormalizedBBoxOpt& bbox1,
-    const float bbox1_size, const NormalizedBBoxOpt& bbox2,
-    const float bbox2_size, const bool normalized = true)
-{
-  NormalizedBBoxOpt intersect_bbox;
-  IntersectBBoxOpt(bbox1, bbox2, &intersect_bbox);
-  float intersect_width, intersect_height;
-  if (normalized) {
-    intersect_width = intersect_bbox.xmax - intersect_bbox.xmin;
-    intersect_height = intersect_bbox.ymax - intersect_bbox.ymin;
-  } else {
-    intersect_width = intersect_bbox.xmax - intersect_bbox.xmin + 1;
-    intersect_height = intersect_bbox.ymax - intersect_bbox.ymin + 1;
-  }
-  if (intersect_width > 0 && intersect_height > 0) {
-    float intersect_size = intersect_width * intersect_height;
-    return intersect_size / (bbox1_size + bbox2_size - intersect_size);
-  } else {
-    return 0.;
-  }
-}
-
 void ApplyNMSFast_opt(const NormalizedBBoxOpt* bboxes,
     const int bboxes_size, const float* bboxes_area,
     const float* scores, const float score_threshold,
@@ -202,32 +169,18 @@ void ApplyNMSFast_opt(const NormalizedBBoxOpt* bboxes,
   GetMaxScoreIndex_opt(scores, bboxes_size, score_threshold, top_k,
       stride,  &score_index_vec);
 
-  float adaptive_threshold = nms_threshold;
+  NmsParam param = {NMS_IOU_CAFFE, nms_threshold, eta, 0.f, false};
+  NmsKernel kernel(param);
   indices->clear();
-  while (score_index_vec.size() != 0) {
-    const int idx = score_index_vec.front().second;
-    bool keep = true;
-    for (int k = 0; k < indices->size(); ++k) {
-      if (keep) {
-        const int kept_idx = (*indices)[k].second;
-        float overlap = JaccardOverlapOpt(bboxes[idx], bboxes_area[idx],
-            bboxes[kept_idx], bboxes_area[kept_idx]);
-        keep = overlap <= adaptive_threshold;
-      } else {
-        break;
-      }
-    }
-    if (keep) {
-      indices->push_back(score_index_vec.front());
-    }
-    score_index_vec.erase(score_index_vec.begin());
-    if (keep && eta < 1 && adaptive_threshold > 0.5) {
-      adaptive_threshold *= eta;
+  for (size_t i = 0; i < score_index_vec.size(); ++i) {
+    const int idx = score_index_vec[i].second;
+    if (kernel.offer(kernel.load(&bboxes[idx].xmin, bboxes_area[idx], 0))) {
+      indices->push_back(score_index_vec[i]);
     }
   }
 }
 
-static void DecodeBBox_opt(const float* prior_bboxes,
+void DecodeBBox_opt(const float* prior_bboxes,
     const float* prior_variances, const int num_priors,
     const CodeType code_type, const bool variance_encoded_in_target,
     const bool clip_bbox, const NormalizedBBoxOpt* bboxes,
@@ -438,4 +391,482 @@ template void insert_sort(vector<pair<float, int>>::iterator begin,
 template void insert_sort(vector<pair<float, pair<int, int>>>::iterator begin,
                           vector<pair<float, pair<int, int>>>::iterator end);
 
+/* The overlap rules are written once against a small set of vector ops, so
+ * the scalar tail and the SIMD steps do exactly the same float math. min and
+ * max keep the a < b ? a : b form the layers used. */
+struct NmsScalarOps {
+  typedef float F;
+  typedef bool M;
+  static F dup(float v) { return v; }
+  static F ld(const float* p) { return *p; }
+  static F min(F a, F b) { return a < b ? a : b; }
+  static F max(F a, F b) { return a > b ? a : b; }
+  static F add(F a, F b) { return a + b; }
+  static F sub(F a, F b) { return a - b; }
+  static F mul(F a, F b) { return a * b; }
+  static F div(F a, F b) { return a / b; }
+  static M gt(F a, F b) { return a > b; }
+  static M ge(F a, F b) { return a >= b; }
+  static M lt(F a, F b) { return a < b; }
+  static M le(F a, F b) { return a <= b; }
+  static M ne(F a, F b) { return a != b; }
+  static M and_(M a, M b) { return a && b; }
+  static M or_(M a, M b) { return a || b; }
+  static M not_(M a) { return !a; }
+  static F sel(M m, F a, F b) { return m ? a : b; }
+  static M id_eq(const int* p, int id) { return *p == id; }
+  static int bits(M m) { return m ? 1 : 0; }
+  static void st(float* p, F v) { *p = v; }
+  enum { LANES = 1 };
+};
+
+#if defined(USE_SSE2)
+struct NmsSimdOps {
+  typedef __m128 F;
+  typedef __m128 M;
+  static F dup(float v) { return _mm_set1_ps(v); }
+  static F ld(const float* p) { return _mm_loadu_ps(p); }
+  static F min(F a, F b) { return _mm_min_ps(a, b); }
+  static F max(F a, F b) { return _mm_max_ps(a, b); }
+  static F add(F a, F b) { return _mm_add_ps(a, b); }
+  static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+  static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+  static F div(F a, F b) { return _mm_div_ps(a, b); }
+  static M gt(F a, F b) { return _mm_cmpgt_ps(a, b); }
+  static M ge(F a, F b) { return _mm_cmpge_ps(a, b); }
+  static M lt(F a, F b) { return _mm_cmplt_ps(a, b); }
+  static M le(F a, F b) { return _mm_cmple_ps(a, b); }
+  static M ne(F a, F b) { return _mm_cmpneq_ps(a, b); }
+  static M and_(M a, M b) { return _mm_and_ps(a, b); }
+  static M or_(M a, M b) { return _mm_or_ps(a, b); }
+  static M not_(M a) { return _mm_xor_ps(a, _mm_castsi128_ps(_mm_set1_epi32(-1))); }
+  static F sel(M m, F a, F b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+  static M id_eq(const int* p, int id) {
+    return _mm_castsi128_ps(_mm_cmpeq_epi32(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)), _mm_set1_epi32(id)));
+  }
+  static int bits(M m) { return _mm_movemask_ps(m); }
+  static void st(float* p, F v) { _mm_storeu_ps(p, v); }
+  enum { LANES = 4 };
+};
+#define NMS_SIMD
+#elif defined(USE_NEON)
+struct NmsSimdOps {
+  typedef float32x4_t F;
+  typedef uint32x4_t M;
+  static F dup(float v) { return vdupq_n_f32(v); }
+  static F ld(const float* p) { return vld1q_f32(p); }
+  /* vminq/vmaxq differ from a < b ? a : b on nan */
+  static F min(F a, F b) { return vbslq_f32(vcltq_f32(a, b), a, b); }
+  static F max(F a, F b) { return vbslq_f32(vcgtq_f32(a, b), a, b); }
+  static F add(F a, F b) { return vaddq_f32(a, b); }
+  static F sub(F a, F b) { return vsubq_f32(a, b); }
+  static F mul(F a, F b) { return vmulq_f32(a, b); }
+  static F div(F a, F b) { return vdivq_f32(a, b); }
+  static M gt(F a, F b) { return vcgtq_f32(a, b); }
+  static M ge(F a, F b) { return vcgeq_f32(a, b); }
+  static M lt(F a, F b) { return vcltq_f32(a, b); }
+  static M le(F a, F b) { return vcleq_f32(a, b); }
+  static M ne(F a, F b) { return vmvnq_u32(vceqq_f32(a, b)); }
+  static M and_(M a, M b) { return vandq_u32(a, b); }
+  static M or_(M a, M b) { return vorrq_u32(a, b); }
+  static M not_(M a) { return vmvnq_u32(a); }
+  static F sel(M m, F a, F b) { return vbslq_f32(m, a, b); }
+  static M id_eq(const int* p, int id) { return vceqq_s32(vld1q_s32(p), vdupq_n_s32(id)); }
+  static int bits(M m) {
+    static const uint32_t weight[4] = {1, 2, 4, 8};
+    return vaddvq_u32(vandq_u32(m, vld1q_u32(weight)));
+  }
+  static void st(float* p, F v) { vst1q_f32(p, v); }
+  enum { LANES = 4 };
+};
+#define NMS_SIMD
+#endif
+
+template <class O>
+struct NmsBoxV {
+  typename O::F x1, y1, x2, y2, area;
+};
+
+/* Each type below is one layer's overlap rule. test() gives the iou and
+ * whether the kept box k suppresses the candidate c. */
+struct NmsIouCaffe {
+  template <class O>
+  static typename O::M test(const NmsBoxV<O>& c, const NmsBoxV<O>& k,
+      typename O::F thr, typename O::F off, typename O::F* iou) {
+    typename O::F zero = O::dup(0.f);
+    typename O::M none = O::or_(O::or_(O::gt(k.x1, c.x2), O::lt(k.x2, c.x1)),
+                                O::or_(O::gt(k.y1, c.y2), O::lt(k.y2, c.y1)));
+    typename O::F w = O::sub(O::min(c.x2, k.x2), O::max(c.x1, k.x1));
+    typename O::F h = O::sub(O::min(c.y2, k.y2), O::max(c.y1, k.y1));
+    typename O::M ok = O::and_(O::not_(none), O::and_(O::gt(w, zero), O::gt(h, zero)));
+    typename O::F inter = O::mul(w, h);
+    *iou = O::sel(ok, O::div(inter, O::sub(O::add(c.area, k.area), inter)), zero);
+    return O::not_(O::le(*iou, thr));
+  }
+};
+
+struct NmsIouPaddle {
+  template <class O>
+  static typename O::M test(const NmsBoxV<O>& c, const NmsBoxV<O>& k,
+      typename O::F thr, typename O::F off, typename O::F* iou) {
+    typename O::M none = O::or_(O::or_(O::gt(k.x1, c.x2), O::lt(k.x2, c.x1)),
+                                O::or_(O::gt(k.y1, c.y2), O::lt(k.y2, c.y1)));
+    typename O::F w = O::add(O::sub(O::min(c.x2, k.x2), O::max(c.x1, k.x1)), off);
+    typename O::F h = O::add(O::sub(O::min(c.y2, k.y2), O::max(c.y1, k.y1)), off);
+    typename O::F inter = O::mul(w, h);
+    *iou = O::sel(none, O::dup(0.f), O::div(inter, O::sub(O::add(c.area, k.area), inter)));
+    return O::not_(O::le(*iou, thr));
+  }
+};
+
+template <bool ONNX>
+struct NmsIouTf {
+  template <class O>
+  static typename O::M test(const NmsBoxV<O>& c, const NmsBoxV<O>& k,
+      typename O::F thr, typename O::F off, typename O::F* iou) {
+    typename O::F zero = O::dup(0.f);
+    typename O::F ymax = O::min(c.y2, k.y2);
+    typename O::F ymin = O::max(c.y1, k.y1);
+    typename O::F xmax = O::min(c.x2, k.x2);
+    typename O::F xmin = O::max(c.x1, k.x1);
+    typename O::M ok = O::and_(O::and_(O::not_(O::le(c.area, zero)), O::not_(O::le(k.area, zero))),
+                               O::and_(O::gt(ymax, ymin), O::gt(xmax, xmin)));
+    typename O::F inter = O::mul(O::sub(ymax, ymin), O::sub(xmax, xmin));
+    *iou = O::sel(ok, O::div(inter, O::sub(O::add(c.area, k.area), inter)), zero);
+    if (ONNX)
+      return O::and_(O::gt(*iou, thr), O::ne(*iou, zero));
+    return O::ge(*iou, thr);
+  }
+};
+
+struct NmsIouCaffe2 {
+  template <class O>
+  static typename O::M test(const NmsBoxV<O>& c, const NmsBoxV<O>& k,
+      typename O::F thr, typename O::F off, typename O::F* iou) {
+    typename O::F zero = O::dup(0.f);
+    typename O::F w = O::add(O::sub(O::min(c.x2, k.x2), O::max(c.x1, k.x1)), off);
+    typename O::F h = O::add(O::sub(O::min(c.y2, k.y2), O::max(c.y1, k.y1)), off);
+    typename O::M ok = O::and_(O::not_(O::le(w, zero)), O::not_(O::le(h, zero)));
+    typename O::F inter = O::mul(w, h);
+    *iou = O::sel(ok, O::div(inter, O::sub(O::add(k.area, c.area), inter)), zero);
+    return O::and_(ok, O::not_(O::le(*iou, thr)));
+  }
+};
+
+struct NmsIouMxnet {
+  template <class O>
+  static typename O::M test(const NmsBoxV<O>& c, const NmsBoxV<O>& k,
+      typename O::F thr, typename O::F off, typename O::F* iou) {
+    typename O::F left = O::max(k.x1, c.x1);
+    typename O::F right = O::min(k.x2, c.x2);
+    typename O::F top = O::max(k.y1, c.y1);
+    typename O::F bottom = O::min(k.y2, c.y2);
+    typename O::M none = O::or_(O::gt(left, right), O::gt(top, bottom));
+    typename O::F inter = O::sel(none, O::dup(0.f),
+                                 O::mul(O::sub(right, left), O::sub(bottom, top)));
+    *iou = O::div(inter, O::sub(O::add(k.area, c.area), inter));
+    return O::gt(*iou, thr);
+  }
+};
+
+struct NmsIouYolo {
+  template <class O>
+  static typename O::M test(const NmsBoxV<O>& c, const NmsBoxV<O>& k,
+      typename O::F thr, typename O::F off, typename O::F* iou) {
+    typename O::F zero = O::dup(0.f);
+    typename O::F w = O::sub(O::min(c.x2, k.x2), O::max(c.x1, k.x1));
+    typename O::F h = O::sub(O::min(c.y2, k.y2), O::max(c.y1, k.y1));
+    typename O::M none = O::or_(O::lt(w, zero), O::lt(h, zero));
+    typename O::F inter = O::sel(none, zero, O::mul(w, h));
+    *iou = O::div(inter, O::sub(O::add(k.area, c.area), inter));
+    return O::ge(*iou, thr);
+  }
+};
+
+NmsKernel::NmsKernel(const NmsParam& param)
+  : param_(param), threshold_(param.iou_threshold), num_(0) {
+}
+
+void NmsKernel::reset(const NmsParam& param) {
+  clear();
+  param_ = param;
+  threshold_ = param.iou_threshold;
+}
+
+void NmsKernel::clear() {
+  threshold_ = param_.iou_threshold;
+  std::fill(x1_.begin(), x1_.begin() + num_, 0.f);
+  std::fill(y1_.begin(), y1_.begin() + num_, 0.f);
+  std::fill(x2_.begin(), x2_.begin() + num_, 0.f);
+  std::fill(y2_.begin(), y2_.begin() + num_, 0.f);
+  std::fill(area_.begin(), area_.begin() + num_, 0.f);
+  std::fill(id_.begin(), id_.begin() + num_, 0);
+  num_ = 0;
+}
+
+NmsBox NmsKernel::load(const float* box, float area, int id) const {
+  NmsBox b = {box[0], box[1], box[2], box[3], area, id};
+  return b;
+}
+
+NmsBox NmsKernel::load(const float* box, int id) const {
+  NmsBox b;
+  b.id = id;
+  switch (param_.type) {
+  case NMS_IOU_TF:
+  case NMS_IOU_ONNX:
+    b.y1 = NmsScalarOps::min(box[0], box[2]);
+    b.y2 = NmsScalarOps::max(box[0], box[2]);
+    b.x1 = NmsScalarOps::min(box[1], box[3]);
+    b.x2 = NmsScalarOps::max(box[1], box[3]);
+    b.area = (b.y2 - b.y1) * (b.x2 - b.x1);
+    break;
+  case NMS_IOU_MXNET_CENTER: {
+    const float w_half = static_cast<int>(box[2] / 2);
+    const float h_half = static_cast<int>(box[3] / 2);
+    b.x1 = box[0] - w_half;
+    b.x2 = box[0] + w_half;
+    b.y1 = box[1] - h_half;
+    b.y2 = box[1] + h_half;
+    b.area = (box[2] < 0 || box[3] < 0) ? 0.f : box[3] * box[2];
+    break;
+  }
+  case NMS_IOU_YOLO: {
+    const float w_half = box[2] * 0.5f;
+    const float h_half = box[3] * 0.5f;
+    b.x1 = box[0] - w_half;
+    b.x2 = box[0] + w_half;
+    b.y1 = box[1] - h_half;
+    b.y2 = box[1] + h_half;
+    b.area = box[2] * box[3];
+    break;
+  }
+  case NMS_IOU_MXNET:
+    b.x1 = box[0]; b.y1 = box[1]; b.x2 = box[2]; b.y2 = box[3];
+    b.area = (b.x2 - b.x1 < 0 || b.y2 - b.y1 < 0) ? 0.f : (b.y2 - b.y1) * (b.x2 - b.x1);
+    break;
+  case NMS_IOU_CAFFE2:
+    b.x1 = box[0]; b.y1 = box[1]; b.x2 = box[2]; b.y2 = box[3];
+    b.area = (b.x2 - b.x1 + param_.offset) * (b.y2 - b.y1 + param_.offset);
+    break;
+  default:
+    /* caffe and paddle: inverted boxes have no area */
+    b.x1 = box[0]; b.y1 = box[1]; b.x2 = box[2]; b.y2 = box[3];
+    if (b.x2 < b.x1 || b.y2 < b.y1)
+      b.area = 0.f;
+    else
+      b.area = (b.x2 - b.x1 + param_.offset) * (b.y2 - b.y1 + param_.offset);
+    break;
+  }
+  return b;
+}
+
+void NmsKernel::keep(const NmsBox& box) {
+  /* two steps of zeros after the last box */
+  const size_t need = num_ + 16;
+  if (x1_.size() < need) {
+    const size_t size = std::max(need, x1_.size() * 2);
+    x1_.resize(size, 0.f);
+    y1_.resize(size, 0.f);
+    x2_.resize(size, 0.f);
+    y2_.resize(size, 0.f);
+    area_.resize(size, 0.f);
+    id_.resize(size, 0);
+  }
+  x1_[num_] = box.x1;
+  y1_[num_] = box.y1;
+  x2_[num_] = box.x2;
+  y2_[num_] = box.y2;
+  area_[num_] = box.area;
+  id_[num_] = box.id;
+  num_++;
+}
+
+template <class O>
+static inline NmsBoxV<O> nms_dup(const NmsBox& b) {
+  NmsBoxV<O> v = {O::dup(b.x1), O::dup(b.y1), O::dup(b.x2), O::dup(b.y2), O::dup(b.area)};
+  return v;
+}
+
+template <class T>
+bool NmsKernel::suppressed(const NmsBox& box) const {
+  int j = 0;
+#ifdef NMS_SIMD
+  typedef NmsSimdOps O;
+  const NmsBoxV<O> c = nms_dup<O>(box);
+  const O::F thr = O::dup(threshold_), off = O::dup(param_.offset);
+  for (; j < num_; j += 2 * O::LANES) {
+    int mask = 0;
+    for (int s = 0; s < 2; s++) {
+      const int k = j + s * O::LANES;
+      NmsBoxV<O> kept = {O::ld(&x1_[k]), O::ld(&y1_[k]), O::ld(&x2_[k]),
+                         O::ld(&y2_[k]), O::ld(&area_[k])};
+      O::F iou;
+      O::M m = T::template test<O>(c, kept, thr, off, &iou);
+      if (param_.class_aware)
+        m = O::and_(m, O::id_eq(&id_[k], box.id));
+      mask |= O::bits(m) << (s * O::LANES);
+    }
+    if (num_ - j < 2 * O::LANES)
+      mask &= (1 << (num_ - j)) - 1;
+    if (mask)
+      return true;
+  }
+#else
+  typedef NmsScalarOps O;
+  const NmsBoxV<O> c = nms_dup<O>(box);
+  for (; j < num_; j++) {
+    NmsBoxV<O> kept = {x1_[j], y1_[j], x2_[j], y2_[j], area_[j]};
+    float iou;
+    if (T::template test<O>(c, kept, threshold_, param_.offset, &iou) &&
+        (!param_.class_aware || id_[j] == box.id))
+      return true;
+  }
+#endif
+  return false;
+}
+
+template <class T>
+void NmsKernel::iou_range(const NmsBox& box, int begin, int end, float* out) const {
+  int j = begin;
+#ifdef NMS_SIMD
+  typedef NmsSimdOps O;
+  const NmsBoxV<O> c = nms_dup<O>(box);
+  const O::F thr = O::dup(threshold_), off = O::dup(param_.offset);
+  for (; j + O::LANES <= end; j += O::LANES) {
+    NmsBoxV<O> kept = {O::ld(&x1_[j]), O::ld(&y1_[j]), O::ld(&x2_[j]),
+                       O::ld(&y2_[j]), O::ld(&area_[j])};
+    O::F iou;
+    T::template test<O>(c, kept, thr, off, &iou);
+    O::st(out + j - begin, iou);
+  }
+#endif
+  const NmsBoxV<NmsScalarOps> cs = nms_dup<NmsScalarOps>(box);
+  for (; j < end; j++) {
+    NmsBoxV<NmsScalarOps> kept = {x1_[j], y1_[j], x2_[j], y2_[j], area_[j]};
+    T::template test<NmsScalarOps>(cs, kept, threshold_, param_.offset, out + j - begin);
+  }
+}
+
+bool NmsKernel::offer(const NmsBox& box) {
+  bool suppress;
+  switch (param_.type) {
+  case NMS_IOU_CAFFE:         suppress = suppressed<NmsIouCaffe>(box); break;
+  case NMS_IOU_PADDLE:        suppress = suppressed<NmsIouPaddle>(box); break;
+  case NMS_IOU_TF:            suppress = suppressed<NmsIouTf<false> >(box); break;
+  case NMS_IOU_ONNX:          suppress = suppressed<NmsIouTf<true> >(box); break;
+  case NMS_IOU_CAFFE2:        suppress = suppressed<NmsIouCaffe2>(box); break;
+  case NMS_IOU_MXNET:
+  case NMS_IOU_MXNET_CENTER:  suppress = suppressed<NmsIouMxnet>(box); break;
+  case NMS_IOU_YOLO:          suppress = suppressed<NmsIouYolo>(box); break;
+  default:
+    BM_LOG(FATAL) << "Unknown nms iou type " << param_.type;
+    return false;
+  }
+  if (suppress)
+    return false;
+  keep(box);
+  if (param_.eta < 1 && threshold_ > 0.5) {
+    threshold_ *= param_.eta;
+  }
+  return true;
+}
+
+void NmsKernel::iou(const NmsBox& box, int begin, int end, float* out) const {
+  switch (param_.type) {
+  case NMS_IOU_CAFFE:         iou_range<NmsIouCaffe>(box, begin, end, out); break;
+  case NMS_IOU_PADDLE:        iou_range<NmsIouPaddle>(box, begin, end, out); break;
+  case NMS_IOU_TF:            iou_range<NmsIouTf<false> >(box, begin, end, out); break;
+  case NMS_IOU_ONNX:          iou_range<NmsIouTf<true> >(box, begin, end, out); break;
+  case NMS_IOU_CAFFE2:        iou_range<NmsIouCaffe2>(box, begin, end, out); break;
+  case NMS_IOU_MXNET:
+  case NMS_IOU_MXNET_CENTER:  iou_range<NmsIouMxnet>(box, begin, end, out); break;
+  case NMS_IOU_YOLO:          iou_range<NmsIouYolo>(box, begin, end, out); break;
+  default:
+    BM_LOG(FATAL) << "Unknown nms iou type " << param_.type;
+  }
+}
+
+void ApplyNMSQueue_opt(const NmsParam& param, const NmsMode mode,
+    const float sigma, const float* boxes, const float* scores,
+    const int num, const float score_threshold, const int max_output,
+    vector<int>* selected, vector<float>* selected_scores)
+{
+  struct Candidate {
+    int box_index;
+    float score;
+    int begin_index;
+  };
+  auto cmp = [](const Candidate i, const Candidate j) {
+    return i.score < j.score;
+  };
+  std::priority_queue<Candidate, std::deque<Candidate>, decltype(cmp)> queue(cmp);
+  for (int i = 0; i < num; ++i) {
+    if (scores[i] > score_threshold) {
+      queue.emplace(Candidate({i, scores[i], 0}));
+    }
+  }
+
+  NmsKernel kernel(param);
+  selected->clear();
+  if (selected_scores)
+    selected_scores->clear();
+  if (mode == NMS_HARD) {
+    /* a candidate is either suppressed or kept at its first pop */
+    while (static_cast<int>(selected->size()) < max_output && !queue.empty()) {
+      const Candidate cand = queue.top();
+      queue.pop();
+      if (kernel.offer(kernel.load(boxes + cand.box_index * 4))) {
+        selected->push_back(cand.box_index);
+        if (selected_scores)
+          selected_scores->push_back(cand.score);
+      }
+    }
+    return;
+  }
+
+  const float thr = param.iou_threshold;
+  const float scale = (mode == NMS_SOFT_GAUSSIAN && sigma > 0.f) ? -0.5f / sigma : 0.f;
+  vector<float> ious;
+  while (static_cast<int>(selected->size()) < max_output && !queue.empty()) {
+    Candidate cand = queue.top();
+    queue.pop();
+    const float original_score = cand.score;
+    const NmsBox box = kernel.load(boxes + cand.box_index * 4);
+    const int end = kernel.kept_num();
+    bool should_hard_suppress = false;
+    if (end > cand.begin_index) {
+      ious.resize(end - cand.begin_index);
+      kernel.iou(box, cand.begin_index, end, ious.data());
+      /* newest kept box first, as tensorflow does */
+      for (int i = end - 1; i >= cand.begin_index; --i) {
+        const float iou = ious[i - cand.begin_index];
+        if (mode == NMS_SOFT_GAUSSIAN) {
+          cand.score *= iou <= thr ? std::exp(scale * iou * iou) : 0.f;
+          if (iou >= thr) {
+            should_hard_suppress = true;
+            break;
+          }
+        } else if (iou > thr) {
+          cand.score *= 1.f - iou;
+        }
+        if (cand.score <= score_threshold)
+          break;
+      }
+    }
+    cand.begin_index = end;
+    if (should_hard_suppress)
+      continue;
+    if (cand.score == original_score) {
+      kernel.keep(box);
+      selected->push_back(cand.box_index);
+      if (selected_scores)
+        selected_scores->push_back(cand.score);
+    } else if (cand.score > score_threshold) {
+      queue.push(cand);
+    }
+  }
+}
+
 }
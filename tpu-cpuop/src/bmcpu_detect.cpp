@@ -0,0 +1,184 @@
+#include <climits>
+#include <limits>
+#include <algorithm>
+#include "bmcpu_detect.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BMCPU_SSE2
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace bmcpu {
+
+DetectArena& DetectArena::local() {
+  static thread_local DetectArena arena;
+  return arena;
+}
+
+void DetectArena::clear() {
+  box_.clear();
+  area_.clear();
+  score_.clear();
+  label_.clear();
+}
+
+void DetectAboveThreshold(const float* scores, int num, float threshold,
+                          std::vector<int>* index) {
+  index->clear();
+  int i = 0;
+#if defined(BMCPU_SSE2)
+  const __m128 vthr = _mm_set1_ps(threshold);
+  for (; i + 8 <= num; i += 8) {
+    int mask = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(scores + i), vthr)) |
+               _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(scores + i + 4), vthr)) << 4;
+    for (; mask; mask &= mask - 1) index->push_back(i + __builtin_ctz(mask));
+  }
+#elif defined(__aarch64__)
+  static const uint32_t bits[4] = {1, 2, 4, 8};
+  const float32x4_t vthr = vdupq_n_f32(threshold);
+  const uint32x4_t vbits = vld1q_u32(bits);
+  for (; i + 8 <= num; i += 8) {
+    int mask = vaddvq_u32(vandq_u32(vcgtq_f32(vld1q_f32(scores + i), vthr), vbits)) |
+               vaddvq_u32(vandq_u32(vcgtq_f32(vld1q_f32(scores + i + 4), vthr), vbits)) << 4;
+    for (; mask; mask &= mask - 1) index->push_back(i + __builtin_ctz(mask));
+  }
+#endif
+  for (; i < num; i++)
+    if (scores[i] > threshold) index->push_back(i);
+}
+
+/* SortScorePairDescend of bbox_util, inlined: the same comparisons, so
+ * the stable sort gives the same order */
+struct DetectCaffeDescend {
+  template <typename T>
+  bool operator()(const pair<float, T>& a, const pair<float, T>& b) const {
+    return (a.first - b.first) > std::numeric_limits<float>::epsilon();
+  }
+};
+
+struct DetectExactDescend {
+  template <typename T>
+  bool operator()(const pair<float, T>& a, const pair<float, T>& b) const {
+    return a.first > b.first;
+  }
+};
+
+static void DetectRow(const std::vector<float>& box, int image, int label, float score,
+                      int slot, std::vector<float>* rows) {
+  rows->push_back(image);
+  rows->push_back(label);
+  rows->push_back(score);
+  rows->insert(rows->end(), &box[4 * slot], &box[4 * slot] + 4);
+}
+
+void DetectNms(const DetectParam& param, DetectArena& arena, int image,
+               std::vector<float>* rows) {
+  const int num = arena.num();
+  const int groups = param.class_agnostic ? 1 : param.num_classes;
+  NmsParam nms = param.nms;
+  nms.class_aware = false;
+
+  // Group the candidates by label, keeping the order they were pushed in.
+  std::vector<int>& order = arena.order_;
+  std::vector<int>& begin = arena.label_begin_;
+  order.resize(num);
+  begin.assign(groups + 1, 0);
+  if (param.class_agnostic) {
+    for (int i = 0; i < num; i++) order[i] = i;
+    begin[1] = num;
+  } else {
+    for (int i = 0; i < num; i++) begin[arena.label_[i] + 1]++;
+    for (int g = 0; g < groups; g++) begin[g + 1] += begin[g];
+    // placing moves every begin to the next label's, shift them back
+    for (int i = 0; i < num; i++) order[begin[arena.label_[i]]++] = i;
+    for (int g = groups; g > 0; g--) begin[g] = begin[g - 1];
+    begin[0] = 0;
+  }
+  if ((int)arena.label_keep_.size() < groups) arena.label_keep_.resize(groups);
+  if ((int)arena.kernels_.size() < groups) arena.kernels_.resize(groups, NmsKernel(nms));
+
+  parallel_for(0, groups, [&](int g) {
+    vector<pair<float, int> >& keep = arena.label_keep_[g];
+    keep.clear();
+    for (int i = begin[g]; i < begin[g + 1]; i++)
+      keep.push_back(std::make_pair(arena.score_[order[i]], order[i]));
+    if (keep.empty()) return;
+    if (param.caffe_sort)
+      std::stable_sort(keep.begin(), keep.end(), DetectCaffeDescend());
+    else
+      std::stable_sort(keep.begin(), keep.end(), DetectExactDescend());
+    if (param.top_k > -1 && param.top_k < (int)keep.size()) keep.resize(param.top_k);
+
+    NmsKernel& kernel = arena.kernels_[g];
+    kernel.reset(nms);
+    int max_keep = param.class_agnostic && param.keep_top_k > -1 ? param.keep_top_k : INT_MAX;
+    int kept = 0;
+    for (size_t i = 0; i < keep.size() && kept < max_keep; i++) {
+      const int slot = keep[i].second;
+      const float* box = &arena.box_[4 * slot];
+      const float area = arena.area_[slot];
+      if (kernel.offer(area < 0 ? kernel.load(box) : kernel.load(box, area, 0)))
+        keep[kept++] = keep[i];
+    }
+    keep.resize(kept);
+  });
+
+  int num_det = 0;
+  for (int g = 0; g < groups; g++) num_det += arena.label_keep_[g].size();
+  if (!param.class_agnostic && param.keep_top_k > -1 && num_det > param.keep_top_k) {
+    // Keep the best keep_top_k of the image, then regroup them by label.
+    vector<pair<float, pair<int, int> > > score_index_pairs;
+    score_index_pairs.reserve(num_det);
+    for (int g = 0; g < groups; g++)
+      for (auto& p : arena.label_keep_[g])
+        score_index_pairs.push_back(std::make_pair(p.first, std::make_pair(g, p.second)));
+    if (param.caffe_sort)
+      std::sort(score_index_pairs.begin(), score_index_pairs.end(), DetectCaffeDescend());
+    else
+      std::sort(score_index_pairs.begin(), score_index_pairs.end(), DetectExactDescend());
+    score_index_pairs.resize(param.keep_top_k);
+    std::stable_sort(score_index_pairs.begin(), score_index_pairs.end(),
+                     [](const pair<float, pair<int, int> >& a, const pair<float, pair<int, int> >& b) {
+                       return a.second.first < b.second.first;
+                     });
+    for (auto& p : score_index_pairs)
+      DetectRow(arena.box_, image, p.second.first, p.first, p.second.second, rows);
+    return;
+  }
+  for (int g = 0; g < groups; g++)
+    for (auto& p : arena.label_keep_[g])
+      DetectRow(arena.box_, image, param.class_agnostic ? arena.label_[p.second] : g,
+                p.first, p.second, rows);
+}
+
+void DetectWriteOutput(const std::vector<std::vector<float> >& rows,
+                       float* top_data, std::vector<int>& top_shape) {
+  const int num = rows.size();
+  int total = 0;
+  for (auto& r : rows) total += r.size() / 7;
+  top_shape.clear();
+  top_shape.push_back(1);
+  top_shape.push_back(1);
+  if (total == 0) {
+    top_shape.push_back(num);
+    top_shape.push_back(7);
+    // Generate fake results per image.
+    for (int i = 0; i < num; ++i) {
+      top_data[0] = i;
+      for (int j = 1; j < 7; ++j)
+        top_data[j] = -1;
+      top_data += 7;
+    }
+    return;
+  }
+  top_shape.push_back(total);
+  top_shape.push_back(7);
+  for (auto& r : rows) {
+    std::copy(r.begin(), r.end(), top_data);
+    top_data += r.size();
+  }
+}
+
+}  // namespace bmcpu
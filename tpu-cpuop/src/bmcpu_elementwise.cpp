@@ -0,0 +1,463 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <climits>
+#include <cmath>
+#include <algorithm>
+#include "bmcpu_elementwise.hpp"
+#include "bmcpu_utils.hpp"
+#include "bmcpu_macro.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BMCPU_SSE2
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace bmcpu {
+
+/* about this many elements per parallel_for chunk */
+#define ELEMENTWISE_GRAIN (16 * 1024)
+/* fp16 is converted to fp32 by tiles of this many elements */
+#define FP16_TILE 256
+
+int broadcast_shape(const int* in_shape0, int in_dim0,
+                    const int* in_shape1, int in_dim1, int* out_shape)
+{
+    int out_dim = std::max(in_dim0, in_dim1);
+    for (int i = 0; i < out_dim; i++) {
+        int s0 = (i < out_dim - in_dim0) ? 1 : in_shape0[i - (out_dim - in_dim0)];
+        int s1 = (i < out_dim - in_dim1) ? 1 : in_shape1[i - (out_dim - in_dim1)];
+        out_shape[i] = s0 == 1 ? s1 : (s1 == 1 ? s0 : std::max(s0, s1));
+    }
+    return out_dim;
+}
+
+void broadcast_plan(const int* in_shape0, int in_dim0,
+                    const int* in_shape1, int in_dim1, broadcast_plan_t* plan)
+{
+    int out_dim = std::max(in_dim0, in_dim1);
+    CPU_ASSERT(out_dim <= BROADCAST_MAX_DIM);
+    /* bit 0: input 0 is full in this dim, bit 1: input 1 is full */
+    int type[BROADCAST_MAX_DIM];
+    int prev_type = -1;
+    plan->dim = 0;
+    plan->out_num = 1;
+    for (int i = 0; i < out_dim; i++) {
+        int s0 = (i < out_dim - in_dim0) ? 1 : in_shape0[i - (out_dim - in_dim0)];
+        int s1 = (i < out_dim - in_dim1) ? 1 : in_shape1[i - (out_dim - in_dim1)];
+        int s = s0 == 1 ? s1 : s0;
+        CPU_ASSERT(s0 == s || s0 == 1);
+        CPU_ASSERT(s1 == s || s1 == 1);
+        plan->out_num *= s;
+        if (s == 1) continue;
+        int t = (s0 == s ? 1 : 0) | (s1 == s ? 2 : 0);
+        if (t == prev_type) {
+            plan->shape[plan->dim - 1] *= s;
+        } else {
+            type[plan->dim] = t;
+            plan->shape[plan->dim++] = s;
+            prev_type = t;
+        }
+    }
+    if (plan->dim == 0) {
+        type[0] = 3;
+        plan->shape[0] = 1;
+        plan->dim = 1;
+    }
+    int64_t acc0 = 1, acc1 = 1;
+    for (int i = plan->dim - 1; i >= 0; i--) {
+        plan->stride0[i] = (type[i] & 1) ? acc0 : 0;
+        plan->stride1[i] = (type[i] & 2) ? acc1 : 0;
+        if (type[i] & 1) acc0 *= plan->shape[i];
+        if (type[i] & 2) acc1 *= plan->shape[i];
+    }
+}
+
+/* row(offset0, offset1, out_offset, len) for every inner row of the plan */
+template<typename Row>
+static void run_rows(const broadcast_plan_t& plan, Row row)
+{
+    if (plan.out_num == 0) return;
+    const int dim = plan.dim;
+    const int inner = plan.shape[dim - 1];
+    const int64_t outer = plan.out_num / inner;
+    CPU_ASSERT(outer <= INT_MAX);
+    int grain = std::max(1, ELEMENTWISE_GRAIN / inner);
+    parallel_for(0, (int)outer, grain, [&](int start, int end) {
+        int idx[BROADCAST_MAX_DIM];
+        int64_t r = start;
+        for (int k = dim - 2; k >= 0; k--) {
+            idx[k] = r % plan.shape[k];
+            r /= plan.shape[k];
+        }
+        for (int i = start; i < end; i++) {
+            int64_t off0 = 0, off1 = 0;
+            for (int k = 0; k < dim - 1; k++) {
+                off0 += idx[k] * plan.stride0[k];
+                off1 += idx[k] * plan.stride1[k];
+            }
+            row(off0, off1, (int64_t)i * inner, inner);
+            for (int k = dim - 2; k >= 0; k--) {
+                if (++idx[k] < plan.shape[k]) break;
+                idx[k] = 0;
+            }
+        }
+    });
+}
+
+struct op_mod {
+    static const bool is_mod = true;
+    template<typename T>
+    static T run(T a, T b) { return static_cast<int>(a) % static_cast<int>(b); }
+};
+
+struct op_div {
+    static const bool is_mod = false;
+    template<typename T>
+    static T run(T a, T b) { return static_cast<int>(a) / static_cast<int>(b); }
+};
+
+/* Integer a / b and a % b on the double divider: the quotient of two int32
+ * rounded to double never crosses an integer, so truncating it is exact, and
+ * so is a - q * b. Returns how many leading elements were done. */
+#if defined(BMCPU_SSE2)
+static inline __m128i load_i32x4(const int* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline __m128i load_i32x4(const float* p) { return _mm_cvttps_epi32(_mm_loadu_ps(p)); }
+static inline void store_i32x4(int* p, __m128i v) { _mm_storeu_si128((__m128i*)p, v); }
+static inline void store_i32x4(float* p, __m128i v) { _mm_storeu_ps(p, _mm_cvtepi32_ps(v)); }
+
+template<bool MOD>
+static inline __m128i divmod_i32x2(__m128i a, __m128i b)
+{
+    __m128d ad = _mm_cvtepi32_pd(a);
+    __m128d bd = _mm_cvtepi32_pd(b);
+    __m128i q = _mm_cvttpd_epi32(_mm_div_pd(ad, bd));
+    if (MOD) q = _mm_cvttpd_epi32(_mm_sub_pd(ad, _mm_mul_pd(_mm_cvtepi32_pd(q), bd)));
+    return q;
+}
+
+template<bool MOD>
+static inline __m128i divmod_i32x4(__m128i a, __m128i b)
+{
+    __m128i lo = divmod_i32x2<MOD>(a, b);
+    __m128i hi = divmod_i32x2<MOD>(_mm_shuffle_epi32(a, 0xee), _mm_shuffle_epi32(b, 0xee));
+    return _mm_unpacklo_epi64(lo, hi);
+}
+
+template<bool MOD, int SA, int SB, typename T>
+static int divmod_row_simd(const T* a, const T* b, T* dst, int n)
+{
+    const __m128i va = _mm_set1_epi32(static_cast<int>(a[0]));
+    const __m128i vb = _mm_set1_epi32(static_cast<int>(b[0]));
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m128i a0 = SA ? load_i32x4(a + i) : va;
+        __m128i a1 = SA ? load_i32x4(a + i + 4) : va;
+        __m128i b0 = SB ? load_i32x4(b + i) : vb;
+        __m128i b1 = SB ? load_i32x4(b + i + 4) : vb;
+        store_i32x4(dst + i, divmod_i32x4<MOD>(a0, b0));
+        store_i32x4(dst + i + 4, divmod_i32x4<MOD>(a1, b1));
+    }
+    return i;
+}
+#elif defined(__aarch64__)
+static inline int32x4_t load_i32x4(const int* p) { return vld1q_s32(p); }
+static inline int32x4_t load_i32x4(const float* p) { return vcvtq_s32_f32(vld1q_f32(p)); }
+static inline void store_i32x4(int* p, int32x4_t v) { vst1q_s32(p, v); }
+static inline void store_i32x4(float* p, int32x4_t v) { vst1q_f32(p, vcvtq_f32_s32(v)); }
+
+static inline int32x2_t div_i32x2(int32x2_t a, int32x2_t b)
+{
+    float64x2_t ad = vcvtq_f64_s64(vmovl_s32(a));
+    float64x2_t bd = vcvtq_f64_s64(vmovl_s32(b));
+    return vmovn_s64(vcvtq_s64_f64(vdivq_f64(ad, bd)));
+}
+
+template<bool MOD>
+static inline int32x4_t divmod_i32x4(int32x4_t a, int32x4_t b)
+{
+    int32x4_t q = vcombine_s32(div_i32x2(vget_low_s32(a), vget_low_s32(b)),
+                               div_i32x2(vget_high_s32(a), vget_high_s32(b)));
+    return MOD ? vmlsq_s32(a, q, b) : q;
+}
+
+template<bool MOD, int SA, int SB, typename T>
+static int divmod_row_simd(const T* a, const T* b, T* dst, int n)
+{
+    const int32x4_t va = vdupq_n_s32(static_cast<int>(a[0]));
+    const int32x4_t vb = vdupq_n_s32(static_cast<int>(b[0]));
+    int i = 0;
+    for (; i + 8 <= n; i += 8) {
+        int32x4_t a0 = SA ? load_i32x4(a + i) : va;
+        int32x4_t a1 = SA ? load_i32x4(a + i + 4) : va;
+        int32x4_t b0 = SB ? load_i32x4(b + i) : vb;
+        int32x4_t b1 = SB ? load_i32x4(b + i + 4) : vb;
+        store_i32x4(dst + i, divmod_i32x4<MOD>(a0, b0));
+        store_i32x4(dst + i + 4, divmod_i32x4<MOD>(a1, b1));
+    }
+    return i;
+}
+#else
+template<bool MOD, int SA, int SB, typename T>
+static int divmod_row_simd(const T*, const T*, T*, int) { return 0; }
+#endif
+
+template<typename OP, int SA, int SB, typename T>
+static void binary_row(const T* a, const T* b, T* dst, int n)
+{
+    int i = divmod_row_simd<OP::is_mod, SA, SB>(a, b, dst, n);
+    for (; i < n; i++) {
+        dst[i] = OP::run(a[SA * i], b[SB * i]);
+    }
+}
+
+template<typename OP, int SA, int SB>
+static void binary_row_fp16(const uint16_t* a, const uint16_t* b, uint16_t* dst, int n)
+{
+    float fa[FP16_TILE], fb[FP16_TILE], fo[FP16_TILE];
+    if (!SA) fa[0] = fp16_to_fp32(a[0]);
+    if (!SB) fb[0] = fp16_to_fp32(b[0]);
+    for (int i = 0; i < n; i += FP16_TILE) {
+        int len = std::min(FP16_TILE, n - i);
+        for (int j = 0; SA && j < len; j++) fa[j] = fp16_to_fp32(a[i + j]);
+        for (int j = 0; SB && j < len; j++) fb[j] = fp16_to_fp32(b[i + j]);
+        binary_row<OP, SA, SB>(fa, fb, fo, len);
+        for (int j = 0; j < len; j++) dst[i + j] = fp32_to_fp16(fo[j]);
+    }
+}
+
+template<typename OP, int SA, int SB>
+static void run_binary(const broadcast_plan_t& plan, CPU_DATA_TYPE_T dtype,
+                       const void* in0, const void* in1, void* dst)
+{
+    switch (dtype) {
+    case CPU_DTYPE_INT32:
+        run_rows(plan, [&](int64_t off0, int64_t off1, int64_t off, int n) {
+            binary_row<OP, SA, SB>((const int*)in0 + off0, (const int*)in1 + off1, (int*)dst + off, n);
+        });
+        break;
+    case CPU_DTYPE_FP32:
+        run_rows(plan, [&](int64_t off0, int64_t off1, int64_t off, int n) {
+            binary_row<OP, SA, SB>((const float*)in0 + off0, (const float*)in1 + off1, (float*)dst + off, n);
+        });
+        break;
+    case CPU_DTYPE_FP16:
+        run_rows(plan, [&](int64_t off0, int64_t off1, int64_t off, int n) {
+            binary_row_fp16<OP, SA, SB>((const uint16_t*)in0 + off0, (const uint16_t*)in1 + off1,
+                                        (uint16_t*)dst + off, n);
+        });
+        break;
+    default:
+        printf("error: %s: %d: binary does not support dtype %d\n", __FILE__, __LINE__, dtype);
+        CPU_ASSERT(0);
+    }
+}
+
+/* the op, the dtype and the inner strides are chosen once per call */
+template<typename OP>
+static void run_binary(const broadcast_plan_t& plan, CPU_DATA_TYPE_T dtype,
+                       const void* in0, const void* in1, void* dst)
+{
+    const int last = plan.dim - 1;
+    switch ((plan.stride0[last] ? 1 : 0) | (plan.stride1[last] ? 2 : 0)) {
+    case 1: run_binary<OP, 1, 0>(plan, dtype, in0, in1, dst); break;
+    case 2: run_binary<OP, 0, 1>(plan, dtype, in0, in1, dst); break;
+    default: run_binary<OP, 1, 1>(plan, dtype, in0, in1, dst); break;
+    }
+}
+
+void broadcast_binary(BINARY_OP_CODE_T op, CPU_DATA_TYPE_T dtype,
+                      const void* in0, const int* in_shape0, int in_dim0,
+                      const void* in1, const int* in_shape1, int in_dim1,
+                      void* dst)
+{
+    broadcast_plan_t plan;
+    broadcast_plan(in_shape0, in_dim0, in_shape1, in_dim1, &plan);
+    switch (op) {
+    case OP_MOD:
+        run_binary<op_mod>(plan, dtype, in0, in1, dst);
+        break;
+    case OP_DIV:
+        run_binary<op_div>(plan, dtype, in0, in1, dst);
+        break;
+    default:
+        CPU_ASSERT(0);
+    }
+}
+
+/* floor, ceil and round away from zero: |x| >= 2^23, inf and nan are already
+ * integers, the rest goes through truncation. The sign of x is kept so that
+ * -0.5 gives -0 like std::ceil and std::round. */
+enum round_mode_t { ROUND_FLOOR, ROUND_CEIL, ROUND_AWAY };
+
+#if defined(BMCPU_SSE2)
+template<round_mode_t MODE>
+static int round_simd(const float* in, float* out, int n)
+{
+    const __m128 sign_mask = _mm_set1_ps(-0.f);
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 limit = _mm_set1_ps(8388608.f);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(in + i);
+        __m128 sign = _mm_and_ps(x, sign_mask);
+        __m128 small = _mm_cmplt_ps(_mm_andnot_ps(sign_mask, x), limit);
+        __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+        if (MODE == ROUND_FLOOR) {
+            t = _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), one));
+        } else if (MODE == ROUND_CEIL) {
+            t = _mm_add_ps(t, _mm_and_ps(_mm_cmplt_ps(t, x), one));
+        } else {
+            __m128 frac = _mm_andnot_ps(sign_mask, _mm_sub_ps(x, t));
+            t = _mm_add_ps(t, _mm_and_ps(_mm_cmpge_ps(frac, half), _mm_or_ps(one, sign)));
+        }
+        t = _mm_or_ps(t, sign);
+        _mm_storeu_ps(out + i, _mm_or_ps(_mm_and_ps(small, t), _mm_andnot_ps(small, x)));
+    }
+    return i;
+}
+
+static int isfinite_simd(const float* in, float* out, int n)
+{
+    const __m128i exp_mask = _mm_set1_epi32(0x7f800000);
+    const __m128 one = _mm_set1_ps(1.f);
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i e = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in + i)), exp_mask);
+        __m128i inf = _mm_cmpeq_epi32(e, exp_mask);
+        _mm_storeu_ps(out + i, _mm_andnot_ps(_mm_castsi128_ps(inf), one));
+    }
+    return i;
+}
+#elif defined(__aarch64__)
+template<round_mode_t MODE>
+static int round_simd(const float* in, float* out, int n)
+{
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t x = vld1q_f32(in + i);
+        float32x4_t t = MODE == ROUND_FLOOR ? vrndmq_f32(x) :
+                        MODE == ROUND_CEIL ? vrndpq_f32(x) : vrndaq_f32(x);
+        vst1q_f32(out + i, t);
+    }
+    return i;
+}
+
+static int isfinite_simd(const float* in, float* out, int n)
+{
+    const uint32x4_t exp_mask = vdupq_n_u32(0x7f800000);
+    const uint32x4_t one = vreinterpretq_u32_f32(vdupq_n_f32(1.f));
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        uint32x4_t e = vandq_u32(vld1q_u32((const uint32_t*)(in + i)), exp_mask);
+        vst1q_f32(out + i, vreinterpretq_f32_u32(vbicq_u32(one, vceqq_u32(e, exp_mask))));
+    }
+    return i;
+}
+#else
+template<round_mode_t MODE>
+static int round_simd(const float*, float*, int) { return 0; }
+static int isfinite_simd(const float*, float*, int) { return 0; }
+#endif
+
+static void unary_block(UNARY_OP_CODE_T op, const float* in, float* out, int n)
+{
+    int i = 0;
+    switch (op) {
+    case OP_SIN:
+        for (; i < n; i++) out[i] = std::sin(in[i]);
+        break;
+    case OP_COS:
+        for (; i < n; i++) out[i] = std::cos(in[i]);
+        break;
+    case OP_ISFINITE:
+        for (i = isfinite_simd(in, out, n); i < n; i++) out[i] = std::isfinite(in[i]) ? 1.f : 0.f;
+        break;
+    case OP_ROUND:
+        for (i = round_simd<ROUND_AWAY>(in, out, n); i < n; i++) out[i] = std::round(in[i]);
+        break;
+    case OP_FLOOR:
+        for (i = round_simd<ROUND_FLOOR>(in, out, n); i < n; i++) out[i] = std::floor(in[i]);
+        break;
+    case OP_CEIL:
+        for (i = round_simd<ROUND_CEIL>(in, out, n); i < n; i++) out[i] = std::ceil(in[i]);
+        break;
+    default:
+        printf("error: %s: %d: no match operation. \n", __FILE__, __LINE__);
+        exit(-1);
+        break;
+    }
+}
+
+void elementwise_unary(UNARY_OP_CODE_T op, const float* in, float* out, int64_t len)
+{
+    int64_t block_num = (len + ELEMENTWISE_GRAIN - 1) / ELEMENTWISE_GRAIN;
+    CPU_ASSERT(block_num <= INT_MAX);
+    if (block_num <= 1) {
+        unary_block(op, in, out, (int)len);
+        return;
+    }
+    parallel_for(0, (int)block_num, [&](int b) {
+        int64_t start = (int64_t)b * ELEMENTWISE_GRAIN;
+        unary_block(op, in + start, out + start, (int)std::min<int64_t>(ELEMENTWISE_GRAIN, len - start));
+    });
+}
+
+float fp16_to_fp32(uint16_t h)
+{
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1f;
+    uint32_t man = h & 0x3ff;
+    uint32_t bits;
+    if (exp == 0x1f) {
+        bits = sign | 0x7f800000 | (man << 13);
+    } else if (exp != 0) {
+        bits = sign | ((exp + 112) << 23) | (man << 13);
+    } else if (man == 0) {
+        bits = sign;
+    } else {
+        exp = 113;
+        while (!(man & 0x400)) {
+            man <<= 1;
+            exp--;
+        }
+        bits = sign | (exp << 23) | ((man & 0x3ff) << 13);
+    }
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+uint16_t fp32_to_fp16(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    uint16_t sign = (bits >> 16) & 0x8000;
+    uint32_t abs_bits = bits & 0x7fffffff;
+    if (abs_bits > 0x7f800000)
+        return sign | 0x7e00 | ((abs_bits >> 13) & 0x3ff);
+    if (abs_bits >= 0x477ff000)     /* 65520 and up round to inf */
+        return sign | 0x7c00;
+    if (abs_bits < 0x33000000)      /* up to 2^-25 rounds to zero */
+        return sign;
+    uint32_t h, rem, half;
+    if (abs_bits < 0x38800000) {    /* subnormal */
+        uint32_t man = (abs_bits & 0x7fffff) | 0x800000;
+        int shift = 126 - (int)(abs_bits >> 23);
+        h = man >> shift;
+        rem = man & ((1u << shift) - 1);
+        half = 1u << (shift - 1);
+    } else {
+        h = (abs_bits >> 13) - (112 << 10);
+        rem = abs_bits & 0x1fff;
+        half = 0x1000;
+    }
+    if (rem > half || (rem == half && (h & 1)))
+        h++;
+    return sign | h;
+}
+
+}
@@ -0,0 +1,333 @@
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "bmcpu_gather.hpp"
+#include "bmcpu_elementwise.hpp"
+#include "bmcpu_utils.hpp"
+#include "bmcpu_macro.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BMCPU_SSE2
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace bmcpu {
+
+/* bytes or elements handled by one task */
+#define GATHER_GRAIN (64 * 1024)
+/* prefetch at most this many bytes of the next row */
+#define GATHER_PREFETCH 1024
+
+static inline void gather_prefetch(const void* p, size_t bytes)
+{
+#if defined(__GNUC__)
+    const char* c = (const char*)p;
+    bytes = std::min(bytes, (size_t)GATHER_PREFETCH);
+    for (size_t i = 0; i < bytes; i += 64)
+        __builtin_prefetch(c + i);
+#endif
+}
+
+static inline void gather_copy(char* dst, const char* src, size_t bytes)
+{
+    switch (bytes) {
+    case 2: *(uint16_t*)dst = *(const uint16_t*)src; break;
+    case 4: *(uint32_t*)dst = *(const uint32_t*)src; break;
+    case 8: *(uint64_t*)dst = *(const uint64_t*)src; break;
+    default: memcpy(dst, src, bytes);
+    }
+}
+
+void gather_rows(const void* src, int outer, int axis_len,
+                 const int* index, int index_num, size_t row_bytes, void* dst)
+{
+    const int total = outer * index_num;
+    if (total <= 0 || row_bytes == 0) return;
+    const char* s = (const char*)src;
+    char* d = (char*)dst;
+    int grain = std::max<size_t>(1, GATHER_GRAIN / row_bytes);
+    parallel_for(0, total, grain, [&](int begin, int end) {
+        for (int r = begin; r < end;) {
+            int o = r / index_num;
+            int j = r - o * index_num;
+            // indices counting up copy as one block, e.g. a slice or an arange
+            int run = 1;
+            int stop = std::min(end - r, index_num - j);
+            while (run < stop && index[j + run] == index[j] + run) run++;
+            const char* from = s + ((size_t)o * axis_len + index[j]) * row_bytes;
+            if (run < stop)
+                gather_prefetch(s + ((size_t)o * axis_len + index[j + run]) * row_bytes, row_bytes);
+            gather_copy(d + (size_t)r * row_bytes, from, run * row_bytes);
+            r += run;
+        }
+    });
+}
+
+template <typename T>
+static void gather_elements_typed(const T* src, const int* src_shape,
+                                  const int* index, const int* index_shape, int dims, int axis,
+                                  T* dst)
+{
+    std::vector<size_t> src_stride(dims);
+    src_stride[dims - 1] = 1;
+    for (int d = dims - 2; d >= 0; d--) src_stride[d] = src_stride[d + 1] * src_shape[d + 1];
+    const int last = index_shape[dims - 1];
+    int rows = 1;
+    for (int d = 0; d < dims - 1; d++) rows *= index_shape[d];
+    if (rows <= 0 || last <= 0) return;
+    const size_t axis_stride = src_stride[axis];
+    int grain = std::max(1, GATHER_GRAIN / last);
+    parallel_for(0, rows, grain, [&](int begin, int end) {
+        for (int r = begin; r < end; r++) {
+            // offset of the row in src, the axis coordinate comes from index
+            size_t base = 0;
+            for (int d = dims - 2, rem = r; d >= 0; d--) {
+                int coord = rem % index_shape[d];
+                rem /= index_shape[d];
+                if (d != axis) base += coord * src_stride[d];
+            }
+            const T* s = src + base;
+            const int* idx = index + (size_t)r * last;
+            T* o = dst + (size_t)r * last;
+            if (axis == dims - 1) {
+                for (int k = 0; k < last; k++) o[k] = s[idx[k]];
+            } else {
+                for (int k = 0; k < last; k++) o[k] = s[idx[k] * axis_stride + k];
+            }
+        }
+    });
+}
+
+void gather_elements(const void* src, const int* src_shape,
+                     const int* index, const int* index_shape, int dims, int axis,
+                     int elem_bytes, void* dst)
+{
+    CPU_ASSERT(dims > 0 && axis >= 0 && axis < dims);
+    switch (elem_bytes) {
+    case 1:
+        gather_elements_typed((const uint8_t*)src, src_shape, index, index_shape, dims, axis,
+                              (uint8_t*)dst);
+        break;
+    case 2:
+        gather_elements_typed((const uint16_t*)src, src_shape, index, index_shape, dims, axis,
+                              (uint16_t*)dst);
+        break;
+    case 4:
+        gather_elements_typed((const uint32_t*)src, src_shape, index, index_shape, dims, axis,
+                              (uint32_t*)dst);
+        break;
+    case 8:
+        gather_elements_typed((const uint64_t*)src, src_shape, index, index_shape, dims, axis,
+                              (uint64_t*)dst);
+        break;
+    default:
+        CPU_ASSERT(0);
+    }
+}
+
+/* rows of a half precision table are widened 8 at a time, exactly */
+static void emb_load_fp16(const uint16_t* src, int n, float* dst)
+{
+    int i = 0;
+#if defined(BMCPU_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i sign_mask = _mm_set1_epi32(0x8000);
+    const __m128i abs_mask = _mm_set1_epi32(0x7fff);
+    const __m128i inf_nan = _mm_set1_epi32(0x7bff);
+    const __m128 exp_all = _mm_castsi128_ps(_mm_set1_epi32(0x7f800000));
+    const __m128 scale = _mm_castsi128_ps(_mm_set1_epi32(0x77800000));     /* 2^112 */
+    for (; i + 8 <= n; i += 8) {
+        __m128i h = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128i half[2] = {_mm_unpacklo_epi16(h, zero), _mm_unpackhi_epi16(h, zero)};
+        for (int t = 0; t < 2; t++) {
+            __m128i v = half[t];
+            __m128i sign = _mm_slli_epi32(_mm_and_si128(v, sign_mask), 16);
+            __m128i em = _mm_and_si128(v, abs_mask);
+            // exponent and mantissa moved to fp32 place, rebiased by the
+            // multiply, which also normalizes subnormals
+            __m128 f = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(em, 13)), scale);
+            __m128 special = _mm_castsi128_ps(_mm_cmpgt_epi32(em, inf_nan));
+            f = _mm_or_ps(f, _mm_and_ps(special, exp_all));
+            _mm_storeu_ps(dst + i + 4 * t, _mm_or_ps(f, _mm_castsi128_ps(sign)));
+        }
+    }
+#elif defined(__aarch64__)
+    for (; i + 4 <= n; i += 4)
+        vst1q_f32(dst + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(src + i))));
+#endif
+    for (; i < n; i++) dst[i] = fp16_to_fp32(src[i]);
+}
+
+/* narrows as fp32_to_fp16 does, 4 at a time while all of them are normal
+ * halves, which the rounding branch of the scalar one mispredicts on */
+static void emb_store_fp16(const float* src, int n, uint16_t* dst)
+{
+    int i = 0;
+#if defined(BMCPU_SSE2)
+    const __m128i abs_mask = _mm_set1_epi32(0x7fffffff);
+    const __m128i min_normal = _mm_set1_epi32(0x387fffff);
+    const __m128i to_inf = _mm_set1_epi32(0x477ff000);
+    const __m128i round = _mm_set1_epi32(0xfff);
+    const __m128i one = _mm_set1_epi32(1);
+    const __m128i rebias = _mm_set1_epi32(112 << 10);
+    for (; i + 4 <= n; i += 4) {
+        __m128i bits = _mm_castps_si128(_mm_loadu_ps(src + i));
+        __m128i abs_bits = _mm_and_si128(bits, abs_mask);
+        __m128i normal = _mm_and_si128(_mm_cmpgt_epi32(abs_bits, min_normal),
+                                       _mm_cmplt_epi32(abs_bits, to_inf));
+        if (_mm_movemask_epi8(normal) != 0xffff) {
+            for (int k = 0; k < 4; k++) dst[i + k] = fp32_to_fp16(src[i + k]);
+            continue;
+        }
+        // round to nearest even on the 13 dropped bits, a carry moves the exponent
+        __m128i odd = _mm_and_si128(_mm_srli_epi32(abs_bits, 13), one);
+        __m128i h = _mm_srli_epi32(_mm_add_epi32(abs_bits, _mm_add_epi32(round, odd)), 13);
+        h = _mm_or_si128(_mm_sub_epi32(h, rebias),
+                         _mm_and_si128(_mm_srli_epi32(bits, 16), _mm_set1_epi32(0x8000)));
+        // sign extend the low half so the saturating pack keeps it as is
+        h = _mm_srai_epi32(_mm_slli_epi32(h, 16), 16);
+        _mm_storel_epi64((__m128i*)(dst + i), _mm_packs_epi32(h, h));
+    }
+#elif defined(__aarch64__)
+    for (; i + 4 <= n; i += 4)
+        vst1_u16(dst + i, vreinterpret_u16_f16(vcvt_f16_f32(vld1q_f32(src + i))));
+#endif
+    for (; i < n; i++) dst[i] = fp32_to_fp16(src[i]);
+}
+
+static void emb_load_bf16(const uint16_t* src, int n, float* dst)
+{
+    for (int i = 0; i < n; i++) {
+        uint32_t bits = (uint32_t)src[i] << 16;
+        memcpy(dst + i, &bits, sizeof(bits));
+    }
+}
+
+static inline uint16_t emb_fp32_to_bf16(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    if ((bits & 0x7fffffff) > 0x7f800000)
+        return (bits >> 16) | 0x40;
+    bits += 0x7fff + ((bits >> 16) & 1);    /* round to nearest even */
+    return bits >> 16;
+}
+
+/* acc += row */
+static inline void emb_add(float* acc, const float* row, int n)
+{
+    int i = 0;
+#if defined(BMCPU_SSE2)
+    for (; i + 8 <= n; i += 8) {
+        _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), _mm_loadu_ps(row + i)));
+        _mm_storeu_ps(acc + i + 4, _mm_add_ps(_mm_loadu_ps(acc + i + 4), _mm_loadu_ps(row + i + 4)));
+    }
+#elif defined(__aarch64__)
+    for (; i + 8 <= n; i += 8) {
+        vst1q_f32(acc + i, vaddq_f32(vld1q_f32(acc + i), vld1q_f32(row + i)));
+        vst1q_f32(acc + i + 4, vaddq_f32(vld1q_f32(acc + i + 4), vld1q_f32(row + i + 4)));
+    }
+#endif
+    for (; i < n; i++) acc[i] += row[i];
+}
+
+/* acc = std::max(acc, row), so a NaN already in acc stays and one in row
+ * is ignored. row NULL stands for zeros. */
+static inline void emb_max(float* acc, const float* row, int n)
+{
+    int i = 0;
+#if defined(BMCPU_SSE2)
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4) {
+        __m128 r = row ? _mm_loadu_ps(row + i) : zero;
+        // maxps returns its second operand unless the first is greater
+        _mm_storeu_ps(acc + i, _mm_max_ps(r, _mm_loadu_ps(acc + i)));
+    }
+#elif defined(__aarch64__)
+    const float32x4_t zero = vdupq_n_f32(0.f);
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t a = vld1q_f32(acc + i);
+        float32x4_t r = row ? vld1q_f32(row + i) : zero;
+        vst1q_f32(acc + i, vbslq_f32(vcltq_f32(a, r), r, a));
+    }
+#endif
+    for (; i < n; i++) acc[i] = std::max(acc[i], row ? row[i] : 0.f);
+}
+
+template <typename Load>
+static void emb_bag(const char* weight, int num_embeddings, int dim, size_t row_bytes,
+                    const int* indices, int begin, int end, EMB_MODE_T mode, Load load,
+                    float* acc, float* buf)
+{
+    if (begin >= end) {
+        memset(acc, 0, dim * sizeof(float));
+        return;
+    }
+    for (int j = begin; j < end; j++) {
+        if (j + 1 < end && (unsigned)indices[j + 1] < (unsigned)num_embeddings)
+            gather_prefetch(weight + (size_t)indices[j + 1] * row_bytes, row_bytes);
+        const bool valid = (unsigned)indices[j] < (unsigned)num_embeddings;
+        const float* row = valid ? load(weight + (size_t)indices[j] * row_bytes, buf) : NULL;
+        if (j == begin) {
+            if (row)
+                memcpy(acc, row, dim * sizeof(float));
+            else
+                memset(acc, 0, dim * sizeof(float));
+        } else if (mode == EMB_MAX) {
+            emb_max(acc, row, dim);
+        } else if (row) {
+            emb_add(acc, row, dim);
+        }
+    }
+    if (mode == EMB_MEAN) {
+        const float count = end - begin;
+        for (int k = 0; k < dim; k++) acc[k] /= count;
+    }
+}
+
+void embedding_bag(CPU_DATA_TYPE_T dtype, const void* weight, int num_embeddings, int dim,
+                   const int* indices, int num_indices, const int* offsets, int num_bags,
+                   EMB_MODE_T mode, void* out)
+{
+    CPU_ASSERT(dtype == CPU_DTYPE_FP32 || dtype == CPU_DTYPE_FP16 || dtype == CPU_DTYPE_BFP16);
+    if (num_bags <= 0 || dim <= 0) return;
+    const size_t row_bytes = (size_t)dim * cpu_get_type_len(dtype);
+    const int rows = std::max(1, num_indices / num_bags);
+    int grain = std::max(1, GATHER_GRAIN / (rows * dim));
+    parallel_for(0, num_bags, grain, [&](int bag_begin, int bag_end) {
+        static thread_local std::vector<float> scratch;
+        if (dtype != CPU_DTYPE_FP32 && scratch.size() < 2 * (size_t)dim) scratch.resize(2 * dim);
+        for (int i = bag_begin; i < bag_end; i++) {
+            int begin = offsets[i];
+            int end = i == num_bags - 1 ? num_indices : offsets[i + 1];
+            if (dtype == CPU_DTYPE_FP32) {
+                // reduce right in the output row
+                emb_bag((const char*)weight, num_embeddings, dim, row_bytes, indices, begin, end,
+                        mode, [](const char* row, float*) { return (const float*)row; },
+                        (float*)out + (size_t)i * dim, NULL);
+                continue;
+            }
+            float* acc = scratch.data();
+            uint16_t* o = (uint16_t*)out + (size_t)i * dim;
+            if (dtype == CPU_DTYPE_FP16) {
+                emb_bag((const char*)weight, num_embeddings, dim, row_bytes, indices, begin, end,
+                        mode, [&](const char* row, float* buf) {
+                            emb_load_fp16((const uint16_t*)row, dim, buf);
+                            return (const float*)buf;
+                        }, acc, acc + dim);
+                emb_store_fp16(acc, dim, o);
+            } else {
+                emb_bag((const char*)weight, num_embeddings, dim, row_bytes, indices, begin, end,
+                        mode, [&](const char* row, float* buf) {
+                            emb_load_bf16((const uint16_t*)row, dim, buf);
+                            return (const float*)buf;
+                        }, acc, acc + dim);
+                for (int k = 0; k < dim; k++) o[k] = emb_fp32_to_bf16(acc[k]);
+            }
+        }
+    });
+}
+
+}
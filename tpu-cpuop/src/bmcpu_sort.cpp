@@ -0,0 +1,145 @@
+#include <string.h>
+#include <algorithm>
+#include <vector>
+#include "bmcpu_sort.hpp"
+#include "bmcpu_utils.hpp"
+#include "bmcpu_macro.h"
+
+namespace bmcpu {
+
+/* lanes shorter than this sort the packed pairs with std::sort */
+#define SORT_RADIX_MIN 256
+/* about this many elements per parallel_for chunk */
+#define SORT_GRAIN (64 * 1024)
+/* lanes sorted together when the sort axis is not the last one */
+#define SORT_TILE 16
+
+/* maps a value to an unsigned key of the same order, -0.f to the key of 0.f */
+static inline uint32_t sort_key(float v)
+{
+    uint32_t u;
+    if (v == 0.f) v = 0.f;
+    memcpy(&u, &v, sizeof(u));
+    return (u & 0x80000000u) ? ~u : (u | 0x80000000u);
+}
+
+static inline uint32_t sort_key(int v)
+{
+    return (uint32_t)v ^ 0x80000000u;
+}
+
+/* pair is key << 32 | position, so ordering the pairs as integers orders by
+ * key with ties in input order. LSD radix over the 4 key bytes, a pass is
+ * skipped when all keys share that byte. Returns the buffer holding the result. */
+static const uint64_t* radix_sort_pairs(uint64_t* pair, uint64_t* tmp, int len)
+{
+    uint32_t hist[4][256];
+    memset(hist, 0, sizeof(hist));
+    for (int j = 0; j < len; j++) {
+        uint32_t key = pair[j] >> 32;
+        hist[0][key & 0xff]++;
+        hist[1][(key >> 8) & 0xff]++;
+        hist[2][(key >> 16) & 0xff]++;
+        hist[3][key >> 24]++;
+    }
+    for (int b = 0; b < 4; b++) {
+        int shift = 32 + 8 * b;
+        uint32_t* h = hist[b];
+        if (h[(pair[0] >> shift) & 0xff] == (uint32_t)len) continue;
+        uint32_t sum = 0;
+        for (int d = 0; d < 256; d++) {
+            uint32_t c = h[d];
+            h[d] = sum;
+            sum += c;
+        }
+        for (int j = 0; j < len; j++)
+            tmp[h[(pair[j] >> shift) & 0xff]++] = pair[j];
+        std::swap(pair, tmp);
+    }
+    /* after an odd number of passes this is the caller's tmp */
+    return pair;
+}
+
+/* sorts tile lanes next to each other (inner > 1), so that the gather and
+ * the index scatter walk rows of tile contiguous elements instead of
+ * striding by inner for every element. pair holds tile * len entries. */
+template<typename T, typename IndexT>
+static void sort_tile(const T* in, int tile, int len, int64_t inner, bool descending,
+                      uint64_t* pair, uint64_t* tmp, IndexT* index, T* out)
+{
+    uint32_t flip = descending ? 0xffffffffu : 0;
+    for (int j = 0; j < len; j++) {
+        const T* row = in + j * inner;
+        for (int t = 0; t < tile; t++)
+            pair[t * (int64_t)len + j] = (uint64_t)(sort_key(row[t]) ^ flip) << 32 | (uint32_t)j;
+    }
+    for (int t = 0; t < tile; t++) {
+        uint64_t* lane = pair + t * (int64_t)len;
+        if (len < SORT_RADIX_MIN) {
+            std::sort(lane, lane + len);
+        } else if (radix_sort_pairs(lane, tmp, len) != lane) {
+            memcpy(lane, tmp, len * sizeof(uint64_t));
+        }
+    }
+    for (int j = 0; j < len; j++) {
+        IndexT* index_row = index + j * inner;
+        T* out_row = out ? out + j * inner : NULL;
+        for (int t = 0; t < tile; t++) {
+            uint32_t pos = (uint32_t)pair[t * (int64_t)len + j];
+            index_row[t] = (IndexT)pos;
+            if (out_row) out_row[t] = in[pos * inner + t];
+        }
+    }
+}
+
+template<typename T, typename IndexT>
+static void sort_lanes(const T* in, int outer, int len, int inner, bool descending,
+                       IndexT* index, T* out)
+{
+    if (outer <= 0 || len <= 0 || inner <= 0) return;
+    int grain = std::max(1, SORT_GRAIN / len);
+    if (inner > 1) grain = (grain + SORT_TILE - 1) / SORT_TILE * SORT_TILE;
+    parallel_for(0, outer * inner, grain, [&](int begin, int end) {
+        /* one scratch per chunk, reused by all its lanes */
+        std::vector<uint64_t> pair((int64_t)std::min(SORT_TILE, inner) * len);
+        std::vector<uint64_t> tmp(len < SORT_RADIX_MIN ? 0 : len);
+        for (int lane = begin; lane < end;) {
+            int i = lane % inner;
+            int tile = std::min(std::min(SORT_TILE, inner - i), end - lane);
+            int64_t base = (int64_t)(lane / inner) * len * inner + i;
+            sort_tile(in + base, tile, len, inner, descending, pair.data(), tmp.data(),
+                      index + base, out ? out + base : NULL);
+            lane += tile;
+        }
+    });
+}
+
+void strided_sort(const float* in, int outer, int len, int inner, bool descending,
+                  int* index, float* out)
+{
+    sort_lanes(in, outer, len, inner, descending, index, out);
+}
+
+void strided_sort(const int* in, int outer, int len, int inner, bool descending,
+                  int* index, int* out)
+{
+    sort_lanes(in, outer, len, inner, descending, index, out);
+}
+
+void strided_argsort(const float* in, int outer, int len, int inner, bool descending,
+                     float* index)
+{
+    sort_lanes(in, outer, len, inner, descending, index, (float*)NULL);
+}
+
+void sort_view(const int* shape, int dims, int axis, int* outer, int* len, int* inner)
+{
+    CPU_ASSERT(axis >= 0 && axis < dims);
+    *outer = 1;
+    *inner = 1;
+    for (int i = 0; i < axis; i++) *outer *= shape[i];
+    for (int i = axis + 1; i < dims; i++) *inner *= shape[i];
+    *len = shape[axis];
+}
+
+}
@@ -0,0 +1,255 @@
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include "bmcpu_topk.hpp"
+#include "bmcpu_utils.hpp"
+#include "bmcpu_macro.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BMCPU_SSE2
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace bmcpu {
+
+/* lanes at least this many times longer than k stream through a bounded
+ * heap, shorter ones select with nth_element over all the pairs */
+#define TOPK_HEAP_RATIO 16
+/* about this many elements per parallel_for chunk */
+#define TOPK_GRAIN (64 * 1024)
+
+/* Every element maps to a signed key of the same order, negated with ~ when
+ * the smallest are wanted. A candidate is packed as
+ * (key ^ INT_MIN) << 32 | ~index, so the k largest pairs are the answer and
+ * equal keys prefer the lower index. */
+static inline uint64_t topk_pack(int32_t key, uint32_t j)
+{
+    return (uint64_t)((uint32_t)key ^ 0x80000000u) << 32 | (uint32_t)~j;
+}
+
+static inline int32_t topk_key_of(uint64_t pair)
+{
+    return (int32_t)((uint32_t)(pair >> 32) ^ 0x80000000u);
+}
+
+static inline uint32_t topk_index_of(uint64_t pair)
+{
+    return ~(uint32_t)pair;
+}
+
+/* sign and magnitude floats, the magnitude bits of negatives are flipped and
+ * -0 lands on the key of 0 */
+struct TopkFp32 {
+    typedef uint32_t T;
+    static int32_t key(T v) {
+        int32_t b = (int32_t)v, m = b >> 31;
+        return (b ^ (m & 0x7fffffff)) - m;
+    }
+    static T one() { return 0x3f800000u; }
+};
+
+/* fp16 and bf16 share the sign and magnitude layout */
+struct TopkHalf {
+    typedef uint16_t T;
+    static int32_t key(T v) {
+        int32_t b = (int16_t)v, m = b >> 31;
+        return (b ^ (m & 0x7fff)) - m;
+    }
+};
+struct TopkFp16 : TopkHalf { static T one() { return 0x3c00; } };
+struct TopkBf16 : TopkHalf { static T one() { return 0x3f80; } };
+
+template<typename I>
+struct TopkInt {
+    typedef I T;
+    static int32_t key(T v) { return (int32_t)v; }
+    static T one() { return 1; }
+};
+
+struct TopkUint32 {
+    typedef uint32_t T;
+    static int32_t key(T v) { return (int32_t)(v ^ 0x80000000u); }
+    static T one() { return 1; }
+};
+
+/* bit t set when the key of p[t], xor flip, is above thr, for 8 elements */
+template<typename K>
+static inline int topk_block_mask(const typename K::T* p, int32_t thr, int32_t flip)
+{
+    int mask = 0;
+    for (int t = 0; t < 8; t++)
+        mask |= ((K::key(p[t]) ^ flip) > thr) << t;
+    return mask;
+}
+
+#if defined(BMCPU_SSE2)
+static inline __m128i topk_fp32_key4(__m128i b)
+{
+    __m128i m = _mm_srai_epi32(b, 31);
+    return _mm_sub_epi32(_mm_xor_si128(b, _mm_and_si128(m, _mm_set1_epi32(0x7fffffff))), m);
+}
+
+template<>
+inline int topk_block_mask<TopkFp32>(const uint32_t* p, int32_t thr, int32_t flip)
+{
+    __m128i vthr = _mm_set1_epi32(thr), vflip = _mm_set1_epi32(flip);
+    __m128i k0 = _mm_xor_si128(topk_fp32_key4(_mm_loadu_si128((const __m128i*)p)), vflip);
+    __m128i k1 = _mm_xor_si128(topk_fp32_key4(_mm_loadu_si128((const __m128i*)(p + 4))), vflip);
+    return _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(k0, vthr))) |
+           _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(k1, vthr))) << 4;
+}
+#elif defined(__aarch64__)
+static inline int topk_mask4(uint32x4_t gt)
+{
+    static const uint32_t bits[4] = {1, 2, 4, 8};
+    return vaddvq_u32(vandq_u32(gt, vld1q_u32(bits)));
+}
+
+static inline int32x4_t topk_fp32_key4(int32x4_t b)
+{
+    int32x4_t m = vshrq_n_s32(b, 31);
+    return vsubq_s32(veorq_s32(b, vandq_s32(m, vdupq_n_s32(0x7fffffff))), m);
+}
+
+template<>
+inline int topk_block_mask<TopkFp32>(const uint32_t* p, int32_t thr, int32_t flip)
+{
+    int32x4_t vthr = vdupq_n_s32(thr), vflip = vdupq_n_s32(flip);
+    int32x4_t k0 = veorq_s32(topk_fp32_key4(vld1q_s32((const int32_t*)p)), vflip);
+    int32x4_t k1 = veorq_s32(topk_fp32_key4(vld1q_s32((const int32_t*)(p + 4))), vflip);
+    return topk_mask4(vcgtq_s32(k0, vthr)) | topk_mask4(vcgtq_s32(k1, vthr)) << 4;
+}
+#endif
+
+struct topk_out_t {
+    bool largest;
+    bool sorted;
+    void* values;
+    void* indices;
+    bool float_index;
+    void* mask;
+};
+
+/* min heap of the k best pairs so far, the input is only touched once and
+ * a block of 8 is skipped when none of it beats the k-th best key */
+template<typename K>
+static void topk_heap(const typename K::T* in, int len, int64_t inner, int k,
+                      int32_t flip, uint64_t* heap)
+{
+    std::greater<uint64_t> cmp;
+    for (int j = 0; j < k; j++)
+        heap[j] = topk_pack(K::key(in[j * inner]) ^ flip, j);
+    std::make_heap(heap, heap + k, cmp);
+    int32_t thr = topk_key_of(heap[0]);
+    auto offer = [&](int j) {
+        int32_t key = K::key(in[j * inner]) ^ flip;
+        /* a later index never wins a tie */
+        if (key <= thr) return;
+        std::pop_heap(heap, heap + k, cmp);
+        heap[k - 1] = topk_pack(key, j);
+        std::push_heap(heap, heap + k, cmp);
+        thr = topk_key_of(heap[0]);
+    };
+    int j = k;
+    if (inner == 1) {
+        for (; j + 8 <= len; j += 8) {
+            int mask = topk_block_mask<K>(in + j, thr, flip);
+            while (mask) {
+                int t = __builtin_ctz(mask);
+                mask &= mask - 1;
+                offer(j + t);
+            }
+        }
+    }
+    for (; j < len; j++) offer(j);
+}
+
+template<typename K>
+static void topk_lane(const typename K::T* in, int len, int64_t inner, int k,
+                      const topk_out_t& out, int64_t in_base, int64_t out_base,
+                      std::vector<uint64_t>& scratch)
+{
+    typedef typename K::T T;
+    int32_t flip = out.largest ? 0 : -1;
+    if ((int64_t)k * TOPK_HEAP_RATIO <= len) {
+        if ((int)scratch.size() < k) scratch.resize(k);
+        topk_heap<K>(in, len, inner, k, flip, scratch.data());
+    } else {
+        if ((int)scratch.size() < len) scratch.resize(len);
+        for (int j = 0; j < len; j++)
+            scratch[j] = topk_pack(K::key(in[j * inner]) ^ flip, j);
+        if (k < len)
+            std::nth_element(scratch.begin(), scratch.begin() + k - 1,
+                             scratch.begin() + len, std::greater<uint64_t>());
+    }
+    uint64_t* best = scratch.data();
+    if (out.sorted) {
+        std::sort(best, best + k, std::greater<uint64_t>());
+    } else {
+        /* ~index descending is index ascending */
+        std::sort(best, best + k, [](uint64_t a, uint64_t b) { return (uint32_t)a > (uint32_t)b; });
+    }
+
+    T* values = out.values ? (T*)out.values + out_base : NULL;
+    T* mask = out.mask ? (T*)out.mask + in_base : NULL;
+    if (mask) {
+        for (int j = 0; j < len; j++) mask[j * inner] = 0;
+    }
+    for (int t = 0; t < k; t++) {
+        uint32_t j = topk_index_of(best[t]);
+        if (values) values[t * inner] = in[j * inner];
+        if (out.indices) {
+            if (out.float_index) ((float*)out.indices)[out_base + t * inner] = (float)j;
+            else ((int*)out.indices)[out_base + t * inner] = (int)j;
+        }
+        if (mask) mask[j * inner] = K::one();
+    }
+}
+
+template<typename K>
+static void topk_lanes(const void* in, int outer, int len, int inner, int k,
+                       const topk_out_t& out)
+{
+    typedef typename K::T T;
+    int kk = std::min(k, len);
+    int grain = std::max(1, TOPK_GRAIN / len);
+    parallel_for(0, outer * inner, grain, [&](int begin, int end) {
+        /* kept per thread, so repeated calls do not allocate */
+        static thread_local std::vector<uint64_t> scratch;
+        for (int lane = begin; lane < end; lane++) {
+            int o = lane / inner, i = lane % inner;
+            int64_t in_base = (int64_t)o * len * inner + i;
+            int64_t out_base = (int64_t)o * k * inner + i;
+            topk_lane<K>((const T*)in + in_base, len, inner, kk, out,
+                         in_base, out_base, scratch);
+        }
+    });
+}
+
+void topk(CPU_DATA_TYPE_T dtype, const void* in, int outer, int len, int inner,
+          int k, bool largest, bool sorted,
+          void* values, void* indices, CPU_DATA_TYPE_T index_dtype, void* mask)
+{
+    if (outer <= 0 || len <= 0 || inner <= 0 || k <= 0) return;
+    CPU_ASSERT(index_dtype == CPU_DTYPE_INT32 || index_dtype == CPU_DTYPE_FP32 ||
+               index_dtype == CPU_DTYPE_UINT32);
+    topk_out_t out = {largest, sorted, values, indices, index_dtype == CPU_DTYPE_FP32, mask};
+    switch (dtype) {
+    case CPU_DTYPE_FP32:   topk_lanes<TopkFp32>(in, outer, len, inner, k, out); break;
+    case CPU_DTYPE_FP16:   topk_lanes<TopkFp16>(in, outer, len, inner, k, out); break;
+    case CPU_DTYPE_BFP16:  topk_lanes<TopkBf16>(in, outer, len, inner, k, out); break;
+    case CPU_DTYPE_INT8:   topk_lanes<TopkInt<int8_t>>(in, outer, len, inner, k, out); break;
+    case CPU_DTYPE_UINT8:  topk_lanes<TopkInt<uint8_t>>(in, outer, len, inner, k, out); break;
+    case CPU_DTYPE_INT16:  topk_lanes<TopkInt<int16_t>>(in, outer, len, inner, k, out); break;
+    case CPU_DTYPE_UINT16: topk_lanes<TopkInt<uint16_t>>(in, outer, len, inner, k, out); break;
+    case CPU_DTYPE_INT32:  topk_lanes<TopkInt<int32_t>>(in, outer, len, inner, k, out); break;
+    case CPU_DTYPE_UINT32: topk_lanes<TopkUint32>(in, outer, len, inner, k, out); break;
+    default:
+        CPU_ASSERT(0);
+    }
+}
+
+}
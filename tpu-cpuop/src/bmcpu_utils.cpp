@@ -1,4 +1,5 @@
 #include <cstdlib>
+#include <climits>
 #include "bmcpu_utils.hpp"
 namespace bmcpu {
 int using_thread_num(int N){
@@ -11,6 +12,110 @@ int using_thread_num(int N){
   return nthreads;
 }
 
+ThreadPool::ThreadPool(int thread_num) {
+  for (int i = 1; i < thread_num; i++) {
+    workers_.emplace_back(&ThreadPool::worker_loop, this);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  job_cv_.notify_all();
+  for (auto& t : workers_) {
+    t.join();
+  }
+}
+
+static thread_local bool in_pool_task = false;
+
+/* take tasks of the current job until none is left */
+static void run_tasks(const std::function<void(int)>& task, int task_num,
+                      std::atomic<int>& next_task, std::exception_ptr& error,
+                      std::mutex& mutex, int& done_num) {
+  int done = 0;
+  std::exception_ptr first_error;
+  bool was_in_task = in_pool_task;
+  in_pool_task = true;
+  for (int i = next_task.fetch_add(1); i < task_num; i = next_task.fetch_add(1)) {
+    try {
+      task(i);
+    } catch (...) {
+      if (!first_error) first_error = std::current_exception();
+    }
+    done++;
+  }
+  in_pool_task = was_in_task;
+  std::lock_guard<std::mutex> lock(mutex);
+  done_num += done;
+  if (first_error && !error) error = first_error;
+}
+
+void ThreadPool::worker_loop() {
+  unsigned long seen_job = 0;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    job_cv_.wait(lock, [&] { return stop_ || (task_ && job_id_ != seen_job); });
+    if (stop_) return;
+    seen_job = job_id_;
+    const std::function<void(int)>& task = *task_;
+    int task_num = task_num_;
+    active_num_++;
+    lock.unlock();
+    run_tasks(task, task_num, next_task_, error_, mutex_, done_num_);
+    lock.lock();
+    active_num_--;
+    done_cv_.notify_all();
+  }
+}
+
+void ThreadPool::run(int task_num, const std::function<void(int)>& task) {
+  std::unique_lock<std::mutex> run_lock(run_mutex_, std::defer_lock);
+  if (workers_.empty() || task_num <= 1 || in_pool_task || !run_lock.try_lock()) {
+    for (int i = 0; i < task_num; i++) task(i);
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    task_num_ = task_num;
+    next_task_ = 0;
+    done_num_ = 0;
+    error_ = nullptr;
+    job_id_++;
+  }
+  job_cv_.notify_all();
+  run_tasks(task, task_num, next_task_, error_, mutex_, done_num_);
+
+  std::exception_ptr error;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    // workers that wake up late must not see the finished job
+    done_cv_.wait(lock, [&] { return done_num_ == task_num && active_num_ == 0; });
+    task_ = nullptr;
+    error = error_;
+  }
+  if (error) std::rethrow_exception(error);
+}
+
+static thread_local ThreadPool* thread_pool_in_scope = nullptr;
+
+ThreadPool* current_thread_pool() {
+  if (thread_pool_in_scope) return thread_pool_in_scope;
+  static ThreadPool default_pool(using_thread_num(INT_MAX));
+  return &default_pool;
+}
+
+ThreadPoolScope::ThreadPoolScope(ThreadPool* pool) : prev_(thread_pool_in_scope) {
+  thread_pool_in_scope = pool;
+}
+
+ThreadPoolScope::~ThreadPoolScope() {
+  thread_pool_in_scope = prev_;
+}
+
 int cpu_get_type_len(CPU_DATA_TYPE_T dtype) {
     if(dtype == CPU_DTYPE_FP32 || dtype == CPU_DTYPE_UINT32 || dtype == CPU_DTYPE_INT32){
         return 4;
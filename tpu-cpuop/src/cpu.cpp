@@ -1,5 +1,8 @@
+#include <climits>
+#include <mutex>
 #include "cpu_layer.h"
 #include "bmcpu.h"
+#include "bmcpu_utils.hpp"
 #ifdef __linux__
 #include <dlfcn.h>
 #else
@@ -27,7 +30,12 @@ typedef int (*t_bmcpu_user_dtype)(void *, void *,
                                   vector<int>&);
 
 typedef struct {
-  std::map<int, std::shared_ptr<cpu_layer>> cpu_layers_;
+  /* idle instances of each op type, a call takes one for its whole duration
+   * since layers keep the tensors and params of the call as members */
+  std::map<int, std::vector<std::shared_ptr<cpu_layer>>> cpu_layers_;
+  std::mutex cpu_layers_mutex_;
+  /* threads of the multi-threaded layers, kept for the handle's lifetime */
+  std::shared_ptr<bmcpu::ThreadPool> thread_pool_;
 
   void *user_cpu_handle;
   t_bmcpu_user_init    bmcpu_user_init_;
@@ -37,6 +45,39 @@ typedef struct {
   t_bmcpu_user_dtype   bmcpu_user_dtype_;
 } bmcpu_handle_t;
 
+/* an instance of op_type for the current call, another one is created when
+ * all instances are busy in other threads; returned to the handle in the end */
+class cpu_layer_guard {
+public:
+    cpu_layer_guard(bmcpu_handle_t *handle, int op_type) : handle_(handle), idle_(nullptr) {
+        std::lock_guard<std::mutex> lock(handle_->cpu_layers_mutex_);
+        auto iter = handle_->cpu_layers_.find(op_type);
+        if (iter == handle_->cpu_layers_.end()) {
+            return;
+        }
+        idle_ = &iter->second;
+        if (idle_->empty()) {
+            layer_ = CpuLayerRegistry::createlayer(op_type);
+        } else {
+            layer_ = idle_->back();
+            idle_->pop_back();
+        }
+    }
+    ~cpu_layer_guard() {
+        if (layer_) {
+            std::lock_guard<std::mutex> lock(handle_->cpu_layers_mutex_);
+            idle_->push_back(layer_);
+        }
+    }
+    cpu_layer *get() const { return layer_.get(); }
+    cpu_layer *operator->() const { return layer_.get(); }
+
+private:
+    bmcpu_handle_t *handle_;
+    std::vector<std::shared_ptr<cpu_layer>> *idle_;
+    std::shared_ptr<cpu_layer> layer_;
+};
+
 #ifndef __linux__
 bool windows_support(int idx) {
     return idx < 46;
@@ -56,12 +97,13 @@ void* bmcpu_init()
         }
         #endif
         if (layer_idx != CPU_USER_DEFINED) {
-            cpu_layers_[layer_idx] = CpuLayerRegistry::createlayer(layer_idx);
+            cpu_layers_[layer_idx].push_back(CpuLayerRegistry::createlayer(layer_idx));
         } else {
             // printf("bmcpu init: skip cpu_user_defined\n");
         }
     }
-    cpu_layers_[CPU_DEBUG] = CpuLayerRegistry::createlayer(CPU_DEBUG);
+    cpu_layers_[CPU_DEBUG] = {CpuLayerRegistry::createlayer(CPU_DEBUG)};
+    bmcpu_handle_->thread_pool_ = std::make_shared<bmcpu::ThreadPool>(bmcpu::using_thread_num(INT_MAX));
 
     #ifdef __linux__
     t_bmcpu_user_init    bmcpu_user_init_      =  (t_bmcpu_user_init)dlsym(NULL,    "user_cpu_init");
@@ -182,12 +224,12 @@ int bmcpu_process(void* bmcpu_handle, int op_type,
         }
 
     } else {
-        auto& cpu_layers_ = bmcpu_handle_->cpu_layers_;
-        map<int, std::shared_ptr<cpu_layer> >::iterator iter = cpu_layers_.find(op_type);
-        if (iter != cpu_layers_.end()) {
-            iter->second->set_common_param(input_tensors,  input_shapes,
-                                       output_tensors, output_shapes);
-            result_code = iter->second->process(param, param_size);
+        cpu_layer_guard layer(bmcpu_handle_, op_type);
+        if (layer.get()) {
+            bmcpu::ThreadPoolScope pool_scope(bmcpu_handle_->thread_pool_.get());
+            layer->set_common_param(input_tensors,  input_shapes,
+                                    output_tensors, output_shapes);
+            result_code = layer->process(param, param_size);
         } else {
             cout << "unknown cpu_layer" << endl;
             result_code = -1;
@@ -245,10 +287,9 @@ int bmcpu_reshape(void* bmcpu_handle, int op_type,
         }
 
     } else {
-        auto& cpu_layers_ = bmcpu_handle_->cpu_layers_;
-        map<int, std::shared_ptr<cpu_layer> >::iterator iter = cpu_layers_.find(op_type);
-        if (iter != cpu_layers_.end()) {
-            return iter->second->reshape(param, param_size, input_shapes, output_shapes);
+        cpu_layer_guard layer(bmcpu_handle_, op_type);
+        if (layer.get()) {
+            return layer->reshape(param, param_size, input_shapes, output_shapes);
         }
     }
 
@@ -280,10 +321,9 @@ int  bmcpu_dtype(void* bmcpu_handle, int op_type, const void *param, size_t para
         }
 
     } else {
-        auto& cpu_layers_ = bmcpu_handle_->cpu_layers_;
-        map<int, std::shared_ptr<cpu_layer> >::iterator iter = cpu_layers_.find(op_type);
-        if (iter != cpu_layers_.end()) {
-            return iter->second->dtype(param, param_size, input_dtypes, output_dtypes);
+        cpu_layer_guard layer(bmcpu_handle_, op_type);
+        if (layer.get()) {
+            return layer->dtype(param, param_size, input_dtypes, output_dtypes);
         }
     }
 
@@ -1,6 +1,6 @@
 #include "cpu_affine_grid_generator.h"
 #include <cmath>
-#include <thread>
+#include "bmcpu_utils.hpp"
 #define FLOAT_PTR(p) (reinterpret_cast<float *>(p))
 #define INT_PTR(p) (reinterpret_cast<int *>(p))
 #define FLOAT(val) (static_cast<float>(val))
@@ -68,11 +68,7 @@ int cpu_affine_grid_generatorlayer::process(void *param, int psize) {
     if (num_thread == 1)
         func(ps.data());
     else {
-        std::vector<std::thread> threads;
-        for (auto &it : ps)
-            threads.push_back(std::thread(func, &it));
-        for (auto &it : threads)
-            it.join();
+        parallel_for(0, (int)ps.size(), [&](int i) { func(&ps[i]); });
     }
     *output_shapes_ = {{N, H, W, 2}};
     delete [] hSteps;
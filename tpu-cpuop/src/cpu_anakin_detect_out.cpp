@@ -1,5 +1,6 @@
 #include "cpu_anakin_detect_out.h"
 #include <algorithm>
+#include "bmcpu_utils.hpp"
 
 #define Dtype float
 //#define TIME_PROFILE
@@ -153,18 +154,11 @@ int cpu_anakin_detect_outlayer::process(void *param, int param_size)
   for (int i = 0; i < num; ++i) {
     map<int, vector<pair<float,int>> > indices;
     int num_det = 0;
-    for (int c = 0; c < num_classes_; ++c) {
-      if (c == background_label_id_) continue;
-      if (c >= num_classes_) {
-        // Something bad happened if there are no predictions for current label.
-        BM_LOG(FATAL) << "Could not find confidence predictions for label " << c;
-      }
+    // Classes are independent, their nms runs in parallel.
+    vector<vector<pair<float,int>> > class_indices(num_classes_);
+    parallel_for(0, num_classes_, [&](int c) {
       int label = share_location_ ? 0 : c;
-      if (label >= num_loc_classes_) {
-        // Something bad happened if there are no predictions for current label.
-        BM_LOG(FATAL) << "Could not find location predictions for label " << label;
-        continue;
-      }
+      if (c == background_label_id_ || label >= num_loc_classes_) return;
       const NormalizedBBoxOpt* bboxes = all_decode_bboxes + label * num_priors_ +
                                         i * num_priors_ * num_loc_classes_;
       const float* bboxes_area = all_decode_bboxes_area + label * num_priors_ +
@@ -174,7 +168,17 @@ int cpu_anakin_detect_outlayer::process(void *param, int param_size)
       else                            scores = scores + c * num_priors_;
       ApplyNMSFast_opt(bboxes, num_priors_, bboxes_area, scores,
           confidence_threshold_, nms_threshold_, eta_, top_k_,
-          conf_stride, &(indices[c]));
+          conf_stride, &class_indices[c]);
+    });
+    for (int c = 0; c < num_classes_; ++c) {
+      if (c == background_label_id_) continue;
+      int label = share_location_ ? 0 : c;
+      if (label >= num_loc_classes_) {
+        // Something bad happened if there are no predictions for current label.
+        BM_LOG(FATAL) << "Could not find location predictions for label " << label;
+        continue;
+      }
+      indices[c].swap(class_indices[c]);
       num_det += indices[c].size();
     }
     if (keep_top_k_ > -1 && num_det > keep_top_k_) {
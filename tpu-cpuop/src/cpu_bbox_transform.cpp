@@ -1,6 +1,6 @@
 #include "cpu_bbox_transform.h"
 #include <cmath>
-#include <thread>
+#include "bmcpu_utils.hpp"
 #define FLOAT_PTR(p) (reinterpret_cast<float *>(p))
 #define INT_PTR(p) (reinterpret_cast<int *>(p))
 #define FLOAT(val) (static_cast<float>(val))
@@ -110,11 +110,7 @@ int cpu_bbox_transformlayer::process(void *param, int psize) {
         if (num_thread == 1)
             func(ps.data());
         else {
-            std::vector<std::thread> threads;
-            for (auto &it : ps)
-                threads.push_back(std::thread(func, &it));
-            for (auto &it : threads)
-                it.join();
+            parallel_for(0, (int)ps.size(), [&](int i) { func(&ps[i]); });
         }
         offset += num_rois;
         delete [] cur_boxes;
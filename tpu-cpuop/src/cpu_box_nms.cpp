@@ -3,6 +3,8 @@
 #include <algorithm>
 #include "cpu_box_nms.h"
 #include "bmcpu_macro.h"
+#include "bmcpu_utils.hpp"
+#include "bbox_util_opt.hpp"
 
 namespace bmcpu {
 
@@ -77,95 +79,6 @@ static void center_to_corner(int i, float* data, int stride){
     real_data[3] = y+h_half;
 }
 
-static float box_area(const float* box, int format){
-    float width, height;
-    if(format == BOX_FORMAT_CENTER){
-        width = box[2];
-        height = box[3];
-    } else {
-        width = box[2]- box[0];
-        height = box[3] - box[1];
-    }
-    if(width<0 || height<0){
-        return 0;
-    }
-    return height*width;
-}
-static void compute_area(int i, float* areas, const float* in_data, const int* indice,
-                         const int* batch_start, int topk, int stride, int format){
-    int b = i/topk;
-    int k = i%topk;
-    int pos = batch_start[b]+k;
-    if(pos>=batch_start[b+1]) return;
-    int index = indice[pos];
-    int in_offset = index * stride;
-    areas[pos] = box_area(in_data+in_offset, format);
-}
-
-float compute_overlap(const float* box0, const float* box1, int format){
-    float left, right, top, bottom;
-    if(format == BOX_FORMAT_CENTER){
-        int w_half0 = box0[2]/2;
-        int h_half0 = box0[3]/2;
-        int w_half1 = box1[2]/2;
-        int h_half1 = box1[3]/2;
-        left = std::max(box0[0]-w_half0, box1[0]-w_half1);
-        right = std::min(box0[0]+w_half0, box1[0]+w_half1);
-        top = std::max(box0[1]-h_half0, box1[1]-h_half1);
-        bottom = std::min(box0[1]+h_half0, box1[1]+h_half1);
-    } else {
-        left = std::max(box0[0], box1[0]);
-        top = std::max(box0[1], box1[1]);
-        right = std::min(box0[2], box1[2]);
-        bottom = std::min(box0[3], box1[3]);
-    }
-    if(left>right || top>bottom){
-        return 0;
-    }
-    return (right-left) * (bottom-top);
-}
-
-void nms_mark(int i, int* index,
-              const int* batch_start, const float *input, const float* areas,
-              int num_worker, int ref, int stride, int offset_box, int offset_id,
-              float thresh, bool force, int format){
-    int b = i/num_worker;
-    int pos = i%num_worker+ ref+1;
-    ref = batch_start[b]+ref;
-    pos = batch_start[b]+pos;
-    if(ref>=batch_start[b+1]) return;
-    if(pos>=batch_start[b+1]) return;
-    if(index[ref]<0) return;
-    if(index[pos]<0) return;
-    int ref_offset = index[ref] * stride + offset_box;
-    int pos_offset = index[pos] * stride + offset_box;
-    if(!force && offset_id>=0){
-        int ref_id = input[ref_offset-offset_box + offset_id];
-        int pos_id = input[pos_offset-offset_box + offset_id];
-        if(ref_id != pos_id) return;
-    }
-    float overlap = compute_overlap(input+ref_offset, input+pos_offset, format);
-    float iou = overlap / (areas[ref]+ areas[pos]- overlap);
-    if(iou> thresh){
-        index[pos] = -1;
-    }
-}
-void compute_nms(int num_batch, int topk,
-                 int* valid_index, const int* batch_start,
-                 const float* in_ptr, const float* areas,
-                 int stride, int coord_start, int id_index,
-                 float threshold, bool force_suppress, int in_format){
-    for(int ref=0; ref<topk; ref++){
-        int num_worker = topk - ref -1;
-        if(num_worker<1) continue;
-        ParallelExecutor::run(nms_mark, num_batch*num_worker,
-                              valid_index, batch_start, in_ptr, areas,
-                              num_worker, ref, stride, coord_start, id_index,
-                              threshold, force_suppress, in_format);
-
-    }
-}
-
 int bmcpu::cpu_boxnmslayer::process(void *raw_param, int param_size)
 {
     BMCPU_DECLARE_AND_UNPACK_PARAM(cpu_box_nms_param_t, param, raw_param, param_size);
@@ -225,16 +138,21 @@ int bmcpu::cpu_boxnmslayer::process(void *raw_param, int param_size)
         }
     }
 
-    std::vector<float> areas(num_valid);
-    ParallelExecutor::run(
-                compute_area,
-                num_batch*topk, areas.data(),
-                in_ptr+coord_start, valid_indice.data(), batch_start.data(),
-                topk, stride, in_format);
-    compute_nms(num_batch, topk,
-                valid_indice.data(), batch_start.data(), in_ptr, areas.data(),
-                stride, coord_start, id_index, param->overlap_thresh,
-                param->force_suppress, in_format);
+    /* greedy nms over the first topk boxes of every batch */
+    NmsParam nms_param = {in_format == BOX_FORMAT_CENTER ? NMS_IOU_MXNET_CENTER : NMS_IOU_MXNET,
+                          param->overlap_thresh, 1.f, 0.f,
+                          !param->force_suppress && class_exist};
+    parallel_for(0, num_batch, [&](int b) {
+        NmsKernel kernel(nms_param);
+        int end = std::min(batch_start[b] + topk, batch_start[b+1]);
+        for(int pos=batch_start[b]; pos<end; pos++){
+            const float* item = in_ptr + valid_indice[pos] * stride;
+            int id = class_exist ? static_cast<int>(item[id_index]) : 0;
+            if(!kernel.offer(kernel.load(item + coord_start, id))){
+                valid_indice[pos] = -1;
+            }
+        }
+    });
     std::fill(out_ptr, out_ptr + total_elem*stride, -1.0);
     ParallelExecutor::run(assign_nms_batch,
                           num_batch, out_ptr, in_ptr, stride, valid_indice.data(), batch_start.data(), topk, num_elem);
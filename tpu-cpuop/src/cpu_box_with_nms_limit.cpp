@@ -1,4 +1,6 @@
 #include "cpu_box_with_nms_limit.h"
+#include "bbox_util_opt.hpp"
+#include "bmcpu_utils.hpp"
 #include <algorithm>
 #define FLOAT_PTR(p) (reinterpret_cast<float *>(p))
 #define INT_PTR(p) (reinterpret_cast<int *>(p))
@@ -52,44 +54,16 @@ static inline void boxWithNMSLimit(const BoxWithNMSLimitParam_t *p) {
         });
         int keep_max = p->detections_per_im > 0 ? p->detections_per_im : -1;
         if (p->box_dim == 4) {
-            std::vector<int> order = inds;
-            float *areas = new float[p->num_boxes];
-            const float *biter = p->boxes;
-            for (int i = 0; i < p->num_boxes; ++i) {
-                areas[i] = (biter[2] - biter[0] + legacy_plus_one) *
-                           (biter[3] - biter[1] + legacy_plus_one);
-                biter += p->boxes_stride;
-            }
-            while (order.size() > 0) {
+            NmsParam nms_param = {NMS_IOU_CAFFE2, p->nms_thres, 1.f,
+                                  FLOAT(legacy_plus_one), false};
+            NmsKernel kernel(nms_param);
+            for (int o = 0; o < inds.size(); ++o) {
                 if (keep_max >= 0 && p->keep->size() >= keep_max)
                     break;
-                int i = order[0];
-                p->keep->push_back(i);
-                std::vector<int> rinds(order.begin() + 1, order.end());
-                const float *ib = p->boxes + i * p->boxes_stride;
-                std::vector<int> new_order;
-                for (int o = 0; o < rinds.size(); ++o) {
-                    const float *biter = p->boxes + rinds[o] * p->boxes_stride;
-                    float w = std::max(std::min(biter[2], ib[2]) -
-                                       std::max(biter[0], ib[0]) + legacy_plus_one, 0.f);
-                    if (w == 0.f) {
-                        new_order.push_back(order[o + 1]);
-                        continue;
-                    }
-                    float h = std::max(std::min(biter[3], ib[3]) -
-                                       std::max(biter[1], ib[1]) + legacy_plus_one, 0.f);
-                    if (h == 0.f) {
-                        new_order.push_back(order[o + 1]);
-                        continue;
-                    }
-                    float inter = w * h;
-                    float ovr = inter / (areas[i] + areas[rinds[o]] - inter);
-                    if (ovr <= p->nms_thres)
-                        new_order.push_back(order[o + 1]);
-                }
-                order = new_order;
+                const float *box = p->boxes + inds[o] * p->boxes_stride;
+                if (kernel.offer(kernel.load(box)))
+                    p->keep->push_back(inds[o]);
             }
-            delete [] areas;
         } else
             CPU_ASSERT(p->box_dim == 4);
     }
@@ -126,8 +100,7 @@ int cpu_box_with_nms_limitlayer::process(void *param, int psize) {
         const float *scores = FLOAT_PTR(input_tensors_[0]) + offset * input_shapes_[0][1];
         const float *boxes = FLOAT_PTR(input_tensors_[1]) + offset * input_shapes_[1][1];
         std::vector<std::vector<int>> keeps(num_classes);
-        int total_keep_count = 0;
-        for (int j = 1; j < num_classes; ++j) {
+        parallel_for(1, num_classes, [&](int j) {
             BoxWithNMSLimitParam_t p;
             p.scores = scores + this->get_score_cls_index(j);
             p.num_scores = input_shapes_[0][0];
@@ -143,8 +116,10 @@ int cpu_box_with_nms_limitlayer::process(void *param, int psize) {
             p.legacy_plus_one = rip->legacy_plus_one;
             p.keep = &keeps[j];
             boxWithNMSLimit(&p);
-            total_keep_count += p.keep->size();
-        }
+        });
+        int total_keep_count = 0;
+        for (int j = 1; j < num_classes; ++j)
+            total_keep_count += keeps[j].size();
         if (rip->soft_nms_enabled)
             CPU_ASSERT(!rip->soft_nms_enabled);
         if (rip->detections_per_im > 0 && total_keep_count > rip->detections_per_im) {
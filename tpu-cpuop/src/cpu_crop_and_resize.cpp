@@ -1,6 +1,6 @@
 #include <string>
 #include <cmath>
-#include <thread>
+#include "bmcpu_utils.hpp"
 #include "cpu_crop_and_resize.h"
 #include "cpu_layer.h"
 namespace  bmcpu {
@@ -188,11 +188,7 @@ int cpu_crop_and_resizelayer::process(void *raw_param, int param_size) {
                 c.num = i < num_thread - 1 ? bpt : (input_shapes_[1][0] - bpt * i);
                 ps.push_back(c);
             }
-            std::vector<std::thread> threads;
-            for (auto &it : ps)
-                threads.push_back(std::thread(threadProc, &it));
-            for (auto &it : threads)
-                it.join();
+            parallel_for(0, (int)ps.size(), [&](int i) { threadProc(&ps[i]); });
         }
     }
     (*output_shapes_)[0][0] = input_shapes_[1][0];
@@ -2,7 +2,7 @@
 #include <algorithm>
 #include <numeric>
 #include <cmath>
-#include <thread>
+#include "bmcpu_utils.hpp"
 #define FLOAT_PTR(p) (reinterpret_cast<float *>(p))
 #define INT_PTR(p) (reinterpret_cast<int *>(p))
 #define FLOAT(val) (static_cast<float>(val))
@@ -191,11 +191,7 @@ int cpu_distribute_fpn_proposals_roi_align_concatlayer::process(void *param, int
     if (num_thread == 1)
         func(ps.data());
     else {
-        std::vector<std::thread> threads;
-        for (auto &it : ps)
-            threads.push_back(std::thread(func, &it));
-        for (auto &it : threads)
-            it.join();
+        parallel_for(0, (int)ps.size(), [&](int i) { func(&ps[i]); });
     }
     int total = 0;
     for (int i = 0; i < 4; ++i) {
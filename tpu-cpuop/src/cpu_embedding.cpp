@@ -2,6 +2,8 @@
 #include <vector>
 #include "cpu_embedding.h"
 #include "cpu_layer.h"
+#include "bmcpu_gather.hpp"
+#include "bmcpu_utils.hpp"
 
 namespace bmcpu {
 
@@ -24,15 +26,11 @@ int cpu_embeddinglayer::process(void* param, int param_size) {
     }
 
     int embedding_dim = weight_shape[1];
-    float * output = output_tensors_[0];
     for (int i=0; i<input_size; ++i) {
-        const float *embedding_index = weight + input[i]*embedding_dim;
-        for (int j=0; j<embedding_dim; ++j) {
-            *output = *embedding_index;
-            ++output;
-            ++embedding_index;
-        }
+        CPU_ASSERT(input[i] >= 0 && input[i] < weight_shape[0]);
     }
+    gather_rows(weight, 1, weight_shape[0], input, input_size,
+                (size_t)embedding_dim * cpu_get_type_len(params->dtype), output_tensors_[0]);
 
     for (int i=0; i<input_dim; ++i) {
         (*output_shapes_)[0][i] = shape[i];
@@ -1,6 +1,8 @@
 #include "cpu_gathernd.h"
 #include <algorithm>
 #include <fstream>
+#include <vector>
+#include "bmcpu_gather.hpp"
 using namespace std;
 
 namespace bmcpu {
@@ -14,17 +16,6 @@ int cpu_gatherndlayer::process(void *raw_param, int param_size) {
     CPU_ASSERT(indice_dim == 2);
     const float* data_ptr = input_tensors_[0];
     const int* indice = (int*)input_tensors_[1];
-    if(is_float){
-        int indice_len = 1;
-        for(int i=0; i<indice_dim; i++){
-            indice_len *= indice_shape[i];
-        }
-        auto int_buffer = new int[indice_len];
-        for(int i=0; i<indice_len; i++){
-            int_buffer[i] = (int)(input_tensors_[1][i]);
-        }
-        indice = int_buffer;
-    }
 
     int dim_out = data_dim - indice_shape[0] + 1;
     
@@ -34,35 +25,28 @@ int cpu_gatherndlayer::process(void *raw_param, int param_size) {
     if (dim_out - 1 > 0) {
         std::copy(data_shape.end() - (dim_out - 1), data_shape.end(), shape_out.begin()+1);
     }
-    
-    //calculate the offset coefficient of the data sequence
-    int* base_offset = new int[data_dim];
-    base_offset[data_dim - 1] = 1;
-    for (int i = 0; i < data_dim - 1; i++) {
-        int temp_base = 1;
-        for (int i_temp_base = i; i_temp_base < data_dim - 1; i_temp_base++) {
-            temp_base *= data_shape[i_temp_base + 1];
-        }
-        base_offset[i] = temp_base;
+
+    //every column of indice picks one row of data, which is the part of data
+    //after the first indice_shape[0] dims
+    int row_size = 1;
+    for (int i = indice_shape[0]; i < data_dim; i++) {
+        row_size *= data_shape[i];
     }
-    
-    //copy the list with different offset according to different output dim
-    float* out_ptr = output_tensors_[0];
-    int out_index = 0;
-    for (int i = 0; i < shape_out[0]; i++) {
-        int offset_move = 0;  //the offset of every move action
-        for (int i_move = 0; i_move < indice_shape[0]; i_move++) {
-            offset_move += extract_from_indice(indice, indice_shape,i_move, i) * base_offset[i_move];
-        }
-        memcpy(out_ptr + out_index, data_ptr + offset_move, base_offset[indice_shape[0] - 1] * sizeof(float));
-        out_index += base_offset[indice_shape[0] - 1];
+    int row_num = 1;
+    for (int i = 0; i < indice_shape[0]; i++) {
+        row_num *= data_shape[i];
     }
-    
-    delete []base_offset;
-    if(is_float){
-        delete []indice;
+    static thread_local std::vector<int> rows;
+    rows.assign(indice_shape[1], 0);
+    for (int i_move = 0; i_move < indice_shape[0]; i_move++) {
+        for (int i = 0; i < indice_shape[1]; i++) {
+            int pos = is_float ? (int)(input_tensors_[1][i_move * indice_shape[1] + i])
+                               : indice[i_move * indice_shape[1] + i];
+            rows[i] = rows[i] * data_shape[i_move] + pos;
+        }
     }
-    
+    gather_rows(data_ptr, 1, row_num, rows.data(), indice_shape[1],
+                row_size * sizeof(float), output_tensors_[0]);
     return 0;
 
 }
@@ -82,9 +66,5 @@ int cpu_gatherndlayer::reshape(void *param, int param_size,
     return 0;
 }
 
-int cpu_gatherndlayer::extract_from_indice(const int* ptr, vector<int> shape, int i0, int i1) {
-    return ptr[i0 * shape[1] + i1];
-}
-
 REGISTER_CPULAYER_CLASS(CPU_GATHERND, cpu_gathernd)
 }/* namespace bmcpu*/
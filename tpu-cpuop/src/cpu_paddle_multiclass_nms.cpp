@@ -1,4 +1,6 @@
 #include "cpu_paddle_multiclass_nms.h"
+#include "bbox_util_opt.hpp"
+#include "bmcpu_utils.hpp"
 #include <algorithm>
 #include <numeric>
 #include <cmath>
@@ -31,41 +33,6 @@ void cpu_paddle_multiclass_nmslayer::GetMaxScoreIndex(
     }
 }
 
-float cpu_paddle_multiclass_nmslayer::BBoxArea(const float* box) {
-    if (box[2] < box[0] || box[3] < box[1]) {
-        return 0.f;
-    } else {
-        const float w = box[2] - box[0];
-        const float h = box[3] - box[1];
-        if (normalized_) {
-            return w * h;
-        } else {
-            return (w + 1) * (h + 1);
-        }
-    }
-}
-
-float cpu_paddle_multiclass_nmslayer::JaccardOverlap(
-    const float* box1,
-    const float* box2) {
-    if (box2[0] > box1[2] || box2[2] < box1[0] || box2[1] > box1[3] ||
-            box2[3] < box1[1]) {
-        return 0.f;
-    } else {
-        const float inter_xmin = std::max(box1[0],  box2[0]);
-        const float inter_ymin = std::max(box1[1],  box2[1]);
-        const float inter_xmax = std::min(box1[2],  box2[2]);
-        const float inter_ymax = std::min(box1[3],  box2[3]);
-        float norm = normalized_ ? 0.f : 1.f;
-        float inter_w = inter_xmax - inter_xmin + norm;
-        float inter_h = inter_ymax - inter_ymin + norm;
-        const float inter_area = inter_w * inter_h;
-        const float bbox1_area = BBoxArea(box1);
-        const float bbox2_area = BBoxArea(box2);
-        return inter_area / (bbox1_area + bbox2_area - inter_area);
-    }
-}
-
 void cpu_paddle_multiclass_nmslayer::NMSFast(float* box,
         float* score,
         std::vector<int>* selected_indices) {
@@ -73,30 +40,28 @@ void cpu_paddle_multiclass_nmslayer::NMSFast(float* box,
     std::vector<std::pair<float,  int>> sorted_indices;
     GetMaxScoreIndex(score,  &sorted_indices);
     selected_indices->clear();
-    float adaptive_threshold = nms_threshold_;
-    while (sorted_indices.size() != 0) {
-        const int idx = sorted_indices.front().second;
-        bool keep = true;
-        for (size_t k = 0; k < selected_indices->size(); ++k) {
+    if (box_size != 4) {
+        /* no overlap is defined for other box sizes */
+        float adaptive_threshold = nms_threshold_;
+        for (size_t i = 0; i < sorted_indices.size(); ++i) {
+            bool keep = selected_indices->empty() || 0.f <= adaptive_threshold;
             if (keep) {
-                const int kept_idx = (*selected_indices)[k];
-                float overlap = 0.f;
-                if (box_size == 4) {
-                    overlap = JaccardOverlap(box + idx * box_size,
-                                             box + kept_idx * box_size);
-                }
-                keep = overlap <= adaptive_threshold;
-            } else {
-                break;
+                selected_indices->push_back(sorted_indices[i].second);
+            }
+            if (keep && nms_eta_ < 1 && adaptive_threshold > 0.5) {
+                adaptive_threshold *= nms_eta_;
             }
         }
-        if (keep) {
+        return;
+    }
+    NmsParam param = {NMS_IOU_PADDLE, nms_threshold_, nms_eta_,
+                      normalized_ ? 0.f : 1.f, false};
+    NmsKernel kernel(param);
+    for (size_t i = 0; i < sorted_indices.size(); ++i) {
+        const int idx = sorted_indices[i].second;
+        if (kernel.offer(kernel.load(box + idx * box_size))) {
             selected_indices->push_back(idx);
         }
-        sorted_indices.erase(sorted_indices.begin());
-        if (keep && nms_eta_ < 1 && adaptive_threshold > 0.5) {
-            adaptive_threshold *= nms_eta_;
-        }
     }
 }
 
@@ -137,10 +102,15 @@ void cpu_paddle_multiclass_nmslayer::MultiClassNMS(float* box,
         int* num_nmsed_out) {
     int num_det = 0;
     int class_num = score_dims_[1];
+    std::vector<std::vector<int>> class_indices(class_num);
+    parallel_for(0, class_num, [&](int c) {
+        if (c == background_label_) return;
+        float* c_score = score + c * score_dims_[2];
+        NMSFast(box,  c_score,  &class_indices[c]);
+    });
     for (int c = 0; c < class_num; ++c) {
         if (c == background_label_) continue;
-        float* c_score = score + c * score_dims_[2];
-        NMSFast(box,  c_score,  &((*indices)[c]));
+        (*indices)[c].swap(class_indices[c]);
         num_det += (*indices)[c].size();
     }
     *num_nmsed_out = num_det;
@@ -3,6 +3,7 @@
 #include <numeric>
 #include <cmath>
 #include <queue>
+#include "bmcpu_utils.hpp"
 
 namespace bmcpu {
     
@@ -91,42 +92,51 @@ namespace bmcpu {
 
         float* boxes_data = output_tensors_[0];
         float* scores_data = output_tensors_[1];
-        float box[4];
         memset(boxes_data,  0,  output_shapes_[0][0][0] * output_shapes_[0][0][1] * output_shapes_[0][0][2] * sizeof(float));
         memset(scores_data,  0,  output_shapes_[0][1][0] * output_shapes_[0][1][1] * output_shapes_[0][1][2] * sizeof(float));
 
         bool clip_bbox = clip_bbox_;
         float scale = scale_;
         float bias = -0.5 * (scale - 1.);
-        for (int i = 0; i < n; i++) {
-            int img_height = imgsize_data[2 * i]; 
+        // Skip the anchors whose objectness logit is far below the logit of
+        // conf_thresh_ without calling exp, the ones near it still take the
+        // sigmoid test, so the same anchors are kept.
+        bool prefilter = conf_thresh_ > 1e-6f && conf_thresh_ < 0.99f;
+        float logit_thresh = prefilter ?
+            std::log((double)conf_thresh_ / (1. - conf_thresh_)) - 0.05 : 0.f;
+        parallel_for(0, n * an_num, [&](int ij) {
+            int i = ij / an_num;
+            int j = ij - i * an_num;
+            int img_height = imgsize_data[2 * i];
             int img_width = imgsize_data[2 * i + 1];
-            for (int j = 0; j < an_num; j++) {
-                for (int k = 0; k < h; k++) {
-                    for (int l = 0; l < w; l++) {
-                        int obj_idx =
-                            GetEntryIndex(i,  j,  k * w + l,  an_num,  an_stride,  stride,  4); 
-                        float conf = sigmoid<float>(input_data[obj_idx]);
-                        if (conf < conf_thresh_) {
-                            continue;
-                        }
-                        int box_idx =
-                            GetEntryIndex(i,  j,  k * w + l,  an_num,  an_stride,  stride,  0); 
-                        GetYoloBox<float>(box,  input_data,  anchors_data,  l,  k,  j,  h,  w, 
-                                input_size_h,  input_size_w,  box_idx,  stride, 
-                                img_height,  img_width,  scale,  bias);
-                        box_idx = (i * b_num + j * stride + k * w + l) * 4;
-                        CalcDetectionBox<float>(boxes_data,  box,  box_idx,  img_height,  img_width, 
-                                clip_bbox);
-                        int label_idx =
-                            GetEntryIndex(i,  j,  k * w + l,  an_num,  an_stride,  stride,  5); 
-                        int score_idx = (i * b_num + j * stride + k * w + l) * class_num_;
-                        CalcLabelScore<float>(scores_data,  input_data,  label_idx,  score_idx, 
-                                class_num_,  conf,  stride);
+            float box[4];
+            for (int k = 0; k < h; k++) {
+                for (int l = 0; l < w; l++) {
+                    int obj_idx =
+                        GetEntryIndex(i,  j,  k * w + l,  an_num,  an_stride,  stride,  4);
+                    if (prefilter && input_data[obj_idx] < logit_thresh) {
+                        continue;
                     }
+                    float conf = sigmoid<float>(input_data[obj_idx]);
+                    if (conf < conf_thresh_) {
+                        continue;
+                    }
+                    int box_idx =
+                        GetEntryIndex(i,  j,  k * w + l,  an_num,  an_stride,  stride,  0);
+                    GetYoloBox<float>(box,  input_data,  anchors_data,  l,  k,  j,  h,  w,
+                            input_size_h,  input_size_w,  box_idx,  stride,
+                            img_height,  img_width,  scale,  bias);
+                    box_idx = (i * b_num + j * stride + k * w + l) * 4;
+                    CalcDetectionBox<float>(boxes_data,  box,  box_idx,  img_height,  img_width,
+                            clip_bbox);
+                    int label_idx =
+                        GetEntryIndex(i,  j,  k * w + l,  an_num,  an_stride,  stride,  5);
+                    int score_idx = (i * b_num + j * stride + k * w + l) * class_num_;
+                    CalcLabelScore<float>(scores_data,  input_data,  label_idx,  score_idx,
+                            class_num_,  conf,  stride);
                 }
-            }   
-        }
+            }
+        });
  #ifdef CALC_TIME
         gettimeofday(&stop,  0);
         float timeuse = 1000000 * (stop.tv_sec - start.tv_sec) + stop.tv_usec - start.tv_usec;
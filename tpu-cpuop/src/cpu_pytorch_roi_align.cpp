@@ -3,7 +3,7 @@
 #include <numeric>
 #include <vector>
 #include <cmath>
-#include <thread>
+#include "bmcpu_utils.hpp"
 #define FLOAT_PTR(p) (reinterpret_cast<float *>(p))
 #define INT_PTR(p) (reinterpret_cast<int *>(p))
 #define FLOAT(val) (static_cast<float>(val))
@@ -167,11 +167,7 @@ int cpu_pytorch_roi_alignlayer::process(void *param, int psize) {
     if (num_thread == 1)
         func(ps.data());
     else {
-        std::vector<std::thread> threads;
-        for (auto &it : ps)
-            threads.push_back(std::thread(func, &it));
-        for (auto &it : threads)
-            it.join();
+        parallel_for(0, (int)ps.size(), [&](int i) { func(&ps[i]); });
     }
     *output_shapes_ = {{num_rois, channels, pooled_h, pooled_w}};
     return 0;
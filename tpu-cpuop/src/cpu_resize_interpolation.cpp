@@ -1,5 +1,5 @@
 #include <cmath>
-#include <thread>
+#include "bmcpu_utils.hpp"
 #include "cpu_resize_interpolation.h"
 #include "cpu_layer.h"
 namespace bmcpu {
@@ -196,11 +196,7 @@ static inline void nearest(const std::vector<threadProcParam<int> > &ps,
     if (ps.size() == 1)
         f(&ps[0]);
     else {
-        std::vector<std::thread> threads;
-        for (auto &it : ps)
-            threads.push_back(std::thread(f, &it));
-        for (auto &it : threads)
-            it.join();
+        parallel_for(0, (int)ps.size(), [&](int i) { f(&ps[i]); });
     }
 }
 static inline void bilinearNCHW2NCHW(const threadProcParam<BilinearInterp> *p) {
@@ -323,11 +319,7 @@ static inline void bilinear(
     if (ps.size() == 1)
         f(&ps[0]);
     else {
-        std::vector<std::thread> threads;
-        for (auto &it : ps)
-            threads.push_back(std::thread(f, &it));
-        for (auto &it : threads)
-            it.join();
+        parallel_for(0, (int)ps.size(), [&](int i) { f(&ps[i]); });
     }
 }
 static inline void copyNCHW2NCHW(const threadProcParam<void> *p) {
@@ -399,11 +391,7 @@ static inline void copy(const std::vector<threadProcParam<void> > &ps,
     if (ps.size() == 1)
         f(&ps[0]);
     else {
-        std::vector<std::thread> threads;
-        for (auto &it : ps)
-            threads.push_back(std::thread(f, &it));
-        for (auto &it : threads)
-            it.join();
+        parallel_for(0, (int)ps.size(), [&](int i) { f(&ps[i]); });
     }
 }
 int cpu_resize_interpolationlayer::process(void *param, int param_size) {
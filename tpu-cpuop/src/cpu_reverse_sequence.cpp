@@ -1,5 +1,5 @@
 #include "cpu_reverse_sequence.h"
-#include <thread>
+#include "bmcpu_utils.hpp"
 
 namespace bmcpu {
 
@@ -55,9 +55,7 @@ void compute_reverse_sequence(
     func(ps.data());
   }
   else {
-    std::vector<std::thread> threads;
-    for (auto &it : ps) threads.push_back(std::thread(func, &it));
-    for (auto &it : threads) it.join();
+    parallel_for(0, (int)ps.size(), [&](int i) { func(&ps[i]); });
   }
  
 }
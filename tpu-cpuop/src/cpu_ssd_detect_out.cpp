@@ -1,5 +1,6 @@
 #include "cpu_ssd_detect_out.h"
 #include <algorithm>
+#include "bmcpu_detect.hpp"
 
 #define Dtype float
 //#define TIME_PROFILE
@@ -46,154 +47,61 @@ int cpu_ssd_detect_outlayer::process(void *param, int param_size)
 
   // Retrieve all prior bboxes. It is same within a batch since we assume all
   // images in a batch are of same dimension.
-  TIMER_START;
   float* prior_bboxes = NULL;
   float* prior_variances = NULL;
   GetPriorBBoxes_opt(prior_data, num_priors_, prior_bboxes, prior_variances);
-  TIMER_END("GetPriorBBoxes");
 
-  // Decode all loc predictions to bboxes.
-  TIMER_START;
-  NormalizedBBoxOpt* all_decode_bboxes = NULL;
-  float* all_decode_bboxes_area = NULL;
-  const bool clip_bbox = false;
-  DecodeBBoxesAll_opt(all_loc_preds, prior_bboxes, prior_variances, num,
-      share_location_, num_priors_, num_loc_classes_,
-      background_label_id_, code_type_, variance_encoded_in_target_,
-      clip_bbox, all_decode_bboxes, all_decode_bboxes_area);
-  TIMER_END("DecodeBBoxesAll");
+  if (!share_location_ && num_loc_classes_ < num_classes_) {
+    // Something bad happened if there are no predictions for a label.
+    BM_LOG(FATAL) << "Could not find location predictions for label " << num_loc_classes_;
+  }
 
+  // Threshold the scores first and decode only the priors some class keeps,
+  // 4 priors at a time as DecodeBBoxesAll_opt would.
   TIMER_START;
-  int num_kept = 0;
-  vector<map<int, vector<pair<float,int>> > > all_indices;
-  for (int i = 0; i < num; ++i) {
-    map<int, vector<pair<float,int>> > indices;
-    int num_det = 0;
-    for (int c = 0; c < num_classes_; ++c) {
-      if (c == background_label_id_) continue;
-      if (c >= num_classes_) {
-        // Something bad happened if there are no predictions for current label.
-        BM_LOG(FATAL) << "Could not find confidence predictions for label " << c;
-      }
+  DetectParam detect_param;
+  detect_param.nms.type = NMS_IOU_CAFFE;
+  detect_param.nms.iou_threshold = nms_threshold_;
+  detect_param.nms.eta = eta_;
+  detect_param.nms.offset = 0.f;
+  detect_param.nms.class_aware = false;
+  detect_param.num_classes = num_classes_;
+  detect_param.top_k = top_k_;
+  detect_param.keep_top_k = keep_top_k_;
+  detect_param.class_agnostic = false;
+  detect_param.caffe_sort = true;
+  const int num_blocks = (num_priors_ + 3) / 4;
+  auto fill = [&](int i, DetectArena& arena) {
+    const int loc_num = num_loc_classes_ * num_priors_;
+    arena.cache.resize(loc_num * 5);
+    arena.flags.assign(num_loc_classes_ * num_blocks, 0);
+    NormalizedBBoxOpt* decode_bboxes = (NormalizedBBoxOpt*)arena.cache.data();
+    float* decode_area = arena.cache.data() + loc_num * 4;
+    const float* conf = conf_data + i * num_priors_ * num_classes_;
+    DetectAboveThreshold(conf, num_priors_ * num_classes_, confidence_threshold_, &arena.index);
+    for (int k : arena.index) {
+      int p = k / num_classes_;
+      int c = k - p * num_classes_;
       int label = share_location_ ? 0 : c;
-      if (label >= num_loc_classes_) {
-        // Something bad happened if there are no predictions for current label.
-        BM_LOG(FATAL) << "Could not find location predictions for label " << label;
-        continue;
+      if (c == background_label_id_ || label >= num_loc_classes_) continue;
+      int offset = label * num_priors_;
+      int block = p / 4;
+      if (!arena.flags[label * num_blocks + block]) {
+        int begin = block * 4;
+        DecodeBBox_opt(prior_bboxes + 4 * begin, prior_variances + 4 * begin,
+            std::min(4, num_priors_ - begin), code_type_, variance_encoded_in_target_,
+            false, all_loc_preds + i * loc_num + offset + begin,
+            decode_bboxes + offset + begin, decode_area + offset + begin);
+        arena.flags[label * num_blocks + block] = 1;
       }
-
-      const float* scores = (float*)conf_data + i * num_priors_ * num_classes_ + c;
-      const NormalizedBBoxOpt* bboxes = all_decode_bboxes + label * num_priors_ +
-                                        i * num_priors_ * num_loc_classes_;
-      const float* bboxes_area = all_decode_bboxes_area + label * num_priors_ +
-                                 i * num_priors_ * num_loc_classes_;
-      ApplyNMSFast_opt(bboxes, num_priors_, bboxes_area, scores, confidence_threshold_,
-          nms_threshold_, eta_, top_k_, num_classes_, &(indices[c]));
-      num_det += indices[c].size();
+      arena.push(&decode_bboxes[offset + p].xmin, decode_area[offset + p], conf[k], c);
     }
-    if (keep_top_k_ > -1 && num_det > keep_top_k_) {
-      vector<pair<float, pair<int, int> > > score_index_pairs;
-      for (auto it = indices.begin(); it != indices.end(); ++it) {
-        int label = it->first;
-        const vector<pair<float,int>>& label_indices = it->second;
-        if (label >= num_classes_) {
-          // Something bad happened for current label.
-          BM_LOG(FATAL) << "Could not find location predictions for " << label;
-          continue;
-        }
-        for (int j = 0; j < label_indices.size(); ++j) {
-          int idx = label_indices[j].second;
-          BM_CHECK_LT(idx, num_priors_);
-          score_index_pairs.push_back(std::make_pair(
-                  label_indices[j].first, std::make_pair(label, idx)));
-        }
-      }
-      // Keep top k results per image.
-      // insert_sort(score_index_pairs.begin(), score_index_pairs.end());
-      std::sort(score_index_pairs.begin(), score_index_pairs.end(),
-                SortScorePairDescend<pair<int, int> >);
-      score_index_pairs.resize(keep_top_k_);
-      // Store the new indices.
-      map<int, vector<pair<float,int>> > new_indices;
-      for (int j = 0; j < score_index_pairs.size(); ++j) {
-        int label = score_index_pairs[j].second.first;
-        int idx = score_index_pairs[j].second.second;
-        float s = score_index_pairs[j].first;
-        new_indices[label].push_back(make_pair(s , idx));
-      }
-      all_indices.push_back(new_indices);
-      num_kept += keep_top_k_;
-    } else {
-      all_indices.push_back(indices);
-      num_kept += num_det;
-    }
-  }
+  };
+  DetectOutput(detect_param, num, fill, output_tensors_[0], (*output_shapes_)[0]);
   TIMER_END("NMS");
 
-  TIMER_START;
-  Dtype* top_data = output_tensors_[0];
-  if (num_kept == 0) {
-    (*output_shapes_)[0].clear();
-    (*output_shapes_)[0].push_back(1);
-    (*output_shapes_)[0].push_back(1);
-    (*output_shapes_)[0].push_back(num);
-    (*output_shapes_)[0].push_back(7);
-
-    // Generate fake results per image.
-    for (int i = 0; i < num; ++i) {
-      top_data[0] = i;
-      for(int j = 1; j < 7; ++j) {
-        top_data[j] = -1;
-      }
-      top_data += 7;
-    }
-  } else {
-    (*output_shapes_)[0].clear();
-    (*output_shapes_)[0].push_back(1);
-    (*output_shapes_)[0].push_back(1);
-    (*output_shapes_)[0].push_back(num_kept);
-    (*output_shapes_)[0].push_back(7);
-  }
-
-  top_data = output_tensors_[0];
-  for (int i = 0; i < num; ++i) {
-    for (auto it = all_indices[i].begin(); it != all_indices[i].end(); ++it) {
-      int label = it->first;
-      if (label >= num_classes_) {
-        // Something bad happened if there are no predictions for current label.
-        BM_LOG(FATAL) << "Could not find confidence predictions for " << label;
-        continue;
-      }
-      int loc_label = share_location_ ? 0 : label;
-      if (loc_label >= num_loc_classes_) {
-        // Something bad happened if there are no predictions for current label.
-        BM_LOG(FATAL) << "Could not find location predictions for " << loc_label;
-        continue;
-      }
-      const NormalizedBBoxOpt* bboxes = all_decode_bboxes + loc_label * num_priors_ +
-                                        i * num_priors_ * num_loc_classes_;
-      vector<pair<float,int>>& indices = it->second;
-
-      for (int j = 0; j < indices.size(); ++j) {
-        int idx = indices[j].second;
-        top_data[0] = i;
-        top_data[1] = label;
-        top_data[2] = indices[j].first;
-        const NormalizedBBoxOpt& bbox = bboxes[idx];
-        top_data[3] = bbox.xmin;
-        top_data[4] = bbox.ymin;
-        top_data[5] = bbox.xmax;
-        top_data[6] = bbox.ymax;
-        top_data += 7;
-      }
-    }
-  }
-  TIMER_END("output box");
-
   TIMER_START;
   if(num_loc_classes_ != 1 && all_loc_preds != NULL) delete[] all_loc_preds;
-  if(all_decode_bboxes != NULL)                      delete[] all_decode_bboxes;
-  if(all_decode_bboxes_area != NULL)                 delete[] all_decode_bboxes_area;
   TIMER_END("Release memory");
 
 #ifdef TIME_PROFILE
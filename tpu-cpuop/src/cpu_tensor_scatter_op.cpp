@@ -121,30 +121,23 @@ int cpu_tensor_scatter_oplayer::process(void *param, int param_size)
     char *nt = getenv("BM_CPU_LAYER_NUM_THREAD");
     int nthreads = 1;
     if (nt != nullptr && *nt != '0') nthreads = atoi(nt);
-    int worker_start = 0;
-    std::vector<std::thread> threads;
     int thread_stride = batch / nthreads + 1;
 
-    for (int t = 0; t < nthreads; t++) {
-        threads.emplace_back([batch, &outer_stride, index_base, output_base, update_base, length, detail_param]
-            (int batch_st, int batch_ed){
-            for(int idx=batch_st; idx < batch_ed; idx++) {
-                int index_depth = outer_stride.size();
-                auto index_data = index_base + idx * index_depth;
-                size_t tensor_offset = 0;
-                for(size_t i = 0; i<outer_stride.size(); i++) {
-                    tensor_offset += index_data[i] * outer_stride[i];
-                }
-                auto tensor_data = output_base + tensor_offset;
-                auto update_data = update_base +  idx * outer_stride.back();
-                update_core_ex(tensor_data, update_data, length, detail_param->scatter_op, detail_param->input_dtype);
+    parallel_for(0, batch, thread_stride,
+        [&outer_stride, index_base, output_base, update_base, length, detail_param]
+        (int batch_st, int batch_ed){
+        for(int idx=batch_st; idx < batch_ed; idx++) {
+            int index_depth = outer_stride.size();
+            auto index_data = index_base + idx * index_depth;
+            size_t tensor_offset = 0;
+            for(size_t i = 0; i<outer_stride.size(); i++) {
+                tensor_offset += index_data[i] * outer_stride[i];
             }
-        },worker_start, std::min(worker_start + thread_stride, batch));
-        worker_start += thread_stride;
-    }
-    for(auto& t: threads){
-        t.join();
-    }
+            auto tensor_data = output_base + tensor_offset;
+            auto update_data = update_base +  idx * outer_stride.back();
+            update_core_ex(tensor_data, update_data, length, detail_param->scatter_op, detail_param->input_dtype);
+        }
+    });
 
     return 0;
 }
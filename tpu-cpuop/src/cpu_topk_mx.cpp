@@ -1,53 +1,11 @@
-#include <algorithm>
-#include <numeric>
 #include "cpu_topk_mx.h"
+#include "bmcpu_topk.hpp"
 
 namespace bmcpu{
 
-template<typename DType>
-void TopKSort(DType* sorted_vals, int* indices,
-              const DType* in_vals, int flatten_len,
-              int K, int N, bool is_ascend, bool need_mask) {
-    // Use full sort when K is relatively large.
-    const bool full_sort(K*8 > N);
-    // Batch size.
-    const int M(flatten_len/N);
-    auto vals = in_vals;
-    if(need_mask){
-        memset(sorted_vals, 0, flatten_len*sizeof(DType));
-    }
-    for (int i = 0; i < M; ++i) {
-        // Tensor `in_vals` stores the flattened source data, while `dat` stores the sorted result.
-        int ind_offset = i*N;
-        int *ind = indices +ind_offset;
-        if (is_ascend) {
-            auto cmp =  [&](const int& i1, const int& i2){ return vals[i1] < vals[i2]; };
-            if (full_sort) {
-                std::sort(ind, ind+N, cmp);
-            } else {
-                std::partial_sort(ind, ind+K, ind+N, cmp);
-            }
-        } else {
-            auto cmp =  [&](const int& i1, const int& i2){ return vals[i1] > vals[i2]; };
-            if (full_sort) {
-                std::sort(ind, ind+N, cmp);
-            } else {
-                std::partial_sort(ind, ind+K, ind+N, cmp);
-            }
-        }
-        if(need_mask){
-            for (int j = 0; j < K; ++j) {
-                sorted_vals[ind[j]] = 1;
-            }
-        } else {
-            DType *sorted_ptr = sorted_vals +ind_offset;
-            for (int j = 0; j < K; ++j) {
-                sorted_ptr[j] = vals[ind[j]];
-                ind[j] -= ind_offset;
-            }
-        }
-    }
-}
+template<typename DType> struct topk_mx_dtype;
+template<> struct topk_mx_dtype<float> { static const CPU_DATA_TYPE_T value = CPU_DTYPE_FP32; };
+
 static void ParseTopKParam(const vector<int>& src_shape, const cpu_topk_mx_param_t& param,
                            std::vector<int>& target_shape, int *batch_size, int *element_num,
                            int *axis, int *k, bool *do_transpose, bool *is_ascend) {
@@ -92,39 +50,6 @@ static void ParseTopKParam(const vector<int>& src_shape, const cpu_topk_mx_param
     CPU_ASSERT(*k >= 1 && *k <= *element_num);
 }
 
-template<typename DType, typename SType>
-void assign_slice(DType* dst, const SType* src, int batch, int hslice, int height, int wslice, int width, bool do_transpose){
-    int batch_in_stride = height*width;
-    int batch_out_stride = hslice*wslice;
-    int hstride = wslice;
-    int wstride = 1;
-    if(do_transpose){
-        hstride = 1;
-        wstride = hslice;
-    }
-    for(int b =0 ; b<batch; b++){
-        auto in_ptr = src+ b *batch_in_stride;
-        auto out_ptr = dst+ b *batch_out_stride;
-        for(int h=0; h<hslice; h++){
-            for(int w=0; w<wslice; w++){
-                int in_idx = h*width + w;
-                int out_idx = h*hstride+w*wstride;
-                out_ptr[out_idx] =  (DType)in_ptr[in_idx];
-            }
-        }
-    }
-}
-
-template<typename SType>
-void assign_slice_by_dtype(void* dst, const SType* src, int batch, int hslice, int height, int wslice, int width, bool do_transpose, int dtype){
-    if(dtype == 0){
-        auto out_ptr = (float*)dst;
-        assign_slice(out_ptr, src, batch, hslice, height, wslice, width, do_transpose);
-    } else {
-        auto out_ptr = (int*)dst;
-        assign_slice(out_ptr, src, batch, hslice, height, wslice, width, do_transpose);
-    }
-}
 template<typename DType>
 int cpu_topk_mx_template<DType>::process(void *param, int param_size)
 {
@@ -138,8 +63,6 @@ int cpu_topk_mx_template<DType>::process(void *param, int param_size)
     ParseTopKParam(src_shape, *topk_param, target_shape,
             &batch_size, &N, &axis, &k, &do_transpose, &is_ascend);
 
-    int flatten_len = batch_size * N;
-    auto flatten_data = (DType*)input_tensors_[0];
     int inner_len = 1;
     if(do_transpose){
         for(size_t i=axis+1; i<src_shape.size(); i++){
@@ -147,38 +70,24 @@ int cpu_topk_mx_template<DType>::process(void *param, int param_size)
         }
     }
     int outer_len = batch_size/inner_len;
-    if(do_transpose){
-        flatten_data = new DType[flatten_len];
-        assign_slice(flatten_data, input_tensors_[0], outer_len, N, N, inner_len, inner_len, do_transpose);
-    }
-    auto indices = new int[flatten_len];
-    auto sorted_data = new DType[flatten_len];
-    std::iota(indices, indices+flatten_len, 0);
-    bool need_mask = topk_param->ret_type == MX_TOPK_RET_MASK;
-
-    TopKSort(sorted_data, indices, flatten_data, flatten_len, k, N, is_ascend, need_mask);
-
+    void* values = NULL;
+    void* indices = NULL;
+    void* mask = NULL;
     if(topk_param->ret_type == MX_TOPK_RET_MASK){
-        auto out_data = (DType*)output_tensors_[0];
-        assign_slice(out_data, sorted_data, outer_len, inner_len, inner_len, N, N, do_transpose);
+        mask = output_tensors_[0];
     } else {
-        auto out_data = (DType*)output_tensors_[0];
-        void* out_indice = output_tensors_[topk_param->ret_type == MX_TOPK_RET_BOTH];
         if(topk_param->ret_type == MX_TOPK_RET_VALUE || topk_param->ret_type == MX_TOPK_RET_BOTH){
-            assign_slice(out_data, sorted_data, outer_len, inner_len, inner_len, k, N, do_transpose);
+            values = output_tensors_[0];
         }
         if(topk_param->ret_type == MX_TOPK_RET_INDICES || topk_param->ret_type == MX_TOPK_RET_BOTH){
-            assign_slice_by_dtype(out_indice, indices, outer_len, inner_len, inner_len, k, N, do_transpose, topk_param->dtype);
+            indices = output_tensors_[topk_param->ret_type == MX_TOPK_RET_BOTH];
         }
     }
+    topk(topk_mx_dtype<DType>::value, input_tensors_[0], outer_len, N, inner_len, k,
+         !is_ascend, true, values, indices, (CPU_DATA_TYPE_T)topk_param->dtype, mask);
     for(size_t i=0; i < (*output_shapes_).size(); i++) {
         (*output_shapes_)[i] = target_shape;
     }
-    delete []indices;
-    delete [] sorted_data;
-    if(do_transpose){
-        delete [] flatten_data;
-    }
     return 0;
 }
 
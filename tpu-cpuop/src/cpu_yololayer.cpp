@@ -1,4 +1,5 @@
 #include "cpu_yololayer.h"
+#include "bmcpu_utils.hpp"
 namespace bmcpu {
 
 #if defined(__aarch64__)
@@ -125,17 +126,16 @@ int cpu_yololayer::process(void *param, int param_size)
 
   memcpy(top_data, bottom_data, batch * channels * height * width * sizeof(float));
 
-  //TODO: implement multi-thread optimization
   int outputs = channels * height * width;
-  for (int b = 0; b < batch; ++b) {
-    for(int n = 0; n < num_; ++n) {
-      int index = 0;
-      index = entry_index(width, height, outputs, classes_, b, n * width * height, 0);
-      activate_array(top_data + index, 2 * width * height);
-      index = entry_index(width, height, outputs, classes_, b, n * width * height, 4);
-      activate_array(top_data + index, (1 + classes_) * width * height);
-    }
-  }
+  parallel_for(0, batch * num_, [&](int bn) {
+    int b = bn / num_;
+    int n = bn - b * num_;
+    int index = 0;
+    index = entry_index(width, height, outputs, classes_, b, n * width * height, 0);
+    activate_array(top_data + index, 2 * width * height);
+    index = entry_index(width, height, outputs, classes_, b, n * width * height, 4);
+    activate_array(top_data + index, (1 + classes_) * width * height);
+  });
 
   return 0;
 }
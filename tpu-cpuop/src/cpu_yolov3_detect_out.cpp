@@ -1,7 +1,7 @@
 #include "cpu_yolov3_detect_out.h"
 #include <algorithm>
 #include <cmath>
-#include <map>
+#include "bmcpu_detect.hpp"
 
 #define KEEP_TOP_K    200
 #define Dtype float
@@ -10,7 +10,7 @@
 #ifdef TIME_PROFILE
 #include <sys/time.h>
 
-static struct timeval t_total, t0, t1;
+static struct timeval t_total, t1;
 #define TIMER_START(t_s) gettimeofday(&t_s, NULL);
 #define TIMER_END(t_e, t_s, str) \
 { \
@@ -116,75 +116,6 @@ inline void sigmoid_batch(Dtype *x, const int n) {
 }
 #endif
 
-struct PredictionResult {
-    Dtype x;
-    Dtype y;
-    Dtype w;
-    Dtype h;
-    Dtype idx;
-    Dtype confidence;
-    int classType;
-};
-
-inline Dtype overlap(Dtype x1, Dtype w1, Dtype x2, Dtype w2) {
-    float w1d2 = w1 * 0.5f;
-    float w2d2 = w2 * 0.5f;
-    float l1 = x1 - w1d2;
-    float l2 = x2 - w2d2;
-    float left = l1 > l2 ? l1 : l2;
-    float r1 = x1 + w1d2;
-    float r2 = x2 + w2d2;
-    float right = r1 < r2 ? r1 : r2;
-    return right - left;
-}
-
-inline Dtype box_intersection(const PredictionResult &a,
-                              const PredictionResult &b) {
-    float w = overlap(a.x, a.w, b.x, b.w);
-    if (w < 0)
-        return 0;
-    float h = overlap(a.y, a.h, b.y, b.h);
-    if (h < 0)
-        return 0;
-    return w * h;
-}
-
-inline Dtype box_iou(const PredictionResult &a, const PredictionResult &b) {
-    float i = box_intersection(a, b);
-    float u = a.w * a.h + b.w * b.h - i;
-    return i / u;
-}
-
-void ApplyNms(vector<PredictionResult> &boxes, vector<int> &idxes,
-              Dtype threshold) {
-    int bbox_cnt = (int)boxes.size();
-    // init the map
-    #ifdef __linux__
-    unsigned int map[(bbox_cnt >> 5) + 1];
-    #else
-    std::shared_ptr<unsigned int> map_(new unsigned int[(bbox_cnt >> 5) + 1], std::default_delete<unsigned int[]>());
-    unsigned int *map = map_.get();
-    #endif
-    memset(map, 0xFF, sizeof(map));
-    for (int i = 0; i < bbox_cnt - 1; ++i) {
-        // skip the dropped bbox
-        if (!(map[i >> 5] & (1 << (i & 0x1F))))
-            continue;
-        for (int j = i + 1; j < bbox_cnt; ++j) {
-            // skip the dropped bbox
-            if (!(map[j >> 5] & (1 << (j & 0x1F))))
-                continue;
-            Dtype iou = box_iou(boxes[i], boxes[j]);
-            if (iou >= threshold)
-                map[j >> 5] &= ~(1 << (j & 0x1F));
-        }
-    }
-    for (int i = 0; i < bbox_cnt; ++i) {
-        if (map[i >> 5] & (1 << (i & 0x1F)))
-            idxes.push_back(i);
-    }
-}
-
 void normalize_bbox(
     vector<Dtype> &b, Dtype *x, Dtype *biases, int n,
     int i, int j, int lw, int lh, int w, int h) {
@@ -195,144 +126,69 @@ void normalize_bbox(
     b.push_back(exp(x[3]) * biases[2 * n + 1] / (h));
 }
 
-bool BoxSortDecendScore(const PredictionResult &box1,
-                        const PredictionResult &box2) {
-    return box1.confidence > box2.confidence;
-}
-
 int cpu_yolov3_detect_outlayer::process(void *param, int param_size) {
     setParam(param, param_size);
     const int num = input_shapes_[0][0];
     int len = 4 + num_classes_ + 1;
-    int mask_offset = 0;
-    int total_num = 0;
-    vector< PredictionResult > total_preds;
     // calc the threshold for Po
     float po_thres = -std::log(1 / confidence_threshold_ - 1);
-    char str[256];
     TIMER_START(t_total);
-    vector<Dtype> class_score;
-    for (int b = 0; b < num; b++) {
-        vector< PredictionResult > predicts;
-        predicts.clear();
-        mask_offset = 0;
-        TIMER_START(t0);
+    DetectParam detect_param;
+    detect_param.nms.type = NMS_IOU_YOLO;
+    detect_param.nms.iou_threshold = nms_threshold_;
+    detect_param.nms.eta = 1.f;
+    detect_param.nms.offset = 0.f;
+    detect_param.nms.class_aware = false;
+    detect_param.num_classes = num_classes_;
+    detect_param.top_k = -1;
+    detect_param.keep_top_k = KEEP_TOP_K;
+    detect_param.class_agnostic = true;
+    detect_param.caffe_sort = false;
+    auto fill = [&](int b, DetectArena& arena) {
+        vector<Dtype> pred;
+        int mask_offset = 0;
         for (int t = 0; t < num_inputs_; t++) {
             int h = input_shapes_[t][2];
             int w = input_shapes_[t][3];
             int stride = h * w;
-            const Dtype *input_data = input_tensors_[t];
+            const Dtype *input_data = input_tensors_[t] + b * input_shapes_[t][1] * stride;
             for (int n = 0; n < num_boxes_; n++) {
-                for (int cy = 0; cy < h; cy++) {
-                    for (int cx = 0; cx < w; cx++) {
-                        int index = b * input_shapes_[t][1] * stride +
-                                    n * len * stride +
-                                    cy * w + cx;
-                        vector<Dtype> pred;
-                        class_score.clear();
-                        // Po/Pmax/tx/ty/tw/th
-                        Dtype swap_data[6] = {0};
-                        // filter bbxo by Po
-                        int index_po = 4 * stride + index;
-                        if (input_data[index_po] <= po_thres)
-                            continue;
-                        for (int c = 0; c < len; ++c) {
-                            int index2 = c * stride + index;
-                            if (c > 4)
-                                class_score.push_back(input_data[index2]);
-                            else {
-                                if (c == 4)
-                                    swap_data[0] = input_data[index2];
-                                else
-                                    swap_data[c + 2] = input_data[index2];
-                            }
-                        }
-                        PredictionResult predict;
-                        swap_data[1] = *std::max_element(class_score.begin(), class_score.end());
-                        int arg_max = std::distance(class_score.begin(),
-                                                    std::max_element(class_score.begin(), class_score.end()));
-                        sigmoid_batch(swap_data, 4);
-                        // Pmax = Pmax * Po
-                        swap_data[1] = swap_data[0] * swap_data[1];
-                        if (swap_data[1] > confidence_threshold_) {
-                            normalize_bbox(
-                                pred, &swap_data[2], biases_, mask_[n + mask_offset],
-                                cx, cy, w, h, w * anchors_scale_[t], h * anchors_scale_[t]);
-                            predict.idx = b;
-                            predict.x = pred[0];
-                            predict.y = pred[1];
-                            predict.w = pred[2];
-                            predict.h = pred[3];
-                            predict.classType = arg_max;
-                            predict.confidence = swap_data[1];
-                            predicts.push_back(predict);
-                        }
+                const Dtype *box_data = input_data + n * len * stride;
+                // filter bbox by Po before touching the other channels
+                const Dtype *po_data = box_data + 4 * stride;
+                DetectAboveThreshold(po_data, stride, po_thres, &arena.index);
+                for (int index : arena.index) {
+                    int cy = index / w;
+                    int cx = index - cy * w;
+                    // Po/Pmax/tx/ty/tw/th
+                    Dtype swap_data[6];
+                    swap_data[0] = po_data[index];
+                    for (int c = 0; c < 4; ++c)
+                        swap_data[c + 2] = box_data[c * stride + index];
+                    const Dtype *class_data = box_data + 5 * stride + index;
+                    int arg_max = 0;
+                    for (int c = 1; c < num_classes_; ++c) {
+                        if (class_data[arg_max * stride] < class_data[c * stride])
+                            arg_max = c;
+                    }
+                    swap_data[1] = class_data[arg_max * stride];
+                    sigmoid_batch(swap_data, 4);
+                    // Pmax = Pmax * Po
+                    swap_data[1] = swap_data[0] * swap_data[1];
+                    if (swap_data[1] > confidence_threshold_) {
+                        normalize_bbox(
+                            pred, &swap_data[2], biases_, mask_[n + mask_offset],
+                            cx, cy, w, h, w * anchors_scale_[t], h * anchors_scale_[t]);
+                        arena.push(pred.data(), -1.f, swap_data[1], arg_max);
                     }
                 }
             }
             mask_offset += mask_group_size_;
         }
-        sprintf(str, "Filter %d Boxes (batch %d)", (int)predicts.size(), b);
-        TIMER_END(t1, t0, str);
-        // NMS for each image
-        vector<int> idxes;
-        idxes.clear();
-        int num_kept = 0;
-        if (predicts.size() > 0) {
-            TIMER_START(t0);
-            std::stable_sort(predicts.begin(), predicts.end(), BoxSortDecendScore);
-            sprintf(str, "Sort Box (batch %d)", b);
-            TIMER_END(t1, t0, str);
-            TIMER_START(t0);
-            ApplyNms(predicts, idxes, nms_threshold_);
-            num_kept = idxes.size();
-            sprintf(str, "NMS %d Boxes (batch %d)", num_kept, b);
-            TIMER_END(t1, t0, str);
-            if (num_kept > KEEP_TOP_K)    num_kept = KEEP_TOP_K;
-            for (int i=0; i < num_kept; i++)
-                total_preds.push_back(predicts[idxes[i]]);
-            total_num += num_kept;
-        }
-    }
-    num_out_boxes_ = total_num;
-    Dtype *top_data = output_tensors_[0];
-    if (total_num == 0) {
-        (*output_shapes_)[0].clear();
-        (*output_shapes_)[0].push_back(1);
-        (*output_shapes_)[0].push_back(1);
-        (*output_shapes_)[0].push_back(num);
-        (*output_shapes_)[0].push_back(7);
-        num_out_boxes_ = num;
-        // Generate fake results per image.
-        for (int i = 0; i < num; ++i) {
-            top_data[0] = i;
-            for (int j = 1; j < 7; ++j)
-                top_data[j] = -1;
-            top_data += 7;
-        }
-    } else {
-        (*output_shapes_)[0].clear();
-        (*output_shapes_)[0].push_back(1);
-        (*output_shapes_)[0].push_back(1);
-        (*output_shapes_)[0].push_back(total_num);
-        (*output_shapes_)[0].push_back(7);
-        for (int i = 0; i < total_num; i++) {
-            *top_data = total_preds[i].idx;         // Image_Id
-            ++top_data;
-            *top_data = total_preds[i].classType;   // label
-            ++top_data;
-            *top_data = total_preds[i].confidence;  // confidence
-            ++top_data;
-            *top_data = total_preds[i].x;
-            ++top_data;
-            *top_data = total_preds[i].y;
-            ++top_data;
-            *top_data = total_preds[i].w;
-            ++top_data;
-            *top_data = total_preds[i].h;
-            ++top_data;
-        }
-    }
+    };
+    // one nms over all classes per image, as darknet does
+    DetectOutput(detect_param, num, fill, output_tensors_[0], (*output_shapes_)[0]);
+    num_out_boxes_ = (*output_shapes_)[0][2];
     TIMER_END(t1, t_total, "Total Time");
     return 0;
 }
@@ -0,0 +1,310 @@
+/*
+ * cpu_ssd_detect_out / cpu_yolov3_detect_out: the old decode all, then
+ * threshold and nms pipeline vs the fused one, end to end per batch.
+ * The yolov5 like shape (80 classes, 20/40/80 grids) runs through the
+ * yolov3 layer, which takes the same [n, anchors * (5 + classes), h, w].
+ * The outputs are compared row by row.
+ * usage: detect_bench [loops]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <algorithm>
+#include <map>
+#include <random>
+#include <vector>
+#include "cpu_ssd_detect_out.h"
+#include "cpu_yolov3_detect_out.h"
+#include "bbox_util_opt.hpp"
+#include "bmcpu_utils.hpp"
+
+using std::vector;
+using namespace bmcpu;
+
+/* what cpu_ssd_detect_out did before the fused pipeline */
+static vector<float> old_ssd(const cpu_ssd_detect_out_param_t& p, int num, int num_priors,
+                             const float* loc_data, const float* conf_data, const float* prior_data)
+{
+    const int num_classes = p.num_classes_;
+    NormalizedBBoxOpt* all_loc_preds = NULL;
+    GetLocPredictions_opt(loc_data, num, num_priors, 1, true, all_loc_preds);
+    float* prior_bboxes = NULL;
+    float* prior_variances = NULL;
+    GetPriorBBoxes_opt(prior_data, num_priors, prior_bboxes, prior_variances);
+    NormalizedBBoxOpt* all_decode_bboxes = NULL;
+    float* all_decode_bboxes_area = NULL;
+    DecodeBBoxesAll_opt(all_loc_preds, prior_bboxes, prior_variances, num, true, num_priors, 1,
+                        p.background_label_id_, (CodeType)p.code_type_,
+                        p.variance_encoded_in_target_, false, all_decode_bboxes,
+                        all_decode_bboxes_area);
+    vector<float> rows;
+    for (int i = 0; i < num; ++i) {
+        vector<vector<pair<float, int> > > class_indices(num_classes);
+        parallel_for(0, num_classes, [&](int c) {
+            if (c == p.background_label_id_) return;
+            ApplyNMSFast_opt(all_decode_bboxes + i * num_priors, num_priors,
+                             all_decode_bboxes_area + i * num_priors,
+                             conf_data + i * num_priors * num_classes + c,
+                             p.confidence_threshold_, p.nms_threshold_, p.eta_, p.top_k_,
+                             num_classes, &class_indices[c]);
+        });
+        std::map<int, vector<pair<float, int> > > indices;
+        int num_det = 0;
+        for (int c = 0; c < num_classes; ++c) {
+            if (c == p.background_label_id_) continue;
+            indices[c].swap(class_indices[c]);
+            num_det += indices[c].size();
+        }
+        if (p.keep_top_k_ > -1 && num_det > p.keep_top_k_) {
+            vector<pair<float, pair<int, int> > > score_index_pairs;
+            for (auto& it : indices)
+                for (auto& s : it.second)
+                    score_index_pairs.push_back(std::make_pair(s.first, std::make_pair(it.first, s.second)));
+            std::sort(score_index_pairs.begin(), score_index_pairs.end(),
+                      SortScorePairDescend<pair<int, int> >);
+            score_index_pairs.resize(p.keep_top_k_);
+            std::map<int, vector<pair<float, int> > > new_indices;
+            for (auto& s : score_index_pairs)
+                new_indices[s.second.first].push_back(std::make_pair(s.first, s.second.second));
+            indices.swap(new_indices);
+        }
+        for (auto& it : indices) {
+            for (auto& s : it.second) {
+                const NormalizedBBoxOpt& bbox = all_decode_bboxes[i * num_priors + s.second];
+                float row[7] = {(float)i, (float)it.first, s.first,
+                                bbox.xmin, bbox.ymin, bbox.xmax, bbox.ymax};
+                rows.insert(rows.end(), row, row + 7);
+            }
+        }
+    }
+    delete[] all_decode_bboxes;
+    delete[] all_decode_bboxes_area;
+    return rows;
+}
+
+struct OldYoloBox {
+    float x, y, w, h, confidence;
+    int image, label;
+};
+
+static float old_overlap(float x1, float w1, float x2, float w2)
+{
+    float l1 = x1 - w1 * 0.5f;
+    float l2 = x2 - w2 * 0.5f;
+    float left = l1 > l2 ? l1 : l2;
+    float r1 = x1 + w1 * 0.5f;
+    float r2 = x2 + w2 * 0.5f;
+    float right = r1 < r2 ? r1 : r2;
+    return right - left;
+}
+
+static float old_iou(const OldYoloBox& a, const OldYoloBox& b)
+{
+    float w = old_overlap(a.x, a.w, b.x, b.w);
+    if (w < 0) return 0;
+    float h = old_overlap(a.y, a.h, b.y, b.h);
+    if (h < 0) return 0;
+    float i = w * h;
+    return i / (a.w * a.h + b.w * b.h - i);
+}
+
+/* what cpu_yolov3_detect_out did before the fused pipeline */
+static vector<float> old_yolov3(const cpu_yolov3_detect_out_param_t& p,
+                                const vector<vector<int> >& shapes, const vector<float*>& inputs)
+{
+    const int num = shapes[0][0];
+    const int len = 4 + p.num_classes_ + 1;
+    const float po_thres = -std::log(1 / p.confidence_threshold_ - 1);
+    vector<float> rows;
+    for (int b = 0; b < num; b++) {
+        vector<OldYoloBox> predicts;
+        int mask_offset = 0;
+        for (int t = 0; t < p.num_inputs_; t++) {
+            int h = shapes[t][2], w = shapes[t][3], stride = h * w;
+            for (int n = 0; n < p.num_boxes_; n++) {
+                for (int cy = 0; cy < h; cy++) {
+                    for (int cx = 0; cx < w; cx++) {
+                        const float* d = inputs[t] + b * shapes[t][1] * stride + n * len * stride + cy * w + cx;
+                        if (d[4 * stride] <= po_thres) continue;
+                        vector<float> class_score;
+                        for (int c = 5; c < len; c++) class_score.push_back(d[c * stride]);
+                        auto best = std::max_element(class_score.begin(), class_score.end());
+                        float po = 1.0f / (1.0f + exp(-d[4 * stride]));
+                        float conf = po * (1.0f / (1.0f + exp(-*best)));
+                        if (!(conf > p.confidence_threshold_)) continue;
+                        float tx = 1.0f / (1.0f + exp(-d[0]));
+                        float ty = 1.0f / (1.0f + exp(-d[stride]));
+                        int mask = p.mask_[n + mask_offset];
+                        OldYoloBox box;
+                        box.x = (cx + tx) / w;
+                        box.y = (cy + ty) / h;
+                        box.w = exp(d[2 * stride]) * p.biases_[2 * mask] / (w * p.anchors_scale_[t]);
+                        box.h = exp(d[3 * stride]) * p.biases_[2 * mask + 1] / (h * p.anchors_scale_[t]);
+                        box.confidence = conf;
+                        box.image = b;
+                        box.label = best - class_score.begin();
+                        predicts.push_back(box);
+                    }
+                }
+            }
+            mask_offset += p.mask_group_size_;
+        }
+        std::stable_sort(predicts.begin(), predicts.end(), [](const OldYoloBox& l, const OldYoloBox& r) {
+            return l.confidence > r.confidence;
+        });
+        vector<bool> dropped(predicts.size(), false);
+        int kept = 0;
+        for (size_t i = 0; i < predicts.size() && kept < 200; i++) {
+            if (dropped[i]) continue;
+            for (size_t j = i + 1; j < predicts.size(); j++)
+                if (!dropped[j] && old_iou(predicts[i], predicts[j]) >= p.nms_threshold_)
+                    dropped[j] = true;
+            kept++;
+            const OldYoloBox& r = predicts[i];
+            float row[7] = {(float)r.image, (float)r.label, r.confidence, r.x, r.y, r.w, r.h};
+            rows.insert(rows.end(), row, row + 7);
+        }
+    }
+    return rows;
+}
+
+template <typename F>
+static double time_us(int loops, F f)
+{
+    f();
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < loops; i++) f();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(t1 - t0).count() / loops;
+}
+
+static void report(const char* name, double old_us, double new_us, const vector<float>& expect,
+                   const vector<float>& out, const vector<int>& out_shape)
+{
+    printf("%-34s old: %9.1f us  new: %9.1f us  speedup %.2fx  (%d rows)\n", name, old_us, new_us,
+           old_us / new_us, (int)expect.size() / 7);
+    if ((size_t)out_shape[2] * 7 != expect.size() ||
+        !std::equal(expect.begin(), expect.end(), out.begin()))
+        printf("  output mismatch\n");
+}
+
+static void bench_ssd(int loops, int num, int num_priors, int num_classes, std::mt19937& rng)
+{
+    cpu_ssd_detect_out_param_t p;
+    memset(&p, 0, sizeof(p));
+    p.num_classes_ = num_classes;
+    p.share_location_ = true;
+    p.nms_threshold_ = 0.45f;
+    p.top_k_ = 400;
+    p.code_type_ = PriorBoxParameter_CodeType_CENTER_SIZE;
+    p.keep_top_k_ = 200;
+    p.confidence_threshold_ = 0.01f;
+    p.num_loc_classes_ = 1;
+    p.eta_ = 1.f;
+
+    std::uniform_real_distribution<float> u(0.f, 1.f);
+    std::normal_distribution<float> g(0.f, 0.5f);
+    vector<float> prior(num_priors * 8), loc((size_t)num * num_priors * 4);
+    vector<float> conf((size_t)num * num_priors * num_classes);
+    for (int i = 0; i < num_priors; i++) {
+        float cx = u(rng), cy = u(rng), w = 0.05f + 0.5f * u(rng), h = 0.05f + 0.5f * u(rng);
+        float box[8] = {cx - w / 2, cy - h / 2, cx + w / 2, cy + h / 2, 0.1f, 0.1f, 0.2f, 0.2f};
+        std::copy(box, box + 4, &prior[i * 4]);
+        std::copy(box + 4, box + 8, &prior[num_priors * 4 + i * 4]);
+    }
+    for (auto& x : loc) x = g(rng);
+    // softmax like: most scores tiny, a few classes per prior above threshold
+    for (auto& x : conf) x = u(rng) < 0.97f ? u(rng) * 0.01f : u(rng);
+
+    bmcpu::cpu_ssd_detect_outlayer layer;
+    vector<vector<int> > input_shapes = {{num, num_priors * 4}, {num, num_priors * num_classes},
+                                         {1, 2, num_priors * 4}};
+    vector<vector<int> > output_shapes(1);
+    layer.reshape(&p, sizeof(p), input_shapes, output_shapes);
+    vector<float> out((size_t)output_shapes[0][2] * 7 + num * 7);
+    vector<float*> input_tensors = {loc.data(), conf.data(), prior.data()};
+    vector<float*> output_tensors = {out.data()};
+    vector<float> expect;
+    double old_us = time_us(loops, [&]() {
+        expect = old_ssd(p, num, num_priors, loc.data(), conf.data(), prior.data());
+    });
+    double new_us = time_us(loops, [&]() {
+        layer.set_common_param(input_tensors, input_shapes, output_tensors, output_shapes);
+        layer.process(&p, sizeof(p));
+    });
+    char name[64];
+    snprintf(name, sizeof(name), "ssd n %d priors %d classes %d", num, num_priors, num_classes);
+    report(name, old_us, new_us, expect, out, output_shapes[0]);
+}
+
+static void bench_yolo(int loops, const char* tag, int num, int num_classes,
+                       const vector<int>& grids, float conf_thresh, std::mt19937& rng)
+{
+    static const float biases[18] = {10, 13, 16, 30, 33, 23, 30, 61, 62, 45,
+                                     59, 119, 116, 90, 156, 198, 373, 326};
+    cpu_yolov3_detect_out_param_t p;
+    memset(&p, 0, sizeof(p));
+    p.num_inputs_ = grids.size();
+    p.num_classes_ = num_classes;
+    p.num_boxes_ = 3;
+    p.confidence_threshold_ = conf_thresh;
+    p.nms_threshold_ = 0.45f;
+    p.mask_group_size_ = 3;
+    memcpy(p.biases_, biases, sizeof(biases));
+    for (int i = 0; i < 3; i++) p.anchors_scale_[i] = 32 >> i;
+    for (int i = 0; i < 9; i++) p.mask_[i] = 8 - i;
+
+    std::normal_distribution<float> g(0.f, 1.f);
+    const int len = 5 + num_classes;
+    vector<vector<int> > input_shapes;
+    vector<vector<float> > inputs;
+    for (int grid : grids) {
+        input_shapes.push_back({num, 3 * len, grid, grid});
+        vector<float> in((size_t)num * 3 * len * grid * grid);
+        for (size_t i = 0; i < in.size(); i++) {
+            int c = (i / (grid * grid)) % len;
+            in[i] = c == 4 ? g(rng) * 2 - 5 : g(rng);
+        }
+        inputs.push_back(in);
+    }
+    vector<float*> input_tensors;
+    for (auto& in : inputs) input_tensors.push_back(in.data());
+
+    bmcpu::cpu_yolov3_detect_outlayer layer;
+    vector<vector<int> > output_shapes(1);
+    layer.reshape(&p, sizeof(p), input_shapes, output_shapes);
+    vector<float> out((size_t)output_shapes[0][2] * 7);
+    vector<float*> output_tensors = {out.data()};
+    vector<float> expect;
+    double old_us = time_us(loops, [&]() { expect = old_yolov3(p, input_shapes, input_tensors); });
+    double new_us = time_us(loops, [&]() {
+        layer.set_common_param(input_tensors, input_shapes, output_tensors, output_shapes);
+        layer.process(&p, sizeof(p));
+    });
+    char name[64];
+    snprintf(name, sizeof(name), "%s n %d conf %.2f", tag, num, conf_thresh);
+    report(name, old_us, new_us, expect, out, output_shapes[0]);
+}
+
+int main(int argc, char* argv[])
+{
+    int loops = 20;
+    if (argc > 1) {
+        loops = atoi(argv[1]);
+        if (loops <= 0) {
+            printf("usage: %s [loops]\n", argv[0]);
+            return -1;
+        }
+    }
+    std::mt19937 rng(1);
+    bench_ssd(loops, 1, 8732, 21, rng);
+    bench_ssd(loops, 4, 8732, 21, rng);
+    bench_ssd(loops, 1, 1917, 91, rng);
+    bench_yolo(loops, "yolov3 13/26/52", 1, 80, {13, 26, 52}, 0.5f, rng);
+    bench_yolo(loops, "yolov3 13/26/52", 4, 80, {13, 26, 52}, 0.1f, rng);
+    bench_yolo(loops, "yolov5 like 20/40/80", 1, 80, {20, 40, 80}, 0.25f, rng);
+    bench_yolo(loops, "yolov5 like 20/40/80", 1, 80, {20, 40, 80}, 0.05f, rng);
+    return 0;
+}
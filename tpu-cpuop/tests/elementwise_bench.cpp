@@ -0,0 +1,182 @@
+/*
+ * cpu_binary / cpu_unary on typical broadcast patterns: the old per element
+ * index walk vs bmcpu::broadcast_binary and elementwise_unary.
+ * The outputs are compared bit by bit.
+ * usage: elementwise_bench [loops]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <cmath>
+#include <random>
+#include <vector>
+#include "bmcpu_elementwise.hpp"
+
+/* what cpu_binary did before the broadcast engine */
+static int increase_indice(int* indice, const int* limit, int len)
+{
+    for (int i = len - 1; i >= 0; i--) {
+        if (++indice[i] < limit[i]) return 1;
+        indice[i] = 0;
+    }
+    return 0;
+}
+
+template<typename T>
+static T old_binary_core(T a, T b, BINARY_OP_CODE_T op)
+{
+    switch (op) {
+    case OP_MOD:
+        return static_cast<int>(a) % static_cast<int>(b);
+    case OP_DIV:
+        return static_cast<int>(a) / static_cast<int>(b);
+    default:
+        exit(-1);
+    }
+}
+
+template<typename T>
+static void old_broadcast(const T* in0, const std::vector<int>& shape0,
+                          const T* in1, const std::vector<int>& shape1,
+                          BINARY_OP_CODE_T op, T* dst)
+{
+    int out_dim = std::max(shape0.size(), shape1.size());
+    int in_dim0 = shape0.size(), in_dim1 = shape1.size();
+    int* s0 = new int[out_dim];
+    int* s1 = new int[out_dim];
+    int* st0 = new int[out_dim];
+    int* st1 = new int[out_dim];
+    int* out_shape = new int[out_dim];
+    int* out_stride = new int[out_dim];
+    int* idx = new int[out_dim];
+    for (int i = out_dim - 1; i >= 0; i--) {
+        s0[i] = (i < out_dim - in_dim0) ? 1 : shape0[i - (out_dim - in_dim0)];
+        s1[i] = (i < out_dim - in_dim1) ? 1 : shape1[i - (out_dim - in_dim1)];
+        out_shape[i] = std::max(s0[i], s1[i]);
+        st0[i] = (i == out_dim - 1) ? 1 : st0[i + 1] * s0[i + 1];
+        st1[i] = (i == out_dim - 1) ? 1 : st1[i + 1] * s1[i + 1];
+        out_stride[i] = (i == out_dim - 1) ? 1 : out_stride[i + 1] * out_shape[i + 1];
+        idx[i] = 0;
+    }
+    do {
+        int off0 = 0, off1 = 0, off = 0;
+        for (int i = 0; i < out_dim; i++) {
+            off0 += s0[i] == 1 ? 0 : idx[i] * st0[i];
+            off1 += s1[i] == 1 ? 0 : idx[i] * st1[i];
+            off += idx[i] * out_stride[i];
+        }
+        dst[off] = old_binary_core(in0[off0], in1[off1], op);
+    } while (increase_indice(idx, out_shape, out_dim));
+    delete[] s0;
+    delete[] s1;
+    delete[] st0;
+    delete[] st1;
+    delete[] out_shape;
+    delete[] out_stride;
+    delete[] idx;
+}
+
+static size_t shape_num(const std::vector<int>& shape)
+{
+    size_t n = 1;
+    for (int s : shape) n *= s;
+    return n;
+}
+
+static std::string shape_str(const std::vector<int>& shape)
+{
+    std::string s = "[";
+    for (size_t i = 0; i < shape.size(); i++)
+        s += (i ? "," : "") + std::to_string(shape[i]);
+    return s + "]";
+}
+
+template<typename Func>
+static double time_us(int loops, Func func)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < loops; i++) func();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(t1 - t0).count() / loops;
+}
+
+template<typename T>
+static int bench_binary(const char* dtype_name, CPU_DATA_TYPE_T dtype, BINARY_OP_CODE_T op,
+                        const std::vector<int>& shape0, const std::vector<int>& shape1, int loops)
+{
+    std::mt19937 rng(7);
+    std::vector<T> in0(shape_num(shape0)), in1(shape_num(shape1));
+    for (auto& v : in0) v = (T)((int)(rng() % 20001) - 10000);
+    for (auto& v : in1) v = (T)((int)(rng() % 200) + 1);
+    std::vector<int> out_shape(std::max(shape0.size(), shape1.size()));
+    bmcpu::broadcast_shape(shape0.data(), shape0.size(), shape1.data(), shape1.size(), out_shape.data());
+    std::vector<T> old_out(shape_num(out_shape)), new_out(old_out.size());
+
+    double old_us = time_us(loops, [&]() {
+        old_broadcast(in0.data(), shape0, in1.data(), shape1, op, old_out.data());
+    });
+    double new_us = time_us(loops, [&]() {
+        bmcpu::broadcast_binary(op, dtype, in0.data(), shape0.data(), shape0.size(),
+                                in1.data(), shape1.data(), shape1.size(), new_out.data());
+    });
+    printf("%-5s %s %-16s %-16s old: %9.1f us  new: %9.1f us  speedup: %6.2fx\n",
+           dtype_name, op == OP_MOD ? "mod" : "div", shape_str(shape0).c_str(),
+           shape_str(shape1).c_str(), old_us, new_us, new_us > 0 ? old_us / new_us : 0.0);
+    if (memcmp(old_out.data(), new_out.data(), old_out.size() * sizeof(T)) != 0) {
+        printf("  output mismatch\n");
+        return -1;
+    }
+    return 0;
+}
+
+static int bench_unary(const char* name, UNARY_OP_CODE_T op, float (*ref)(float), int loops)
+{
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> dist(-1000.f, 1000.f);
+    std::vector<float> in(1 << 20), old_out(in.size()), new_out(in.size());
+    for (auto& v : in) v = dist(rng);
+    double old_us = time_us(loops, [&]() {
+        for (size_t i = 0; i < in.size(); i++) old_out[i] = ref(in[i]);
+    });
+    double new_us = time_us(loops, [&]() {
+        bmcpu::elementwise_unary(op, in.data(), new_out.data(), in.size());
+    });
+    printf("%-8s [%zu] old: %9.1f us  new: %9.1f us  speedup: %6.2fx\n",
+           name, in.size(), old_us, new_us, new_us > 0 ? old_us / new_us : 0.0);
+    if (memcmp(old_out.data(), new_out.data(), in.size() * sizeof(float)) != 0) {
+        printf("  output mismatch\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int loops = argc > 1 ? atoi(argv[1]) : 10;
+    if (loops <= 0) {
+        printf("usage: %s [loops]\n", argv[0]);
+        return -1;
+    }
+    const std::vector<std::pair<std::vector<int>, std::vector<int>>> cases = {
+        {{8, 64, 56, 56}, {8, 64, 56, 56}},   /* same shape */
+        {{8, 64, 56, 56}, {1}},               /* scalar */
+        {{8, 64, 56, 56}, {1, 64, 1, 1}},     /* per channel */
+        {{8, 64, 56, 56}, {8, 1, 56, 56}},    /* per pixel */
+        {{1024, 1}, {1, 1024}},               /* outer product */
+        {{64, 1, 128}, {64, 256, 1}},
+    };
+    int ret = 0;
+    for (auto& c : cases) {
+        ret |= bench_binary<int>("int32", CPU_DTYPE_INT32, OP_DIV, c.first, c.second, loops);
+        ret |= bench_binary<int>("int32", CPU_DTYPE_INT32, OP_MOD, c.first, c.second, loops);
+        ret |= bench_binary<float>("fp32", CPU_DTYPE_FP32, OP_DIV, c.first, c.second, loops);
+    }
+    ret |= bench_unary("floor", OP_FLOOR, [](float x) { return std::floor(x); }, loops);
+    ret |= bench_unary("ceil", OP_CEIL, [](float x) { return std::ceil(x); }, loops);
+    ret |= bench_unary("round", OP_ROUND, [](float x) { return std::round(x); }, loops);
+    ret |= bench_unary("isfinite", OP_ISFINITE, [](float x) { return std::isfinite(x) ? 1.f : 0.f; }, loops);
+    return ret;
+}
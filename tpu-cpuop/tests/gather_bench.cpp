@@ -0,0 +1,134 @@
+/*
+ * cpu_embedding_bag: the old per bag loop vs the gather engine on a
+ * recommendation sized table, fp32 and the same table in fp16, plus
+ * cpu_gather rows vs a memcpy per row. The fp32 outputs are compared.
+ * usage: gather_bench [loops]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+#include <random>
+#include <vector>
+#include "bmcpu_gather.hpp"
+#include "bmcpu_elementwise.hpp"
+
+using std::vector;
+using namespace bmcpu;
+
+/* what cpu_embedding_bag did before the gather engine */
+static void old_embedding_bag(const float* weight, int num_embeddings, int dim,
+                              const int* indices, int num_indices, const int* offsets,
+                              int num_bags, EMB_MODE_T mode, float* output)
+{
+    for (int i = 0; i < num_bags; i++) {
+        int end = (i == num_bags - 1) ? num_indices : offsets[i + 1];
+        for (int j = offsets[i]; j < end; j++) {
+            if (j == offsets[i]) {
+                if (indices[j] < num_embeddings)
+                    memcpy(output + i * dim, weight + indices[j] * dim, dim * sizeof(float));
+                else
+                    memset(output + i * dim, 0, dim * sizeof(float));
+                continue;
+            }
+            if (mode == EMB_MAX) {
+                for (int k = 0; k < dim; k++) {
+                    float weight_val = indices[j] < num_embeddings ? weight[indices[j] * dim + k] : 0.f;
+                    output[i * dim + k] = std::max(output[i * dim + k], weight_val);
+                }
+                continue;
+            }
+            if (indices[j] < num_embeddings) {
+                const float* weight_ptr = weight + indices[j] * dim;
+                float* output_ptr = output + i * dim;
+                for (int k = 0; k < dim; k++) output_ptr[k] += weight_ptr[k];
+            }
+            if (mode == EMB_MEAN && j == end - 1) {
+                for (int k = 0; k < dim; k++) output[i * dim + k] /= (end - offsets[i]);
+            }
+        }
+    }
+}
+
+template <typename F>
+static double time_us(int loops, F f)
+{
+    f();
+    auto t0 = std::chrono::steady_clock::now();
+    for (int l = 0; l < loops; l++) f();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(t1 - t0).count() / loops;
+}
+
+int main(int argc, char** argv)
+{
+    int loops = argc > 1 ? atoi(argv[1]) : 10;
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> u(-1.f, 1.f);
+    const int num_embeddings = 500000, dim = 64;
+    vector<float> weight((size_t)num_embeddings * dim);
+    for (auto& w : weight) w = u(rng);
+    vector<uint16_t> weight_fp16(weight.size());
+    for (size_t i = 0; i < weight.size(); i++) weight_fp16[i] = fp32_to_fp16(weight[i]);
+
+    struct { int num_bags, min_bag, max_bag; } cases[] = {
+        {2048, 20, 80}, {512, 1, 10}, {128, 100, 300}};
+    const char* mode_names[] = {"sum", "mean", "max"};
+    for (auto& c : cases) {
+        vector<int> indices, offsets;
+        for (int i = 0; i < c.num_bags; i++) {
+            offsets.push_back(indices.size());
+            int len = c.min_bag + rng() % (c.max_bag - c.min_bag + 1);
+            for (int j = 0; j < len; j++) indices.push_back(rng() % num_embeddings);
+        }
+        for (int mode = EMB_SUM; mode <= EMB_MAX; mode++) {
+            vector<float> out_old((size_t)c.num_bags * dim), out_new(out_old.size());
+            vector<uint16_t> out_fp16(out_old.size());
+            double t_old = time_us(loops, [&] {
+                old_embedding_bag(weight.data(), num_embeddings, dim, indices.data(), indices.size(),
+                                  offsets.data(), c.num_bags, (EMB_MODE_T)mode, out_old.data());
+            });
+            double t_new = time_us(loops, [&] {
+                embedding_bag(CPU_DTYPE_FP32, weight.data(), num_embeddings, dim, indices.data(),
+                              indices.size(), offsets.data(), c.num_bags, (EMB_MODE_T)mode,
+                              out_new.data());
+            });
+            double t_fp16 = time_us(loops, [&] {
+                embedding_bag(CPU_DTYPE_FP16, weight_fp16.data(), num_embeddings, dim, indices.data(),
+                              indices.size(), offsets.data(), c.num_bags, (EMB_MODE_T)mode,
+                              out_fp16.data());
+            });
+            if (memcmp(out_old.data(), out_new.data(), out_old.size() * sizeof(float)))
+                printf("output mismatch\n");
+            printf("embedding_bag %s bags %d x [%d, %d] dim %d: old %.1fus new %.1fus (%.2fx) fp16 %.1fus\n",
+                   mode_names[mode], c.num_bags, c.min_bag, c.max_bag, dim, t_old, t_new,
+                   t_old / t_new, t_fp16);
+        }
+    }
+
+    struct { int outer, axis_len, index_num, inner; } gathers[] = {
+        {1, num_embeddings, 16384, dim}, {64, 1000, 100, 16}, {8, 4096, 4096, 1}};
+    for (auto& g : gathers) {
+        vector<int> index(g.index_num);
+        for (int i = 0; i < g.index_num; i++)
+            index[i] = (i & 3) ? (index[i - 1] + 1) % g.axis_len : rng() % g.axis_len;
+        size_t row = g.inner * sizeof(float);
+        vector<float> out_old((size_t)g.outer * g.index_num * g.inner), out_new(out_old.size());
+        double t_old = time_us(loops, [&] {
+            for (int o = 0; o < g.outer; o++)
+                for (int j = 0; j < g.index_num; j++)
+                    memcpy(out_old.data() + ((size_t)o * g.index_num + j) * g.inner,
+                           weight.data() + ((size_t)o * g.axis_len + index[j]) * g.inner, row);
+        });
+        double t_new = time_us(loops, [&] {
+            gather_rows(weight.data(), g.outer, g.axis_len, index.data(), g.index_num, row,
+                        out_new.data());
+        });
+        if (memcmp(out_old.data(), out_new.data(), out_old.size() * sizeof(float)))
+            printf("output mismatch\n");
+        printf("gather [%d, %d, %d] by %d: old %.1fus new %.1fus (%.2fx)\n",
+               g.outer, g.axis_len, g.inner, g.index_num, t_old, t_new, t_old / t_new);
+    }
+    return 0;
+}
@@ -0,0 +1,210 @@
+/*
+ * nms on 20k boxes and 80 classes: the old per layer loops vs the shared
+ * NmsKernel (bbox_util_opt). The kept indices are compared one by one.
+ * usage: nms_bench [num_boxes] [num_classes] [loops]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <random>
+#include <vector>
+#include "bbox_util_opt.hpp"
+
+/* what ApplyNMSFast_opt did before the kernel */
+static float old_caffe_iou(const float* b1, float a1, const float* b2, float a2)
+{
+    if (b2[0] > b1[2] || b2[2] < b1[0] || b2[1] > b1[3] || b2[3] < b1[1])
+        return 0.f;
+    float w = std::min(b1[2], b2[2]) - std::max(b1[0], b2[0]);
+    float h = std::min(b1[3], b2[3]) - std::max(b1[1], b2[1]);
+    if (w > 0 && h > 0) {
+        float inter = w * h;
+        return inter / (a1 + a2 - inter);
+    }
+    return 0.f;
+}
+
+static void old_ssd_nms(const float* boxes, const float* areas, const float* scores, int num,
+                        int stride, float score_threshold, float nms_threshold, int top_k,
+                        std::vector<std::pair<float, int>>* indices)
+{
+    std::vector<std::pair<float, int>> order;
+    for (int i = 0; i < num; i++)
+        if (scores[i * stride] > score_threshold)
+            order.push_back(std::make_pair(scores[i * stride], i));
+    std::stable_sort(order.begin(), order.end(), bmcpu::SortScorePairDescend<int>);
+    if (top_k > -1 && top_k < (int)order.size())
+        order.resize(top_k);
+    indices->clear();
+    while (!order.empty()) {
+        const int idx = order.front().second;
+        bool keep = true;
+        for (size_t k = 0; k < indices->size() && keep; ++k) {
+            const int kept = (*indices)[k].second;
+            keep = old_caffe_iou(boxes + idx * 4, areas[idx], boxes + kept * 4, areas[kept]) <= nms_threshold;
+        }
+        if (keep)
+            indices->push_back(order.front());
+        order.erase(order.begin());
+    }
+}
+
+/* what cpu_nms / cpu_tensorflow_nms_v5 did before the kernel */
+static float old_tf_iou(const float* box, int i, int j)
+{
+    const float* bi = box + i * 4;
+    const float* bj = box + j * 4;
+    const float ymax_i = std::max(bi[0], bi[2]), ymin_i = std::min(bi[0], bi[2]);
+    const float xmax_i = std::max(bi[1], bi[3]), xmin_i = std::min(bi[1], bi[3]);
+    const float ymax_j = std::max(bj[0], bj[2]), ymin_j = std::min(bj[0], bj[2]);
+    const float xmax_j = std::max(bj[1], bj[3]), xmin_j = std::min(bj[1], bj[3]);
+    const float area_i = (ymax_i - ymin_i) * (xmax_i - xmin_i);
+    const float area_j = (ymax_j - ymin_j) * (xmax_j - xmin_j);
+    if (area_i <= 0.f || area_j <= 0.f)
+        return 0.f;
+    const float y_inter = std::max(std::min(ymax_i, ymax_j) - std::max(ymin_i, ymin_j), 0.f);
+    const float x_inter = std::max(std::min(xmax_i, xmax_j) - std::max(xmin_i, xmin_j), 0.f);
+    if (y_inter == 0.f || x_inter == 0.f)
+        return 0.f;
+    const float inter = y_inter * x_inter;
+    return inter / (area_i + area_j - inter);
+}
+
+struct Candidate {
+    int box_index;
+    float score;
+    int begin_index;
+};
+struct CandidateLess {
+    bool operator()(const Candidate& i, const Candidate& j) const { return i.score < j.score; }
+};
+
+static void old_tf_nms(const float* box, const float* score, int num, float iou_threshold,
+                       float score_threshold, float sigma, int max_output, std::vector<int>* selected)
+{
+    std::priority_queue<Candidate, std::deque<Candidate>, CandidateLess> queue;
+    for (int i = 0; i < num; ++i)
+        if (score[i] > score_threshold)
+            queue.push(Candidate({i, score[i], 0}));
+    float scale = sigma > 0.f ? -.5f / sigma : 0.f;
+    selected->clear();
+    while ((int)selected->size() < max_output && !queue.empty()) {
+        Candidate cand = queue.top();
+        float original_score = cand.score;
+        queue.pop();
+        bool hard = false;
+        for (int i = (int)selected->size() - 1; i >= cand.begin_index; --i) {
+            float iou = old_tf_iou(box, cand.box_index, (*selected)[i]);
+            cand.score *= iou <= iou_threshold ? std::exp(scale * iou * iou) : 0.f;
+            if (iou >= iou_threshold) {
+                hard = true;
+                break;
+            }
+            if (cand.score <= score_threshold)
+                break;
+        }
+        cand.begin_index = selected->size();
+        if (!hard) {
+            if (cand.score == original_score)
+                selected->push_back(cand.box_index);
+            if (cand.score > score_threshold)
+                queue.push(cand);
+        }
+    }
+}
+
+template<typename Func>
+static double time_ms(int loops, Func func)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < loops; i++) func();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(t1 - t0).count() / loops;
+}
+
+static void report(const char* name, double old_ms, double new_ms, bool same)
+{
+    printf("%-28s old: %9.2f ms  new: %9.2f ms  speedup: %6.2fx%s\n", name, old_ms, new_ms,
+           new_ms > 0 ? old_ms / new_ms : 0.0, same ? "" : "  output mismatch");
+}
+
+int main(int argc, char* argv[])
+{
+    int num = argc > 1 ? atoi(argv[1]) : 20000;
+    int num_classes = argc > 2 ? atoi(argv[2]) : 80;
+    int loops = argc > 3 ? atoi(argv[3]) : 1;
+    if (num <= 0 || num_classes <= 0 || loops <= 0) {
+        printf("usage: %s [num_boxes] [num_classes] [loops]\n", argv[0]);
+        return -1;
+    }
+
+    /* detections crowd around objects, as the decoded priors of a detector do */
+    std::mt19937 rng(5);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    std::vector<float> boxes(num * 4), areas(num), scores(num * num_classes);
+    std::vector<float> cx(200), cy(200);
+    for (size_t i = 0; i < cx.size(); i++) {
+        cx[i] = unit(rng);
+        cy[i] = unit(rng);
+    }
+    for (int i = 0; i < num; i++) {
+        float x = cx[i % cx.size()] + 0.05f * (unit(rng) - 0.5f);
+        float y = cy[i % cy.size()] + 0.05f * (unit(rng) - 0.5f);
+        float w = 0.02f + 0.1f * unit(rng), h = 0.02f + 0.1f * unit(rng);
+        float* b = &boxes[i * 4];
+        b[0] = x - w / 2;
+        b[1] = y - h / 2;
+        b[2] = x + w / 2;
+        b[3] = y + h / 2;
+        areas[i] = w * h;
+    }
+    for (auto& s : scores) s = unit(rng);
+    int ret = 0;
+
+    /* ssd detection output: per class, top_k 400 as in the ssd prototxt */
+    for (int top_k : {400, -1}) {
+        std::vector<std::vector<std::pair<float, int>>> old_out(num_classes), new_out(num_classes);
+        double old_ms = time_ms(loops, [&]() {
+            for (int c = 0; c < num_classes; c++)
+                old_ssd_nms(boxes.data(), areas.data(), scores.data() + c, num, num_classes,
+                            0.5f, 0.45f, top_k, &old_out[c]);
+        });
+        double new_ms = time_ms(loops, [&]() {
+            for (int c = 0; c < num_classes; c++)
+                bmcpu::ApplyNMSFast_opt((const bmcpu::NormalizedBBoxOpt*)boxes.data(), num, areas.data(),
+                                        scores.data() + c, 0.5f, 0.45f, 1.f, top_k, num_classes, &new_out[c]);
+        });
+        char name[64];
+        snprintf(name, sizeof(name), "ssd %d classes top_k %d", num_classes, top_k);
+        report(name, old_ms, new_ms, old_out == new_out);
+        ret |= old_out != new_out;
+    }
+
+    /* tensorflow NonMaxSuppressionV5 on one class, hard and soft */
+    for (float sigma : {0.f, 0.5f}) {
+        std::vector<float> tf_boxes(num * 4);
+        for (int i = 0; i < num; i++) {
+            tf_boxes[i * 4] = boxes[i * 4 + 1];
+            tf_boxes[i * 4 + 1] = boxes[i * 4];
+            tf_boxes[i * 4 + 2] = boxes[i * 4 + 3];
+            tf_boxes[i * 4 + 3] = boxes[i * 4 + 2];
+        }
+        std::vector<float> tf_scores(scores.begin(), scores.begin() + num);
+        std::vector<int> old_out, new_out;
+        double old_ms = time_ms(loops, [&]() {
+            old_tf_nms(tf_boxes.data(), tf_scores.data(), num, 0.5f, 0.05f, sigma, num, &old_out);
+        });
+        bmcpu::NmsParam param = {bmcpu::NMS_IOU_TF, 0.5f, 1.f, 0.f, false};
+        double new_ms = time_ms(loops, [&]() {
+            bmcpu::ApplyNMSQueue_opt(param, sigma > 0.f ? bmcpu::NMS_SOFT_GAUSSIAN : bmcpu::NMS_HARD,
+                                     sigma, tf_boxes.data(), tf_scores.data(), num, 0.05f, num,
+                                     &new_out, NULL);
+        });
+        report(sigma > 0.f ? "tensorflow soft nms" : "tensorflow nms", old_ms, new_ms, old_out == new_out);
+        ret |= old_out != new_out;
+    }
+    return ret;
+}
@@ -0,0 +1,280 @@
+/*
+ * cpu_sort_per_dim / cpu_argsort: the old index combination and transpose
+ * based layers vs bmcpu::strided_sort and strided_argsort.
+ * The outputs are compared element by element.
+ * usage: sort_bench [loops]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+#include "bmcpu_sort.hpp"
+
+using std::vector;
+
+/* what cpu_sort_per_dim did before the strided sort */
+template <typename Dtype>
+static vector<Dtype> concat_1dim_array(vector<Dtype> array1, vector<Dtype> array2)
+{
+    vector<Dtype> concat_array;
+    concat_array.reserve(array1.size() + array2.size());
+    concat_array.insert(concat_array.end(), array1.begin(), array1.end());
+    concat_array.insert(concat_array.end(), array2.begin(), array2.end());
+    return concat_array;
+}
+
+template <typename Dtype>
+static vector<vector<Dtype>> conbine_2dim_array(vector<vector<Dtype>> array1, vector<vector<Dtype>> array2)
+{
+    vector<vector<Dtype>> concat_array;
+    if (array1.size() == 0) return array2;
+    for (size_t idx1 = 0; idx1 < array1.size(); ++idx1)
+        for (size_t idx2 = 0; idx2 < array2.size(); ++idx2)
+            concat_array.push_back(concat_1dim_array(array1[idx1], array2[idx2]));
+    return concat_array;
+}
+
+template <typename Dtype>
+static vector<vector<Dtype>> get_array_combinations(vector<vector<Dtype>> array)
+{
+    vector<vector<vector<Dtype>>> split_array(array.size());
+    for (size_t i = 0; i < array.size(); ++i) {
+        split_array[i].resize(array[i].size());
+        for (size_t j = 0; j < array[i].size(); ++j)
+            split_array[i][j].push_back(array[i][j]);
+    }
+    if (split_array.size() == 1) return split_array[0];
+    vector<vector<Dtype>> combine_array;
+    for (size_t i = 0; i < split_array.size(); ++i) {
+        vector<vector<Dtype>> temp_array;
+        temp_array = conbine_2dim_array(combine_array, split_array[i]);
+        combine_array = temp_array;
+    }
+    return combine_array;
+}
+
+static void old_sort_per_dim(const float* in_addr, int* index_addr, float* out_addr,
+                             const vector<int>& shape, int dim, bool descending)
+{
+    vector<int> shape_in = shape;
+    if (shape_in.size() == 1) shape_in.push_back(1);
+    int shape_num = shape_in.size();
+    vector<int> block_size(shape_num, 1);
+    for (int i = shape_num - 2; i >= 0; --i)
+        block_size[i] = block_size[i + 1] * shape_in[i + 1];
+    vector<vector<int>> array(shape_num);
+    for (int i = 0; i < shape_num; ++i) {
+        if (i == dim) continue;
+        array[i].resize(shape_in[i]);
+        std::iota(array[i].begin(), array[i].end(), 0);
+    }
+    array.erase(array.begin() + dim);
+    vector<vector<int>> other_dim_idx_combine = get_array_combinations(array);
+    for (size_t i = 0; i < other_dim_idx_combine.size(); ++i) {
+        int ele_idx = 0;
+        for (size_t j = 0; j < other_dim_idx_combine[i].size(); ++j) {
+            if ((int)j < dim) ele_idx += other_dim_idx_combine[i][j] * block_size[j];
+            else ele_idx += other_dim_idx_combine[i][j] * block_size[j + 1];
+        }
+        vector<int> idx(shape_in[dim]);
+        std::iota(idx.begin(), idx.end(), 0);
+        vector<float> temp;
+        for (int j = 0; j < shape_in[dim]; ++j)
+            temp.push_back(in_addr[ele_idx + j * block_size[dim]]);
+        std::stable_sort(idx.begin(), idx.end(), [&temp, &descending](size_t i1, size_t i2) {
+            return descending ? temp[i1] > temp[i2] : temp[i1] < temp[i2];
+        });
+        for (int j = 0; j < shape_in[dim]; ++j) {
+            index_addr[ele_idx + j * block_size[dim]] = idx[j];
+            out_addr[ele_idx + j * block_size[dim]] = in_addr[ele_idx + idx[j] * block_size[dim]];
+        }
+    }
+}
+
+/* what cpu_argsort did before the strided sort */
+static int* calc_dim(int dims, int* base_offset, int offset)
+{
+    int* index = new int[dims];
+    for (int i = 0; i < dims; i++) {
+        index[i] = offset / base_offset[i];
+        offset = offset % base_offset[i];
+    }
+    return index;
+}
+
+static int calc_offset(int* base_offset, int* index, int dims)
+{
+    int prt_loc = 0;
+    for (int i = 0; i < dims; ++i) prt_loc += index[i] * base_offset[i];
+    return prt_loc;
+}
+
+static vector<float> old_argsort_lane(const vector<float>& array, bool ascend)
+{
+    vector<float> array_index(array.size());
+    for (size_t i = 0; i < array.size(); ++i) array_index[i] = float(i);
+    if (ascend)
+        std::sort(array_index.begin(), array_index.end(),
+                  [&array](int pos1, int pos2) { return array[pos1] < array[pos2]; });
+    else
+        std::sort(array_index.begin(), array_index.end(),
+                  [&array](int pos1, int pos2) { return array[pos1] > array[pos2]; });
+    return array_index;
+}
+
+static void old_argsort(const float* input_prt, float* out_prt, const vector<int>& shape,
+                        int axis, bool is_ascend)
+{
+    int dim = shape.size();
+    vector<int> trans_shape0 = shape;
+    std::swap(trans_shape0[dim - 1], trans_shape0[axis]);
+    int* base_offset = new int[dim];
+    int* base_offset_trans = new int[dim];
+    for (int i = 0; i < dim; i++) {
+        int b = 1, bt = 1;
+        for (int k = i; k < dim - 1; k++) {
+            b *= shape[k + 1];
+            bt *= trans_shape0[k + 1];
+        }
+        base_offset[i] = b;
+        base_offset_trans[i] = bt;
+    }
+    int len = 1;
+    for (int i = 0; i < dim; i++) len *= shape[i];
+    float* trans_prt = new float[len];
+    for (int i = 0; i < len; i++) {
+        int* index = calc_dim(dim, base_offset, i);
+        int* index_trans = new int[dim];
+        memcpy(index_trans, index, dim * sizeof(int));
+        index_trans[axis] = index[dim - 1];
+        index_trans[dim - 1] = index[axis];
+        trans_prt[calc_offset(base_offset_trans, index_trans, dim)] = input_prt[i];
+        delete[] index;
+        delete[] index_trans;
+    }
+    int cutting_len = trans_shape0[dim - 1];
+    float* out_prt_temp = new float[len];
+    for (int i = 0; i < len; i += cutting_len) {
+        vector<float> temp_sort(trans_prt + i, trans_prt + i + cutting_len);
+        auto out_sort = old_argsort_lane(temp_sort, is_ascend);
+        memcpy(out_prt_temp + i, &out_sort[0], out_sort.size() * sizeof(float));
+    }
+    delete[] trans_prt;
+    for (int i = 0; i < len; i++) {
+        int* index = calc_dim(dim, base_offset_trans, i);
+        int* index_trans_again = new int[dim];
+        memcpy(index_trans_again, index, dim * sizeof(int));
+        index_trans_again[axis] = index[dim - 1];
+        index_trans_again[dim - 1] = index[axis];
+        out_prt[calc_offset(base_offset, index_trans_again, dim)] = out_prt_temp[i];
+        delete[] index;
+        delete[] index_trans_again;
+    }
+    delete[] out_prt_temp;
+    delete[] base_offset;
+    delete[] base_offset_trans;
+}
+
+static size_t shape_num(const vector<int>& shape)
+{
+    size_t n = 1;
+    for (int s : shape) n *= s;
+    return n;
+}
+
+static std::string shape_str(const vector<int>& shape, int axis)
+{
+    std::string s = "[";
+    for (size_t i = 0; i < shape.size(); i++)
+        s += (i ? "," : "") + std::to_string(shape[i]);
+    return s + "] axis " + std::to_string(axis);
+}
+
+template<typename Func>
+static double time_us(int loops, Func func)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < loops; i++) func();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(t1 - t0).count() / loops;
+}
+
+/* distinct values, so the unstable old argsort has a single answer */
+static vector<float> random_input(size_t num)
+{
+    std::mt19937 rng(17);
+    vector<float> in(num);
+    for (size_t i = 0; i < num; i++) in[i] = (float)i - num / 2;
+    std::shuffle(in.begin(), in.end(), rng);
+    return in;
+}
+
+static int bench_sort_per_dim(const vector<int>& shape, int axis, int loops)
+{
+    auto in = random_input(shape_num(shape));
+    vector<int> old_index(in.size()), new_index(in.size());
+    vector<float> old_out(in.size()), new_out(in.size());
+    double old_us = time_us(loops, [&]() {
+        old_sort_per_dim(in.data(), old_index.data(), old_out.data(), shape, axis, true);
+    });
+    double new_us = time_us(loops, [&]() {
+        int outer, len, inner;
+        bmcpu::sort_view(shape.data(), shape.size(), axis, &outer, &len, &inner);
+        bmcpu::strided_sort(in.data(), outer, len, inner, true, new_index.data(), new_out.data());
+    });
+    printf("sort_per_dim %-24s old: %11.1f us  new: %9.1f us  speedup: %7.2fx\n",
+           shape_str(shape, axis).c_str(), old_us, new_us, new_us > 0 ? old_us / new_us : 0.0);
+    if (old_index != new_index || old_out != new_out) {
+        printf("  output mismatch\n");
+        return -1;
+    }
+    return 0;
+}
+
+static int bench_argsort(const vector<int>& shape, int axis, int loops)
+{
+    auto in = random_input(shape_num(shape));
+    vector<float> old_index(in.size()), new_index(in.size());
+    double old_us = time_us(loops, [&]() {
+        old_argsort(in.data(), old_index.data(), shape, axis, true);
+    });
+    double new_us = time_us(loops, [&]() {
+        int outer, len, inner;
+        bmcpu::sort_view(shape.data(), shape.size(), axis, &outer, &len, &inner);
+        bmcpu::strided_argsort(in.data(), outer, len, inner, false, new_index.data());
+    });
+    printf("argsort      %-24s old: %11.1f us  new: %9.1f us  speedup: %7.2fx\n",
+           shape_str(shape, axis).c_str(), old_us, new_us, new_us > 0 ? old_us / new_us : 0.0);
+    if (old_index != new_index) {
+        printf("  output mismatch\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int loops = argc > 1 ? atoi(argv[1]) : 3;
+    if (loops <= 0) {
+        printf("usage: %s [loops]\n", argv[0]);
+        return -1;
+    }
+    const vector<std::pair<vector<int>, int>> cases = {
+        {{1 << 20}, 0},            /* one long lane */
+        {{1024, 1000}, 1},         /* last axis, e.g. class scores */
+        {{1000, 1024}, 0},         /* first axis, strided lanes */
+        {{8, 64, 32, 32}, 1},      /* channel axis */
+        {{16, 8192, 8}, 1},
+    };
+    int ret = 0;
+    for (auto& c : cases) {
+        ret |= bench_sort_per_dim(c.first, c.second, loops);
+        ret |= bench_argsort(c.first, c.second, loops);
+    }
+    return ret;
+}
@@ -0,0 +1,118 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+#include "bmcpu.h"
+#include "bmcpu_common.h"
+
+/* one cpu subnet launch: grid sampler or affine grid generator of its own size */
+struct CpuCall {
+    int op_type;
+    cpu_grid_sampler_param_t sampler_param;
+    cpu_affine_grid_generator_param_t generator_param;
+    std::vector<std::vector<float>> inputs;
+    std::vector<std::vector<int>> input_shapes;
+    std::vector<int> output_shape;
+
+    std::vector<float> run(void *handle) {
+        std::vector<float> output(output_shape[0] * output_shape[1] * output_shape[2] * output_shape[3]);
+        std::vector<float *> input_tensors;
+        for (auto &in : inputs) input_tensors.push_back(in.data());
+        std::vector<float *> output_tensors(1, output.data());
+        std::vector<std::vector<int>> output_shapes(1, output_shape);
+        void *param = op_type == CPU_GRID_SAMPLER ? (void *)&sampler_param : (void *)&generator_param;
+        int param_size = op_type == CPU_GRID_SAMPLER ? sizeof(sampler_param) : sizeof(generator_param);
+        int ret = bmcpu_process(handle, op_type, param, param_size,
+                                input_tensors, input_shapes, output_tensors, output_shapes);
+        EXPECT_EQ(ret, 0);
+        EXPECT_EQ(output_shapes[0], output_shape);
+        return output;
+    }
+};
+
+static CpuCall make_call(int idx) {
+    std::mt19937 rng(idx);
+    std::uniform_real_distribution<float> dist(-1.2f, 1.2f);
+    CpuCall call;
+    int N = 1 + idx % 2, H = 4 + idx % 7, W = 5 + idx % 5;
+    if (idx % 2 == 0) {
+        int C = 1 + idx % 3, IH = 3 + idx % 4, IW = 6 + idx % 3;
+        call.op_type = CPU_GRID_SAMPLER;
+        call.sampler_param.mode = GridSamplerBilinear;
+        call.sampler_param.padding_mode = idx % 3;
+        call.sampler_param.align_corners = idx % 4 < 2;
+        call.inputs.resize(2);
+        call.inputs[0].resize(N * C * IH * IW);
+        for (auto &v : call.inputs[0]) v = dist(rng);
+        call.inputs[1].resize(N * H * W * 2);
+        for (auto &v : call.inputs[1]) v = dist(rng);
+        call.input_shapes = {{N, C, IH, IW}, {N, H, W, 2}};
+        call.output_shape = {N, C, H, W};
+    } else {
+        call.op_type = CPU_AFFINE_GRID_GENERATOR;
+        call.generator_param.align_corners = idx % 4 < 2;
+        call.generator_param.N = N;
+        call.generator_param.H = H;
+        call.generator_param.W = W;
+        call.inputs.resize(2);
+        call.inputs[0].resize(N * 6);
+        for (auto &v : call.inputs[0]) v = dist(rng);
+        int size[4] = {N, 1, H, W};
+        call.inputs[1].resize(4);
+        memcpy(call.inputs[1].data(), size, sizeof(size));
+        call.input_shapes = {{N, 2, 3}, {4}};
+        call.output_shape = {N, H, W, 2};
+    }
+    return call;
+}
+
+TEST(BmcpuProcessTest, concurrentCallsMatchSerial)
+{
+    void *handle = bmcpu_init();
+    const int call_num = 16, thread_num = 8, loops = 1000;
+    std::vector<CpuCall> calls;
+    std::vector<std::vector<float>> expects;
+    for (int i = 0; i < call_num; i++) {
+        calls.push_back(make_call(i));
+        expects.push_back(calls.back().run(handle));
+    }
+
+    std::atomic<int> mismatch(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_num; t++) {
+        threads.emplace_back([&, t]() {
+            for (int loop = 0; loop < loops; loop++) {
+                int idx = (t * 7 + loop) % call_num;
+                if (calls[idx].run(handle) != expects[idx]) mismatch++;
+            }
+        });
+    }
+    for (auto &t : threads) t.join();
+    bmcpu_uninit(handle);
+    ASSERT_EQ(mismatch.load(), 0);
+}
+
+TEST(BmcpuProcessTest, reshapeWhileProcessing)
+{
+    void *handle = bmcpu_init();
+    CpuCall call = make_call(3);
+    std::vector<float> expect = call.run(handle);
+    std::atomic<bool> stop(false);
+    std::atomic<int> bad_shape(0);
+    std::thread reshaper([&]() {
+        while (!stop) {
+            std::vector<std::vector<int>> output_shapes;
+            bmcpu_reshape(handle, call.op_type, &call.generator_param, sizeof(call.generator_param),
+                          call.input_shapes, output_shapes);
+            if (output_shapes.size() != 1 || output_shapes[0] != call.output_shape) bad_shape++;
+        }
+    });
+    for (int loop = 0; loop < 2000; loop++)
+        ASSERT_EQ(call.run(handle), expect);
+    stop = true;
+    reshaper.join();
+    bmcpu_uninit(handle);
+    ASSERT_EQ(bad_shape.load(), 0);
+}
@@ -0,0 +1,249 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <cmath>
+#include <limits>
+#include <random>
+#include "cpu_binary.h"
+#include "cpu_unary.h"
+#include "bmcpu_elementwise.hpp"
+
+/* element by element reference, the way cpu_binary used to walk the output */
+template<typename T>
+static T ref_binary(T a, T b, BINARY_OP_CODE_T op)
+{
+    return op == OP_MOD ? static_cast<int>(a) % static_cast<int>(b)
+                        : static_cast<int>(a) / static_cast<int>(b);
+}
+
+template<typename T, typename CVT, typename BACK>
+static std::vector<T> ref_broadcast(const std::vector<T>& in0, std::vector<int> shape0,
+                                    const std::vector<T>& in1, std::vector<int> shape1,
+                                    BINARY_OP_CODE_T op, CVT cvt, BACK back)
+{
+    size_t dim = std::max(shape0.size(), shape1.size());
+    shape0.insert(shape0.begin(), dim - shape0.size(), 1);
+    shape1.insert(shape1.begin(), dim - shape1.size(), 1);
+    std::vector<int> out_shape(dim);
+    size_t out_num = 1;
+    for (size_t i = 0; i < dim; i++) {
+        out_shape[i] = shape0[i] == 1 ? shape1[i] : shape0[i];
+        out_num *= out_shape[i];
+    }
+    std::vector<T> out(out_num);
+    for (size_t o = 0; o < out_num; o++) {
+        size_t r = o, off0 = 0, off1 = 0, st0 = 1, st1 = 1;
+        for (int i = (int)dim - 1; i >= 0; i--) {
+            size_t idx = r % out_shape[i];
+            r /= out_shape[i];
+            if (shape0[i] != 1) off0 += idx * st0;
+            if (shape1[i] != 1) off1 += idx * st1;
+            st0 *= shape0[i];
+            st1 *= shape1[i];
+        }
+        out[o] = back(ref_binary(cvt(in0[off0]), cvt(in1[off1]), op));
+    }
+    return out;
+}
+
+static size_t shape_num(const std::vector<int>& shape)
+{
+    size_t n = 1;
+    for (int s : shape) n *= s;
+    return n;
+}
+
+static const std::vector<std::pair<std::vector<int>, std::vector<int>>> broadcast_cases = {
+    {{2, 3, 17, 19}, {2, 3, 17, 19}},    /* same shape */
+    {{4, 5, 33}, {1}},                   /* scalar */
+    {{1}, {4, 5, 33}},
+    {{2, 16, 9, 9}, {1, 16, 1, 1}},      /* per channel */
+    {{2, 16, 9, 9}, {16, 9, 9}},         /* fewer dims */
+    {{3, 7, 1, 13}, {3, 1, 5, 13}},
+    {{37, 1}, {1, 41}},                  /* outer product */
+    {{1, 41}, {37, 1}},
+    {{6, 1, 2}, {6, 5, 1}},
+    {{1, 1, 1}, {1}},
+    {{3, 0, 4}, {1, 4}},                 /* empty */
+};
+
+class CPUBinaryTest : public ::testing::TestWithParam<BINARY_OP_CODE_T> {
+protected:
+    std::mt19937 rng{1234};
+
+    template<typename T>
+    void run_layer(std::vector<T>& in0, const std::vector<int>& shape0,
+                   std::vector<T>& in1, const std::vector<int>& shape1,
+                   CPU_DATA_TYPE_T dtype, std::vector<T>& out, std::vector<int>& out_shape)
+    {
+        bmcpu::cpu_binarylayer layer;
+        cpu_binary_param_t param = {GetParam(), dtype};
+        std::vector<std::vector<int>> input_shapes = {shape0, shape1};
+        std::vector<std::vector<int>> output_shapes;
+        layer.reshape(&param, sizeof(param), input_shapes, output_shapes);
+        out.assign(shape_num(output_shapes[0]), T());
+        std::vector<float*> input_tensors = {(float*)in0.data(), (float*)in1.data()};
+        std::vector<float*> output_tensors = {(float*)out.data()};
+        layer.set_common_param(input_tensors, input_shapes, output_tensors, output_shapes);
+        layer.process(&param, sizeof(param));
+        out_shape = output_shapes[0];
+    }
+
+    /* a divisor is never 0 */
+    int random_int(bool divisor)
+    {
+        int v = (int)(rng() % 2001) - 1000;
+        if (divisor && v == 0) v = 7;
+        return v;
+    }
+};
+
+TEST_P(CPUBinaryTest, int32)
+{
+    for (auto& c : broadcast_cases) {
+        std::vector<int> in0(shape_num(c.first)), in1(shape_num(c.second)), out, out_shape;
+        for (auto& v : in0) v = random_int(false);
+        for (auto& v : in1) v = random_int(true);
+        run_layer(in0, c.first, in1, c.second, CPU_DTYPE_INT32, out, out_shape);
+        auto expect = ref_broadcast(in0, c.first, in1, c.second, GetParam(),
+                                    [](int v) { return v; }, [](int v) { return v; });
+        ASSERT_EQ(out_shape.size(), std::max(c.first.size(), c.second.size()));
+        ASSERT_EQ(out, expect);
+    }
+}
+
+TEST_P(CPUBinaryTest, int32Extremes)
+{
+    std::vector<int> in0 = {INT32_MAX, INT32_MIN, INT32_MAX, INT32_MIN, 2147483646, -2147483647,
+                            1, -1, 0, 5, -5, 999999937, INT32_MIN + 1, 7, -7, 12345678};
+    std::vector<int> in1 = {1, 1, -1, 2, INT32_MAX, INT32_MAX, INT32_MIN, INT32_MIN,
+                            3, -3, 3, 65537, -1, INT32_MAX, INT32_MIN + 1, 2};
+    std::vector<int> shape = {(int)in0.size()}, out, out_shape;
+    run_layer(in0, shape, in1, shape, CPU_DTYPE_INT32, out, out_shape);
+    auto expect = ref_broadcast(in0, shape, in1, shape, GetParam(),
+                                [](int v) { return v; }, [](int v) { return v; });
+    ASSERT_EQ(out, expect);
+}
+
+TEST_P(CPUBinaryTest, fp32)
+{
+    std::uniform_real_distribution<float> dist(-1000.f, 1000.f);
+    for (auto& c : broadcast_cases) {
+        std::vector<float> in0(shape_num(c.first)), in1(shape_num(c.second)), out;
+        std::vector<int> out_shape;
+        for (auto& v : in0) v = dist(rng);
+        for (auto& v : in1) {
+            v = dist(rng);
+            if (std::fabs(v) < 1.f) v = 1.5f;
+        }
+        run_layer(in0, c.first, in1, c.second, CPU_DTYPE_FP32, out, out_shape);
+        auto expect = ref_broadcast(in0, c.first, in1, c.second, GetParam(),
+                                    [](float v) { return v; }, [](float v) { return v; });
+        ASSERT_EQ(out.size(), expect.size());
+        if (!out.empty())
+            ASSERT_EQ(memcmp(out.data(), expect.data(), out.size() * sizeof(float)), 0);
+    }
+}
+
+TEST_P(CPUBinaryTest, fp16)
+{
+    std::uniform_real_distribution<float> dist(-1000.f, 1000.f);
+    for (auto& c : broadcast_cases) {
+        std::vector<uint16_t> in0(shape_num(c.first)), in1(shape_num(c.second)), out;
+        std::vector<int> out_shape;
+        for (auto& v : in0) v = bmcpu::fp32_to_fp16(dist(rng));
+        for (auto& v : in1) {
+            float f = dist(rng);
+            v = bmcpu::fp32_to_fp16(std::fabs(f) < 1.f ? 3.f : f);
+        }
+        run_layer(in0, c.first, in1, c.second, CPU_DTYPE_FP16, out, out_shape);
+        auto expect = ref_broadcast(in0, c.first, in1, c.second, GetParam(),
+                                    bmcpu::fp16_to_fp32, bmcpu::fp32_to_fp16);
+        ASSERT_EQ(out, expect);
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(ops, CPUBinaryTest, ::testing::Values(OP_MOD, OP_DIV));
+
+TEST(CPUBroadcastPlanTest, mergeDims)
+{
+    bmcpu::broadcast_plan_t plan;
+    std::vector<int> shape0 = {2, 16, 9, 9}, shape1 = {16, 1, 1};
+    bmcpu::broadcast_plan(shape0.data(), 4, shape1.data(), 3, &plan);
+    ASSERT_EQ(plan.dim, 3);
+    ASSERT_EQ(plan.shape[0], 2);
+    ASSERT_EQ(plan.shape[1], 16);
+    ASSERT_EQ(plan.shape[2], 81);
+    ASSERT_EQ(plan.stride1[2], 0);
+    ASSERT_EQ(plan.out_num, 2 * 16 * 81);
+
+    shape1 = {1, 1, 9, 9};
+    bmcpu::broadcast_plan(shape0.data(), 4, shape1.data(), 4, &plan);
+    ASSERT_EQ(plan.dim, 2);
+    ASSERT_EQ(plan.shape[1], 81);
+    ASSERT_EQ(plan.stride0[1], 1);
+    ASSERT_EQ(plan.stride1[1], 1);
+    ASSERT_EQ(plan.stride1[0], 0);
+}
+
+TEST(CPUFp16Test, roundTrip)
+{
+    for (uint32_t h = 0; h < 0x10000; h++) {
+        float f = bmcpu::fp16_to_fp32((uint16_t)h);
+        if (std::isnan(f)) continue;
+        ASSERT_EQ(bmcpu::fp32_to_fp16(f), h) << h;
+    }
+    /* ties go to even */
+    ASSERT_EQ(bmcpu::fp32_to_fp16(2049.f), 0x6800);
+    ASSERT_EQ(bmcpu::fp32_to_fp16(2051.f), 0x6802);
+    ASSERT_EQ(bmcpu::fp32_to_fp16(65519.f), 0x7bff);
+    ASSERT_EQ(bmcpu::fp32_to_fp16(65520.f), 0x7c00);
+    ASSERT_EQ(bmcpu::fp32_to_fp16(std::ldexp(1.f, -25)), 0x0000);
+    ASSERT_EQ(bmcpu::fp32_to_fp16(std::ldexp(1.5f, -25)), 0x0001);
+    ASSERT_EQ(bmcpu::fp32_to_fp16(std::ldexp(3.f, -25)), 0x0002);
+}
+
+static std::vector<float> unary_inputs()
+{
+    std::vector<float> in = {0.f, -0.f, 0.5f, -0.5f, 1.5f, -1.5f, 2.5f, -2.5f, 0.49999997f,
+                             -0.49999997f, 8388607.5f, -8388607.5f, 8388608.f, 16777217.f,
+                             -3e9f, 3e9f, 1e-40f, -1e-40f,
+                             std::numeric_limits<float>::infinity(),
+                             -std::numeric_limits<float>::infinity(),
+                             std::numeric_limits<float>::quiet_NaN(),
+                             std::numeric_limits<float>::max()};
+    std::mt19937 rng(99);
+    std::uniform_real_distribution<float> dist(-100.f, 100.f);
+    for (int i = 0; i < 40000; i++) in.push_back(dist(rng));
+    return in;
+}
+
+TEST(CPUUnaryTest, matchesStd)
+{
+    std::vector<float> in = unary_inputs();
+    const std::vector<std::pair<UNARY_OP_CODE_T, float (*)(float)>> ops = {
+        {OP_SIN, [](float x) { return std::sin(x); }},
+        {OP_COS, [](float x) { return std::cos(x); }},
+        {OP_ISFINITE, [](float x) { return std::isfinite(x) ? 1.f : 0.f; }},
+        {OP_ROUND, [](float x) { return std::round(x); }},
+        {OP_FLOOR, [](float x) { return std::floor(x); }},
+        {OP_CEIL, [](float x) { return std::ceil(x); }},
+    };
+    for (auto& op : ops) {
+        bmcpu::cpu_unarylayer layer;
+        cpu_unary_param_t param = {op.first};
+        std::vector<float> out(in.size());
+        std::vector<std::vector<int>> input_shapes = {{(int)in.size()}}, output_shapes = input_shapes;
+        std::vector<float*> input_tensors = {in.data()}, output_tensors = {out.data()};
+        layer.set_common_param(input_tensors, input_shapes, output_tensors, output_shapes);
+        layer.process(&param, sizeof(param));
+        for (size_t i = 0; i < in.size(); i++) {
+            float expect = op.second(in[i]);
+            if (std::isnan(expect)) {
+                ASSERT_TRUE(std::isnan(out[i])) << "op " << op.first << " x " << in[i];
+            } else {
+                ASSERT_EQ(memcmp(&out[i], &expect, sizeof(float)), 0)
+                    << "op " << op.first << " x " << in[i] << " got " << out[i];
+            }
+        }
+    }
+}
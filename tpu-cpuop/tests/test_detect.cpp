@@ -0,0 +1,339 @@
+#include <gtest/gtest.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <map>
+#include <random>
+#include "cpu_ssd_detect_out.h"
+#include "cpu_yolov3_detect_out.h"
+#include "bbox_util_opt.hpp"
+
+/* The references below are the detection output loops the fused pipeline
+ * replaced: decode everything, then threshold, sort and nms. The layers must
+ * give exactly the same rows. */
+
+/* ssd: per class caffe nms on all decoded priors, then keep_top_k */
+static std::vector<float> ref_ssd(const cpu_ssd_detect_out_param_t& p, int num, int num_priors,
+                                  const float* loc_data, const float* conf_data,
+                                  const float* prior_data)
+{
+    using namespace bmcpu;
+    const int num_classes = p.num_classes_;
+    const int num_loc_classes = p.num_loc_classes_;
+    NormalizedBBoxOpt* all_loc_preds = NULL;
+    GetLocPredictions_opt(loc_data, num, num_priors, num_loc_classes, p.share_location_,
+                          all_loc_preds);
+    float* prior_bboxes = NULL;
+    float* prior_variances = NULL;
+    GetPriorBBoxes_opt(prior_data, num_priors, prior_bboxes, prior_variances);
+    NormalizedBBoxOpt* all_decode_bboxes = NULL;
+    float* all_decode_bboxes_area = NULL;
+    DecodeBBoxesAll_opt(all_loc_preds, prior_bboxes, prior_variances, num, p.share_location_,
+                        num_priors, num_loc_classes, p.background_label_id_,
+                        (CodeType)p.code_type_, p.variance_encoded_in_target_, false,
+                        all_decode_bboxes, all_decode_bboxes_area);
+    std::vector<float> rows;
+    for (int i = 0; i < num; ++i) {
+        std::map<int, std::vector<std::pair<float, int> > > indices;
+        int num_det = 0;
+        for (int c = 0; c < num_classes; ++c) {
+            int label = p.share_location_ ? 0 : c;
+            if (c == p.background_label_id_) continue;
+            const float* scores = conf_data + i * num_priors * num_classes + c;
+            int offset = label * num_priors + i * num_priors * num_loc_classes;
+            ApplyNMSFast_opt(all_decode_bboxes + offset, num_priors, all_decode_bboxes_area + offset,
+                             scores, p.confidence_threshold_, p.nms_threshold_, p.eta_, p.top_k_,
+                             num_classes, &indices[c]);
+            num_det += indices[c].size();
+        }
+        if (p.keep_top_k_ > -1 && num_det > p.keep_top_k_) {
+            std::vector<std::pair<float, std::pair<int, int> > > score_index_pairs;
+            for (auto& it : indices)
+                for (auto& s : it.second)
+                    score_index_pairs.push_back(std::make_pair(s.first, std::make_pair(it.first, s.second)));
+            std::sort(score_index_pairs.begin(), score_index_pairs.end(),
+                      SortScorePairDescend<std::pair<int, int> >);
+            score_index_pairs.resize(p.keep_top_k_);
+            std::map<int, std::vector<std::pair<float, int> > > new_indices;
+            for (auto& s : score_index_pairs)
+                new_indices[s.second.first].push_back(std::make_pair(s.first, s.second.second));
+            indices.swap(new_indices);
+        }
+        for (auto& it : indices) {
+            int label = p.share_location_ ? 0 : it.first;
+            const NormalizedBBoxOpt* bboxes = all_decode_bboxes + label * num_priors +
+                                              i * num_priors * num_loc_classes;
+            for (auto& s : it.second) {
+                const NormalizedBBoxOpt& bbox = bboxes[s.second];
+                float row[7] = {(float)i, (float)it.first, s.first,
+                                bbox.xmin, bbox.ymin, bbox.xmax, bbox.ymax};
+                rows.insert(rows.end(), row, row + 7);
+            }
+        }
+    }
+    if (num_loc_classes != 1) delete[] all_loc_preds;
+    delete[] all_decode_bboxes;
+    delete[] all_decode_bboxes_area;
+    return rows;
+}
+
+struct RefYoloBox {
+    float x, y, w, h, confidence;
+    int image, label;
+};
+
+static float ref_overlap(float x1, float w1, float x2, float w2)
+{
+    float l1 = x1 - w1 * 0.5f;
+    float l2 = x2 - w2 * 0.5f;
+    float left = l1 > l2 ? l1 : l2;
+    float r1 = x1 + w1 * 0.5f;
+    float r2 = x2 + w2 * 0.5f;
+    float right = r1 < r2 ? r1 : r2;
+    return right - left;
+}
+
+static float ref_yolo_iou(const RefYoloBox& a, const RefYoloBox& b)
+{
+    float w = ref_overlap(a.x, a.w, b.x, b.w);
+    float h = ref_overlap(a.y, a.h, b.y, b.h);
+    float i = (w < 0 || h < 0) ? 0 : w * h;
+    return i / (a.w * a.h + b.w * b.h - i);
+}
+
+/* yolov3: decode every anchor over the objectness threshold, then one
+ * stable sort and one greedy nms over all classes, 200 per image */
+static std::vector<float> ref_yolov3(const cpu_yolov3_detect_out_param_t& p,
+                                     const std::vector<std::vector<int> >& shapes,
+                                     const std::vector<float*>& inputs)
+{
+    const int num = shapes[0][0];
+    const int len = 4 + p.num_classes_ + 1;
+    const float po_thres = -std::log(1 / p.confidence_threshold_ - 1);
+    std::vector<float> rows;
+    for (int b = 0; b < num; b++) {
+        std::vector<RefYoloBox> predicts;
+        int mask_offset = 0;
+        for (int t = 0; t < p.num_inputs_; t++) {
+            int h = shapes[t][2], w = shapes[t][3], stride = h * w;
+            for (int n = 0; n < p.num_boxes_; n++) {
+                for (int cy = 0; cy < h; cy++) {
+                    for (int cx = 0; cx < w; cx++) {
+                        const float* d = inputs[t] + b * shapes[t][1] * stride + n * len * stride + cy * w + cx;
+                        if (d[4 * stride] <= po_thres) continue;
+                        std::vector<float> class_score;
+                        for (int c = 5; c < len; c++) class_score.push_back(d[c * stride]);
+                        auto best = std::max_element(class_score.begin(), class_score.end());
+                        float po = 1.0f / (1.0f + exp(-d[4 * stride]));
+                        float conf = po * (1.0f / (1.0f + exp(-*best)));
+                        if (!(conf > p.confidence_threshold_)) continue;
+                        float tx = 1.0f / (1.0f + exp(-d[0]));
+                        float ty = 1.0f / (1.0f + exp(-d[stride]));
+                        int mask = p.mask_[n + mask_offset];
+                        RefYoloBox box;
+                        box.x = (cx + tx) / w;
+                        box.y = (cy + ty) / h;
+                        box.w = exp(d[2 * stride]) * p.biases_[2 * mask] / (w * p.anchors_scale_[t]);
+                        box.h = exp(d[3 * stride]) * p.biases_[2 * mask + 1] / (h * p.anchors_scale_[t]);
+                        box.confidence = conf;
+                        box.image = b;
+                        box.label = best - class_score.begin();
+                        predicts.push_back(box);
+                    }
+                }
+            }
+            mask_offset += p.mask_group_size_;
+        }
+        std::stable_sort(predicts.begin(), predicts.end(), [](const RefYoloBox& l, const RefYoloBox& r) {
+            return l.confidence > r.confidence;
+        });
+        std::vector<bool> dropped(predicts.size(), false);
+        int kept = 0;
+        for (size_t i = 0; i < predicts.size(); i++) {
+            if (dropped[i]) continue;
+            for (size_t j = i + 1; j < predicts.size(); j++)
+                if (!dropped[j] && ref_yolo_iou(predicts[i], predicts[j]) >= p.nms_threshold_)
+                    dropped[j] = true;
+            if (kept++ == 200) break;
+            const RefYoloBox& r = predicts[i];
+            float row[7] = {(float)r.image, (float)r.label, r.confidence, r.x, r.y, r.w, r.h};
+            rows.insert(rows.end(), row, row + 7);
+        }
+    }
+    return rows;
+}
+
+static void expect_rows(const std::vector<float>& out, const std::vector<int>& shape,
+                        const std::vector<float>& expect, int num)
+{
+    ASSERT_EQ(shape.size(), 4u);
+    if (expect.empty()) {
+        ASSERT_EQ(shape[2], num);
+        for (int i = 0; i < num; i++) {
+            EXPECT_EQ(out[i * 7], i);
+            for (int j = 1; j < 7; j++) EXPECT_EQ(out[i * 7 + j], -1);
+        }
+        return;
+    }
+    ASSERT_EQ((size_t)shape[2] * 7, expect.size());
+    for (size_t i = 0; i < expect.size(); i++)
+        ASSERT_EQ(out[i], expect[i]) << "row " << i / 7 << " col " << i % 7;
+}
+
+/* priors clustered on a coarse grid so that the nms has work to do, scores
+ * on few levels so that the sorts meet ties */
+static void make_ssd_inputs(int num, int num_priors, int num_classes, int num_loc_classes,
+                            std::mt19937& rng, std::vector<float>& loc,
+                            std::vector<float>& conf, std::vector<float>& prior)
+{
+    std::uniform_real_distribution<float> u(0.f, 1.f);
+    std::normal_distribution<float> g(0.f, 0.5f);
+    prior.resize(num_priors * 8);
+    for (int i = 0; i < num_priors; i++) {
+        float cx = (rng() % 8 + 0.5f) / 8, cy = (rng() % 8 + 0.5f) / 8;
+        float w = 0.1f + 0.3f * u(rng), h = 0.1f + 0.3f * u(rng);
+        float* b = &prior[i * 4];
+        b[0] = cx - w / 2; b[1] = cy - h / 2; b[2] = cx + w / 2; b[3] = cy + h / 2;
+        float* v = &prior[num_priors * 4 + i * 4];
+        v[0] = v[1] = 0.1f; v[2] = v[3] = 0.2f;
+    }
+    loc.resize((size_t)num * num_priors * num_loc_classes * 4);
+    for (auto& x : loc) x = g(rng);
+    conf.resize((size_t)num * num_priors * num_classes);
+    for (auto& x : conf) {
+        float r = u(rng);
+        x = r < 0.9f ? r * 0.01f : (rng() % 64) / 64.f;
+    }
+}
+
+static void run_ssd(const cpu_ssd_detect_out_param_t& p, int num, int num_priors, int seed)
+{
+    std::mt19937 rng(seed);
+    std::vector<float> loc, conf, prior;
+    make_ssd_inputs(num, num_priors, p.num_classes_, p.num_loc_classes_, rng, loc, conf, prior);
+    std::vector<float> expect = ref_ssd(p, num, num_priors, loc.data(), conf.data(), prior.data());
+
+    bmcpu::cpu_ssd_detect_outlayer layer;
+    std::vector<std::vector<int> > input_shapes = {
+        {num, num_priors * p.num_loc_classes_ * 4}, {num, num_priors * p.num_classes_},
+        {1, 2, num_priors * 4}};
+    std::vector<std::vector<int> > output_shapes(1);
+    layer.reshape((void*)&p, sizeof(p), input_shapes, output_shapes);
+    std::vector<float> out(std::max((size_t)num * 7, expect.size()) + 7, 0.f);
+    std::vector<float*> input_tensors = {loc.data(), conf.data(), prior.data()};
+    std::vector<float*> output_tensors = {out.data()};
+    layer.set_common_param(input_tensors, input_shapes, output_tensors, output_shapes);
+    layer.process((void*)&p, sizeof(p));
+    expect_rows(out, output_shapes[0], expect, num);
+}
+
+static cpu_ssd_detect_out_param_t ssd_param(int num_classes)
+{
+    cpu_ssd_detect_out_param_t p;
+    memset(&p, 0, sizeof(p));
+    p.num_classes_ = num_classes;
+    p.share_location_ = true;
+    p.background_label_id_ = 0;
+    p.nms_threshold_ = 0.45f;
+    p.top_k_ = 400;
+    p.code_type_ = bmcpu::PriorBoxParameter_CodeType_CENTER_SIZE;
+    p.keep_top_k_ = 200;
+    p.confidence_threshold_ = 0.01f;
+    p.num_loc_classes_ = 1;
+    p.variance_encoded_in_target_ = false;
+    p.eta_ = 1.f;
+    return p;
+}
+
+TEST(DetectTest, ssdMatchesDecodeAll)
+{
+    cpu_ssd_detect_out_param_t p = ssd_param(21);
+    run_ssd(p, 1, 1203, 1);
+    run_ssd(p, 3, 500, 2);
+    // keep_top_k not reached
+    p.keep_top_k_ = 5000;
+    run_ssd(p, 2, 777, 3);
+    // no top_k, corner code, adaptive threshold
+    p.top_k_ = -1;
+    p.code_type_ = bmcpu::PriorBoxParameter_CodeType_CORNER;
+    p.eta_ = 0.9f;
+    p.keep_top_k_ = 100;
+    run_ssd(p, 2, 641, 4);
+}
+
+TEST(DetectTest, ssdNothingDetected)
+{
+    cpu_ssd_detect_out_param_t p = ssd_param(21);
+    p.confidence_threshold_ = 2.f;
+    run_ssd(p, 3, 300, 6);
+}
+
+static void run_yolov3(const cpu_yolov3_detect_out_param_t& p, int num, const std::vector<int>& grids,
+                       int seed)
+{
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> g(0.f, 1.f);
+    const int len = 5 + p.num_classes_;
+    std::vector<std::vector<int> > input_shapes;
+    std::vector<std::vector<float> > inputs;
+    for (int grid : grids) {
+        input_shapes.push_back({num, p.num_boxes_ * len, grid, grid});
+        std::vector<float> in((size_t)num * p.num_boxes_ * len * grid * grid);
+        for (size_t i = 0; i < in.size(); i++) {
+            int c = (i / (grid * grid)) % len;
+            // rare objects, class logits on few levels so that argmax ties
+            in[i] = c == 4 ? g(rng) * 2 - 3 : c > 4 ? (float)(rng() % 8) : g(rng);
+        }
+        inputs.push_back(in);
+    }
+    std::vector<float*> input_tensors;
+    for (auto& in : inputs) input_tensors.push_back(in.data());
+    std::vector<float> expect = ref_yolov3(p, input_shapes, input_tensors);
+
+    bmcpu::cpu_yolov3_detect_outlayer layer;
+    std::vector<std::vector<int> > output_shapes(1);
+    layer.reshape((void*)&p, sizeof(p), input_shapes, output_shapes);
+    std::vector<float> out((size_t)output_shapes[0][2] * 7, 0.f);
+    std::vector<float*> output_tensors = {out.data()};
+    layer.set_common_param(input_tensors, input_shapes, output_tensors, output_shapes);
+    layer.process((void*)&p, sizeof(p));
+    expect_rows(out, output_shapes[0], expect, num);
+}
+
+static cpu_yolov3_detect_out_param_t yolov3_param(int num_inputs, int num_classes)
+{
+    static const float biases[18] = {10, 13, 16, 30, 33, 23, 30, 61, 62, 45,
+                                     59, 119, 116, 90, 156, 198, 373, 326};
+    cpu_yolov3_detect_out_param_t p;
+    memset(&p, 0, sizeof(p));
+    p.num_inputs_ = num_inputs;
+    p.num_classes_ = num_classes;
+    p.num_boxes_ = 3;
+    p.confidence_threshold_ = 0.5f;
+    p.nms_threshold_ = 0.45f;
+    p.mask_group_size_ = 3;
+    memcpy(p.biases_, biases, sizeof(biases));
+    for (int i = 0; i < 3; i++) p.anchors_scale_[i] = 32 >> i;
+    for (int i = 0; i < 9; i++) p.mask_[i] = 8 - i;
+    return p;
+}
+
+TEST(DetectTest, yolov3MatchesDecodeAll)
+{
+    cpu_yolov3_detect_out_param_t p = yolov3_param(3, 80);
+    run_yolov3(p, 1, {13, 26, 52}, 11);
+    run_yolov3(p, 2, {13, 26, 52}, 12);
+    // many boxes over the threshold, so keep_top_k cuts
+    p.confidence_threshold_ = 0.05f;
+    p.nms_threshold_ = 0.7f;
+    run_yolov3(p, 2, {13, 26, 52}, 13);
+    p = yolov3_param(2, 3);
+    run_yolov3(p, 3, {7, 14}, 14);
+}
+
+TEST(DetectTest, yolov3NothingDetected)
+{
+    cpu_yolov3_detect_out_param_t p = yolov3_param(2, 20);
+    p.confidence_threshold_ = 0.9999f;
+    run_yolov3(p, 2, {5, 10}, 15);
+}
@@ -0,0 +1,291 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include "cpu_embedding.h"
+#include "cpu_embedding_bag.h"
+#include "cpu_gather.h"
+#include "cpu_gathernd.h"
+#include "cpu_gather_pytorch.h"
+#include "bmcpu_gather.hpp"
+#include "bmcpu_elementwise.hpp"
+
+/* the per element loop cpu_embedding_bag used before the gather engine,
+ * with empty bags zeroed as the engine does */
+static void old_embedding_bag(const float* weight, int num_embeddings, int dim,
+                              const int* indices, int num_indices, const int* offsets,
+                              int num_bags, EMB_MODE_T mode, float* output)
+{
+    for (int i = 0; i < num_bags; i++) {
+        int end = (i == num_bags - 1) ? num_indices : offsets[i + 1];
+        if (offsets[i] == end) memset(output + i * dim, 0, dim * sizeof(float));
+        for (int j = offsets[i]; j < end; j++) {
+            bool valid = indices[j] >= 0 && indices[j] < num_embeddings;
+            if (j == offsets[i]) {
+                if (valid)
+                    memcpy(output + i * dim, weight + indices[j] * dim, dim * sizeof(float));
+                else
+                    memset(output + i * dim, 0, dim * sizeof(float));
+                continue;
+            }
+            for (int k = 0; k < dim; k++) {
+                float weight_val = valid ? weight[indices[j] * dim + k] : 0.f;
+                output[i * dim + k] = (mode == EMB_MAX) ?
+                    std::max(output[i * dim + k], weight_val) :
+                    output[i * dim + k] + weight_val;
+            }
+            if (mode == EMB_MEAN && j == end - 1) {
+                for (int k = 0; k < dim; k++)
+                    output[i * dim + k] /= (end - offsets[i]);
+            }
+        }
+    }
+}
+
+static uint16_t to_bf16(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    if ((bits & 0x7fffffff) > 0x7f800000) return (bits >> 16) | 0x40;
+    bits += 0x7fff + ((bits >> 16) & 1);
+    return bits >> 16;
+}
+
+static float from_bf16(uint16_t h)
+{
+    uint32_t bits = (uint32_t)h << 16;
+    float f;
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+struct BagCase {
+    int num_embeddings, dim, num_bags, max_bag;
+};
+
+static void make_bags(const BagCase& c, std::mt19937& rng, std::vector<float>& weight,
+                      std::vector<int>& indices, std::vector<int>& offsets)
+{
+    std::normal_distribution<float> g(0.f, 1.f);
+    weight.resize((size_t)c.num_embeddings * c.dim);
+    for (auto& w : weight) w = g(rng);
+    // a few special values, as NaN and -0 must reduce as the old loop did
+    weight[0] = -0.f;
+    if (weight.size() > 5) weight[5] = std::numeric_limits<float>::quiet_NaN();
+    indices.clear();
+    offsets.clear();
+    for (int i = 0; i < c.num_bags; i++) {
+        offsets.push_back(indices.size());
+        int len = rng() % (c.max_bag + 1);
+        for (int j = 0; j < len; j++) {
+            int r = rng() % 20;
+            // out of the table now and then, also below 0
+            indices.push_back(r == 0 ? c.num_embeddings + 3 : r == 1 ? -2 : rng() % c.num_embeddings);
+        }
+    }
+}
+
+static bool same_float(float a, float b)
+{
+    return (std::isnan(a) && std::isnan(b)) || memcmp(&a, &b, sizeof(a)) == 0;
+}
+
+static const std::vector<BagCase> bag_cases = {
+    {1000, 64, 50, 20},
+    {300, 13, 40, 5},
+    {50, 3, 100, 3},
+    {2000, 129, 7, 60},
+};
+
+TEST(GatherTest, embeddingBagMatchesOldLoop)
+{
+    std::mt19937 rng(31);
+    for (auto& c : bag_cases) {
+        for (int mode = EMB_SUM; mode <= EMB_MAX; mode++) {
+            std::vector<float> weight;
+            std::vector<int> indices, offsets;
+            make_bags(c, rng, weight, indices, offsets);
+
+            std::vector<float> expect((size_t)c.num_bags * c.dim, 0.f);
+            old_embedding_bag(weight.data(), c.num_embeddings, c.dim, indices.data(), indices.size(),
+                              offsets.data(), c.num_bags, (EMB_MODE_T)mode, expect.data());
+
+            bmcpu::cpu_embedding_baglayer layer;
+            cpu_embedding_bag_param_t param;
+            memset(&param, 0, sizeof(param));
+            param.num_embeddings = c.num_embeddings;
+            param.embedding_dim = c.dim;
+            param.mode = (EMB_MODE_T)mode;
+            std::vector<std::vector<int>> input_shapes = {
+                {c.num_embeddings, c.dim}, {(int)indices.size()}, {c.num_bags}};
+            std::vector<std::vector<int>> output_shapes(1);
+            layer.reshape(&param, sizeof(param), input_shapes, output_shapes);
+            std::vector<float> out(expect.size(), 1.f);
+            std::vector<float*> input_tensors = {weight.data(), (float*)indices.data(),
+                                                 (float*)offsets.data()};
+            std::vector<float*> output_tensors = {out.data()};
+            layer.set_common_param(input_tensors, input_shapes, output_tensors, output_shapes);
+            layer.process(&param, sizeof(param));
+            for (size_t i = 0; i < out.size(); i++)
+                ASSERT_TRUE(same_float(out[i], expect[i])) << "mode " << mode << " at " << i
+                                                           << ": " << out[i] << " vs " << expect[i];
+        }
+    }
+}
+
+/* half precision tables reduce in fp32 and round once at the end */
+TEST(GatherTest, embeddingBagHalfWeights)
+{
+    std::mt19937 rng(32);
+    for (auto& c : bag_cases) {
+        for (int mode = EMB_SUM; mode <= EMB_MAX; mode++) {
+            std::vector<float> weight;
+            std::vector<int> indices, offsets;
+            make_bags(c, rng, weight, indices, offsets);
+            // every fp16 class: subnormals, large values, inf
+            weight[1] = 3e-6f;
+            weight[2] = -6.1e-5f;
+            weight[3] = 60000.f;
+            weight[4] = -std::numeric_limits<float>::infinity();
+            for (CPU_DATA_TYPE_T dtype : {CPU_DTYPE_FP16, CPU_DTYPE_BFP16}) {
+                std::vector<uint16_t> half(weight.size());
+                std::vector<float> widened(weight.size());
+                for (size_t i = 0; i < weight.size(); i++) {
+                    half[i] = dtype == CPU_DTYPE_FP16 ? bmcpu::fp32_to_fp16(weight[i]) : to_bf16(weight[i]);
+                    widened[i] = dtype == CPU_DTYPE_FP16 ? bmcpu::fp16_to_fp32(half[i]) : from_bf16(half[i]);
+                }
+                std::vector<float> expect((size_t)c.num_bags * c.dim, 0.f);
+                old_embedding_bag(widened.data(), c.num_embeddings, c.dim, indices.data(),
+                                  indices.size(), offsets.data(), c.num_bags, (EMB_MODE_T)mode,
+                                  expect.data());
+                std::vector<uint16_t> out(expect.size(), 0x1234);
+                bmcpu::embedding_bag(dtype, half.data(), c.num_embeddings, c.dim, indices.data(),
+                                     indices.size(), offsets.data(), c.num_bags, (EMB_MODE_T)mode,
+                                     out.data());
+                for (size_t i = 0; i < out.size(); i++) {
+                    uint16_t e = dtype == CPU_DTYPE_FP16 ? bmcpu::fp32_to_fp16(expect[i]) : to_bf16(expect[i]);
+                    ASSERT_EQ(out[i], e) << "dtype " << dtype << " mode " << mode << " at " << i;
+                }
+            }
+        }
+    }
+}
+
+TEST(GatherTest, embeddingLookup)
+{
+    std::mt19937 rng(33);
+    const int num = 500, dim = 24;
+    std::vector<float> weight(num * dim);
+    for (auto& w : weight) w = (float)(rng() % 1000);
+    std::vector<int> input = {3, 4, 5, 6, 499, 0, 0, 7, 1, 2, 3};
+    for (int i = 0; i < 200; i++) input.push_back(rng() % num);
+    bmcpu::cpu_embeddinglayer layer;
+    cpu_embedding_param_t param;
+    memset(&param, 0, sizeof(param));
+    std::vector<std::vector<int>> input_shapes = {{(int)input.size()}, {num, dim}};
+    std::vector<std::vector<int>> output_shapes(1);
+    layer.reshape(&param, sizeof(param), input_shapes, output_shapes);
+    std::vector<float> out(input.size() * dim);
+    std::vector<float*> input_tensors = {(float*)input.data(), weight.data()};
+    std::vector<float*> output_tensors = {out.data()};
+    layer.set_common_param(input_tensors, input_shapes, output_tensors, output_shapes);
+    layer.process(&param, sizeof(param));
+    for (size_t i = 0; i < input.size(); i++)
+        for (int k = 0; k < dim; k++)
+            ASSERT_EQ(out[i * dim + k], weight[input[i] * dim + k]);
+}
+
+TEST(GatherTest, gatherAxis)
+{
+    std::mt19937 rng(34);
+    const std::vector<int> shape = {3, 17, 5, 2};
+    std::vector<float> in(3 * 17 * 5 * 2);
+    for (size_t i = 0; i < in.size(); i++) in[i] = i;
+    for (int axis = 0; axis < 4; axis++) {
+        std::vector<int> index_shape = {2, 6};
+        std::vector<int> index(12);
+        for (int i = 0; i < 12; i++) index[i] = i < 4 ? i % shape[axis] : rng() % shape[axis];
+        bmcpu::cpu_gatherlayer layer;
+        cpu_gather_t param = {axis - 4};
+        std::vector<std::vector<int>> input_shapes = {shape, index_shape};
+        std::vector<std::vector<int>> output_shapes(1);
+        layer.reshape(&param, sizeof(param), input_shapes, output_shapes);
+        int outer = 1, inner = 1;
+        for (int d = 0; d < axis; d++) outer *= shape[d];
+        for (int d = axis + 1; d < 4; d++) inner *= shape[d];
+        std::vector<float> out(outer * 12 * inner);
+        std::vector<float*> input_tensors = {in.data(), (float*)index.data()};
+        std::vector<float*> output_tensors = {out.data()};
+        layer.set_common_param(input_tensors, input_shapes, output_tensors, output_shapes);
+        layer.process(&param, sizeof(param));
+        ASSERT_EQ(output_shapes[0].size(), 5u);
+        for (int o = 0; o < outer; o++)
+            for (int j = 0; j < 12; j++)
+                for (int k = 0; k < inner; k++)
+                    ASSERT_EQ(out[(o * 12 + j) * inner + k],
+                              in[(o * shape[axis] + index[j]) * inner + k]);
+    }
+}
+
+TEST(GatherTest, gatherNd)
+{
+    const std::vector<int> shape = {4, 6, 3, 5};
+    std::vector<float> in(4 * 6 * 3 * 5);
+    for (size_t i = 0; i < in.size(); i++) in[i] = i;
+    std::mt19937 rng(35);
+    for (int is_int = 0; is_int < 2; is_int++) {
+        const int m = 2, n = 9;
+        std::vector<int> idx(m * n);
+        for (int i = 0; i < n; i++) {
+            idx[i] = rng() % shape[0];
+            idx[n + i] = rng() % shape[1];
+        }
+        std::vector<float> idx_f(idx.begin(), idx.end());
+        bmcpu::cpu_gatherndlayer layer;
+        cpu_gathernd_t param;
+        param.indice_is_int = is_int;
+        param.batch_dims = 0;
+        std::vector<std::vector<int>> input_shapes = {shape, {m, n}};
+        std::vector<std::vector<int>> output_shapes(1);
+        layer.reshape(&param, sizeof(param), input_shapes, output_shapes);
+        std::vector<float> out(n * 15);
+        std::vector<float*> input_tensors = {in.data(), is_int ? (float*)idx.data() : idx_f.data()};
+        std::vector<float*> output_tensors = {out.data()};
+        layer.set_common_param(input_tensors, input_shapes, output_tensors, output_shapes);
+        layer.process(&param, sizeof(param));
+        ASSERT_EQ(output_shapes[0], std::vector<int>({n, 3, 5}));
+        for (int i = 0; i < n; i++)
+            for (int k = 0; k < 15; k++)
+                ASSERT_EQ(out[i * 15 + k], in[(idx[i] * 6 + idx[n + i]) * 15 + k]);
+    }
+}
+
+TEST(GatherTest, gatherElements)
+{
+    std::mt19937 rng(36);
+    const std::vector<int> shape = {4, 5, 6};
+    std::vector<float> in(4 * 5 * 6);
+    for (size_t i = 0; i < in.size(); i++) in[i] = i;
+    for (int axis = 0; axis < 3; axis++) {
+        const std::vector<int> index_shape = {3, 5, 4};
+        std::vector<int> index(3 * 5 * 4);
+        for (auto& x : index) x = rng() % shape[axis];
+        bmcpu::cpu_gather_ptlayer layer;
+        cpu_gather_t param = {axis};
+        std::vector<std::vector<int>> input_shapes = {shape, index_shape};
+        std::vector<std::vector<int>> output_shapes(1);
+        layer.reshape(&param, sizeof(param), input_shapes, output_shapes);
+        std::vector<float> out(index.size());
+        std::vector<float*> input_tensors = {in.data(), (float*)index.data()};
+        std::vector<float*> output_tensors = {out.data()};
+        layer.set_common_param(input_tensors, input_shapes, output_tensors, output_shapes);
+        layer.process(&param, sizeof(param));
+        for (int i = 0; i < 3; i++)
+            for (int j = 0; j < 5; j++)
+                for (int k = 0; k < 4; k++) {
+                    int pos[3] = {i, j, k};
+                    pos[axis] = index[(i * 5 + j) * 4 + k];
+                    ASSERT_EQ(out[(i * 5 + j) * 4 + k], in[(pos[0] * 5 + pos[1]) * 6 + pos[2]]);
+                }
+    }
+}
@@ -0,0 +1,687 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <queue>
+#include <random>
+#include "cpu_nms.h"
+#include "cpu_onnx_nms.h"
+#include "cpu_tensorflow_nms_v5.h"
+#include "cpu_box_nms.h"
+#include "cpu_box_with_nms_limit.h"
+#include "cpu_paddle_multiclass_nms.h"
+#include "bbox_util_opt.hpp"
+
+/* The references below are the per layer loops the nms kernel replaced,
+ * the layers must give exactly the same indices and scores. */
+
+/* tensorflow / onnx iou over [y1 x1 y2 x2] */
+static float ref_tf_iou(const float* box, int i, int j)
+{
+    const float* box_i = box + i * 4;
+    const float* box_j = box + j * 4;
+    const float ymax_i = (box_i[0] > box_i[2]) ? box_i[0] : box_i[2];
+    const float ymin_i = (box_i[0] < box_i[2]) ? box_i[0] : box_i[2];
+    const float xmax_i = (box_i[1] > box_i[3]) ? box_i[1] : box_i[3];
+    const float xmin_i = (box_i[1] < box_i[3]) ? box_i[1] : box_i[3];
+    const float ymax_j = (box_j[0] > box_j[2]) ? box_j[0] : box_j[2];
+    const float ymin_j = (box_j[0] < box_j[2]) ? box_j[0] : box_j[2];
+    const float xmax_j = (box_j[1] > box_j[3]) ? box_j[1] : box_j[3];
+    const float xmin_j = (box_j[1] < box_j[3]) ? box_j[1] : box_j[3];
+    const float area_i = (ymax_i - ymin_i) * (xmax_i - xmin_i);
+    if (area_i <= 0.f)
+        return 0.f;
+    const float area_j = (ymax_j - ymin_j) * (xmax_j - xmin_j);
+    if (area_j <= 0.f)
+        return 0.f;
+    const float ymax_inter = (ymax_i < ymax_j) ? ymax_i : ymax_j;
+    const float ymin_inter = (ymin_i > ymin_j) ? ymin_i : ymin_j;
+    const float y_inter = (ymax_inter > ymin_inter) ? (ymax_inter - ymin_inter) : 0;
+    if (y_inter == 0.f)
+        return 0.f;
+    const float xmax_inter = (xmax_i < xmax_j) ? xmax_i : xmax_j;
+    const float xmin_inter = (xmin_i > xmin_j) ? xmin_i : xmin_j;
+    const float x_inter = (xmax_inter > xmin_inter) ? (xmax_inter - xmin_inter) : 0;
+    if (x_inter == 0.f)
+        return 0.f;
+    const float area_inter = y_inter * x_inter;
+    return area_inter / (area_i + area_j - area_inter);
+}
+
+struct RefCandidate {
+    int box_index;
+    float score;
+    int begin_index;
+};
+struct RefCandidateLess {
+    bool operator()(const RefCandidate& i, const RefCandidate& j) const { return i.score < j.score; }
+};
+
+/* cpu_nms and cpu_tensorflow_nms_v5 */
+static void ref_tf_nms(const float* box, const float* score, int num, float iou_threshold,
+                       float score_threshold, float sigma, int max_output_size,
+                       std::vector<int>* selected_index, std::vector<float>* selected_score)
+{
+    std::priority_queue<RefCandidate, std::deque<RefCandidate>, RefCandidateLess> queue;
+    for (int i = 0; i < num; ++i)
+        if (score[i] > score_threshold)
+            queue.push(RefCandidate({i, score[i], 0}));
+    float scale = sigma > 0.f ? -.5f / sigma : 0.f;
+    while (selected_index->size() < max_output_size && !queue.empty()) {
+        RefCandidate next_cand = queue.top();
+        float original_score = next_cand.score;
+        queue.pop();
+        bool should_hard_suppress = false;
+        for (int i = (int)selected_index->size() - 1; i >= next_cand.begin_index; --i) {
+            float iou = ref_tf_iou(box, next_cand.box_index, (*selected_index)[i]);
+            next_cand.score *= iou <= iou_threshold ? std::exp(scale * iou * iou) : 0.f;
+            if (iou >= iou_threshold) {
+                should_hard_suppress = true;
+                break;
+            }
+            if (next_cand.score <= score_threshold)
+                break;
+        }
+        next_cand.begin_index = selected_index->size();
+        if (!should_hard_suppress) {
+            if (next_cand.score == original_score) {
+                selected_index->push_back(next_cand.box_index);
+                selected_score->push_back(next_cand.score);
+            }
+            if (next_cand.score > score_threshold)
+                queue.push(next_cand);
+        }
+    }
+}
+
+/* one (batch, class) of cpu_onnx_nms */
+static std::vector<int> ref_onnx_nms(const float* box, const float* score, int num,
+                                     float iou_threshold, float score_threshold, int max_output_size)
+{
+    std::priority_queue<RefCandidate, std::deque<RefCandidate>, RefCandidateLess> queue;
+    for (int i = 0; i < num; ++i)
+        if (score[i] > score_threshold)
+            queue.push(RefCandidate({i, score[i], 0}));
+    std::vector<int> selected_index;
+    while (selected_index.size() < max_output_size && !queue.empty()) {
+        RefCandidate next_cand = queue.top();
+        queue.pop();
+        bool selected = true;
+        for (int i = (int)selected_index.size() - 1; i >= 0; --i) {
+            float iou = ref_tf_iou(box, next_cand.box_index, selected_index[i]);
+            if (iou > iou_threshold && iou != 0.f) {
+                selected = false;
+                break;
+            }
+        }
+        if (selected)
+            selected_index.push_back(next_cand.box_index);
+    }
+    return selected_index;
+}
+
+/* one class of cpu_box_with_nms_limit */
+static std::vector<int> ref_caffe2_nms(const float* scores, int scores_stride, int num,
+                                       const float* boxes, int boxes_stride, float score_thres,
+                                       float nms_thres, int legacy_plus_one)
+{
+    std::vector<int> inds, keep;
+    for (int i = 0; i < num; ++i)
+        if (scores[i * scores_stride] > score_thres)
+            inds.push_back(i);
+    std::sort(inds.begin(), inds.end(), [&](int lhs, int rhs) {
+        return scores[lhs * scores_stride] > scores[rhs * scores_stride];
+    });
+    std::vector<float> areas(num);
+    for (int i = 0; i < num; ++i) {
+        const float* b = boxes + i * boxes_stride;
+        areas[i] = (b[2] - b[0] + legacy_plus_one) * (b[3] - b[1] + legacy_plus_one);
+    }
+    std::vector<int> order = inds;
+    while (order.size() > 0) {
+        int i = order[0];
+        keep.push_back(i);
+        const float* ib = boxes + i * boxes_stride;
+        std::vector<int> new_order;
+        for (size_t o = 1; o < order.size(); ++o) {
+            const float* biter = boxes + order[o] * boxes_stride;
+            float w = std::max(std::min(biter[2], ib[2]) - std::max(biter[0], ib[0]) + legacy_plus_one, 0.f);
+            if (w == 0.f) {
+                new_order.push_back(order[o]);
+                continue;
+            }
+            float h = std::max(std::min(biter[3], ib[3]) - std::max(biter[1], ib[1]) + legacy_plus_one, 0.f);
+            if (h == 0.f) {
+                new_order.push_back(order[o]);
+                continue;
+            }
+            float inter = w * h;
+            float ovr = inter / (areas[i] + areas[order[o]] - inter);
+            if (ovr <= nms_thres)
+                new_order.push_back(order[o]);
+        }
+        order = new_order;
+    }
+    return keep;
+}
+
+/* the caffe ssd loop of ApplyNMSFast_opt */
+static float ref_caffe_iou(const float* b1, float a1, const float* b2, float a2)
+{
+    if (b2[0] > b1[2] || b2[2] < b1[0] || b2[1] > b1[3] || b2[3] < b1[1])
+        return 0.f;
+    float w = std::min(b1[2], b2[2]) - std::max(b1[0], b2[0]);
+    float h = std::min(b1[3], b2[3]) - std::max(b1[1], b2[1]);
+    if (w > 0 && h > 0) {
+        float inter = w * h;
+        return inter / (a1 + a2 - inter);
+    }
+    return 0.f;
+}
+
+/* paddle multiclass and bbox_util ApplyNMSFast(float*) */
+static float ref_paddle_area(const float* box, bool normalized)
+{
+    if (box[2] < box[0] || box[3] < box[1])
+        return 0.f;
+    const float w = box[2] - box[0];
+    const float h = box[3] - box[1];
+    return normalized ? w * h : (w + 1) * (h + 1);
+}
+
+static float ref_paddle_iou(const float* box1, const float* box2, bool normalized)
+{
+    if (box2[0] > box1[2] || box2[2] < box1[0] || box2[1] > box1[3] || box2[3] < box1[1])
+        return 0.f;
+    const float inter_xmin = std::max(box1[0], box2[0]);
+    const float inter_ymin = std::max(box1[1], box2[1]);
+    const float inter_xmax = std::min(box1[2], box2[2]);
+    const float inter_ymax = std::min(box1[3], box2[3]);
+    float norm = normalized ? 0.f : 1.f;
+    const float inter_area = (inter_xmax - inter_xmin + norm) * (inter_ymax - inter_ymin + norm);
+    return inter_area / (ref_paddle_area(box1, normalized) + ref_paddle_area(box2, normalized) - inter_area);
+}
+
+/* greedy loop with the adaptive threshold, order is already sorted */
+template<typename IOU>
+static std::vector<int> ref_greedy(const std::vector<int>& order, float nms_threshold, float eta, IOU iou)
+{
+    std::vector<int> kept;
+    float adaptive_threshold = nms_threshold;
+    for (int idx : order) {
+        bool keep = true;
+        for (size_t k = 0; k < kept.size() && keep; ++k)
+            keep = iou(idx, kept[k]) <= adaptive_threshold;
+        if (keep)
+            kept.push_back(idx);
+        if (keep && eta < 1 && adaptive_threshold > 0.5)
+            adaptive_threshold *= eta;
+    }
+    return kept;
+}
+
+class NmsTest : public ::testing::Test {
+protected:
+    std::mt19937 rng{2024};
+
+    /* overlapping boxes around a few centers, [x1 y1 x2 y2] */
+    std::vector<float> random_boxes(int num, float extent, bool degenerate)
+    {
+        std::uniform_real_distribution<float> center(0.f, extent);
+        std::uniform_real_distribution<float> size(0.02f * extent, 0.2f * extent);
+        std::uniform_real_distribution<float> jitter(-0.05f * extent, 0.05f * extent);
+        std::vector<float> cx(8), cy(8);
+        for (int i = 0; i < 8; i++) {
+            cx[i] = center(rng);
+            cy[i] = center(rng);
+        }
+        std::vector<float> boxes(num * 4);
+        for (int i = 0; i < num; i++) {
+            float x = cx[i % 8] + jitter(rng), y = cy[i % 8] + jitter(rng);
+            float w = size(rng), h = size(rng);
+            float* b = &boxes[i * 4];
+            b[0] = x - w / 2;
+            b[1] = y - h / 2;
+            b[2] = x + w / 2;
+            b[3] = y + h / 2;
+            if (degenerate && rng() % 10 == 0) {
+                switch (rng() % 3) {
+                case 0: b[2] = b[0]; break;                 /* no width */
+                case 1: std::swap(b[1], b[3]); break;       /* inverted */
+                default: b[0] = boxes[0] + boxes[2] - boxes[0]; break;  /* touches box 0 */
+                }
+            }
+        }
+        return boxes;
+    }
+
+    /* distinct scores in random order, so ties never decide the order */
+    std::vector<float> random_scores(int num)
+    {
+        std::vector<float> scores(num);
+        for (int i = 0; i < num; i++)
+            scores[i] = (i + 1.f) / (num + 1.f);
+        std::shuffle(scores.begin(), scores.end(), rng);
+        return scores;
+    }
+
+    /* [x1 y1 x2 y2] to [y1 x1 y2 x2] with the corners in random order */
+    std::vector<float> to_tf_boxes(const std::vector<float>& boxes)
+    {
+        std::vector<float> tf(boxes.size());
+        for (size_t i = 0; i < boxes.size(); i += 4) {
+            bool flip_y = rng() % 2, flip_x = rng() % 2;
+            tf[i] = flip_y ? boxes[i + 3] : boxes[i + 1];
+            tf[i + 2] = flip_y ? boxes[i + 1] : boxes[i + 3];
+            tf[i + 1] = flip_x ? boxes[i + 2] : boxes[i];
+            tf[i + 3] = flip_x ? boxes[i] : boxes[i + 2];
+        }
+        return tf;
+    }
+
+    static void run_layer(bmcpu::cpu_layer& layer, void* param, int param_size,
+                          std::vector<float*> inputs, std::vector<std::vector<int>> input_shapes,
+                          std::vector<float*> outputs, std::vector<std::vector<int>>& output_shapes)
+    {
+        layer.set_common_param(inputs, input_shapes, outputs, output_shapes);
+        layer.process(param, param_size);
+    }
+};
+
+TEST_F(NmsTest, tensorflowNms)
+{
+    const int num = 500;
+    for (float thr : {0.3f, 0.5f, 0.7f}) {
+        std::vector<float> boxes = to_tf_boxes(random_boxes(num, 100.f, false));
+        std::vector<float> scores = random_scores(num);
+        int max_output = 100;
+        std::vector<int> out(num);
+        cpu_nms_t param = {thr, 0.2f, max_output};
+        std::vector<std::vector<int>> output_shapes = {{num}};
+        bmcpu::cpu_nmslayer layer;
+        run_layer(layer, &param, sizeof(param),
+                  {boxes.data(), scores.data(), (float*)&max_output}, {{num, 4}, {num}, {1}},
+                  {(float*)out.data()}, output_shapes);
+        std::vector<int> expect;
+        std::vector<float> expect_score;
+        ref_tf_nms(boxes.data(), scores.data(), num, thr, 0.2f, 0.f, max_output, &expect, &expect_score);
+        out.resize(output_shapes[0][0]);
+        ASSERT_FALSE(expect.empty());
+        ASSERT_EQ(out, expect);
+    }
+}
+
+TEST_F(NmsTest, tensorflowNmsV5)
+{
+    const int num = 400;
+    for (float sigma : {0.f, 0.5f}) {
+        std::vector<float> boxes = to_tf_boxes(random_boxes(num, 1.f, false));
+        std::vector<float> scores = random_scores(num);
+        int max_output = 150;
+        std::vector<int> out_index(max_output);
+        std::vector<float> out_score(max_output);
+        cpu_tensorflow_nms_v5_param_t param = {0.6f, 0.1f, sigma, false, max_output};
+        std::vector<std::vector<int>> output_shapes = {{max_output}, {max_output}};
+        bmcpu::cpu_tensorflow_nms_v5layer layer;
+        run_layer(layer, &param, sizeof(param),
+                  {boxes.data(), scores.data(), (float*)&max_output}, {{num, 4}, {num}, {1}},
+                  {(float*)out_index.data(), out_score.data()}, output_shapes);
+        std::vector<int> expect;
+        std::vector<float> expect_score;
+        ref_tf_nms(boxes.data(), scores.data(), num, 0.6f, 0.1f, sigma, max_output, &expect, &expect_score);
+        out_index.resize(output_shapes[0][0]);
+        out_score.resize(output_shapes[1][0]);
+        ASSERT_EQ(out_index, expect);
+        ASSERT_EQ(0, memcmp(out_score.data(), expect_score.data(), expect_score.size() * sizeof(float)));
+    }
+}
+
+/* a box without area has iou 0 even with itself, it must not come back */
+TEST_F(NmsTest, tensorflowNmsZeroArea)
+{
+    std::vector<float> boxes = {0.f, 0.f, 1.f, 1.f,
+                                0.5f, 0.5f, 0.5f, 2.f,
+                                0.f, 0.f, 1.f, 1.f};
+    std::vector<float> scores = {0.9f, 0.8f, 0.7f};
+    std::vector<int> selected;
+    bmcpu::NmsParam param = {bmcpu::NMS_IOU_TF, 0.5f, 1.f, 0.f, false};
+    for (bmcpu::NmsMode mode : {bmcpu::NMS_HARD, bmcpu::NMS_SOFT_GAUSSIAN}) {
+        bmcpu::ApplyNMSQueue_opt(param, mode, 0.5f, boxes.data(), scores.data(), 3, 0.f, 3,
+                                 &selected, NULL);
+        ASSERT_EQ(selected, std::vector<int>({0, 1}));
+    }
+}
+
+TEST_F(NmsTest, softLinear)
+{
+    /* the second box has iou 1/3 with the first one */
+    std::vector<float> boxes = {0.f, 0.f, 2.f, 2.f,
+                                0.f, 1.f, 2.f, 3.f,
+                                10.f, 10.f, 11.f, 11.f};
+    std::vector<float> scores = {0.9f, 0.8f, 0.6f};
+    std::vector<int> selected;
+    std::vector<float> selected_scores;
+    bmcpu::NmsParam param = {bmcpu::NMS_IOU_TF, 0.3f, 1.f, 0.f, false};
+    bmcpu::ApplyNMSQueue_opt(param, bmcpu::NMS_SOFT_LINEAR, 0.f, boxes.data(), scores.data(), 3,
+                             0.f, 3, &selected, &selected_scores);
+    ASSERT_EQ(selected, std::vector<int>({0, 2, 1}));
+    EXPECT_FLOAT_EQ(selected_scores[2], 0.8f * (1.f - 1.f / 3.f));
+    param.iou_threshold = 0.4f;
+    bmcpu::ApplyNMSQueue_opt(param, bmcpu::NMS_SOFT_LINEAR, 0.f, boxes.data(), scores.data(), 3,
+                             0.f, 3, &selected, &selected_scores);
+    ASSERT_EQ(selected, std::vector<int>({0, 1, 2}));
+}
+
+TEST_F(NmsTest, onnxNms)
+{
+    const int batch = 2, num_class = 3, num = 300;
+    std::vector<float> boxes, scores;
+    for (int n = 0; n < batch; n++) {
+        std::vector<float> b = to_tf_boxes(random_boxes(num, 50.f, true));
+        boxes.insert(boxes.end(), b.begin(), b.end());
+        for (int c = 0; c < num_class; c++) {
+            std::vector<float> s = random_scores(num);
+            scores.insert(scores.end(), s.begin(), s.end());
+        }
+    }
+    int max_output = 40;
+    float iou_threshold = 0.45f, score_threshold = 0.05f;
+    cpu_onnx_nms_param_t param = {0, max_output};
+    std::vector<int> out(max_output * batch * num_class * 3);
+    std::vector<std::vector<int>> output_shapes = {{max_output * batch * num_class, 3}};
+    bmcpu::cpu_onnx_nmslayer layer;
+    run_layer(layer, &param, sizeof(param),
+              {boxes.data(), scores.data(), (float*)&max_output, &iou_threshold, &score_threshold},
+              {{batch, num, 4}, {batch, num_class, num}, {1}, {1}, {1}},
+              {(float*)out.data()}, output_shapes);
+    std::vector<int> expect;
+    for (int n = 0; n < batch; n++) {
+        for (int c = 0; c < num_class; c++) {
+            std::vector<int> sel = ref_onnx_nms(&boxes[n * num * 4], &scores[(n * num_class + c) * num],
+                                                num, iou_threshold, score_threshold, max_output);
+            for (int i : sel) {
+                expect.push_back(n);
+                expect.push_back(c);
+                expect.push_back(i);
+            }
+        }
+    }
+    out.resize(output_shapes[0][0] * 3);
+    ASSERT_EQ(out, expect);
+}
+
+TEST_F(NmsTest, boxWithNmsLimit)
+{
+    const int num = 300, num_classes = 4;
+    for (bool legacy_plus_one : {false, true}) {
+        std::vector<float> scores(num * num_classes), boxes;
+        for (int j = 0; j < num_classes; j++) {
+            std::vector<float> s = random_scores(num);
+            for (int i = 0; i < num; i++)
+                scores[i * num_classes + j] = s[i];
+        }
+        std::vector<std::vector<float>> class_boxes(num_classes);
+        for (int j = 0; j < num_classes; j++)
+            class_boxes[j] = random_boxes(num, 200.f, true);
+        for (int i = 0; i < num; i++)
+            for (int j = 0; j < num_classes; j++)
+                boxes.insert(boxes.end(), &class_boxes[j][i * 4], &class_boxes[j][i * 4 + 4]);
+        float batch_splits = num;
+        cpu_box_with_nms_limit_param_t param = {};
+        param.score_thresh = 0.3f;
+        param.nms = 0.5f;
+        param.detections_per_im = num * num_classes;
+        param.input_boxes_include_bg_cls = true;
+        param.output_classes_include_bg_cls = true;
+        param.legacy_plus_one = legacy_plus_one;
+        const int total = num * num_classes;
+        std::vector<float> out_scores(total), out_boxes(total * 4), out_classes(total), out_batch(1);
+        std::vector<int> out_keeps(total), out_keeps_size(num_classes);
+        std::vector<std::vector<int>> output_shapes(6);
+        bmcpu::cpu_box_with_nms_limitlayer layer;
+        run_layer(layer, &param, sizeof(param),
+                  {scores.data(), boxes.data(), &batch_splits},
+                  {{num, num_classes}, {num, num_classes * 4}, {1}},
+                  {out_scores.data(), out_boxes.data(), out_classes.data(), out_batch.data(),
+                   (float*)out_keeps.data(), (float*)out_keeps_size.data()}, output_shapes);
+        std::vector<int> expect, expect_size(num_classes, 0);
+        for (int j = 1; j < num_classes; j++) {
+            std::vector<int> keep = ref_caffe2_nms(&scores[j], num_classes, num,
+                                                   &boxes[j * 4], num_classes * 4, 0.3f, 0.5f,
+                                                   legacy_plus_one);
+            expect.insert(expect.end(), keep.begin(), keep.end());
+            expect_size[j] = keep.size();
+        }
+        out_keeps.resize(output_shapes[4][0]);
+        ASSERT_EQ(out_keeps, expect);
+        ASSERT_EQ(out_keeps_size, expect_size);
+    }
+}
+
+TEST_F(NmsTest, boxNms)
+{
+    const int batch = 2, num = 200, stride = 6;
+    for (int in_format : {BOX_FORMAT_CORNER, BOX_FORMAT_CENTER}) {
+        for (int force_suppress : {0, 1}) {
+            std::vector<float> in(batch * num * stride);
+            for (int n = 0; n < batch; n++) {
+                std::vector<float> boxes = random_boxes(num, 100.f, true);
+                std::vector<float> scores = random_scores(num);
+                for (int i = 0; i < num; i++) {
+                    float* item = &in[(n * num + i) * stride];
+                    const float* b = &boxes[i * 4];
+                    item[0] = rng() % 3;
+                    item[1] = scores[i];
+                    if (in_format == BOX_FORMAT_CORNER) {
+                        memcpy(item + 2, b, 4 * sizeof(float));
+                    } else {
+                        item[2] = (b[0] + b[2]) / 2;
+                        item[3] = (b[1] + b[3]) / 2;
+                        item[4] = b[2] - b[0];
+                        item[5] = b[3] - b[1];
+                    }
+                }
+            }
+            cpu_box_nms_param_t param = {0.5f, 0.1f, 150, 2, 1, 0, -1, force_suppress, in_format, in_format};
+            std::vector<float> out(in.size());
+            std::vector<std::vector<int>> output_shapes(1);
+            bmcpu::cpu_boxnmslayer layer;
+            run_layer(layer, &param, sizeof(param), {in.data()}, {{batch, num, stride}},
+                      {out.data()}, output_shapes);
+
+            /* the mxnet rule: topk boxes of every batch by score, kept centric marking */
+            std::vector<float> expect(in.size(), -1.f);
+            for (int n = 0; n < batch; n++) {
+                std::vector<int> order;
+                for (int i = 0; i < num; i++) {
+                    const float* item = &in[(n * num + i) * stride];
+                    if (item[1] > param.valid_thresh)
+                        order.push_back(i);
+                }
+                std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+                    return in[(n * num + a) * stride + 1] > in[(n * num + b) * stride + 1];
+                });
+                if (order.size() > (size_t)param.topk)
+                    order.resize(param.topk);
+                auto corners = [&](int i, float* c) {
+                    const float* b = &in[(n * num + i) * stride + 2];
+                    if (in_format == BOX_FORMAT_CORNER) {
+                        memcpy(c, b, 4 * sizeof(float));
+                    } else {
+                        int w_half = b[2] / 2, h_half = b[3] / 2;
+                        c[0] = b[0] - w_half;
+                        c[1] = b[1] - h_half;
+                        c[2] = b[0] + w_half;
+                        c[3] = b[1] + h_half;
+                    }
+                };
+                auto area = [&](int i) {
+                    const float* b = &in[(n * num + i) * stride + 2];
+                    float w = in_format == BOX_FORMAT_CORNER ? b[2] - b[0] : b[2];
+                    float h = in_format == BOX_FORMAT_CORNER ? b[3] - b[1] : b[3];
+                    return (w < 0 || h < 0) ? 0.f : h * w;
+                };
+                std::vector<bool> removed(order.size(), false);
+                for (size_t r = 0; r < order.size(); r++) {
+                    if (removed[r]) continue;
+                    for (size_t p = r + 1; p < order.size(); p++) {
+                        if (removed[p]) continue;
+                        int ref_id = in[(n * num + order[r]) * stride];
+                        int pos_id = in[(n * num + order[p]) * stride];
+                        if (!force_suppress && ref_id != pos_id) continue;
+                        float c0[4], c1[4];
+                        corners(order[r], c0);
+                        corners(order[p], c1);
+                        float left = std::max(c0[0], c1[0]), top = std::max(c0[1], c1[1]);
+                        float right = std::min(c0[2], c1[2]), bottom = std::min(c0[3], c1[3]);
+                        float overlap = (left > right || top > bottom) ? 0.f : (right - left) * (bottom - top);
+                        float iou = overlap / (area(order[r]) + area(order[p]) - overlap);
+                        if (iou > param.overlap_thresh)
+                            removed[p] = true;
+                    }
+                }
+                int count = 0;
+                for (size_t r = 0; r < order.size(); r++) {
+                    if (removed[r]) continue;
+                    memcpy(&expect[(n * num + count) * stride], &in[(n * num + order[r]) * stride],
+                           stride * sizeof(float));
+                    count++;
+                }
+            }
+            ASSERT_EQ(0, memcmp(out.data(), expect.data(), out.size() * sizeof(float)));
+        }
+    }
+}
+
+/* the paddle layer and bbox_util ApplyNMSFast(float*) share this rule */
+class PaddleNmsProbe : public bmcpu::cpu_paddle_multiclass_nmslayer {
+public:
+    PaddleNmsProbe(int num, float nms_threshold, float eta, bool normalized)
+    {
+        score_threshold_ = 0.1f;
+        nms_threshold_ = nms_threshold;
+        nms_eta_ = eta;
+        nms_top_k_ = 250;
+        normalized_ = normalized;
+        boxes_dims_ = {1, num, 4};
+    }
+    using bmcpu::cpu_paddle_multiclass_nmslayer::NMSFast;
+};
+
+TEST_F(NmsTest, paddleNms)
+{
+    const int num = 400;
+    for (bool normalized : {true, false}) {
+        for (float eta : {1.f, 0.9f}) {
+            std::vector<float> boxes = random_boxes(num, normalized ? 1.f : 300.f, true);
+            std::vector<float> scores = random_scores(num);
+            PaddleNmsProbe probe(num, 0.7f, eta, normalized);
+            std::vector<int> out;
+            probe.NMSFast(boxes.data(), scores.data(), &out);
+
+            std::vector<std::pair<float, int>> order;
+            for (int i = 0; i < num; i++)
+                if (scores[i] > 0.1f)
+                    order.push_back(std::make_pair(scores[i], i));
+            std::sort(order.begin(), order.end(),
+                      [](const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first > b.first; });
+            order.resize(std::min<size_t>(order.size(), 250));
+            std::vector<int> idx;
+            for (auto& o : order) idx.push_back(o.second);
+            std::vector<int> expect = ref_greedy(idx, 0.7f, eta, [&](int i, int k) {
+                return ref_paddle_iou(&boxes[i * 4], &boxes[k * 4], normalized);
+            });
+            ASSERT_EQ(out, expect);
+
+            if (normalized) {
+                std::vector<int> bbox_util_out;
+                bmcpu::ApplyNMSFast(boxes.data(), scores.data(), num, 0.1f, 0.7f, eta, 250, &bbox_util_out);
+                ASSERT_EQ(bbox_util_out, expect);
+            }
+        }
+    }
+}
+
+TEST_F(NmsTest, ssdNms)
+{
+    const int num = 1000, num_classes = 3;
+    for (float eta : {1.f, 0.8f}) {
+        std::vector<float> boxes = random_boxes(num, 1.f, true);
+        std::vector<float> areas(num);
+        for (int i = 0; i < num; i++) {
+            const float* b = &boxes[i * 4];
+            areas[i] = std::max(0.f, b[2] - b[0]) * std::max(0.f, b[3] - b[1]);
+        }
+        std::vector<float> scores(num * num_classes);
+        for (int c = 0; c < num_classes; c++) {
+            std::vector<float> s = random_scores(num);
+            for (int i = 0; i < num; i++)
+                scores[i * num_classes + c] = s[i];
+        }
+        for (int c = 0; c < num_classes; c++) {
+            std::vector<std::pair<float, int>> out;
+            bmcpu::ApplyNMSFast_opt((const bmcpu::NormalizedBBoxOpt*)boxes.data(), num, areas.data(),
+                                    scores.data() + c, 0.2f, 0.45f, eta, 400, num_classes, &out);
+
+            std::vector<std::pair<float, int>> order;
+            for (int i = 0; i < num; i++)
+                if (scores[i * num_classes + c] > 0.2f)
+                    order.push_back(std::make_pair(scores[i * num_classes + c], i));
+            std::stable_sort(order.begin(), order.end(), bmcpu::SortScorePairDescend<int>);
+            order.resize(std::min<size_t>(order.size(), 400));
+            std::vector<int> idx;
+            for (auto& o : order) idx.push_back(o.second);
+            std::vector<int> expect = ref_greedy(idx, 0.45f, eta, [&](int i, int k) {
+                return ref_caffe_iou(&boxes[i * 4], areas[i], &boxes[k * 4], areas[k]);
+            });
+            ASSERT_EQ(out.size(), expect.size());
+            for (size_t i = 0; i < out.size(); i++) {
+                ASSERT_EQ(out[i].second, expect[i]);
+                ASSERT_EQ(out[i].first, scores[expect[i] * num_classes + c]);
+            }
+
+            std::vector<bmcpu::NormalizedBBox> nboxes(num);
+            std::vector<float> class_scores(num);
+            for (int i = 0; i < num; i++) {
+                nboxes[i].set_xmin(boxes[i * 4]);
+                nboxes[i].set_ymin(boxes[i * 4 + 1]);
+                nboxes[i].set_xmax(boxes[i * 4 + 2]);
+                nboxes[i].set_ymax(boxes[i * 4 + 3]);
+                class_scores[i] = scores[i * num_classes + c];
+            }
+            std::vector<int> bbox_util_out;
+            bmcpu::ApplyNMSFast(nboxes, class_scores, 0.2f, 0.45f, eta, 400, &bbox_util_out);
+            std::vector<int> expect_nb = ref_greedy(idx, 0.45f, eta, [&](int i, int k) {
+                return ref_caffe_iou(&boxes[i * 4], bmcpu::BBoxSize(nboxes[i]),
+                                     &boxes[k * 4], bmcpu::BBoxSize(nboxes[k]));
+            });
+            ASSERT_EQ(bbox_util_out, expect_nb);
+        }
+    }
+}
+
+/* more kept boxes than one SIMD step, with every tail length */
+TEST_F(NmsTest, kernelTail)
+{
+    bmcpu::NmsParam param = {bmcpu::NMS_IOU_CAFFE2, 0.5f, 1.f, 0.f, false};
+    for (int n = 1; n <= 19; n++) {
+        bmcpu::NmsKernel kernel(param);
+        for (int i = 0; i < n; i++) {
+            float box[4] = {i * 10.f, 0.f, i * 10.f + 5.f, 5.f};
+            ASSERT_TRUE(kernel.offer(kernel.load(box)));
+        }
+        for (int i = 0; i < n; i++) {
+            float box[4] = {i * 10.f + 1.f, 0.f, i * 10.f + 5.f, 5.f};
+            ASSERT_FALSE(kernel.offer(kernel.load(box)));
+        }
+        float far[4] = {1000.f, 0.f, 1005.f, 5.f};
+        ASSERT_TRUE(kernel.offer(kernel.load(far)));
+        std::vector<float> iou(kernel.kept_num());
+        float box[4] = {(n - 1) * 10.f, 0.f, (n - 1) * 10.f + 5.f, 5.f};
+        kernel.iou(kernel.load(box), 0, kernel.kept_num(), iou.data());
+        for (int i = 0; i < kernel.kept_num(); i++)
+            ASSERT_EQ(iou[i], i == n - 1 ? 1.f : 0.f);
+        ASSERT_EQ(kernel.kept_num(), n + 1);
+    }
+}
@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <algorithm>
+#include <climits>
+#include <numeric>
+#include <random>
+#include "cpu_sort_per_dim.h"
+#include "cpu_argsortlayer.h"
+#include "bmcpu_sort.hpp"
+
+static size_t shape_num(const std::vector<int>& shape)
+{
+    size_t n = 1;
+    for (int s : shape) n *= s;
+    return n;
+}
+
+/* stable_sort of every lane, the way cpu_sort_per_dim did it with stable set */
+template<typename T>
+static void ref_sort(const std::vector<T>& in, const std::vector<int>& shape, int axis,
+                     bool descending, std::vector<int>& index, std::vector<T>& out)
+{
+    int outer = 1, inner = 1, len = shape[axis];
+    for (int i = 0; i < axis; i++) outer *= shape[i];
+    for (size_t i = axis + 1; i < shape.size(); i++) inner *= shape[i];
+    index.assign(in.size(), 0);
+    out.assign(in.size(), T());
+    for (int o = 0; o < outer; o++) {
+        for (int i = 0; i < inner; i++) {
+            size_t base = (size_t)o * len * inner + i;
+            std::vector<int> idx(len);
+            std::iota(idx.begin(), idx.end(), 0);
+            std::stable_sort(idx.begin(), idx.end(), [&](int a, int b) {
+                return descending ? in[base + a * inner] > in[base + b * inner]
+                                  : in[base + a * inner] < in[base + b * inner];
+            });
+            for (int j = 0; j < len; j++) {
+                index[base + j * inner] = idx[j];
+                out[base + j * inner] = in[base + idx[j] * inner];
+            }
+        }
+    }
+}
+
+static const std::vector<std::pair<std::vector<int>, int>> sort_cases = {
+    {{1000}, 0},
+    {{7}, 0},
+    {{4, 300}, 1},
+    {{300, 4}, 0},
+    {{3, 5, 7}, 1},
+    {{2, 600, 3}, 1},
+    {{2, 3, 17, 19}, 0},
+    {{2, 3, 17, 19}, 3},
+    {{5, 1, 9}, 1},
+    {{1, 1}, 0},
+};
+
+/* few distinct values so that ties and -0.f / 0.f are exercised */
+static std::vector<float> random_floats(size_t num, std::mt19937& rng)
+{
+    std::vector<float> v(num);
+    for (auto& x : v) {
+        int r = (int)(rng() % 41) - 20;
+        x = r == 0 ? ((rng() & 1) ? -0.f : 0.f) : r * 0.25f;
+    }
+    return v;
+}
+
+class SortPerDimTest : public ::testing::TestWithParam<bool> {};
+
+TEST_P(SortPerDimTest, sortAndArgsort)
+{
+    bool descending = GetParam();
+    std::mt19937 rng(5);
+    for (auto& c : sort_cases) {
+        for (int is_argsort = 0; is_argsort < 2; is_argsort++) {
+            auto in = random_floats(shape_num(c.first), rng);
+            std::vector<int> expect_index;
+            std::vector<float> expect_out;
+            ref_sort(in, c.first, c.second, descending, expect_index, expect_out);
+
+            bmcpu::cpu_sort_per_dimlayer layer;
+            cpu_sort_per_dim_param_t param = {c.second, (bool)is_argsort, true, descending};
+            std::vector<std::vector<int>> input_shapes = {c.first};
+            std::vector<std::vector<int>> output_shapes(2);
+            std::vector<int> index(in.size());
+            std::vector<float> out(in.size());
+            std::vector<float*> input_tensors = {in.data()};
+            std::vector<float*> output_tensors = {(float*)index.data(), out.data()};
+            layer.set_common_param(input_tensors, input_shapes, output_tensors, output_shapes);
+            layer.process(&param, sizeof(param));
+            ASSERT_EQ(output_shapes[0], c.first);
+            ASSERT_EQ(index, expect_index);
+            if (!is_argsort) {
+                ASSERT_EQ(output_shapes[1], c.first);
+                ASSERT_EQ(memcmp(out.data(), expect_out.data(), out.size() * sizeof(float)), 0);
+            }
+        }
+    }
+}
+
+INSTANTIATE_TEST_CASE_P(order, SortPerDimTest, ::testing::Values(false, true));
+
+TEST(ArgsortTest, floatIndex)
+{
+    std::mt19937 rng(9);
+    for (auto& c : sort_cases) {
+        for (int ascend = 0; ascend < 2; ascend++) {
+            auto in = random_floats(shape_num(c.first), rng);
+            std::vector<int> expect_index;
+            std::vector<float> expect_out;
+            ref_sort(in, c.first, c.second, !ascend, expect_index, expect_out);
+
+            bmcpu::cpu_argsortlayer layer;
+            cpu_argsort_param_t param = {c.second - (int)c.first.size(), (bool)ascend};
+            std::vector<std::vector<int>> input_shapes = {c.first};
+            std::vector<std::vector<int>> output_shapes(1);
+            std::vector<float> index(in.size());
+            std::vector<float*> input_tensors = {in.data()};
+            std::vector<float*> output_tensors = {index.data()};
+            layer.set_common_param(input_tensors, input_shapes, output_tensors, output_shapes);
+            layer.process(&param, sizeof(param));
+            ASSERT_EQ(output_shapes[0], c.first);
+            for (size_t i = 0; i < in.size(); i++)
+                ASSERT_EQ(index[i], (float)expect_index[i]);
+        }
+    }
+}
+
+TEST(StridedSortTest, int32)
+{
+    std::mt19937 rng(3);
+    for (auto& c : sort_cases) {
+        for (int descending = 0; descending < 2; descending++) {
+            std::vector<int> in(shape_num(c.first));
+            for (auto& v : in) {
+                switch (rng() % 8) {
+                case 0: v = INT_MIN; break;
+                case 1: v = INT_MAX; break;
+                default: v = (int)rng();
+                }
+            }
+            std::vector<int> expect_index, expect_out, index(in.size()), out(in.size());
+            ref_sort(in, c.first, c.second, descending, expect_index, expect_out);
+            int outer, len, inner;
+            bmcpu::sort_view(c.first.data(), c.first.size(), c.second, &outer, &len, &inner);
+            bmcpu::strided_sort(in.data(), outer, len, inner, descending, index.data(), out.data());
+            ASSERT_EQ(index, expect_index);
+            ASSERT_EQ(out, expect_out);
+        }
+    }
+}
+
+TEST(StridedSortTest, floatSpecials)
+{
+    std::vector<float> in = {1.f, -0.f, 0.f, -1e30f, 1e-40f, -1e-40f, 3.f, -0.f,
+                             std::numeric_limits<float>::infinity(),
+                             -std::numeric_limits<float>::infinity(), 0.f, -1.f};
+    for (int descending = 0; descending < 2; descending++) {
+        std::vector<int> shape = {(int)in.size()}, expect_index, index(in.size());
+        std::vector<float> expect_out, out(in.size());
+        ref_sort(in, shape, 0, descending, expect_index, expect_out);
+        bmcpu::strided_sort(in.data(), 1, in.size(), 1, descending, index.data(), out.data());
+        ASSERT_EQ(index, expect_index);
+        ASSERT_EQ(memcmp(out.data(), expect_out.data(), out.size() * sizeof(float)), 0);
+    }
+}
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "bmcpu_utils.hpp"
+
+TEST(ThreadPoolTest, parallelForCoversRangeOnce)
+{
+    bmcpu::ThreadPool pool(4);
+    bmcpu::ThreadPoolScope scope(&pool);
+    std::vector<std::atomic<int>> hits(1000);
+    for (auto &h : hits) h = 0;
+    bmcpu::parallel_for(0, 1000, [&](int i) { hits[i]++; });
+    for (auto &h : hits) ASSERT_EQ(h.load(), 1);
+}
+
+TEST(ThreadPoolTest, parallelForKeepsGrain)
+{
+    bmcpu::ThreadPool pool(4);
+    bmcpu::ThreadPoolScope scope(&pool);
+    std::atomic<int> chunks(0), items(0);
+    bmcpu::parallel_for(3, 103, 7, [&](int start, int end) {
+        EXPECT_EQ((start - 3) % 7, 0);
+        EXPECT_LE(end - start, 7);
+        chunks++;
+        items += end - start;
+    });
+    ASSERT_EQ(chunks.load(), 15);
+    ASSERT_EQ(items.load(), 100);
+}
+
+TEST(ThreadPoolTest, nestedParallelForRunsInline)
+{
+    bmcpu::ThreadPool pool(3);
+    bmcpu::ThreadPoolScope scope(&pool);
+    std::atomic<int> sum(0);
+    bmcpu::parallel_for(0, 8, [&](int i) {
+        bmcpu::parallel_for(0, 8, [&](int j) { sum += i * 8 + j; });
+    });
+    ASSERT_EQ(sum.load(), 63 * 64 / 2);
+}
+
+TEST(ThreadPoolTest, taskExceptionReachesCaller)
+{
+    bmcpu::ThreadPool pool(4);
+    bmcpu::ThreadPoolScope scope(&pool);
+    EXPECT_THROW(bmcpu::parallel_for(0, 64, [&](int i) {
+        if (i == 17) throw std::runtime_error("task failed");
+    }), std::runtime_error);
+    // the pool is still usable
+    std::atomic<int> count(0);
+    bmcpu::parallel_for(0, 64, [&](int) { count++; });
+    ASSERT_EQ(count.load(), 64);
+}
+
+TEST(ThreadPoolTest, concurrentCallersShareOnePool)
+{
+    bmcpu::ThreadPool pool(4);
+    std::vector<std::thread> callers;
+    std::atomic<long> sum(0);
+    for (int t = 0; t < 4; t++) {
+        callers.emplace_back([&]() {
+            bmcpu::ThreadPoolScope scope(&pool);
+            for (int loop = 0; loop < 200; loop++)
+                bmcpu::parallel_for(0, 32, [&](int i) { sum += i; });
+        });
+    }
+    for (auto &t : callers) t.join();
+    ASSERT_EQ(sum.load(), 4L * 200 * (31 * 32 / 2));
+}
@@ -0,0 +1,344 @@
+#include <gtest/gtest.h>
+#include <string.h>
+#include <algorithm>
+#include <numeric>
+#include <queue>
+#include <random>
+#include "cpu_topk.h"
+#include "cpu_topk_ascending.h"
+#include "cpu_topk_mx.h"
+#include "bmcpu_topk.hpp"
+#include "bmcpu_elementwise.hpp"
+
+/* the heap cpu_topk used before the topk engine, descending only */
+static void old_topk_lane(const float* src, int n, int k, bool sorted, int stride,
+                          float* values, int* indices)
+{
+    typedef std::pair<float, int> P;
+    auto value_comp = [](const P& l, const P& r) {
+        return l.first > r.first || (l.first == r.first && l.second < r.second);
+    };
+    auto index_comp = [](const P& l, const P& r) { return l.second < r.second; };
+    std::vector<P> heap_data;
+    for (int i = 0; i < k && i < n; ++i) heap_data.emplace_back(src[i * stride], i);
+    std::priority_queue<P, std::vector<P>, decltype(value_comp)> pq(value_comp, std::move(heap_data));
+    for (int i = k; i < n; ++i) {
+        if (pq.top().first < src[i * stride]) {
+            pq.pop();
+            pq.emplace(src[i * stride], i);
+        }
+    }
+    int dst_pos = (std::min(k, n) - 1) * stride;
+    if (!sorted) {
+        std::priority_queue<P, std::vector<P>, decltype(index_comp)> pq_index(index_comp);
+        while (!pq.empty()) {
+            pq_index.push(pq.top());
+            pq.pop();
+        }
+        for (; !pq_index.empty(); pq_index.pop(), dst_pos -= stride) {
+            values[dst_pos] = pq_index.top().first;
+            indices[dst_pos] = pq_index.top().second;
+        }
+        return;
+    }
+    for (; !pq.empty(); pq.pop(), dst_pos -= stride) {
+        values[dst_pos] = pq.top().first;
+        indices[dst_pos] = pq.top().second;
+    }
+}
+
+/* best first, equal values by index, or in index order when not sorted */
+template<typename T, typename Less>
+static void ref_topk(const std::vector<T>& in, const std::vector<int>& shape, int axis, int k,
+                     bool largest, bool sorted, Less less,
+                     std::vector<T>& values, std::vector<int>& indices)
+{
+    int outer = 1, inner = 1, len = shape[axis];
+    for (int i = 0; i < axis; i++) outer *= shape[i];
+    for (size_t i = axis + 1; i < shape.size(); i++) inner *= shape[i];
+    int kk = std::min(k, len);
+    values.assign((size_t)outer * k * inner, T());
+    indices.assign(values.size(), -1);
+    for (int o = 0; o < outer; o++) {
+        for (int i = 0; i < inner; i++) {
+            const T* src = in.data() + (size_t)o * len * inner + i;
+            std::vector<int> idx(len);
+            std::iota(idx.begin(), idx.end(), 0);
+            std::stable_sort(idx.begin(), idx.end(), [&](int a, int b) {
+                return largest ? less(src[b * inner], src[a * inner])
+                               : less(src[a * inner], src[b * inner]);
+            });
+            if (!sorted) std::sort(idx.begin(), idx.begin() + kk);
+            for (int t = 0; t < kk; t++) {
+                size_t dst = (size_t)o * k * inner + (size_t)t * inner + i;
+                values[dst] = src[idx[t] * inner];
+                indices[dst] = idx[t];
+            }
+        }
+    }
+}
+
+static size_t shape_num(const std::vector<int>& shape)
+{
+    size_t n = 1;
+    for (int s : shape) n *= s;
+    return n;
+}
+
+struct TopkCase {
+    std::vector<int> shape;
+    int axis;
+    int k;
+};
+
+/* k small against the lane goes through the heap, the others through
+ * nth_element, k above the lane fills min(k, len) entries */
+static const std::vector<TopkCase> topk_cases = {
+    {{1, 5000}, 1, 10},
+    {{3, 4096}, 1, 1},
+    {{4, 300}, 1, 250},
+    {{2, 100, 7}, 1, 5},
+    {{2, 100, 7}, 1, 60},
+    {{1000}, 0, 1000},
+    {{5, 9}, 1, 20},
+    {{50, 3, 2}, 0, 3},
+};
+
+/* few distinct values, so that ties and -0.f / 0.f are exercised */
+static std::vector<float> random_floats(size_t num, std::mt19937& rng, int levels)
+{
+    std::vector<float> v(num);
+    for (auto& x : v) {
+        int r = (int)(rng() % (2 * levels + 1)) - levels;
+        x = r == 0 ? ((rng() & 1) ? -0.f : 0.f) : r * 0.5f;
+    }
+    return v;
+}
+
+static void run_topk_layer(bmcpu::cpu_topklayer& layer, std::vector<float>& in, const TopkCase& c,
+                           bool sorted, std::vector<float>& values, std::vector<int>& indices)
+{
+    cpu_topk_param_t param;
+    param.k = c.k;
+    param.axis = c.axis;
+    param.sorted = sorted;
+    std::vector<std::vector<int>> input_shapes = {c.shape};
+    std::vector<std::vector<int>> output_shapes(2);
+    layer.reshape(&param, sizeof(param), input_shapes, output_shapes);
+    values.assign(shape_num(output_shapes[0]), 0.f);
+    indices.assign(values.size(), -1);
+    std::vector<float*> input_tensors = {in.data()};
+    std::vector<float*> output_tensors = {values.data(), (float*)indices.data()};
+    layer.set_common_param(input_tensors, input_shapes, output_tensors, output_shapes);
+    layer.process(&param, sizeof(param));
+    ASSERT_EQ(output_shapes[0][c.axis], c.k);
+}
+
+TEST(TopkTest, matchesOldHeap)
+{
+    std::mt19937 rng(21);
+    for (auto& c : topk_cases) {
+        for (int sorted = 0; sorted < 2; sorted++) {
+            for (int levels : {3, 1000}) {
+                auto in = random_floats(shape_num(c.shape), rng, levels);
+                std::vector<float> values, expect_values;
+                std::vector<int> indices, expect_indices;
+                bmcpu::cpu_topklayer layer;
+                run_topk_layer(layer, in, c, sorted, values, indices);
+
+                int outer = 1, inner = 1, len = c.shape[c.axis];
+                for (int i = 0; i < c.axis; i++) outer *= c.shape[i];
+                for (size_t i = c.axis + 1; i < c.shape.size(); i++) inner *= c.shape[i];
+                expect_values.assign(values.size(), 0.f);
+                expect_indices.assign(values.size(), -1);
+                for (int o = 0; o < outer; o++)
+                    for (int i = 0; i < inner; i++)
+                        old_topk_lane(in.data() + (size_t)o * len * inner + i, len, c.k, sorted, inner,
+                                      expect_values.data() + (size_t)o * c.k * inner + i,
+                                      expect_indices.data() + (size_t)o * c.k * inner + i);
+                ASSERT_EQ(indices, expect_indices);
+                ASSERT_EQ(values, expect_values);
+            }
+        }
+    }
+}
+
+TEST(TopkTest, ascending)
+{
+    std::mt19937 rng(22);
+    for (auto& c : topk_cases) {
+        for (int sorted = 0; sorted < 2; sorted++) {
+            auto in = random_floats(shape_num(c.shape), rng, 5);
+            std::vector<float> values, expect_values;
+            std::vector<int> indices, expect_indices;
+            bmcpu::cpu_topk_ascendinglayer layer;
+            run_topk_layer(layer, in, c, sorted, values, indices);
+            ref_topk(in, c.shape, c.axis, c.k, false, sorted, std::less<float>(),
+                     expect_values, expect_indices);
+            ASSERT_EQ(indices, expect_indices);
+            ASSERT_EQ(values, expect_values);
+        }
+    }
+}
+
+TEST(TopkTest, valuesOrIndicesOnly)
+{
+    std::mt19937 rng(23);
+    TopkCase c = {{8, 2000}, 1, 7};
+    auto in = random_floats(shape_num(c.shape), rng, 100);
+    std::vector<float> values, expect_values;
+    std::vector<int> indices, expect_indices;
+    ref_topk(in, c.shape, c.axis, c.k, true, true, std::less<float>(), expect_values, expect_indices);
+    for (int values_only = 0; values_only < 2; values_only++) {
+        bmcpu::cpu_topklayer layer;
+        cpu_topk_param_t param;
+        param.k = c.k;
+        param.axis = c.axis;
+        param.values_used_only = values_only;
+        std::vector<std::vector<int>> input_shapes = {c.shape};
+        std::vector<std::vector<int>> output_shapes(2);
+        layer.reshape(&param, sizeof(param), input_shapes, output_shapes);
+        output_shapes.resize(1);
+        std::vector<float> out(shape_num(output_shapes[0]));
+        std::vector<float*> input_tensors = {in.data()};
+        std::vector<float*> output_tensors = {out.data()};
+        layer.set_common_param(input_tensors, input_shapes, output_tensors, output_shapes);
+        layer.process(&param, sizeof(param));
+        if (values_only) {
+            ASSERT_EQ(out, expect_values);
+        } else {
+            ASSERT_EQ(memcmp(out.data(), expect_indices.data(), out.size() * sizeof(int)), 0);
+        }
+    }
+}
+
+TEST(TopkMxTest, retTypes)
+{
+    std::mt19937 rng(24);
+    const std::vector<TopkCase> cases = {{{6, 3000}, 1, 9}, {{4, 50, 3}, 1, 40}, {{10, 20}, 5, 7}};
+    for (auto& c : cases) {
+        for (int ret_type = MX_TOPK_RET_INDICES; ret_type <= MX_TOPK_RET_MASK; ret_type++) {
+            for (int is_ascend = 0; is_ascend < 2; is_ascend++) {
+                auto in = random_floats(shape_num(c.shape), rng, 50);
+                cpu_topk_mx_param_t param;
+                param.k = c.k;
+                param.axis = c.axis;
+                param.ret_type = ret_type;
+                param.is_ascend = is_ascend;
+                param.dtype = ret_type == MX_TOPK_RET_BOTH ? 6 : 0;
+                /* an axis past the dims flattens the input */
+                bool flatten = c.axis >= (int)c.shape.size();
+                std::vector<int> ref_shape = flatten ? std::vector<int>{(int)in.size()} : c.shape;
+                int ref_axis = flatten ? 0 : c.axis;
+                std::vector<float> expect_values;
+                std::vector<int> expect_indices;
+                ref_topk(in, ref_shape, ref_axis, c.k, !is_ascend, true, std::less<float>(),
+                         expect_values, expect_indices);
+
+                bmcpu::cpu_topk_mx_template<float> layer;
+                std::vector<std::vector<int>> input_shapes = {c.shape};
+                std::vector<std::vector<int>> output_shapes(ret_type == MX_TOPK_RET_BOTH ? 2 : 1);
+                layer.reshape(&param, sizeof(param), input_shapes, output_shapes);
+                std::vector<float> out0(shape_num(output_shapes[0]), -1.f), out1(out0.size(), -1.f);
+                std::vector<float*> input_tensors = {in.data()};
+                std::vector<float*> output_tensors = {out0.data(), out1.data()};
+                output_tensors.resize(output_shapes.size());
+                layer.set_common_param(input_tensors, input_shapes, output_tensors, output_shapes);
+                layer.process(&param, sizeof(param));
+                switch (ret_type) {
+                case MX_TOPK_RET_INDICES:
+                    for (size_t i = 0; i < out0.size(); i++)
+                        ASSERT_EQ(out0[i], (float)expect_indices[i]);
+                    break;
+                case MX_TOPK_RET_VALUE:
+                    ASSERT_EQ(out0, expect_values);
+                    break;
+                case MX_TOPK_RET_BOTH:
+                    ASSERT_EQ(out0, expect_values);
+                    ASSERT_EQ(memcmp(out1.data(), expect_indices.data(), out1.size() * sizeof(int)), 0);
+                    break;
+                case MX_TOPK_RET_MASK: {
+                    ASSERT_EQ(output_shapes[0], c.shape);
+                    int outer = 1, inner = 1, len = ref_shape[ref_axis];
+                    for (int i = 0; i < ref_axis; i++) outer *= ref_shape[i];
+                    for (size_t i = ref_axis + 1; i < ref_shape.size(); i++) inner *= ref_shape[i];
+                    std::vector<float> expect_mask(in.size(), 0.f);
+                    for (int o = 0; o < outer; o++)
+                        for (int t = 0; t < c.k; t++)
+                            for (int i = 0; i < inner; i++) {
+                                int j = expect_indices[(size_t)o * c.k * inner + t * inner + i];
+                                expect_mask[(size_t)o * len * inner + (size_t)j * inner + i] = 1.f;
+                            }
+                    ASSERT_EQ(out0, expect_mask);
+                    break;
+                }
+                }
+            }
+        }
+    }
+}
+
+/* fp16, bf16 and the integer types are compared in their own encoding */
+template<typename T, typename ToFloat>
+static void check_dtype(CPU_DATA_TYPE_T dtype, const std::vector<T>& in, ToFloat to_float)
+{
+    for (auto& c : topk_cases) {
+        size_t num = shape_num(c.shape);
+        std::vector<T> data(in.begin(), in.begin() + num);
+        for (int largest = 0; largest < 2; largest++) {
+            std::vector<T> expect_values;
+            std::vector<int> expect_indices;
+            ref_topk(data, c.shape, c.axis, c.k, largest, true,
+                     [&](T a, T b) { return to_float(a) < to_float(b); },
+                     expect_values, expect_indices);
+            int outer = 1, inner = 1, len = c.shape[c.axis];
+            for (int i = 0; i < c.axis; i++) outer *= c.shape[i];
+            for (size_t i = c.axis + 1; i < c.shape.size(); i++) inner *= c.shape[i];
+            std::vector<T> values(expect_values.size());
+            std::vector<int> indices(values.size(), -1);
+            bmcpu::topk(dtype, data.data(), outer, len, inner, c.k, largest, true,
+                        values.data(), indices.data(), CPU_DTYPE_INT32, NULL);
+            ASSERT_EQ(indices, expect_indices) << "dtype " << dtype;
+            ASSERT_EQ(values, expect_values) << "dtype " << dtype;
+        }
+    }
+}
+
+TEST(TopkEngineTest, dtypes)
+{
+    std::mt19937 rng(25);
+    size_t num = 0;
+    for (auto& c : topk_cases) num = std::max(num, shape_num(c.shape));
+    auto f = random_floats(num, rng, 200);
+    for (size_t i = 0; i < num; i += 97) f[i] = (i & 1) ? 65504.f : -1e-7f;
+
+    std::vector<uint16_t> fp16(num), bf16(num);
+    for (size_t i = 0; i < num; i++) {
+        fp16[i] = bmcpu::fp32_to_fp16(f[i]);
+        uint32_t bits;
+        memcpy(&bits, &f[i], sizeof(bits));
+        bf16[i] = bits >> 16;
+    }
+    check_dtype(CPU_DTYPE_FP16, fp16, [](uint16_t v) { return bmcpu::fp16_to_fp32(v); });
+    check_dtype(CPU_DTYPE_BFP16, bf16, [](uint16_t v) {
+        uint32_t bits = (uint32_t)v << 16;
+        float x;
+        memcpy(&x, &bits, sizeof(x));
+        return x;
+    });
+
+    std::vector<int32_t> i32(num);
+    std::vector<uint32_t> u32(num);
+    std::vector<int8_t> i8(num);
+    std::vector<uint16_t> u16(num);
+    for (size_t i = 0; i < num; i++) {
+        i32[i] = (int32_t)rng();
+        u32[i] = (uint32_t)rng() % 50 + (i % 3 ? 0x80000000u : 0);
+        i8[i] = (int8_t)rng();
+        u16[i] = (uint16_t)rng();
+    }
+    check_dtype(CPU_DTYPE_INT32, i32, [](int32_t v) { return (double)v; });
+    check_dtype(CPU_DTYPE_UINT32, u32, [](uint32_t v) { return (double)v; });
+    check_dtype(CPU_DTYPE_INT8, i8, [](int8_t v) { return (double)v; });
+    check_dtype(CPU_DTYPE_UINT16, u16, [](uint16_t v) { return (double)v; });
+}
@@ -0,0 +1,62 @@
+/*
+ * Per-call overhead of the multi-threaded cpu layers: threads created and
+ * joined in every call vs the persistent bmcpu::ThreadPool.
+ * usage: thread_pool_bench [loops] [work per task]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "bmcpu_utils.hpp"
+
+static void work(float *out, int n)
+{
+    float acc = 0.f;
+    for (int i = 0; i < n; ++i)
+        acc = acc * 0.5f + i;
+    *out = acc;
+}
+
+int main(int argc, char *argv[])
+{
+    int loops = argc > 1 ? atoi(argv[1]) : 2000;
+    int work_num = argc > 2 ? atoi(argv[2]) : 256;
+    if (loops <= 0 || work_num < 0) {
+        printf("usage: %s [loops] [work per task]\n", argv[0]);
+        return -1;
+    }
+    printf("loops=%d, work per task=%d, hardware threads=%u\n",
+           loops, work_num, std::thread::hardware_concurrency());
+    for (int num_thread : {1, 4, 16}) {
+        std::vector<float> out(num_thread);
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int loop = 0; loop < loops; ++loop) {
+            if (num_thread == 1) {
+                work(out.data(), work_num);
+                continue;
+            }
+            std::vector<std::thread> threads;
+            for (int i = 0; i < num_thread; ++i)
+                threads.push_back(std::thread(work, &out[i], work_num));
+            for (auto &it : threads)
+                it.join();
+        }
+        auto t1 = std::chrono::steady_clock::now();
+
+        bmcpu::ThreadPool pool(num_thread);
+        bmcpu::ThreadPoolScope scope(&pool);
+        auto t2 = std::chrono::steady_clock::now();
+        for (int loop = 0; loop < loops; ++loop) {
+            bmcpu::parallel_for(0, num_thread, [&](int i) { work(&out[i], work_num); });
+        }
+        auto t3 = std::chrono::steady_clock::now();
+
+        double spawn_us = std::chrono::duration<double, std::micro>(t1 - t0).count() / loops;
+        double pool_us = std::chrono::duration<double, std::micro>(t3 - t2).count() / loops;
+        printf("threads=%2d  spawn+join: %8.2f us/call  pool: %8.2f us/call  speedup: %6.2fx\n",
+               num_thread, spawn_us, pool_us, pool_us > 0 ? spawn_us / pool_us : 0.0);
+    }
+    return 0;
+}
@@ -0,0 +1,137 @@
+/*
+ * cpu_topk / cpu_topk_mx: the old per lane heap and index sort vs
+ * bmcpu::topk, on vocab sized rows and on k close to the lane length.
+ * The outputs are compared element by element.
+ * usage: topk_bench [loops]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <algorithm>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <vector>
+#include "bmcpu_topk.hpp"
+
+using std::vector;
+
+/* what cpu_topk did before the topk engine, sorted and descending */
+static void old_topk(const float* in, int outer, int n, int k, float* values, int* indices)
+{
+    typedef std::pair<float, int> P;
+    auto comp = [](const P& l, const P& r) {
+        return l.first > r.first || (l.first == r.first && l.second < r.second);
+    };
+    for (int o = 0; o < outer; o++) {
+        const float* src = in + (size_t)o * n;
+        std::vector<P> heap_data;
+        heap_data.reserve(k);
+        for (int i = 0; i < k && i < n; ++i) heap_data.emplace_back(src[i], i);
+        std::priority_queue<P, std::vector<P>, decltype(comp)> pq(comp, std::move(heap_data));
+        for (int i = k; i < n; ++i) {
+            if (pq.top().first < src[i]) {
+                pq.pop();
+                pq.emplace(src[i], i);
+            }
+        }
+        int dst_pos = (size_t)o * k + std::min(k, n) - 1;
+        for (; !pq.empty(); pq.pop(), dst_pos--) {
+            values[dst_pos] = pq.top().first;
+            indices[dst_pos] = pq.top().second;
+        }
+    }
+}
+
+/* what cpu_topk_mx did, descending and returning both */
+static void old_topk_mx(const float* vals, int outer, int N, int K, float* values, float* out_indices)
+{
+    const bool full_sort(K * 8 > N);
+    vector<int> indices((size_t)outer * N);
+    vector<float> sorted_vals((size_t)outer * N);
+    std::iota(indices.begin(), indices.end(), 0);
+    for (int i = 0; i < outer; ++i) {
+        int ind_offset = i * N;
+        int* ind = indices.data() + ind_offset;
+        auto cmp = [&](const int& i1, const int& i2) { return vals[i1] > vals[i2]; };
+        if (full_sort) std::sort(ind, ind + N, cmp);
+        else std::partial_sort(ind, ind + K, ind + N, cmp);
+        float* sorted_ptr = sorted_vals.data() + ind_offset;
+        for (int j = 0; j < K; ++j) {
+            sorted_ptr[j] = vals[ind[j]];
+            ind[j] -= ind_offset;
+        }
+    }
+    for (int i = 0; i < outer; i++)
+        for (int j = 0; j < K; j++) {
+            values[(size_t)i * K + j] = sorted_vals[(size_t)i * N + j];
+            out_indices[(size_t)i * K + j] = indices[(size_t)i * N + j];
+        }
+}
+
+template<typename Func>
+static double time_us(int loops, Func func)
+{
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < loops; i++) func();
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::micro>(t1 - t0).count() / loops;
+}
+
+/* distinct values, so the unstable old mx sort has a single answer */
+static vector<float> random_input(size_t num)
+{
+    std::mt19937 rng(31);
+    vector<float> in(num);
+    for (size_t i = 0; i < num; i++) in[i] = ((float)i - num / 2) * 1e-3f;
+    std::shuffle(in.begin(), in.end(), rng);
+    return in;
+}
+
+static int bench(int outer, int n, int k, int loops)
+{
+    auto in = random_input((size_t)outer * n);
+    vector<float> old_values((size_t)outer * k), new_values(old_values.size());
+    vector<int> old_indices(old_values.size()), new_indices(old_values.size());
+    vector<float> mx_values(old_values.size()), mx_indices(old_values.size());
+    vector<float> new_findices(old_values.size());
+    double old_us = time_us(loops, [&]() {
+        old_topk(in.data(), outer, n, k, old_values.data(), old_indices.data());
+    });
+    double mx_us = time_us(loops, [&]() {
+        old_topk_mx(in.data(), outer, n, k, mx_values.data(), mx_indices.data());
+    });
+    double new_us = time_us(loops, [&]() {
+        bmcpu::topk(CPU_DTYPE_FP32, in.data(), outer, n, 1, k, true, true,
+                    new_values.data(), new_indices.data(), CPU_DTYPE_INT32, NULL);
+    });
+    bmcpu::topk(CPU_DTYPE_FP32, in.data(), outer, n, 1, k, true, true,
+                NULL, new_findices.data(), CPU_DTYPE_FP32, NULL);
+    printf("[%d, %d] k %-6d topk old: %9.1f us  mx old: %9.1f us  new: %9.1f us  "
+           "speedup: %6.2fx / %6.2fx\n", outer, n, k, old_us, mx_us, new_us,
+           new_us > 0 ? old_us / new_us : 0.0, new_us > 0 ? mx_us / new_us : 0.0);
+    if (old_values != new_values || old_indices != new_indices ||
+        mx_values != new_values || mx_indices != new_findices) {
+        printf("  output mismatch\n");
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    int loops = argc > 1 ? atoi(argv[1]) : 10;
+    if (loops <= 0) {
+        printf("usage: %s [loops]\n", argv[0]);
+        return -1;
+    }
+    int ret = 0;
+    ret |= bench(1, 151936, 1, loops);      /* greedy sampling */
+    ret |= bench(1, 151936, 50, loops);     /* top-k sampling */
+    ret |= bench(8, 32000, 40, loops);
+    ret |= bench(256, 1000, 5, loops);      /* classification */
+    ret |= bench(16, 10000, 1000, loops);   /* retrieval */
+    ret |= bench(4, 20000, 10000, loops);
+    return ret;
+}
@@ -0,0 +1,236 @@
+/*****************************************************************************
+ *
+ *    Copyright (c) 2016-2026 by Sophgo Technologies Inc. All rights reserved.
+ *
+ *    load time of bdc/gdma command relocation: command by command convert_cmd
+ *    vs batched relocation of whole groups, on a synthetic command stream.
+ *    No device is needed, the two outputs are compared byte by byte.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "bmruntime.h"
+
+using namespace bmruntime;
+using std::string;
+using std::vector;
+
+struct cmd_stream_t {
+  vector<vector<u8>> group_v;
+  vector<u32> cmd_num_v;
+  size_t byte_size = 0;
+};
+
+static void setup_stage(net_stage_t* stage, bmtpu_arch_t arch)
+{
+  u64 base = CTX_START_ADDR;
+  stage->coeff_offset = 0x2000000;
+  stage->io_size = 0;
+  stage->io_start = 0;
+  stage->io_offset = 0;
+  if (arch == BM1688) {
+    // 1688 only relocates nets with io alone
+    stage->io_start = base + 0x8000000;
+    stage->io_size = 0x1000000;
+    stage->io_offset = 0x40000000;
+  }
+  stage->ctx_start = base + 0x10000000;
+  stage->ctx_borders = {0x4000000, 0x8000000};
+  stage->ctx_offset = {0x20000000, 0x30000000 - 0x4000000};
+}
+
+/* a global address from a random region of the stage, dst never lands in coeff */
+static u64 random_addr(std::mt19937& rng, const net_stage_t* stage, bool is_src)
+{
+  u64 base = CTX_START_ADDR;
+  switch (rng() % (is_src ? 4 : 3)) {
+    case 0:
+      return rng() % 0x40000;  // local memory
+    case 1:
+      return stage->ctx_start + rng() % stage->ctx_borders[0];
+    case 2:
+      return stage->ctx_start + stage->ctx_borders[0] +
+             rng() % (stage->ctx_borders[1] - stage->ctx_borders[0]);
+    default:
+      return base + rng() % (stage->io_size > 0 ? stage->io_start - base : stage->ctx_start - base);
+  }
+}
+
+static void put_addr_40bit(u32* cmd, int lo_idx, u64 addr)
+{
+  cmd[lo_idx] = addr & 0xffffffff;
+  cmd[lo_idx + 1] = (cmd[lo_idx + 1] & 0xffffff00) | ((addr >> 32) & 0xff);
+}
+
+static void build_gdma_group(std::mt19937& rng, bmtpu_arch_t arch, const net_stage_t* stage,
+                             u32 cmd_num, vector<u8>& buffer)
+{
+  buffer.assign((size_t)cmd_num * 128 + 128, 0);
+  u64 offset = 0;
+  for (u32 i = 0; i < cmd_num; i++) {
+    bool last_cmd = i == cmd_num - 1;
+    u32* cmd = (u32*)(buffer.data() + offset);
+    for (int w = 0; w < 24; w++) cmd[w] = rng();
+    if (arch == BM1684) {
+      cmd[0] = (cmd[0] & ~0xc4u) | ((rng() % 4) << 6);
+      u64 src = random_addr(rng, stage, true);
+      u64 dst = random_addr(rng, stage, false);
+      cmd[16] = src & 0xffffffff;
+      cmd[17] = dst & 0xffffffff;
+      cmd[18] = (cmd[18] & 0xffff0000) | ((dst >> 32) & 0xff) << 8 | ((src >> 32) & 0xff);
+    } else {
+      u32 cmd_type = rng() % (arch == BM1688 ? 12 : 9);
+      cmd[1] = (cmd[1] & ~0x8fu) | cmd_type | ((rng() % 8 == 0) ? 0x80 : 0);
+      u64 tag = arch == BM1688 ? (1ull << 39) : 0;
+      put_addr_40bit(cmd, 16, random_addr(rng, stage, true) | tag);
+      put_addr_40bit(cmd, 18, random_addr(rng, stage, false) | tag);
+      put_addr_40bit(cmd, 20, random_addr(rng, stage, true) | tag);
+    }
+    if (last_cmd && arch != BM1684) {
+      cmd[1] = (cmd[1] & ~0xfu) | 0x6;
+    }
+    offset += get_gdma_cmd_len(buffer.data(), offset, last_cmd);
+  }
+  buffer.resize(offset);
+}
+
+static void build_bdc_group(std::mt19937& rng, u32 cmd_num, vector<u8>& buffer)
+{
+  buffer.assign((size_t)cmd_num * 128 + 128, 0);
+  u64 offset = 0;
+  for (u32 i = 0; i < cmd_num; i++) {
+    u32* cmd = (u32*)(buffer.data() + offset);
+    for (int w = 0; w < 4; w++) cmd[w] = rng();
+    // long commands, or 16 byte sync commands
+    u32 tsk_type = (rng() % 4 == 0) ? 15 : 0;
+    cmd[0] &= ~0x1u;
+    cmd[1] = (cmd[1] & ~(0xfu << 9)) | (tsk_type << 9);
+    offset += get_bdc_cmd_len(buffer.data(), offset, i == cmd_num - 1);
+  }
+  buffer.resize(offset);
+}
+
+static void build_stream(std::mt19937& rng, bmtpu_arch_t arch, int engine_id, const net_stage_t* stage,
+                         u32 cmd_num, u32 group_num, cmd_stream_t& stream)
+{
+  for (u32 g = 0; g < group_num; g++) {
+    u32 num = cmd_num / group_num + (g < cmd_num % group_num ? 1 : 0);
+    if (num == 0) continue;
+    stream.group_v.emplace_back();
+    if (engine_id == ENGINE_BD) {
+      build_bdc_group(rng, num, stream.group_v.back());
+    } else {
+      build_gdma_group(rng, arch, stage, num, stream.group_v.back());
+    }
+    stream.cmd_num_v.push_back(num);
+    stream.byte_size += stream.group_v.back().size();
+  }
+}
+
+/* what setup_cmd_context did for every command */
+static void relocate_by_cmd(const cmd_stream_t& stream, int engine_id, u64 start_address,
+                            const net_stage_t* stage, u32* cmd_buf)
+{
+  u32* p_cmd_buf = cmd_buf;
+  for (size_t g = 0; g < stream.group_v.size(); g++) {
+    const u8* buffer = stream.group_v[g].data();
+    u32 cmd_num = stream.cmd_num_v[g];
+    u64 offset = 0;
+    for (u32 cmd_idx = 0; cmd_idx < cmd_num; cmd_idx++) {
+      bool last_cmd = cmd_idx == cmd_num - 1;
+      u32 size = engine_id == ENGINE_BD ? get_bdc_cmd_len(buffer, offset, last_cmd)
+                                        : get_gdma_cmd_len(buffer, offset, last_cmd);
+      memcpy(p_cmd_buf, buffer + offset, size);
+      convert_cmd(p_cmd_buf, engine_id, last_cmd, start_address, stage);
+      p_cmd_buf += size / sizeof(u32);
+      offset += size;
+    }
+  }
+}
+
+static void relocate_by_group(const cmd_stream_t& stream, int engine_id, u64 start_address,
+                              const net_stage_t* stage, const cmd_reloc_table_t& table,
+                              int thread_num, u32* cmd_buf)
+{
+  vector<cmd_group_reloc_t> group_v(stream.group_v.size());
+  u32* p_cmd_buf = cmd_buf;
+  for (size_t g = 0; g < stream.group_v.size(); g++) {
+    group_v[g].cmd_buf = p_cmd_buf;
+    index_cmd_group(stream.group_v[g].data(), stream.cmd_num_v[g], engine_id, &group_v[g].offset_v);
+    memcpy(p_cmd_buf, stream.group_v[g].data(), group_v[g].offset_v.back());
+    p_cmd_buf += group_v[g].offset_v.back() / sizeof(u32);
+  }
+  relocate_cmd_groups(group_v, engine_id, start_address, stage, table, thread_num);
+}
+
+static int run_engine(bmtpu_arch_t arch, int engine_id, const net_stage_t* stage,
+                      u32 cmd_num, u32 group_num, int thread_num, int loops)
+{
+  std::mt19937 rng(2024 + engine_id);
+  cmd_stream_t stream;
+  build_stream(rng, arch, engine_id, stage, cmd_num, group_num, stream);
+  cmd_reloc_table_t table;
+  build_cmd_reloc_table(stage, &table);
+  u64 start_address = 0x180000000;
+
+  vector<u32> by_cmd(stream.byte_size / sizeof(u32)), by_group(stream.byte_size / sizeof(u32));
+  double cmd_ns = 0, group_ns = 0;
+  for (int loop = 0; loop < loops; loop++) {
+    auto t0 = std::chrono::steady_clock::now();
+    relocate_by_cmd(stream, engine_id, start_address, stage, by_cmd.data());
+    auto t1 = std::chrono::steady_clock::now();
+    relocate_by_group(stream, engine_id, start_address, stage, table, thread_num, by_group.data());
+    auto t2 = std::chrono::steady_clock::now();
+    cmd_ns += std::chrono::duration<double, std::nano>(t1 - t0).count();
+    group_ns += std::chrono::duration<double, std::nano>(t2 - t1).count();
+  }
+  cmd_ns /= (double)loops * cmd_num;
+  group_ns /= (double)loops * cmd_num;
+
+  const char* engine = engine_id == ENGINE_BD ? "bdc " : "gdma";
+  printf("%s: %u cmds in %zu groups, %zu bytes, batched=%d\n", engine, cmd_num,
+         stream.group_v.size(), stream.byte_size, can_relocate_cmd_group(engine_id, table));
+  printf("  by command : %8.2f ns/cmd\n", cmd_ns);
+  printf("  by group   : %8.2f ns/cmd\n", group_ns);
+  printf("  speedup    : %8.2fx\n", group_ns > 0 ? cmd_ns / group_ns : 0.0);
+  if (memcmp(by_cmd.data(), by_group.data(), stream.byte_size) != 0) {
+    size_t i = 0;
+    while (by_cmd[i] == by_group[i]) i++;
+    printf("  mismatch at word %zu: 0x%08x vs 0x%08x\n", i, by_cmd[i], by_group[i]);
+    return -1;
+  }
+  printf("  output identical\n");
+  return 0;
+}
+
+int main(int argc, char* argv[])
+{
+  string arch_name = argc > 1 ? argv[1] : "BM1684X";
+  int cmd_num = argc > 2 ? atoi(argv[2]) : 200000;
+  int group_num = argc > 3 ? atoi(argv[3]) : 16;
+  int thread_num = argc > 4 ? atoi(argv[4]) : 1;
+  int loops = argc > 5 ? atoi(argv[5]) : 5;
+  if ((arch_name != "BM1684" && arch_name != "BM1684X" && arch_name != "BM1688") ||
+      cmd_num <= 0 || group_num <= 0 || thread_num <= 0 || loops <= 0) {
+    printf("usage: %s [BM1684|BM1684X|BM1688] [cmd_num] [group_num] [thread_num] [loops]\n", argv[0]);
+    return -1;
+  }
+
+  bmrt_arch_info arch_info(arch_name);
+  auto arch = bmrt_arch_info::get_bmtpu_arch();
+  net_stage_t stage;
+  setup_stage(&stage, arch);
+  printf("arch=%s, threads=%d, loops=%d\n", arch_name.c_str(), thread_num, loops);
+
+  int ret = run_engine(arch, ENGINE_GDMA, &stage, cmd_num, group_num, thread_num, loops);
+  if (arch != BM1684) {
+    ret |= run_engine(arch, ENGINE_BD, &stage, cmd_num, group_num, thread_num, loops);
+  }
+  return ret;
+}
@@ -0,0 +1,146 @@
+/*****************************************************************************
+ *
+ *    Copyright (c) 2016-2026 by Sophgo Technologies Inc. All rights reserved.
+ *
+ *    host overhead of multi-subnet dispatch: tensor name lookup vs compiled
+ *    slot plan. No device is needed, only a synthetic subnet chain is built.
+ *
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include "bmruntime.h"
+
+using namespace bmruntime;
+using std::string;
+using std::vector;
+
+static void build_stage(net_stage_t* stage, int subnet_num, int io_num)
+{
+  /* subnet i reads the outputs of subnet i-1, like a tpu/cpu chain */
+  for (int i = 0; i < subnet_num; i++) {
+    SUBNET_INFO_T* subnet = new SUBNET_INFO_T;
+    subnet->id = i;
+    subnet->subnet_mode = (i % 2) ? SUBNET_MODE_CPU : SUBNET_MODE_TPU;
+    subnet->switch_info.valid = false;
+    for (int j = 0; j < io_num; j++) {
+      subnet->input_tensor_name_v.push_back("subnet_" + std::to_string(i) + "_tensor_" + std::to_string(j));
+      subnet->output_tensor_name_v.push_back("subnet_" + std::to_string(i + 1) + "_tensor_" + std::to_string(j));
+    }
+    if (i != subnet_num - 1) {
+      subnet->next_subnet_ids.push_back(i + 1);
+    }
+    for (auto& names : {subnet->input_tensor_name_v, subnet->output_tensor_name_v}) {
+      for (auto& name : names) {
+        tensor_ext_t tensor_ext;
+        memset(&tensor_ext, 0, sizeof(tensor_ext));
+        tensor_ext.io_type = TENSOR_TYPE_IMM_IO;
+        tensor_ext.tensor_info.shape.num_dims = 4;
+        for (int d = 0; d < 4; d++) tensor_ext.tensor_info.shape.dims[d] = d + 1;
+        stage->subnet_tensor_v.insert(std::make_pair(name, tensor_ext));
+      }
+    }
+    stage->subnet_v.push_back(subnet);
+  }
+}
+
+/* what launch_multi_subnet did per subnet before the plan was compiled */
+static long run_by_name(net_stage_t* stage, int loops)
+{
+  long sum = 0;
+  for (int loop = 0; loop < loops; loop++) {
+    std::map<string, int> tensor_iteration;
+    int iteration = 0;
+    const SUBNET_INFO_T* subnet = stage->subnet_v.front();
+    while (subnet) {
+      iteration++;
+      for (auto& name : subnet->output_tensor_name_v) tensor_iteration[name] = iteration;
+      vector<float*> input_data_v(subnet->input_tensor_name_v.size());
+      vector<vector<int>> input_shapes_v;
+      for (size_t i = 0; i < subnet->input_tensor_name_v.size(); i++) {
+        auto& tensor_ext = stage->subnet_tensor_v.find(subnet->input_tensor_name_v[i])->second;
+        auto& shape = tensor_ext.tensor_info.shape;
+        input_shapes_v.push_back(vector<int>(shape.dims, shape.dims + shape.num_dims));
+        input_data_v[i] = (float*)tensor_ext.host_mem.addr;
+        sum += shape.dims[0] + tensor_iteration[subnet->input_tensor_name_v[i]];
+      }
+      for (auto& name : subnet->output_tensor_name_v) {
+        sum += stage->subnet_tensor_v.find(name)->second.io_type;
+      }
+      subnet = subnet->next_subnet_ids.empty() ? nullptr : stage->subnet_v[subnet->next_subnet_ids[0]];
+    }
+  }
+  return sum;
+}
+
+static long run_by_slot(net_stage_t* stage, int loops)
+{
+  long sum = 0;
+  auto& binding = stage->subnet_binding;
+  vector<int> tensor_iteration(binding.tensor_v.size());
+  for (int loop = 0; loop < loops; loop++) {
+    std::fill(tensor_iteration.begin(), tensor_iteration.end(), 0);
+    int iteration = 0;
+    const SUBNET_INFO_T* subnet = stage->subnet_v.front();
+    while (subnet) {
+      iteration++;
+      for (auto slot : subnet->output_slot_v) tensor_iteration[slot] = iteration;
+      auto& cpu_args = binding.cpu_args_v[subnet->id];
+      for (size_t i = 0; i < subnet->input_slot_v.size(); i++) {
+        auto& tensor_ext = *binding.tensor_v[subnet->input_slot_v[i]];
+        auto& shape = tensor_ext.tensor_info.shape;
+        if (subnet->subnet_mode == SUBNET_MODE_CPU) {
+          cpu_args.input_shape_v[i].assign(shape.dims, shape.dims + shape.num_dims);
+          cpu_args.input_data_v[i] = (float*)tensor_ext.host_mem.addr;
+        }
+        sum += shape.dims[0] + tensor_iteration[subnet->input_slot_v[i]];
+      }
+      for (auto slot : subnet->output_slot_v) {
+        sum += binding.tensor_v[slot]->io_type;
+      }
+      subnet = subnet->next_subnet_ids.empty() ? nullptr : stage->subnet_v[subnet->next_subnet_ids[0]];
+    }
+  }
+  return sum;
+}
+
+int main(int argc, char* argv[])
+{
+  int subnet_num = argc > 1 ? atoi(argv[1]) : 64;
+  int io_num = argc > 2 ? atoi(argv[2]) : 4;
+  int loops = argc > 3 ? atoi(argv[3]) : 2000;
+  if (subnet_num <= 0 || io_num <= 0 || loops <= 0) {
+    printf("usage: %s [subnet_num] [io_num] [loops]\n", argv[0]);
+    return -1;
+  }
+
+  net_stage_t stage;
+  build_stage(&stage, subnet_num, io_num);
+  compile_subnet_plan(&stage);
+  bind_subnet_plan(&stage, &stage.subnet_tensor_v, &stage.subnet_binding);
+
+  auto t0 = std::chrono::steady_clock::now();
+  long by_name = run_by_name(&stage, loops);
+  auto t1 = std::chrono::steady_clock::now();
+  long by_slot = run_by_slot(&stage, loops);
+  auto t2 = std::chrono::steady_clock::now();
+
+  double name_ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / loops / subnet_num;
+  double slot_ns = std::chrono::duration<double, std::nano>(t2 - t1).count() / loops / subnet_num;
+  printf("subnets=%d, io per subnet=%d, slots=%zu, loops=%d\n",
+         subnet_num, io_num, stage.subnet_slot_name_v.size(), loops);
+  printf("name lookup : %8.1f ns/subnet\n", name_ns);
+  printf("slot plan   : %8.1f ns/subnet\n", slot_ns);
+  printf("speedup     : %8.2fx\n", slot_ns > 0 ? name_ns / slot_ns : 0.0);
+
+  for (auto subnet : stage.subnet_v) delete subnet;
+  if (by_name != by_slot) {
+    printf("mismatch: %ld vs %ld\n", by_name, by_slot);
+    return -1;
+  }
+  return 0;
+}
@@ -1420,6 +1420,9 @@ vector<string> test_case_v = {
     "bmrt_load_bmodel_data",
     "bmrt_load_context",
     "bmrt_launch_data",
+    "bmrt_launch_data_bench",
+    "bmrt_launch_async",
+    "bmrt_event_trace",
     "bmrt_simple_api",
     "bmrt_multi_thread",
     "bmrt_get_bmodel_api",
@@ -2,6 +2,9 @@
  * This file is to do case test of runtime interface
  ****************************************************************************/
 
+#include <atomic>
+#include <chrono>
+#include <fstream>
 #include "bmrt_test_inner.h"
 
 using std::thread;
@@ -462,6 +465,212 @@ static void test_bmrt_launch()
   }
 }
 
+typedef struct {
+  std::atomic<int> count;
+  std::atomic<bool> ok;
+} async_done_t;
+
+static void async_launch_done(void *user_data, bool result)
+{
+  auto done = (async_done_t *)user_data;
+  if (!result) {
+    done->ok = false;
+  }
+  done->count++;
+}
+
+/* submit all loops without blocking, odd loops complete by callback, even loops by ticket */
+static void thread_entry_bmrt_launch_async(int thread_id, launch_unit_t *launch_unit)
+{
+  const char *net_name = launch_unit->net_name.c_str();
+  int input_num = launch_unit->ref_input_v.size();
+  int output_num = launch_unit->ref_output_v.size();
+  auto &core_list = core_lists[thread_id % core_lists.size()];
+  vector<bm_tensor_t> input_tensors(input_num);
+  for (int i = 0; i < input_num; i++) {
+    bmrt_tensor(&input_tensors[i], g_bmrt, launch_unit->input_type_v[i], launch_unit->input_shape_v[i]);
+    bm_memcpy_s2d(g_bm_handle, input_tensors[i].device_mem, launch_unit->ref_input_v[i]);
+  }
+  vector<vector<bm_tensor_t>> output_tensors(LOOP_NUM, vector<bm_tensor_t>(output_num));
+  vector<uint64_t> tickets;
+  async_done_t done;
+  done.count = 0;
+  done.ok = true;
+  for (int loop = 0; loop < LOOP_NUM; loop++) {
+    bool with_callback = loop % 2;
+    uint64_t ticket = bmrt_launch_tensor_async(g_bmrt, net_name, input_tensors.data(), input_num,
+                                               output_tensors[loop].data(), output_num, false, false,
+                                               core_list.data(), core_list.size(),
+                                               with_callback ? async_launch_done : NULL, &done);
+    if (ticket == 0) {
+      BMRT_LOG(FATAL, "submit net[%s] stage[%d] failed", net_name, launch_unit->stage_idx);
+    }
+    if (!with_callback) {
+      tickets.push_back(ticket);
+    }
+  }
+  for (auto ticket : tickets) {
+    if (!bmrt_wait_launch(g_bmrt, ticket)) {
+      BMRT_LOG(FATAL, "launch net[%s] stage[%d] failed", net_name, launch_unit->stage_idx);
+    }
+  }
+  while (done.count < LOOP_NUM / 2) {
+    std::this_thread::yield();
+  }
+  if (!done.ok) {
+    BMRT_LOG(FATAL, "launch net[%s] stage[%d] failed in callback", net_name, launch_unit->stage_idx);
+  }
+
+  for (auto &outputs : output_tensors) {
+    vector<void *> output_datas(output_num);
+    vector<int> count_v;
+    for (int i = 0; i < output_num; ++i) {
+      size_t size = bmrt_tensor_bytesize(&outputs[i]);
+      count_v.push_back(bmrt_shape_count(&outputs[i].shape));
+      output_datas[i] = malloc(size);
+      bm_memcpy_d2s_partial(g_bm_handle, output_datas[i], outputs[i].device_mem, size);
+      bm_free_device(g_bm_handle, outputs[i].device_mem);
+    }
+    result_cmp((int8_t **)output_datas.data(), *launch_unit, count_v);
+    for (auto data : output_datas) {
+      free(data);
+    }
+  }
+  for (auto &tensor : input_tensors) {
+    bm_free_device(g_bm_handle, tensor.device_mem);
+  }
+}
+
+static void test_bmrt_launch_async()
+{
+  vector<thread> thread_v;
+  for (auto &launch_unit : g_launch_unit_v) {
+    for (int j = 0; j < THREAD_NUM; j++) {
+      thread_v.emplace_back(thread_entry_bmrt_launch_async, j, &launch_unit);
+    }
+  }
+  for (auto &t : thread_v) {
+    t.join();
+  }
+}
+
+/* bmrt_launch_data allocs device io on each call, the io binding keeps it */
+static void test_bmrt_launch_data_bench()
+{
+  auto &core_list = core_lists[0];
+  for (auto &launch_unit : g_launch_unit_v) {
+    const char *net_name = launch_unit.net_name.c_str();
+    int input_num = launch_unit.ref_input_v.size();
+    int output_num = launch_unit.ref_output_v.size();
+    vector<void *> input_datas(launch_unit.ref_input_v);
+    vector<void *> output_datas(output_num), binding_datas(output_num);
+    vector<bm_shape_t> output_shapes(output_num), binding_shapes(output_num);
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int loop = 0; loop < LOOP_NUM; loop++) {
+      if (loop > 0) {
+        for (auto data : output_datas) {
+          free(data);
+        }
+      }
+      if (!bmrt_launch_data_multi_cores(g_bmrt, net_name, input_datas.data(), launch_unit.input_shape_v.data(),
+                                        input_num, output_datas.data(), output_shapes.data(), output_num,
+                                        false, core_list.data(), core_list.size())) {
+        BMRT_LOG(FATAL, "launch net[%s] stage[%d] failed", net_name, launch_unit.stage_idx);
+      }
+    }
+    auto t1 = std::chrono::steady_clock::now();
+
+    void *binding = bmrt_create_io_binding(g_bmrt, net_name);
+    if (binding == NULL) {
+      BMRT_LOG(FATAL, "create io binding of net[%s] failed", net_name);
+    }
+    auto net_info = bmrt_get_network_info(g_bmrt, net_name);
+    vector<vector<int8_t>> host_outputs(output_num);
+    for (int i = 0; i < output_num; i++) {
+      host_outputs[i].resize(net_info->max_output_bytes[i]);
+      bmrt_io_binding_set_output(g_bmrt, binding, i, host_outputs[i].data(), host_outputs[i].size());
+    }
+    auto t2 = std::chrono::steady_clock::now();
+    for (int loop = 0; loop < LOOP_NUM; loop++) {
+      if (!bmrt_launch_data_with_binding(g_bmrt, binding, input_datas.data(), launch_unit.input_shape_v.data(),
+                                         input_num, binding_datas.data(), binding_shapes.data(), output_num,
+                                         false, core_list.data(), core_list.size())) {
+        BMRT_LOG(FATAL, "launch net[%s] stage[%d] with io binding failed", net_name, launch_unit.stage_idx);
+      }
+    }
+    auto t3 = std::chrono::steady_clock::now();
+
+    vector<int> count_v;
+    for (int i = 0; i < output_num; i++) {
+      size_t size = bmrt_shape_count(&output_shapes[i]) * bmrt_data_type_size(net_info->output_dtypes[i]);
+      if (!bmrt_shape_is_same(&output_shapes[i], &binding_shapes[i]) ||
+          memcmp(output_datas[i], binding_datas[i], size) != 0) {
+        BMRT_LOG(FATAL, "net[%s] stage[%d] output[%d] differs with io binding", net_name,
+                 launch_unit.stage_idx, i);
+      }
+      count_v.push_back(bmrt_shape_count(&binding_shapes[i]));
+    }
+    result_cmp((int8_t **)binding_datas.data(), launch_unit, count_v);
+    for (auto data : output_datas) {
+      free(data);
+    }
+    bmrt_destroy_io_binding(g_bmrt, binding);
+
+    auto us = [](std::chrono::steady_clock::duration d) {
+      return (long)std::chrono::duration_cast<std::chrono::microseconds>(d).count() / LOOP_NUM;
+    };
+    printf("net[%s] stage[%d]: launch_data %ld us, with io binding %ld us per launch\n", net_name,
+           launch_unit.stage_idx, us(t1 - t0), us(t3 - t2));
+  }
+}
+
+/* record launches with the event trace on, and check the dumped chrome trace */
+static void test_bmrt_event_trace()
+{
+  const char *filename = "bmrt_event_trace_test.json";
+  auto &core_list = core_lists[0];
+  bmrt_enable_event_trace(true);
+  for (auto &launch_unit : g_launch_unit_v) {
+    const char *net_name = launch_unit.net_name.c_str();
+    int input_num = launch_unit.ref_input_v.size();
+    int output_num = launch_unit.ref_output_v.size();
+    vector<void *> input_datas(launch_unit.ref_input_v);
+    vector<void *> output_datas(output_num);
+    vector<bm_shape_t> output_shapes(output_num);
+    for (int loop = 0; loop < LOOP_NUM; loop++) {
+      if (!bmrt_launch_data_multi_cores(g_bmrt, net_name, input_datas.data(), launch_unit.input_shape_v.data(),
+                                        input_num, output_datas.data(), output_shapes.data(), output_num,
+                                        false, core_list.data(), core_list.size())) {
+        BMRT_LOG(FATAL, "launch net[%s] stage[%d] failed", net_name, launch_unit.stage_idx);
+      }
+      vector<int> count_v;
+      for (int i = 0; i < output_num; i++) {
+        count_v.push_back(bmrt_shape_count(&output_shapes[i]));
+      }
+      result_cmp((int8_t **)output_datas.data(), launch_unit, count_v);
+      for (auto data : output_datas) {
+        free(data);
+      }
+    }
+  }
+  bmrt_enable_event_trace(false);
+
+  if (!bmrt_dump_event_trace(filename)) {
+    BMRT_LOG(FATAL, "dump event trace failed");
+  }
+  std::ifstream fin(filename);
+  string json((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+  if (json.find("\"traceEvents\"") == string::npos || json.find("\"cat\":\"sync\"") == string::npos) {
+    BMRT_LOG(FATAL, "%s is not a chrome trace of the launches", filename);
+  }
+  for (auto &launch_unit : g_launch_unit_v) {
+    if (json.find("\"name\":\"" + launch_unit.net_name.substr(0, 39) + "\",\"cat\":\"launch\"") == string::npos) {
+      BMRT_LOG(FATAL, "launch of net[%s] is not in %s", launch_unit.net_name.c_str(), filename);
+    }
+  }
+}
+
 static void bmrt_api_test_case()
 {
   // prepare test data
@@ -491,6 +700,12 @@ static void bmrt_api_test_case()
 
   if (TEST_CASE == "bmrt_simple_api") {
     test_bmrt_simple_api();
+  } else if (TEST_CASE == "bmrt_launch_data_bench") {
+    test_bmrt_launch_data_bench();
+  } else if (TEST_CASE == "bmrt_launch_async") {
+    test_bmrt_launch_async();
+  } else if (TEST_CASE == "bmrt_event_trace") {
+    test_bmrt_event_trace();
   } else {
     test_bmrt_launch();
   }
@@ -10,6 +10,7 @@
 #ifndef BMRUNTIME_H_
 #define BMRUNTIME_H_
 #include <mutex>
+#include <list>
 #include <thread>
 #include <condition_variable>
 #include <unordered_map>
@@ -137,6 +138,9 @@ typedef struct {
   /* per subnet i/o tensor */
   vector<string> input_tensor_name_v;
   vector<string> output_tensor_name_v;
+  /* slot of each i/o tensor in net_stage_t::subnet_slot_name_v, compiled at load time */
+  vector<int> input_slot_v;
+  vector<int> output_slot_v;
 
   int id;
   vector<int> next_subnet_ids;
@@ -191,6 +195,20 @@ typedef struct {
   unsigned int        pad_h; /* pad_h for conv 3ic */
 } tensor_ext_t;
 
+/* cpu subnet launch arguments, sized when bound so launch does not allocate */
+typedef struct {
+  vector<float*>      input_data_v;
+  vector<float*>      output_data_v;
+  vector<vector<int>> input_shape_v;
+  vector<vector<int>> output_shape_v;
+} subnet_cpu_args_t;
+
+/* subnet tensor slots resolved against one subnet_tensor_v map */
+typedef struct {
+  vector<tensor_ext_t*>     tensor_v;     /* slot -> tensor in the bound map */
+  vector<subnet_cpu_args_t> cpu_args_v;   /* subnet id -> cpu launch arguments */
+} subnet_binding_t;
+
 typedef struct {
   uint64_t addr;
   uint64_t size;
@@ -229,6 +247,8 @@ struct net_stage_t {
 
   /* subnet i/o tensor in addtion to net i/o tensor */
   map<string, tensor_ext_t> subnet_tensor_v;
+  vector<string> subnet_slot_name_v;   /* slot -> subnet tensor name */
+  subnet_binding_t subnet_binding;     /* slots bound to subnet_tensor_v */
   // save the profile info
   vector<u8> net_profile;
   // save the net stat info
@@ -249,9 +269,52 @@ struct dyn_neuron_stage_t {
   std::vector<bm_device_mem_u64_t> neuron_mem;
 
   map<string, tensor_ext_t> subnet_tensor_v;
+  /* slots of each stage bound to subnet_tensor_v */
+  std::unordered_map<const net_stage_t*, subnet_binding_t> subnet_binding_dict;
   float* cpu_addr;
 };
 
+/* assign every subnet i/o tensor of the stage a dense slot */
+void compile_subnet_plan(net_stage_t* stage);
+/* resolve the slots of a compiled stage to the tensors of tensor_v */
+void bind_subnet_plan(const net_stage_t* stage, map<string, tensor_ext_t>* tensor_v,
+                      subnet_binding_t* binding);
+
+/* relocate one bdc/gdma command against the ctx/coeff/io memory of the stage */
+u64 fix_gdma_addr(const net_stage_t* stage, u64 origin_addr, bool is_src);
+void convert_cmd(u32* cmd, int engine_id, bool last_cmd, u64 start_address,
+                 const net_stage_t* stage);
+uint32_t get_bdc_cmd_len(const u8* bdc_buffer, u64 start_offset, bool last_cmd);
+uint32_t get_gdma_cmd_len(const u8* gdma_buffer, u64 start_offset, bool last_cmd);
+
+/* fix_gdma_addr flattened into ascending region bounds, region i is
+ * [bound[i-1], bound[i]) and maps to addr + delta[i]. Unused bounds are ~0,
+ * so the region is found without branches */
+#define CMD_RELOC_MAX_BOUND 8
+#define CMD_RELOC_SRC 0x1
+#define CMD_RELOC_DST 0x2
+struct cmd_reloc_table_t {
+  bool exact = false;       // false if the bounds do not fit, fix_gdma_addr is used then
+  u64 bound[CMD_RELOC_MAX_BOUND];
+  u64 delta[CMD_RELOC_MAX_BOUND + 1];
+  u8 access[CMD_RELOC_MAX_BOUND + 1];  // CMD_RELOC_SRC/CMD_RELOC_DST allowed in the region
+};
+
+/* commands of one group copied to cmd_buf, offset_v holds cmd_num + 1 byte offsets */
+struct cmd_group_reloc_t {
+  u32* cmd_buf;
+  vector<u32> offset_v;
+};
+
+void build_cmd_reloc_table(const net_stage_t* stage, cmd_reloc_table_t* table);
+void index_cmd_group(const u8* buffer, u32 cmd_num, int engine_id, vector<u32>* offset_v);
+/* true if the commands of the engine can be copied as a whole group and relocated afterwards */
+bool can_relocate_cmd_group(int engine_id, const cmd_reloc_table_t& table);
+void relocate_cmd_group(const cmd_group_reloc_t& group, int engine_id, u64 start_address,
+                        const net_stage_t* stage, const cmd_reloc_table_t& table);
+void relocate_cmd_groups(const vector<cmd_group_reloc_t>& group_v, int engine_id, u64 start_address,
+                         const net_stage_t* stage, const cmd_reloc_table_t& table, int thread_num);
+
 struct neuron_mem_block {
   uint64_t key;
   bool used;
@@ -300,6 +363,14 @@ struct net_ctx_t {
   tpu_kernel_allreduce_1684x_t allreduce_param;
 };
 
+/* host time spent on loading a net, in microseconds */
+struct net_load_time_t {
+  double ctx_us = 0;     // ctx/io memory and coeff upload
+  double subnet_us = 0;  // io attributes and subnet parsing
+  double ir_us = 0;      // dynamic ir upload
+  double cmd_us = 0;     // bdc/gdma relocation and upload
+};
+
 // net with cascade
 struct mem_cascade_t {
   string name;
@@ -339,7 +410,36 @@ struct net_cascade_t {
   bm_net_info_t net_info;
 };
 
+/* net and stage resolved once for a set of input shapes, reused by launch */
+struct launch_handle_t {
+  int net_idx;
+  int stage_idx;
+  net_ctx_t* net_ctx;
+  net_stage_t* stage;
+  vector<bm_shape_t> input_shapes;  // input shapes the stage is resolved for
+  vector<int32_t> core_list;        // refined cores of the stage
+};
+
+/* device io buffers of one running launch, sized to the largest stage */
+struct io_binding_slot_t {
+  vector<bm_tensor_t> inputs;
+  vector<bm_tensor_t> outputs;
+};
+
+/* reusable io of a net for launch_data: each launch takes an idle slot and
+   gives it back when done, so there are as many slots as launches ever ran
+   at once. Outputs can be bound to caller-owned host buffers */
+struct io_binding_t {
+  int net_idx;
+  vector<void*> host_outputs;       // caller-owned output buffers, NULL if not bound
+  vector<size_t> host_output_bytes;
+  std::mutex slot_mutex;
+  std::list<io_binding_slot_t> slots;
+  vector<io_binding_slot_t*> idle_slots;
+};
+
 class CascadeThread;
+class LaunchQueue;
 
 class Bmruntime {
  public:
@@ -406,6 +506,25 @@ class Bmruntime {
               uint64_t thread_idx, bool user_mem = false, const std::vector<int>& core_list={}, bool using_thread=false);
   bool launch(const net_cascade_t * net_c, const bm_tensor_t* input_tensors, int input_num,
               bm_tensor_t* output_tensors, int output_num);
+  /* resolve net and stage once, launch(handle) skips the per-call lookup */
+  const launch_handle_t* get_launch_handle(int net_idx, const bm_shape_t* input_shapes);
+  void release_launch_handle(const launch_handle_t* handle);
+  bool launch(const launch_handle_t* handle, const bm_tensor_t* input_tensors, int input_num,
+              bm_tensor_t* output_tensors, int output_num, bool user_mem = false,
+              bool user_stmode = false);
+  /* launch without blocking: the per-device queue launches and syncs, then completes the ticket */
+  uint64_t launch_async(int net_idx, const bm_tensor_t* input_tensors, int input_num,
+                        bm_tensor_t* output_tensors, int output_num, bool user_mem, bool user_stmode,
+                        const std::vector<int>& core_list, void (*callback)(void*, bool), void* user_data);
+  bool wait_launch(uint64_t ticket);
+  void stop_launch_queues();
+  /* launch with system memory io through device buffers kept by the binding */
+  io_binding_t* create_io_binding(int net_idx);
+  void destroy_io_binding(io_binding_t* binding);
+  bool bind_output(io_binding_t* binding, int output_idx, void* data, size_t bytes);
+  bool launch_data(io_binding_t* binding, void* const input_datas[], const bm_shape_t input_shapes[],
+                   int input_num, void* output_datas[], bm_shape_t output_shapes[], int output_num,
+                   bool user_mem = false, const std::vector<int>& core_list = {});
   void pre_alloc_neuron_multi_cores(int net_idx, int stage_idx, const std::vector<int> &core_list);
   void pre_alloc_neuron_multi_thread(uint64_t thread_idx, const mem_info_t* mem_info);
   void pre_alloc_neuron(int net_idx);
@@ -536,6 +655,18 @@ protected:
                  int input_num, bm_tensor_t* output_tensors, int output_num,
                  const std::vector<int32_t> &core_list, const size_t dyn_core_mask);
 
+  io_binding_slot_t* acquire_io_binding_slot(io_binding_t* binding);
+  void release_io_binding_slot(io_binding_t* binding, io_binding_slot_t* slot);
+  bool launch_data_with_slot(io_binding_t* binding, io_binding_slot_t* slot, void* const input_datas[],
+                             const bm_shape_t input_shapes[], int input_num, void* output_datas[],
+                             bm_shape_t output_shapes[], int output_num, bool user_mem,
+                             const std::vector<int>& core_list);
+  void free_io_binding(io_binding_t* binding);
+  bool launch_stage(int net_idx, int stage_idx, const std::vector<int32_t> &final_core_list,
+                    const bm_tensor_t* input_tensors, int input_num,
+                    bm_tensor_t* output_tensors, int output_num, uint64_t thread_idx,
+                    bool user_mem, bool user_stmode, bool using_thread);
+
   int get_stage_idx(const net_ctx_t* net_ctx, const bm_tensor_t* input_tensors);
   int get_static_stage_idx(const net_ctx_t* net_ctx, const bm_tensor_t* input_tensors);
   int get_dynamic_stage_idx(const net_ctx_t* net_ctx, const bm_tensor_t* input_tensors);
@@ -545,16 +676,23 @@ protected:
 
 protected:
   // functions for load bmodel
-  u64 fix_gdma_addr(const net_stage_t* stage, u64 origin_addr, bool is_src);
-  void convert_cmd(u32* cmd, int engine_id, bool last_cmd, u64 start_address,
-                   const net_stage_t* stage);
   bool setup_cmd_context(ModelCtx* model_ctx, const bmodel::NetParameter *param,
                          net_stage_t* stage, uint32_t device_id);
   bool setup_ir_context(ModelCtx* model_ctx, const bmodel::Binary* binary_ir,
                         const Vector<Offset<bmodel::StageIR>>* stage_ir, net_stage_t* stage, uint32_t device_id);
   bool load_bmodel(ModelCtx*);
-  bool load_bmodel_net(ModelCtx*, int net_idx);
-  bool load_bmodel_net(ModelCtx*, int net_idx, net_ctx_t* net_ctx);
+  bool load_bmodel_net(ModelCtx*, int net_idx, const bmodel::bmodel_mem_info_t& bmem_info);
+  bool load_bmodel_net(ModelCtx*, int net_idx, net_ctx_t* net_ctx, net_load_time_t* load_time);
+  bool prepare_bmodel_net(ModelCtx*, int net_idx, net_ctx_t* net_ctx,
+                          vector<vector<u64>>& stage_ctx_sizes, net_load_time_t* load_time);
+  void load_bmodel_stage(ModelCtx*, const NetParameter* param, net_ctx_t* net_ctx,
+                         net_stage_t* net_stage, const vector<u64>& ctx_sizes,
+                         net_load_time_t* load_time);
+  bool load_bmodel_nets_parallel(ModelCtx*, u32 load_net_num, int thread_num,
+                                 const bmodel::bmodel_mem_info_t& bmem_info);
+  bool is_net_loaded(const string& net_name);
+  void add_loaded_net(net_ctx_t* net_ctx, const bmodel::bmodel_mem_info_t& bmem_info,
+                      const net_load_time_t& load_time);
   bool cascade_net_init(const Net* net, int net_idx, net_ctx_t* net_ctx);
   void load_tpu_module(ModelCtx*);
   void load_cpu_module(ModelCtx*);
@@ -602,17 +740,13 @@ protected:
                             const T_stage *stage,
                             const bm_tensor_t *user_tensors, bool is_input);
   // function for fill tpu static subnet net info
-  template <typename T_stage>
   void fill_tpu_tensor_info(vector<tpu_tensor_info_t> &tensor_info,
-                            const T_stage *stage,
+                            const subnet_binding_t *binding,
                             const SUBNET_INFO_T *subnet,
                             const bm_tensor_t *user_tensors, bool is_input);
   void fill_tpu_cmd_info(std::vector<tpu_cmd_info_t> &cmd_info,
                          const std::vector<single_core_command_t> &core_commands,
                          const int32_t core_idx);
-  template <typename T_stage>
-  void get_tensor_attr(const T_stage *stage, const vector<string> &tensor_name_v,
-                       vector<tensor_attr_t> &input_v);
   void fill_tpu_tensor_info(vector<tpu_tensor_info_t> &tensor_info,
     const vector<tensor_attr_t> &tensor_v, const bm_tensor_t *user_tensors,
     bool is_input);
@@ -650,6 +784,10 @@ protected:                                                    // one bmruntime c
   vector<net_ctx_t*> m_net_ctx_v;
   vector<net_cascade_t> m_net_cascade_v;                      // net in cascade info
   vector<std::shared_ptr<CascadeThread>> m_cascade_thread_v;  // thread for cascade
+  std::list<launch_handle_t> m_launch_handles;               // resolved launch handles
+  std::mutex m_launch_handle_mutex;
+  std::list<io_binding_t> m_io_bindings;                     // io bindings of launch_data
+  std::mutex m_io_binding_mutex;
 
   static const int MAX_DEVICE_NUM = 32;   // one bmruntime can run 32 device at most
   bm_handle_t m_handles[MAX_DEVICE_NUM];
@@ -659,6 +797,8 @@ protected:                                                    // one bmruntime c
   bool using_internal_bm_handle; /* internal initlized bm_handle or accept from user parameter */
   int m_devids[MAX_DEVICE_NUM];
   bool using_fast_allreduce;
+  std::shared_ptr<LaunchQueue> m_launch_queues[MAX_DEVICE_NUM];  // created by the first launch_async
+  std::mutex m_launch_queue_mutex;
 
   vector<bm_device_mem_t> m_device_mem_vec;     /* save device memory address, for free */
   vector<uint32_t> m_device_mem_ids;            /* record each device memory belong which device*/
@@ -674,6 +814,9 @@ protected:                                                    // one bmruntime c
   static std::mutex m_global_cpu_const_mutex;
 
   std::mutex m_load_mutex;
+  std::mutex m_alloc_mutex;  /* device allocation may come from several loading threads */
+  int m_cmd_reloc_threads = 1;  /* threads relocating the command groups of a stage */
+  string m_reloc_cache_prefix;  /* relocation cache files of the loading bmodel, empty if disabled */
 
   bool b_enable_mmap;
   bool m_subnet_time_print;
@@ -705,13 +848,15 @@ protected:                                                    // one bmruntime c
   /* functions for subnet */
   void bmcpu_setup();
   void bmtpu_setup();
-  bool launch_cpu_subnet(net_ctx_t* net_ctx, map<string, tensor_ext_t> *subnet_tensor_v, const SUBNET_INFO_T* subnet,
+  bool launch_cpu_subnet(net_ctx_t* net_ctx, subnet_binding_t* binding, const SUBNET_INFO_T* subnet,
                          const bm_tensor_t* input_tensors, bm_shape_t real_out_shape[]);
-  bool launch_tpu_subnet(net_ctx_t* net_ctx, net_stage_t* stage, const SUBNET_INFO_T* subnet,
+  bool launch_tpu_subnet(net_ctx_t* net_ctx, net_stage_t* stage, const subnet_binding_t* binding,
+                         const SUBNET_INFO_T* subnet,
                          const bm_tensor_t* input_tensors, int input_num,
                          bm_tensor_t* output_tensors, int output_num,
                          const std::vector<int32_t> &core_list, const uint32_t dyn_core_mask, bool force_sync);
-  bool launch_tpu_ir_subnet(net_ctx_t* net_ctx, net_stage_t* stage, const SUBNET_INFO_T* subnet,
+  bool launch_tpu_ir_subnet(net_ctx_t* net_ctx, net_stage_t* stage, const subnet_binding_t* binding,
+                            const SUBNET_INFO_T* subnet,
                             const bm_tensor_t* input_tensors, const int* input_elem_num, int input_num,
                             bm_tensor_t* output_tensors, int* output_elem_num, int output_num,
                             const std::vector<int32_t> &core_list, const uint32_t dyn_core_mask);
@@ -724,11 +869,12 @@ protected:                                                    // one bmruntime c
                               const Vector<Offset<bmodel::Tensor>>* tensor_set_v, bool is_input,
                               std::set<string> subnet_switch_inputs);
   void subnet_clear(net_ctx_t* net_ctx);
-  void subnet_tensor_s2d(uint32_t devid, map<string, tensor_ext_t> *subnet_tensor_v, const string& tensor_name,
+  void subnet_tensor_s2d(uint32_t devid, tensor_ext_t& tensor_ext, const string& tensor_name,
                          bm_device_mem_t* out_dev_mem = NULL, u64 offset = 0, u64 size = 0);
-  void* subnet_tensor_d2s(uint32_t devid, map<string, tensor_ext_t> *subnet_tensor_v, const string& tensor_name,
+  void* subnet_tensor_d2s(uint32_t devid, tensor_ext_t& tensor_ext, const string& tensor_name,
                          bm_device_mem_t* out_dev_mem = NULL, u64 offset = 0, u64 size = 0);
-  void subnet_tensor_forward(uint32_t devid, map<string, tensor_ext_t> *subnet_tensor_v, const string& src_tensor, const string& dst_tensor, const bm_tensor_t* output_tensors);
+  void subnet_tensor_forward(uint32_t devid, tensor_ext_t& src_tensor, const string& src_name,
+                             tensor_ext_t& dst_tensor, const bm_tensor_t* output_tensors);
 
  protected:
   typedef void* (*t_bmcpu_init)();
@@ -999,6 +1145,52 @@ private:
   std::vector<tpu_kernel_global_move_1684x_t> *m_global_move_params;
 };
 
+/* async launches of one device: submitters only enqueue, the worker launches
+   all queued requests, syncs the device once for them and completes them in order */
+class LaunchQueue {
+public:
+  typedef void (*callback_t)(void *user_data, bool result);
+  static const int DEVICE_BITS = 5;  // ticket = seq << DEVICE_BITS | device_idx
+  static const size_t MAX_RESULTS = 1024;  // unwaited results kept, the oldest are dropped
+
+  LaunchQueue(Bmruntime *rt, bm_handle_t handle, int device_idx);
+  ~LaunchQueue();  // completes the queued requests first
+
+  uint64_t submit(int net_idx, const bm_tensor_t *input_tensors, int input_num,
+                  bm_tensor_t *output_tensors, int output_num, bool user_mem, bool user_stmode,
+                  const std::vector<int> &core_list, callback_t callback, void *user_data);
+  bool wait(uint64_t ticket);
+
+private:
+  struct request_t {
+    uint64_t seq;
+    int net_idx;
+    vector<bm_tensor_t> input_tensors;
+    bm_tensor_t *output_tensors;
+    int output_num;
+    bool user_mem;
+    bool user_stmode;
+    std::vector<int> core_list;
+    callback_t callback;
+    void *user_data;
+    bool ok;
+  };
+  void threadFunction();
+
+  Bmruntime *m_rt;
+  bm_handle_t m_handle;
+  int m_device_idx;
+  std::mutex m_mutex;
+  std::condition_variable m_submit_cond;
+  std::condition_variable m_done_cond;
+  vector<request_t> m_pending;
+  map<uint64_t, bool> m_results;  // results of the tickets without callback, until waited
+  uint64_t m_next_seq;
+  uint64_t m_done_seq;
+  bool m_stop;
+  std::thread m_worker;
+};
+
 }  // namespace bmruntime
 
 #endif
@@ -81,6 +81,11 @@ class Network {
   // if sync == false, bm_thread_sync should be called to make sure inference finished
   bm_status_t Forward(bool sync = true) const;
 
+  // resolve the stage of the given input shapes once, if shapes == NULL use the current input shapes;
+  // Forward with the handle then skips the net and stage lookup. The handle lives as long as Context
+  const void *GetLaunchHandle(const bm_shape_t *shapes = NULL) const;
+  bm_status_t Forward(const void *launch_handle, bool sync = true) const;
+
   // get input and output tensors
   const std::vector<Tensor *> &Inputs();
   const std::vector<Tensor *> &Outputs();
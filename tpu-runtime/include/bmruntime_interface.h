@@ -191,6 +191,8 @@ DECL_EXPORT uint32_t bmrt_get_flags(void* p_bmrt);
  *
  * This API is to load bmodel created by BM compiler.
  * After loading bmodel, we can run the inference of neuron network.
+ * If BM_RUNTIME_MMAP_BMODEL is set by bmrt_set_flags, the bmodel file is mapped
+ * instead of read, and runtimes in one process share the mapping of the same file.
  *
  * @param   [in]   p_bmrt        Bmruntime that had been created
  * @param   [in]   bmodel_path   Bmodel file directory.
@@ -461,6 +463,64 @@ DECL_EXPORT bool bmrt_launch_tensor(void* p_bmrt, const char * net_name, const b
 DECL_EXPORT bool bmrt_launch_tensor_ex(void* p_bmrt, const char * net_name, const bm_tensor_t input_tensors[], int input_num,
                            bm_tensor_t output_tensors[], int output_num, bool user_mem, bool user_stmode);
 
+/**
+ * @name    bmrt_get_launch_handle
+ * @brief   To resolve the network and the stage of the given input shapes once
+ * @ingroup bmruntime
+ *
+ * The returned handle holds the network index, the stage index and the input layout, so
+ * bmrt_launch_tensor_with_handle skips the network name compares and the stage scans of
+ * bmrt_launch_tensor_ex. The handle is owned by p_bmrt and freed with it; it can be released
+ * earlier by bmrt_release_launch_handle. Cascade networks are not supported.
+ *
+ * @param [in]    p_bmrt         Bmruntime that had been created
+ * @param [in]    net_name       The name of the neuron network
+ * @param [in]    stage_shapes   Array of input shape, defined like bm_shape_t stage_shapes[input_num].
+ *                               If NULL, the input shapes of the first stage are used.
+ * @param [in]    input_num      Input number
+ *
+ * @retval  void*                Launch handle; NULL if the network or the stage is not found.
+ */
+DECL_EXPORT void* bmrt_get_launch_handle(void* p_bmrt, const char* net_name,
+                                         const bm_shape_t stage_shapes[], int input_num);
+
+/**
+ * @name    bmrt_launch_tensor_with_handle
+ * @brief   To launch the inference of the neuron network resolved by bmrt_get_launch_handle
+ * @ingroup bmruntime
+ *
+ * Same as bmrt_launch_tensor_ex, but the network and the stage come from the handle. The tensors
+ * are checked as in bmrt_launch_tensor_ex; if the input shapes differ from the handle, the
+ * launch falls back to the full lookup of bmrt_launch_tensor_ex.
+ * bm_thread_sync should be called to make sure inference finished.
+ *
+ * @param [in]    p_bmrt            Bmruntime that had been created
+ * @param [in]    launch_handle     Handle returned by bmrt_get_launch_handle
+ * @param [in]    input_tensors     Array of input tensor, defined like bm_tensor_t input_tensors[input_num]
+ * @param [in]    input_num         Input number
+ * @param [out]   output_tensors    Array of output tensor, defined like bm_tensor_t output_tensors[output_num]
+ * @param [in]    output_num        Output number
+ * @param [in]    user_mem          whether device_mem of output tensors are set
+ * @param [in]    user_stmode       whether stmode of output tensors are set
+ *
+ * @retval true    Launch success.
+ * @retval false   Launch failed.
+ */
+DECL_EXPORT bool bmrt_launch_tensor_with_handle(void* p_bmrt, const void* launch_handle,
+                                                const bm_tensor_t input_tensors[], int input_num,
+                                                bm_tensor_t output_tensors[], int output_num,
+                                                bool user_mem, bool user_stmode);
+
+/**
+ * @name    bmrt_release_launch_handle
+ * @brief   To release a handle returned by bmrt_get_launch_handle before p_bmrt is destroyed
+ * @ingroup bmruntime
+ *
+ * @param [in]    p_bmrt          Bmruntime that had been created
+ * @param [in]    launch_handle   Handle returned by bmrt_get_launch_handle
+ */
+DECL_EXPORT void bmrt_release_launch_handle(void* p_bmrt, const void* launch_handle);
+
 /**
  * @name    bmrt_launch_data
  * @brief   To launch the inference of the neuron network with setting input datas in system memory
@@ -530,6 +590,134 @@ DECL_EXPORT bool bmrt_launch_data_multi_cores(void* p_bmrt, const char* net_name
                       bm_shape_t output_shapes[], int output_num, bool user_mem, const int* core_list, int core_num);
 
 
+/* called from the launch queue when an async launch completes, result is false if it failed */
+typedef void (*bmrt_launch_callback_t)(void* user_data, bool result);
+
+/**
+ * @name    bmrt_launch_tensor_async
+ * @brief   To submit the inference of the neuron network without blocking
+ * @ingroup bmruntime
+ *
+ * The launch is queued to a worker thread of the device, which launches all queued requests
+ * by the same path as bmrt_launch_tensor_ex / bmrt_launch_tensor_multi_cores, calls
+ * bm_thread_sync once for them, and then completes them in submission order. The caller must not
+ * call bm_thread_sync for it. input_tensors are copied, output_tensors must stay valid until the
+ * launch completes. Cascade networks are not supported.
+ *
+ * @param [in]    p_bmrt            Bmruntime that had been created
+ * @param [in]    net_name          The name of the neuron network
+ * @param [in]    input_tensors     Array of input tensor, defined like bm_tensor_t input_tensors[input_num]
+ * @param [in]    input_num         Input number
+ * @param [out]   output_tensors    Array of output tensor, defined like bm_tensor_t output_tensors[output_num]
+ * @param [in]    output_num        Output number
+ * @param [in]    user_mem          whether device_mem of output tensors are set
+ * @param [in]    user_stmode       whether stmode of output tensors are set
+ * @param [in]    core_list         core id list those will be used to inference, NULL for the default cores
+ * @param [in]    core_num          number of the core list
+ * @param [in]    callback          called with user_data when the launch completes. If NULL,
+ *                                  bmrt_wait_launch must be called with the returned ticket;
+ *                                  only the results of the latest 1024 unwaited tickets are kept.
+ * @param [in]    user_data         passed to callback
+ *
+ * @retval  uint64_t  Ticket of the launch; 0 if it can't be submitted.
+ */
+DECL_EXPORT uint64_t bmrt_launch_tensor_async(void* p_bmrt, const char* net_name,
+                                              const bm_tensor_t input_tensors[], int input_num,
+                                              bm_tensor_t output_tensors[], int output_num,
+                                              bool user_mem, bool user_stmode,
+                                              const int* core_list, int core_num,
+                                              bmrt_launch_callback_t callback, void* user_data);
+
+/**
+ * @name    bmrt_wait_launch
+ * @brief   To block until an async launch without callback completes
+ * @ingroup bmruntime
+ *
+ * @param [in]    p_bmrt         Bmruntime that had been created
+ * @param [in]    ticket         Ticket returned by bmrt_launch_tensor_async
+ *
+ * @retval true    Inference success.
+ * @retval false   Inference failed, or the ticket is unknown, has a callback or is already waited.
+ */
+DECL_EXPORT bool bmrt_wait_launch(void* p_bmrt, uint64_t ticket);
+
+/**
+ * @name    bmrt_create_io_binding
+ * @brief   To create reusable io buffers of a network for bmrt_launch_data_with_binding
+ * @ingroup bmruntime
+ *
+ * bmrt_launch_data allocates and frees device memory of each input and output on every call.
+ * A binding keeps sets of device buffers sized to the largest stage; each launch takes an idle
+ * set and gives it back when done, so there are as many sets as launches that ever ran at the
+ * same time. They are kept until bmrt_destroy_io_binding or bmrt_destroy.
+ *
+ * @param [in]    p_bmrt         Bmruntime that had been created
+ * @param [in]    net_name       The name of the neuron network
+ *
+ * @retval  void*                IO binding; NULL if the network is not found.
+ */
+DECL_EXPORT void* bmrt_create_io_binding(void* p_bmrt, const char* net_name);
+
+/**
+ * @name    bmrt_io_binding_set_output
+ * @brief   To bind a caller-owned system memory buffer to an output of the binding
+ * @ingroup bmruntime
+ *
+ * The output data of each later launch is copied into the buffer. Bound buffers are shared
+ * by all threads of the binding. Set data to NULL to unbind.
+ *
+ * @param [in]    p_bmrt         Bmruntime that had been created
+ * @param [in]    io_binding     IO binding created by bmrt_create_io_binding
+ * @param [in]    output_idx     Output index
+ * @param [in]    data           System memory buffer of the output
+ * @param [in]    size           Byte size of data
+ *
+ * @retval true    Bind success.
+ * @retval false   Bind failed.
+ */
+DECL_EXPORT bool bmrt_io_binding_set_output(void* p_bmrt, void* io_binding, int output_idx,
+                                            void* data, size_t size);
+
+/**
+ * @name    bmrt_launch_data_with_binding
+ * @brief   To launch the inference of the neuron network with input datas in system memory,
+ *          through the device buffers of an io binding
+ * @ingroup bmruntime
+ *
+ * Same as bmrt_launch_data_multi_cores, without device memory allocation on each call.
+ * The CPU program will be blocked until the outputs are copied back. If an output is bound by
+ * bmrt_io_binding_set_output, output_datas[i] is set to the bound buffer; otherwise it follows
+ * user_mem as bmrt_launch_data.
+ *
+ * @param [in]    p_bmrt         Bmruntime that had been created
+ * @param [in]    io_binding     IO binding created by bmrt_create_io_binding
+ * @param [in]    input_datas    Array of input data, defined like void * input_datas[input_num]
+ * @param [in]    input_shapes   Array of input shape, defined like bm_shape_t input_shapes[input_num]
+ * @param [in]    input_num      Input number
+ * @param [out]   output_datas   Array of output data, defined like void * output_datas[output_num]
+ * @param [out]   output_shapes  Array of output shape, defined like bm_shape_t output_shapes[output_num]
+ * @param [in]    output_num     Output number
+ * @param [in]    user_mem       whether output_datas[i] of unbound outputs have allocated memory
+ * @param [in]    core_list      the cores to launch on. If core_list = NULL, core_num must be 0
+ * @param [in]    core_num       number of cores to use
+ *
+ * @retval true    Launch success.
+ * @retval false   Launch failed.
+ */
+DECL_EXPORT bool bmrt_launch_data_with_binding(void* p_bmrt, void* io_binding, void* const input_datas[],
+                      const bm_shape_t input_shapes[], int input_num, void * output_datas[],
+                      bm_shape_t output_shapes[], int output_num, bool user_mem, const int* core_list, int core_num);
+
+/**
+ * @name    bmrt_destroy_io_binding
+ * @brief   To free the device buffers of an io binding before p_bmrt is destroyed
+ * @ingroup bmruntime
+ *
+ * @param [in]    p_bmrt         Bmruntime that had been created
+ * @param [in]    io_binding     IO binding created by bmrt_create_io_binding
+ */
+DECL_EXPORT void bmrt_destroy_io_binding(void* p_bmrt, void* io_binding);
+
 /**
  * @name    bmrt_trace
  * @brief   To check runtime environment, and collect info for DEBUG
@@ -542,6 +730,36 @@ DECL_EXPORT bool bmrt_launch_data_multi_cores(void* p_bmrt, const char* net_name
  */
 DECL_EXPORT void bmrt_trace(void* p_bmrt);
 
+/**
+ * @name    bmrt_enable_event_trace
+ * @brief   To turn on or off the event trace of all bmruntimes in the process
+ * @ingroup bmruntime
+ *
+ * The event trace records the time of each launch, subnet, memcpy and sync into a fixed-size
+ * ring buffer of the calling thread, keeping the latest BMRUNTIME_EVENT_TRACE_SIZE events
+ * (4096 by default). It is cheap enough to keep on, and can also be turned on by
+ * BMRUNTIME_ENABLE_EVENT_TRACE=1. If BMRUNTIME_EVENT_TRACE_SIGNAL is set to a signal number,
+ * the signal dumps the trace to bmrt_event_trace_<pid>_<n>.json in the working directory.
+ *
+ * @param [in]    enable         true to record events, false to stop recording
+ */
+DECL_EXPORT void bmrt_enable_event_trace(bool enable);
+
+/**
+ * @name    bmrt_dump_event_trace
+ * @brief   To write the recorded events of all threads as Chrome trace JSON
+ * @ingroup bmruntime
+ *
+ * The file can be opened by chrome://tracing or https://ui.perfetto.dev. Recording
+ * goes on during and after the dump.
+ *
+ * @param [in]    filename       Path of the JSON file
+ *
+ * @retval true    Dump success.
+ * @retval false   Dump failed.
+ */
+DECL_EXPORT bool bmrt_dump_event_trace(const char* filename);
+
 /**
  * @name    bmrt_launch_tensor_multi_cores
  * @brief   To launch the inference of the neuron network with setting input tensors, and support multi core inference.
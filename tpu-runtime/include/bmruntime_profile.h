@@ -6,6 +6,7 @@
 #include <string.h>
 #include <memory>
 #include <functional>
+#include <atomic>
 #include "bmrt_arch_info.h"
 #include "bmruntime_common.h"
 #ifdef __linux__
@@ -23,6 +24,10 @@
 #define ENV_DISABLE_BDC "BMRUNTIME_DISABLE_BDC_PERF"
 #define ENV_DISABLE_ARM "BMRUNTIME_DISABLE_ARM_PERF"
 
+#define ENV_ENABLE_EVENT_TRACE "BMRUNTIME_ENABLE_EVENT_TRACE"
+#define ENV_EVENT_TRACE_SIZE "BMRUNTIME_EVENT_TRACE_SIZE"
+#define ENV_EVENT_TRACE_SIGNAL "BMRUNTIME_EVENT_TRACE_SIGNAL"
+
 #define PROFILE_ENGINE_MCU 0
 #define PROFILE_ENGINE_GDMA 1
 #define PROFILE_ENGINE_TIU 2
@@ -207,6 +212,49 @@ protected:
     bool enable = false;
 };
 
+typedef enum {
+    TRACE_LAUNCH = 0,
+    TRACE_SUBNET = 1,
+    TRACE_MEMCPY = 2,
+    TRACE_SYNC   = 3,
+} trace_event_type_t;
+
+/*
+ * Always-on event trace, independent of the device profile above.
+ * Each thread records into its own fixed-size ring, overwriting the oldest events,
+ * without lock or allocation once the ring exists. dump() writes the rings of all
+ * threads as Chrome trace JSON, which chrome://tracing and Perfetto open.
+ */
+class BMEventTrace {
+public:
+    static bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+    static void set_enable(bool is_enable);
+    // install the dump signal handler of ENV_EVENT_TRACE_SIGNAL, once per process
+    static void setup();
+    static u64 now_ns();
+    static void record(trace_event_type_t type, const char* name, u64 begin_ns, long long arg);
+    static bool dump(const char* filename);
+
+private:
+    static std::atomic<bool> s_enabled;
+};
+
+class BMEventTraceScope {
+public:
+    BMEventTraceScope(trace_event_type_t type, const char* name, long long arg = 0)
+        : type(type), name(name), arg(arg),
+          begin_ns(BMEventTrace::enabled() ? BMEventTrace::now_ns() : 0) {}
+    ~BMEventTraceScope() {
+        if (begin_ns) BMEventTrace::record(type, name, begin_ns, arg);
+    }
+
+private:
+    trace_event_type_t type;
+    const char* name;
+    long long arg;
+    u64 begin_ns;
+};
+
 }
 
 #endif // BMRUNTIME_PROFILE_H
@@ -61,6 +61,12 @@ target_link_libraries(bmrt_test bmrt  bmrt_static)
 target_compile_definitions(bmrt_test PRIVATE
     VER="${revision}")
 
+add_executable(bmrt_subnet_plan_bench app/bmrt_subnet_plan_bench.cpp)
+target_link_libraries(bmrt_subnet_plan_bench bmrt_static)
+
+add_executable(bmrt_cmd_reloc_bench app/bmrt_cmd_reloc_bench.cpp)
+target_link_libraries(bmrt_cmd_reloc_bench bmrt_static)
+
 set(runner_srcs
     app/model_runner/cnpy.cpp
     app/model_runner/model_runner.cpp)
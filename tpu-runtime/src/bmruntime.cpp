@@ -9,6 +9,8 @@
 #ifdef __linux__
 #include <unistd.h>
 #include <atomic>
+#include <algorithm>
+#include <exception>
 #endif
 #include <string.h>
 #include <stdlib.h>
@@ -455,6 +457,11 @@ void Bmruntime::uninit_cpu_handles() {
 
 /* free device memory */
 void Bmruntime::free_device_memory() {
+  for (auto &binding : m_io_bindings) {
+    free_io_binding(&binding);
+  }
+  m_io_bindings.clear();
+
   for (size_t i = 0; i < m_device_mem_vec.size(); i++) {
     auto &dev_mem = m_device_mem_vec[i];
     auto id = m_device_mem_ids[i];
@@ -512,6 +519,9 @@ void Bmruntime::free_bm_handle_and_custom_cpu_handles() {
 
 void Bmruntime::destory_without_coeff()
 {
+  // step0: complete the async launches
+  stop_launch_queues();
+
   // step1: uninit cpu handles
   uninit_cpu_handles();
 
@@ -530,6 +540,9 @@ void Bmruntime::destory_without_coeff()
 
 Bmruntime::~Bmruntime()
 {
+  // step0: complete the async launches
+  stop_launch_queues();
+
   // step1: uninit cpu handles
   uninit_cpu_handles();
 
@@ -652,7 +665,7 @@ void Bmruntime::bmcpu_setup()
   }
 }
 
-u64 Bmruntime::fix_gdma_addr(const net_stage_t* stage, u64 origin_addr, bool is_src)
+u64 fix_gdma_addr(const net_stage_t* stage, u64 origin_addr, bool is_src)
 {
   if (origin_addr < CTX_START_ADDR) {
 #ifdef SOC_MODE
@@ -679,8 +692,8 @@ u64 Bmruntime::fix_gdma_addr(const net_stage_t* stage, u64 origin_addr, bool is_
   return origin_addr + stage->ctx_offset[mem_index];
 }
 
-void Bmruntime::convert_cmd(u32* cmd, int engine_id, bool last_cmd, u64 start_address,
-                            const net_stage_t* stage)
+void convert_cmd(u32* cmd, int engine_id, bool last_cmd, u64 start_address,
+                 const net_stage_t* stage)
 {
   ENGINE_ID id = (ENGINE_ID)(engine_id);
   BMRT_ASSERT_INFO(id == ENGINE_BD || id == ENGINE_GDMA,"id:%d should be ENGINE_BD:0 or ENGINE_GDMA:1\n",id);
@@ -919,6 +932,239 @@ void Bmruntime::convert_cmd(u32* cmd, int engine_id, bool last_cmd, u64 start_ad
   }
 }
 
+/* below this many commands in a stage, threads cost more than they save */
+#define CMD_RELOC_PARALLEL_MIN 4096
+
+void build_cmd_reloc_table(const net_stage_t* stage, cmd_reloc_table_t* table)
+{
+  // the same regions fix_gdma_addr walks through, in the same order
+  u64 below_ctx_delta = 0;
+#ifdef SOC_MODE
+  below_ctx_delta = bmrt_arch_info::get_gmem_offset_soc();
+#endif
+  bool io_alone = stage->io_size > 0;
+  vector<u64> bound_v, delta_v;
+  vector<u8> access_v;
+  bound_v.push_back(CTX_START_ADDR);
+  delta_v.push_back(below_ctx_delta);
+  access_v.push_back(CMD_RELOC_SRC | CMD_RELOC_DST);
+  bound_v.push_back(io_alone ? stage->io_start : stage->ctx_start);
+  delta_v.push_back(stage->coeff_offset);
+  access_v.push_back(CMD_RELOC_SRC);
+  if (io_alone) {
+    bound_v.push_back(stage->ctx_start);
+    delta_v.push_back(stage->io_offset);
+    access_v.push_back(CMD_RELOC_SRC | CMD_RELOC_DST);
+  }
+  for (size_t i = 0; i < stage->ctx_borders.size() && i < stage->ctx_offset.size(); i++) {
+    bound_v.push_back(stage->ctx_start + stage->ctx_borders[i]);
+    delta_v.push_back(stage->ctx_offset[i]);
+    access_v.push_back(CMD_RELOC_SRC | CMD_RELOC_DST);
+  }
+  table->exact = bound_v.size() <= CMD_RELOC_MAX_BOUND &&
+                 stage->ctx_borders.size() == stage->ctx_offset.size() &&
+                 std::is_sorted(bound_v.begin(), bound_v.end());
+  // past the last ctx border, fix_gdma_addr reports the overflow
+  for (int i = 0; i <= CMD_RELOC_MAX_BOUND; i++) {
+    bool used = i < (int)bound_v.size();
+    if (i < CMD_RELOC_MAX_BOUND) {
+      table->bound[i] = used ? bound_v[i] : ~0ull;
+    }
+    table->delta[i] = used ? delta_v[i] : 0;
+    table->access[i] = used ? access_v[i] : 0;
+  }
+}
+
+/* with ascending bounds, the region is the number of bounds not above addr.
+ * An address that needs no relocation keeps its value */
+static inline u64 reloc_addr(const cmd_reloc_table_t& table, const net_stage_t* stage,
+                             u64 addr, bool is_src, bool need_reloc)
+{
+  u32 region = 0;
+  for (int i = 0; i < CMD_RELOC_MAX_BOUND; i++) {
+    region += addr >= table.bound[i];
+  }
+  bool allowed = table.access[region] & (is_src ? CMD_RELOC_SRC : CMD_RELOC_DST);
+  if (need_reloc & !allowed) {
+    return fix_gdma_addr(stage, addr, is_src);
+  }
+  return addr + (table.delta[region] & (0 - (u64)need_reloc));
+}
+
+bool can_relocate_cmd_group(int engine_id, const cmd_reloc_table_t& table)
+{
+  switch (bmrt_arch_info::get_bmtpu_arch()) {
+    case BM1684:
+      return engine_id == ENGINE_GDMA && table.exact;
+    case BM1684X:
+    case BM1688:
+      return engine_id == ENGINE_BD || table.exact;
+    case SG2380:
+    case BM1690:
+    case MARS3:
+    case SGTPUV8:
+      return true;
+    default:
+      // convert_cmd of the other archs may rewrite bytes past a short command,
+      // which are then overwritten by the next one, so keep copying one by one
+      return false;
+  }
+}
+
+/* the fields are rewritten even if unchanged, which leaves them as they were */
+static void relocate_gdma_1684(const cmd_group_reloc_t& group, const net_stage_t* stage,
+                               const cmd_reloc_table_t& table)
+{
+  u32 cmd_num = group.offset_v.size() - 1;
+  for (u32 i = 0; i < cmd_num; i++) {
+    u32* cmd = group.cmd_buf + group.offset_v[i] / sizeof(u32);
+    if (i == cmd_num - 1)
+      cmd[0] |= (1 << 2);
+    u32 gdma_direction = (cmd[0] >> 6) & 0x3;
+    bool fix_src = GDMA_DIR_S2L == gdma_direction || GDMA_DIR_S2S == gdma_direction;
+    bool fix_dst = GDMA_DIR_L2S == gdma_direction || GDMA_DIR_S2S == gdma_direction;
+    u64 src_addr = (u64)cmd[16] + (((u64)(cmd[18] & 0xff)) << 32);
+    u64 fix_addr = reloc_addr(table, stage, src_addr, true, fix_src);
+    cmd[16] = fix_addr & 0xffffffff;
+    cmd[18] = ((u32)((fix_addr >> 32) & 0xff)) | (cmd[18] & 0xffffff00);
+    u64 dst_addr = (u64)cmd[17] + (((u64)((cmd[18] >> 8) & 0xff)) << 32);
+    fix_addr = reloc_addr(table, stage, dst_addr, false, fix_dst);
+    cmd[17] = fix_addr & 0xffffffff;
+    cmd[18] = ((u32)(((fix_addr >> 32) << 8) & 0xff00)) | (cmd[18] & 0xffff00ff);
+  }
+}
+
+/* address field at cmd[lo_idx] and the low byte of cmd[lo_idx + 1], as in 1684x/1688 gdma */
+static inline void relocate_field_40bit(u32* cmd, int lo_idx, u64 addr_mask, u64 tag, bool need_reloc,
+                                        const net_stage_t* stage, const cmd_reloc_table_t& table,
+                                        bool is_src)
+{
+  u64 addr = ((u64)(cmd[lo_idx + 1] & 0xff) << 32) | ((u64)cmd[lo_idx]);
+  u64 fix_addr = reloc_addr(table, stage, addr & addr_mask, is_src, need_reloc);
+  fix_addr = need_reloc ? (fix_addr | tag) : addr;
+  cmd[lo_idx] = fix_addr & 0xffffffff;
+  cmd[lo_idx + 1] = ((u32)((fix_addr >> 32) & 0xff)) | (cmd[lo_idx + 1] & 0xffffff00);
+}
+
+static void relocate_gdma_1684x(const cmd_group_reloc_t& group, const net_stage_t* stage,
+                                const cmd_reloc_table_t& table)
+{
+  const u64 global_start = GLOBAL_MEM_START_ADDR;
+  u32 cmd_num = group.offset_v.size() - 1;
+  // the last command is sys end, it is never relocated
+  for (u32 i = 0; i + 1 < cmd_num; i++) {
+    u32* cmd = group.cmd_buf + group.offset_v[i] / sizeof(u32);
+    u64 src_addr = ((u64)(cmd[17] & 0xff) << 32) | ((u64)cmd[16]);
+    u64 dst_addr = ((u64)(cmd[19] & 0xff) << 32) | ((u64)cmd[18]);
+    u64 index_addr = ((u64)(cmd[21] & 0xff) << 32) | ((u64)cmd[20]);
+    u32 cmd_type = cmd[1] & 0xf;
+    u32 const_fill = cmd[1] & 0x80;
+    bool has_index = cmd_type == 2 || cmd_type == 7 || cmd_type == 8;
+    relocate_field_40bit(cmd, 16, ~0ull, 0, src_addr >= global_start && !(cmd_type == 0 && const_fill),
+                         stage, table, true);
+    relocate_field_40bit(cmd, 18, ~0ull, 0, dst_addr >= global_start, stage, table, false);
+    relocate_field_40bit(cmd, 20, ~0ull, 0, has_index && index_addr >= global_start, stage, table, true);
+  }
+}
+
+static void relocate_gdma_1688(const cmd_group_reloc_t& group, const net_stage_t* stage,
+                               const cmd_reloc_table_t& table)
+{
+  if (stage->io_size <= 0) {
+    return;
+  }
+  const u64 addr_mask = (1ull << 35) - 1;
+  const u64 tag = 1ull << 39;
+  // global address: bit 39 set and bits [36, 39) clear
+  auto is_global = [](u64 addr) { return ((addr >> 36) & 0xf) == 0x8; };
+  u32 cmd_num = group.offset_v.size() - 1;
+  for (u32 i = 0; i + 1 < cmd_num; i++) {
+    u32* cmd = group.cmd_buf + group.offset_v[i] / sizeof(u32);
+    u32 cmd_type = cmd[1] & 0x0f;
+    if (cmd_type == 6) {
+      continue; // DMA_sys, only 16 bytes long
+    }
+    u64 src_addr = ((u64)(cmd[17] & 0xff) << 32) | ((u64)cmd[16]);
+    u64 dst_addr = ((u64)(cmd[19] & 0xff) << 32) | ((u64)cmd[18]);
+    u64 index_addr = ((u64)(cmd[21] & 0xff) << 32) | ((u64)cmd[20]);
+    u32 const_fill = cmd[1] & 0x80;
+    bool has_index = cmd_type == 2 || cmd_type == 7 || cmd_type == 8 || cmd_type == 0xa || cmd_type == 0xb;
+    relocate_field_40bit(cmd, 16, addr_mask, tag, is_global(src_addr) && !(cmd_type == 0 && const_fill),
+                         stage, table, true);
+    relocate_field_40bit(cmd, 18, addr_mask, tag, is_global(dst_addr), stage, table, false);
+    relocate_field_40bit(cmd, 20, addr_mask, tag, has_index && is_global(index_addr), stage, table, true);
+  }
+}
+
+void relocate_cmd_group(const cmd_group_reloc_t& group, int engine_id, u64 start_address,
+                        const net_stage_t* stage, const cmd_reloc_table_t& table)
+{
+  u32 cmd_num = group.offset_v.size() - 1;
+  if (cmd_num == 0) {
+    return;
+  }
+  auto arch = bmrt_arch_info::get_bmtpu_arch();
+  if (!can_relocate_cmd_group(engine_id, table)) {
+    for (u32 i = 0; i < cmd_num; i++) {
+      convert_cmd(group.cmd_buf + group.offset_v[i] / sizeof(u32), engine_id,
+                  i == cmd_num - 1, start_address, stage);
+    }
+  } else if (engine_id == ENGINE_BD) {
+    // nothing to relocate in bdc commands of these archs
+  } else if (arch == BM1684) {
+    relocate_gdma_1684(group, stage, table);
+  } else if (arch == BM1684X) {
+    relocate_gdma_1684x(group, stage, table);
+  } else if (arch == BM1688) {
+    relocate_gdma_1688(group, stage, table);
+  }
+}
+
+void relocate_cmd_groups(const vector<cmd_group_reloc_t>& group_v, int engine_id, u64 start_address,
+                         const net_stage_t* stage, const cmd_reloc_table_t& table, int thread_num)
+{
+  size_t cmd_num = 0;
+  for (auto& group : group_v) {
+    cmd_num += group.offset_v.size() - 1;
+  }
+  // the groups write to disjoint parts of the command buffer
+  thread_num = std::min<int>(thread_num, group_v.size());
+  if (thread_num <= 1 || cmd_num < CMD_RELOC_PARALLEL_MIN) {
+    for (auto& group : group_v) {
+      relocate_cmd_group(group, engine_id, start_address, stage, table);
+    }
+    return;
+  }
+  std::atomic<size_t> next_group(0);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto worker = [&]() {
+    size_t idx;
+    while ((idx = next_group++) < group_v.size()) {
+      try {
+        relocate_cmd_group(group_v[idx], engine_id, start_address, stage, table);
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        next_group = group_v.size();
+      }
+    }
+  };
+  vector<std::thread> threads;
+  for (int i = 1; i < thread_num; i++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& t : threads) {
+    t.join();
+  }
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
 bool Bmruntime::launch(int net_idx, const int input_num, const bm_device_mem_t* input_mems,
                        int* input_shapes, int* input_dims, int* in_stmode, int output_num,
                        const bm_device_mem_t* output_mems, int* out_stmode, bm_shape_t * output_shapes)
@@ -984,6 +1230,7 @@ bool Bmruntime::launch(int net_idx, const int input_num, const bm_device_mem_t*
   bool ret = launch(net_idx, input_tensors, input_num, output_tensors, output_num, true, user_stmode);
   // sync is needed for profile save data
   if (ret == true && m_profile->is_enabled()){
+    BMEventTraceScope trace_scope(TRACE_SYNC, "bm_thread_sync", -1);
     ret = (BM_SUCCESS == bm_thread_sync(m_handles[devid]));
   }
   if (!ret) {
@@ -1001,6 +1248,7 @@ bool Bmruntime::launch(int net_idx, const int input_num, const bm_device_mem_t*
 void Bmruntime::sync_cores(bm_handle_t handle, const std::vector<int32_t>& core_list)
 {
   for (int core_idx=0; core_idx<core_list.size(); core_idx++) {
+      BMEventTraceScope trace_scope(TRACE_SYNC, "bm_thread_sync_from_core", core_list[core_idx]);
       bm_status_t status = bm_thread_sync_from_core(handle, core_list[core_idx]);
       if (BM_SUCCESS != status) {
         BMRT_LOG(WRONG, "launch failed, status:%d", status);
@@ -1523,9 +1771,83 @@ bool Bmruntime::launch(int net_idx, const bm_tensor_t *input_tensors,
   auto core_num = stage->core_commands.size();
   std::vector<int32_t> core_list(core_num);
   std::iota(core_list.begin(), core_list.end(), 0);
+  auto final_core_list = refine_core_list(stage, core_list, m_handles[net_ctx->device_id]);
 
-  return launch_multi_cores(net_idx, input_tensors, input_num, output_tensors,
-                            output_num, 0, core_list, user_mem, user_stmode);
+  if (false == check_launch_params(net_ctx, stage, input_tensors, input_num, output_tensors, output_num, user_stmode)) {
+    return false;
+  }
+  return launch_stage(net_idx, stage_idx, final_core_list, input_tensors, input_num,
+                      output_tensors, output_num, 0, user_mem, user_stmode, false);
+}
+
+const launch_handle_t *Bmruntime::get_launch_handle(int net_idx, const bm_shape_t *input_shapes)
+{
+  if (net_idx < 0 || net_idx >= (int)m_net_ctx_v.size()) {
+    BMRT_LOG(WRONG, "net idx:%d invalid", net_idx);
+    return NULL;
+  }
+  auto net_ctx = m_net_ctx_v[net_idx];
+  int input_num = net_ctx->input_name_v.size();
+  std::vector<bm_tensor_t> input_tensors(input_num);
+  for (int idx = 0; idx < input_num; idx++) {
+    input_tensors[idx].dtype = net_ctx->input_type_v[idx];
+    input_tensors[idx].st_mode = BM_STORE_1N;
+    input_tensors[idx].shape = input_shapes ? input_shapes[idx] : net_ctx->stage_v[0]->input_v[idx].shape;
+  }
+  int stage_idx = get_stage_idx(net_ctx, input_tensors.data());
+  if (stage_idx == -1) {
+    BMRT_LOG(WRONG, "Shapes of the input tensors are not supported");
+    return NULL;
+  }
+  auto stage = net_ctx->stage_v[stage_idx];
+  std::vector<int32_t> core_list(stage->core_commands.size());
+  std::iota(core_list.begin(), core_list.end(), 0);
+
+  launch_handle_t handle;
+  handle.net_idx = net_idx;
+  handle.stage_idx = stage_idx;
+  handle.net_ctx = net_ctx;
+  handle.stage = stage;
+  handle.core_list = refine_core_list(stage, core_list, m_handles[net_ctx->device_id]);
+  for (auto &tensor : input_tensors) {
+    handle.input_shapes.push_back(tensor.shape);
+  }
+  std::lock_guard<std::mutex> guard(m_launch_handle_mutex);
+  m_launch_handles.push_back(std::move(handle));
+  return &m_launch_handles.back();
+}
+
+void Bmruntime::release_launch_handle(const launch_handle_t *handle)
+{
+  std::lock_guard<std::mutex> guard(m_launch_handle_mutex);
+  for (auto it = m_launch_handles.begin(); it != m_launch_handles.end(); ++it) {
+    if (&*it == handle) {
+      m_launch_handles.erase(it);
+      return;
+    }
+  }
+  BMRT_LOG(WRONG, "launch handle %p is not created by this runtime", handle);
+}
+
+bool Bmruntime::launch(const launch_handle_t *handle, const bm_tensor_t *input_tensors,
+                       int input_num, bm_tensor_t *output_tensors, int output_num,
+                       bool user_mem, bool user_stmode)
+{
+  // net and stage are resolved, inputs of other shapes go through the full lookup
+  if (input_tensors != NULL && input_num == (int)handle->input_shapes.size()) {
+    for (int idx = 0; idx < input_num; idx++) {
+      if (!bmrt_shape_is_same(&input_tensors[idx].shape, &handle->input_shapes[idx])) {
+        return launch(handle->net_idx, input_tensors, input_num, output_tensors, output_num,
+                      user_mem, user_stmode);
+      }
+    }
+  }
+  if (false == check_launch_params(handle->net_ctx, handle->stage, input_tensors, input_num,
+                                   output_tensors, output_num, user_stmode)) {
+    return false;
+  }
+  return launch_stage(handle->net_idx, handle->stage_idx, handle->core_list, input_tensors,
+                      input_num, output_tensors, output_num, 0, user_mem, user_stmode, false);
 }
 
 std::vector<int32_t>
@@ -1832,19 +2154,6 @@ bool Bmruntime::launch_multi_cores(int net_idx,
                                    const std::vector<int> &core_list,
                                    bool user_mem, bool user_stmode, bool using_thread) {
   auto net_ctx = m_net_ctx_v[net_idx];
-  auto devid = net_ctx->device_id;
-  bool save_io = false;
-  char *nt = getenv("BMRT_SAVE_IO_TENSORS");
-  if (nt != nullptr)
-      save_io = static_cast<bool>(atoi(nt));
-  if (save_io)
-      saveData(m_handles[devid], "input_ref_data.dat.bmrt", input_tensors, input_num);
-
-  static int save_count = 0;
-  BMRT_LOG_RUN(DUMP, {
-      std::string filename = std::string("tensor_dev")+std::to_string(devid) + "_" +std::to_string(save_count) + "_in";
-      saveDataExt(m_handles[devid], filename, input_tensors, input_num);
-  });
 
   // check parameters
   int stage_idx = get_stage_idx(net_ctx, input_tensors);
@@ -1855,11 +2164,37 @@ bool Bmruntime::launch_multi_cores(int net_idx,
   auto& stage = net_ctx->stage_v[stage_idx];
 
   // process core list
-  auto final_core_list = refine_core_list(stage, core_list, m_handles[devid]);
+  auto final_core_list = refine_core_list(stage, core_list, m_handles[net_ctx->device_id]);
 
   if (false == check_launch_params(net_ctx, stage, input_tensors, input_num, output_tensors, output_num, user_stmode)) {
     return false;
   }
+  return launch_stage(net_idx, stage_idx, final_core_list, input_tensors, input_num,
+                      output_tensors, output_num, thread_idx, user_mem, user_stmode, using_thread);
+}
+
+bool Bmruntime::launch_stage(int net_idx, int stage_idx,
+                             const std::vector<int32_t> &final_core_list,
+                             const bm_tensor_t *input_tensors, int input_num,
+                             bm_tensor_t *output_tensors, int output_num,
+                             uint64_t thread_idx, bool user_mem, bool user_stmode,
+                             bool using_thread) {
+  auto net_ctx = m_net_ctx_v[net_idx];
+  BMEventTraceScope trace_scope(TRACE_LAUNCH, net_ctx->net_name.c_str(), stage_idx);
+  auto devid = net_ctx->device_id;
+  auto& stage = net_ctx->stage_v[stage_idx];
+  bool save_io = false;
+  char *nt = getenv("BMRT_SAVE_IO_TENSORS");
+  if (nt != nullptr)
+      save_io = static_cast<bool>(atoi(nt));
+  if (save_io)
+      saveData(m_handles[devid], "input_ref_data.dat.bmrt", input_tensors, input_num);
+
+  static int save_count = 0;
+  BMRT_LOG_RUN(DUMP, {
+      std::string filename = std::string("tensor_dev")+std::to_string(devid) + "_" +std::to_string(save_count) + "_in";
+      saveDataExt(m_handles[devid], filename, input_tensors, input_num);
+  });
 
   bool use_multi_subnet = stage->subnet_num > 1 ||
                           (stage->subnet_num == 1 && stage->subnet_v[0]->subnet_mode == SUBNET_MODE_CPU);
@@ -1895,6 +2230,7 @@ bool Bmruntime::launch_multi_cores(int net_idx,
         ret = launch_multi_subnet(net_ctx, stage, input_tensors, input_num, output_tensors,
                                      output_num, final_core_list, core_mask);
   } else {
+      BMEventTraceScope subnet_trace_scope(TRACE_SUBNET, net_ctx->net_name.c_str(), 0);
       m_profile->begin_subnet(net_ctx, 0, 0, SUBNET_MODE_TPU);
       m_profile->set_extra_data(net_ctx->is_dynamic);
       if(net_ctx->is_dynamic) {
@@ -2552,6 +2888,7 @@ bool Bmruntime::launch_multi_cores(int net_idx, void* const input_datas[], const
 
   for (int i = 0; i < input_num; i++) {
     bmrt_tensor(&input_tensors[i], this, net_ctx->input_type_v[i], input_shapes[i]);
+    BMEventTraceScope trace_scope(TRACE_MEMCPY, "s2d", bmrt_tensor_bytesize(&input_tensors[i]));
     bm_memcpy_s2d(m_handles[devid], input_tensors[i].device_mem, (void*)input_datas[i]);
   }
 
@@ -2560,6 +2897,7 @@ bool Bmruntime::launch_multi_cores(int net_idx, void* const input_datas[], const
 
   // sync is needed for the following d2s to fetch output data
   if (ret){
+    BMEventTraceScope trace_scope(TRACE_SYNC, "bm_thread_sync", -1);
     ret = (BM_SUCCESS == bm_thread_sync(m_handles[devid]));
   }
   if (!ret) {
@@ -2571,6 +2909,7 @@ bool Bmruntime::launch_multi_cores(int net_idx, void* const input_datas[], const
       }
     }
     for (int i = 0; i < output_num; i++) {
+      BMEventTraceScope trace_scope(TRACE_MEMCPY, "d2s", bmrt_tensor_bytesize(&output_tensors[i]));
       bm_memcpy_d2s_partial(m_handles[devid], output_datas[i], output_tensors[i].device_mem,
                             bmrt_tensor_bytesize(&output_tensors[i]));
       free_device_mem(devid, output_tensors[i].device_mem);
@@ -2583,6 +2922,247 @@ bool Bmruntime::launch_multi_cores(int net_idx, void* const input_datas[], const
   return ret;
 }
 
+uint64_t Bmruntime::launch_async(int net_idx, const bm_tensor_t *input_tensors, int input_num,
+                                 bm_tensor_t *output_tensors, int output_num, bool user_mem,
+                                 bool user_stmode, const std::vector<int> &core_list,
+                                 void (*callback)(void *, bool), void *user_data)
+{
+  auto devid = m_net_ctx_v[net_idx]->device_id;
+  // refine_core_list fails hard on a bad core id, catch it before the worker thread does
+  uint32_t arch_core_num = 0;
+  bm_get_tpu_scalar_num(m_handles[devid], &arch_core_num);
+  for (auto core_idx : core_list) {
+    if (core_idx < 0 || core_idx >= (int)arch_core_num) {
+      BMRT_LOG(WRONG, "invalid core_id:%d, arch max core id:%d", core_idx, (int)arch_core_num - 1);
+      return 0;
+    }
+  }
+  std::shared_ptr<LaunchQueue> queue;
+  {
+    std::lock_guard<std::mutex> guard(m_launch_queue_mutex);
+    if (!m_launch_queues[devid]) {
+      m_launch_queues[devid] = std::make_shared<LaunchQueue>(this, m_handles[devid], devid);
+    }
+    queue = m_launch_queues[devid];
+  }
+  return queue->submit(net_idx, input_tensors, input_num, output_tensors, output_num, user_mem,
+                       user_stmode, core_list, callback, user_data);
+}
+
+bool Bmruntime::wait_launch(uint64_t ticket)
+{
+  int devid = ticket & ((1 << LaunchQueue::DEVICE_BITS) - 1);
+  std::shared_ptr<LaunchQueue> queue;
+  {
+    std::lock_guard<std::mutex> guard(m_launch_queue_mutex);
+    queue = m_launch_queues[devid];
+  }
+  if (!queue) {
+    BMRT_LOG(WRONG, "launch ticket %llu is not submitted", (unsigned long long)ticket);
+    return false;
+  }
+  return queue->wait(ticket);
+}
+
+void Bmruntime::stop_launch_queues()
+{
+  std::lock_guard<std::mutex> guard(m_launch_queue_mutex);
+  for (auto &queue : m_launch_queues) {
+    queue.reset();
+  }
+}
+
+io_binding_t *Bmruntime::create_io_binding(int net_idx)
+{
+  if (net_idx < 0 || net_idx >= (int)m_net_ctx_v.size()) {
+    BMRT_LOG(WRONG, "net idx:%d invalid", net_idx);
+    return NULL;
+  }
+  std::lock_guard<std::mutex> guard(m_io_binding_mutex);
+  m_io_bindings.emplace_back();
+  auto &binding = m_io_bindings.back();
+  binding.net_idx = net_idx;
+  binding.host_outputs.assign(m_net_ctx_v[net_idx]->output_name_v.size(), NULL);
+  binding.host_output_bytes.assign(binding.host_outputs.size(), 0);
+  return &binding;
+}
+
+void Bmruntime::free_io_binding(io_binding_t *binding)
+{
+  auto devid = m_net_ctx_v[binding->net_idx]->device_id;
+  for (auto &slot : binding->slots) {
+    for (auto &tensor : slot.inputs) {
+      free_device_mem(devid, tensor.device_mem);
+    }
+    for (auto &tensor : slot.outputs) {
+      free_device_mem(devid, tensor.device_mem);
+    }
+  }
+  binding->idle_slots.clear();
+  binding->slots.clear();
+}
+
+void Bmruntime::destroy_io_binding(io_binding_t *binding)
+{
+  std::lock_guard<std::mutex> guard(m_io_binding_mutex);
+  for (auto it = m_io_bindings.begin(); it != m_io_bindings.end(); ++it) {
+    if (&*it == binding) {
+      free_io_binding(binding);
+      m_io_bindings.erase(it);
+      return;
+    }
+  }
+  BMRT_LOG(WRONG, "io binding %p is not created by this runtime", binding);
+}
+
+bool Bmruntime::bind_output(io_binding_t *binding, int output_idx, void *data, size_t bytes)
+{
+  if (output_idx < 0 || output_idx >= (int)binding->host_outputs.size()) {
+    BMRT_LOG(WRONG, "output idx:%d invalid", output_idx);
+    return false;
+  }
+  binding->host_outputs[output_idx] = data;
+  binding->host_output_bytes[output_idx] = data ? bytes : 0;
+  return true;
+}
+
+io_binding_slot_t *Bmruntime::acquire_io_binding_slot(io_binding_t *binding)
+{
+  {
+    std::lock_guard<std::mutex> guard(binding->slot_mutex);
+    if (!binding->idle_slots.empty()) {
+      auto slot = binding->idle_slots.back();
+      binding->idle_slots.pop_back();
+      return slot;
+    }
+  }
+  // all slots are running, alloc one more for the largest stage
+  auto net_ctx = m_net_ctx_v[binding->net_idx];
+  auto &net_info = net_ctx->net_info;
+  io_binding_slot_t slot;
+  slot.inputs.resize(net_info.input_num);
+  slot.outputs.resize(net_info.output_num);
+  vector<std::pair<bm_tensor_t*, u64>> allocs;
+  for (int i = 0; i < net_info.input_num; i++) {
+    auto &tensor = slot.inputs[i];
+    tensor.dtype = net_info.input_dtypes[i];
+    tensor.st_mode = BM_STORE_1N;
+    tensor.shape = net_info.stages[0].input_shapes[i];
+    allocs.push_back(std::make_pair(&tensor, (u64)net_info.max_input_bytes[i]));
+  }
+  for (int i = 0; i < net_info.output_num; i++) {
+    auto &tensor = slot.outputs[i];
+    tensor.dtype = net_info.output_dtypes[i];
+    tensor.st_mode = BM_STORE_1N;
+    tensor.shape = net_info.stages[0].output_shapes[i];
+    allocs.push_back(std::make_pair(&tensor, (u64)net_info.max_output_bytes[i]));
+  }
+  size_t alloc_num = 0;
+  try {
+    for (; alloc_num < allocs.size(); alloc_num++) {
+      must_alloc_device_mem(net_ctx->device_id, &allocs[alloc_num].first->device_mem,
+                            allocs[alloc_num].second, "io_binding");
+    }
+  } catch (...) {
+    for (size_t i = 0; i < alloc_num; i++) {
+      free_device_mem(net_ctx->device_id, allocs[i].first->device_mem);
+    }
+    throw;
+  }
+  std::lock_guard<std::mutex> guard(binding->slot_mutex);
+  binding->slots.push_back(std::move(slot));
+  return &binding->slots.back();
+}
+
+void Bmruntime::release_io_binding_slot(io_binding_t *binding, io_binding_slot_t *slot)
+{
+  std::lock_guard<std::mutex> guard(binding->slot_mutex);
+  binding->idle_slots.push_back(slot);
+}
+
+bool Bmruntime::launch_data(io_binding_t *binding, void* const input_datas[], const bm_shape_t input_shapes[],
+                            int input_num, void* output_datas[], bm_shape_t output_shapes[], int output_num,
+                            bool user_mem, const std::vector<int>& core_list)
+{
+  auto net_ctx = m_net_ctx_v[binding->net_idx];
+  // check parameters, bound outputs need no user memory
+  if (false == check_launch_params(net_ctx, input_datas, input_shapes, input_num, output_datas,
+                                   output_shapes, output_num, false)) {
+    return false;
+  }
+  for (int i = 0; user_mem && i < output_num; i++) {
+    if (output_datas[i] == NULL && binding->host_outputs[i] == NULL) {
+      BMRT_LOG(WRONG, "output[%d] is NULL", i);
+      return false;
+    }
+  }
+
+  auto slot = acquire_io_binding_slot(binding);
+  bool ret = false;
+  try {
+    ret = launch_data_with_slot(binding, slot, input_datas, input_shapes, input_num, output_datas,
+                                output_shapes, output_num, user_mem, core_list);
+  } catch (...) {
+    release_io_binding_slot(binding, slot);
+    throw;
+  }
+  release_io_binding_slot(binding, slot);
+  return ret;
+}
+
+bool Bmruntime::launch_data_with_slot(io_binding_t *binding, io_binding_slot_t *slot,
+                                      void* const input_datas[], const bm_shape_t input_shapes[],
+                                      int input_num, void* output_datas[], bm_shape_t output_shapes[],
+                                      int output_num, bool user_mem, const std::vector<int>& core_list)
+{
+  int net_idx = binding->net_idx;
+  auto net_ctx = m_net_ctx_v[net_idx];
+  auto devid = net_ctx->device_id;
+  for (int i = 0; i < input_num; i++) {
+    auto &tensor = slot->inputs[i];
+    tensor.shape = input_shapes[i];
+    size_t bytes = bmrt_tensor_bytesize(&tensor);
+    if (bytes > bm_mem_get_device_size(tensor.device_mem)) {
+      BMRT_LOG(WRONG, "input[%d] is larger than the inputs of all stages", i);
+      return false;
+    }
+    BMEventTraceScope trace_scope(TRACE_MEMCPY, "s2d", bytes);
+    bm_memcpy_s2d_partial(m_handles[devid], tensor.device_mem, (void*)input_datas[i], bytes);
+  }
+
+  // launch may not call sync internally
+  bool ret = launch_multi_cores(net_idx, slot->inputs.data(), input_num, slot->outputs.data(),
+                                output_num, 0, core_list, true, false);
+
+  // sync is needed for the following d2s to fetch output data
+  if (ret) {
+    BMEventTraceScope trace_scope(TRACE_SYNC, "bm_thread_sync", -1);
+    ret = (BM_SUCCESS == bm_thread_sync(m_handles[devid]));
+  }
+  if (!ret) {
+    BMRT_LOG(WRONG, "launch net[%s] failed", net_ctx->net_name.c_str());
+    return false;
+  }
+  for (int i = 0; i < output_num; i++) {
+    auto &tensor = slot->outputs[i];
+    size_t bytes = bmrt_tensor_bytesize(&tensor);
+    if (binding->host_outputs[i] != NULL) {
+      if (bytes > binding->host_output_bytes[i]) {
+        BMRT_LOG(WRONG, "output[%d] needs %zu bytes, bound buffer has %zu", i, bytes,
+                 binding->host_output_bytes[i]);
+        return false;
+      }
+      output_datas[i] = binding->host_outputs[i];
+    } else if (false == user_mem) {
+      output_datas[i] = malloc(bytes);
+    }
+    BMEventTraceScope trace_scope(TRACE_MEMCPY, "d2s", bytes);
+    bm_memcpy_d2s_partial(m_handles[devid], output_datas[i], tensor.device_mem, bytes);
+    output_shapes[i] = tensor.shape;
+  }
+  return true;
+}
+
 const vector<string>* Bmruntime::get_input_tensor(int net_idx) const
 {
   return &m_net_ctx_v[net_idx]->input_name_v;
@@ -3116,6 +3696,7 @@ void Bmruntime::must_free_device_mem_u64(uint32_t devid, bm_device_mem_u64_t& me
 }
 
 u64 Bmruntime::alloc_device_mem(uint32_t devid, bm_device_mem_t &mem, u64 size, const std::string &desc, int type_len, bool auto_free_mem) {
+  std::lock_guard<std::mutex> guard(m_alloc_mutex);
   uint64_t device_addr;
   if (alloc_mem) {
     device_addr = must_alloc_device_mem(devid, &mem, size, desc, type_len);
@@ -3155,6 +3736,7 @@ void Bmruntime::clear_device_mem(const std::string &desc) {
 }
 
 u64 Bmruntime::alloc_device_mem_u64(uint32_t devid, bm_device_mem_u64_t &mem, u64 size, const std::string &desc, int type_len, bool auto_free_mem) {
+  std::lock_guard<std::mutex> guard(m_alloc_mutex);
   uint64_t device_addr;
   if (alloc_mem) {
     device_addr = must_alloc_device_mem_u64(devid, &mem, size, desc, type_len);
@@ -5,11 +5,16 @@
 #include <unistd.h>
 #else
 #include <windows.h>
+#include <process.h>
+#define getpid _getpid
 #endif
 #include <numeric>
 #include <string>
 #include <map>
 #include <sstream>
+#include <chrono>
+#include <atomic>
+#include <thread>
 #include "bmodel.hpp"
 #include "bmruntime.h"
 #include "bmlib_runtime.h"
@@ -162,6 +167,135 @@ static void fill_io_tag_fuse_attr(
   }
 }
 
+static double elapsed_us(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+#define LOAD_MAX_THREADS 64
+
+#ifndef SOC_MODE
+#define COEFF_BLK_SIZE 0x1000000
+#define COEFF_MAX_DEPTH 16
+
+/* coeff upload chunk size in bytes, BMRUNTIME_COEFF_CHUNK_SIZE overrides the default 16MB */
+static u64 get_coeff_chunk_size() {
+  const char *env = getenv("BMRUNTIME_COEFF_CHUNK_SIZE");
+  u64 chunk_size = env ? strtoull(env, NULL, 0) : 0;
+  return chunk_size > 0 ? chunk_size : COEFF_BLK_SIZE;
+}
+
+/* number of host staging buffers, BMRUNTIME_COEFF_CHUNK_DEPTH=1 disables the reader thread */
+static int get_coeff_chunk_depth() {
+  const char *env = getenv("BMRUNTIME_COEFF_CHUNK_DEPTH");
+  int depth = env ? atoi(env) : 2;
+  return std::max(1, std::min(depth, COEFF_MAX_DEPTH));
+}
+
+/* reading the bmodel and copying to device overlap: a reader thread fills the next
+ * staging buffer while the previous one is being copied by s2d */
+static void upload_coeff_chunks(ModelCtx *model_ctx, const bmodel::Binary *binary,
+                                bm_handle_t handle, u64 address, u64 size) {
+  u64 chunk_size = get_coeff_chunk_size();
+  u64 chunk_num = (size + chunk_size - 1) / chunk_size;
+  int depth = (int)std::min<u64>(get_coeff_chunk_depth(), chunk_num);
+  /* mapped bmodel is copied to device in place, the os reads ahead instead of the reader thread */
+  const u8 *mapped = model_ctx->is_mmap() ? model_ctx->binary_data(binary) : NULL;
+  vector<std::unique_ptr<u8[]>> buffers;
+  for (int i = 0; mapped == NULL && i < depth; i++) {
+    buffers.emplace_back(new u8[std::min(chunk_size, size)]);
+  }
+
+  double read_us = 0, copy_us = 0;
+  auto total_start = std::chrono::steady_clock::now();
+  auto read_chunk = [&](u64 idx) {
+    u64 offset = idx * chunk_size;
+    auto start = std::chrono::steady_clock::now();
+    model_ctx->read_binary(binary, offset, buffers[idx % depth].get(),
+                           std::min(chunk_size, size - offset));
+    read_us += elapsed_us(start);
+  };
+  auto copy_chunk = [&](u64 idx) {
+    u64 offset = idx * chunk_size;
+    u64 data_size = std::min(chunk_size, size - offset);
+    auto start = std::chrono::steady_clock::now();
+    bm_device_mem_t pmem = bm_mem_from_device(address + offset, data_size);
+    bm_status_t status = bm_memcpy_s2d(handle, pmem, (void *)buffers[idx % depth].get());
+    copy_us += elapsed_us(start);
+    return status;
+  };
+
+  bm_status_t status = BM_SUCCESS;
+  if (mapped != NULL) {
+    model_ctx->advise_sequential(binary);
+    model_ctx->prefetch_binary(binary, 0, chunk_size * depth);
+    for (u64 idx = 0; idx < chunk_num && status == BM_SUCCESS; idx++) {
+      u64 offset = idx * chunk_size;
+      model_ctx->prefetch_binary(binary, offset + chunk_size * depth, chunk_size);
+      auto start = std::chrono::steady_clock::now();
+      bm_device_mem_t pmem = bm_mem_from_device(address + offset, std::min(chunk_size, size - offset));
+      status = bm_memcpy_s2d(handle, pmem, (void *)(mapped + offset));
+      copy_us += elapsed_us(start);
+    }
+  } else if (depth == 1) {
+    for (u64 idx = 0; idx < chunk_num && status == BM_SUCCESS; idx++) {
+      read_chunk(idx);
+      status = copy_chunk(idx);
+    }
+  } else {
+    std::mutex mutex;
+    std::condition_variable cond;
+    u64 read_done = 0, copy_done = 0;
+    bool read_failed = false, stop = false;
+    std::thread reader([&] {
+      try {
+        for (u64 idx = 0; idx < chunk_num; idx++) {
+          {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond.wait(lock, [&] { return stop || idx - copy_done < (u64)depth; });
+            if (stop) return;
+          }
+          read_chunk(idx);
+          std::lock_guard<std::mutex> lock(mutex);
+          read_done = idx + 1;
+          cond.notify_all();
+        }
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        read_failed = true;
+        cond.notify_all();
+      }
+    });
+    for (u64 idx = 0; idx < chunk_num && status == BM_SUCCESS; idx++) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond.wait(lock, [&] { return read_failed || read_done > idx; });
+        if (read_failed) break;
+      }
+      status = copy_chunk(idx);
+      std::lock_guard<std::mutex> lock(mutex);
+      copy_done = idx + 1;
+      cond.notify_all();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+      cond.notify_all();
+    }
+    reader.join();
+    BMRT_ASSERT_INFO(!read_failed, "read coeff from bmodel failed");
+  }
+  CHECK_status(status);
+
+  double total_us = elapsed_us(total_start);
+  auto mbps = [](u64 bytes, double us) { return us > 0 ? bytes / us : 0.0; };
+  BMRT_LOG(DEBUG, "coeff upload %llu bytes%s, %llu chunks of 0x%llx, depth %d: "
+           "read %.1f MB/s, copy %.1f MB/s, overall %.1f MB/s (%.1f ms)",
+           size, mapped ? " from mmap" : "", chunk_num, chunk_size, depth,
+           mbps(size, read_us), mbps(size, copy_us),
+           mbps(size, total_us), total_us / 1000);
+}
+#endif
+
 static void upload_coeff_data(ModelCtx *model_ctx,
                               const bmodel::CoeffMem *coeff_mem,
                               bm_handle_t handle,
@@ -172,28 +306,16 @@ static void upload_coeff_data(ModelCtx *model_ctx,
   void *vmem = NULL;
   status = bm_mem_mmap_device_mem_u64(handle, &dev_mem, (u64 *)&vmem);
   CHECK_status(status);
+  model_ctx->advise_sequential(coeff_mem->binary_coeff());
   model_ctx->read_binary(coeff_mem->binary_coeff(), (u8 *)vmem);
   status = bm_mem_flush_device_mem_u64(handle, &dev_mem);
   CHECK_status(status);
   bm_mem_unmap_device_mem_u64(handle, vmem, size);
 #else
   if (coeff_mem->encrypt_mode() == 0) {
-#define COEFF_BLK_SIZE 0x1000000
-    u8 *data = new u8[COEFF_BLK_SIZE];
-    auto data_sp = SP(data, u8);
-    u64 left_size = size;
-    u64 offset = 0;
-    u64 address = bm_mem_get_device_addr_u64(dev_mem);
-    while (left_size > 0) {
-      u64 data_size =
-          (left_size >= COEFF_BLK_SIZE ? COEFF_BLK_SIZE : left_size);
-      model_ctx->read_binary(coeff_mem->binary_coeff(), offset, data,
-                             data_size);
-      bm_device_mem_t pmem = bm_mem_from_device(address + offset, data_size);
-      status = bm_memcpy_s2d(handle, pmem, ((void *)data));
-      CHECK_status(status);
-      offset += data_size;
-      left_size -= data_size;
+    if (size > 0) {
+      upload_coeff_chunks(model_ctx, coeff_mem->binary_coeff(), handle,
+                          bm_mem_get_device_addr_u64(dev_mem), size);
     }
   } else if (coeff_mem->encrypt_mode() == 1) {
     // encrypted data
@@ -247,8 +369,20 @@ static void update_coeff_data(ModelCtx *model_ctx,
   }
 }
 
-static uint32_t get_bdc_cmd_len(const u8 *bdc_buffer, u64 start_offset,
-                                bool last_cmd) {
+/* binary in the mapped or in-memory bmodel is used in place, otherwise read into holder */
+static const u8 *get_binary_data(ModelCtx *model_ctx, const bmodel::Binary *binary,
+                                 vector<u8> &holder) {
+  const u8 *data = model_ctx->binary_data(binary);
+  if (data == NULL) {
+    holder.resize(binary->size());
+    model_ctx->read_binary(binary, holder.data());
+    data = holder.data();
+  }
+  return data;
+}
+
+uint32_t get_bdc_cmd_len(const u8 *bdc_buffer, u64 start_offset,
+                         bool last_cmd) {
   uint32_t len = 0;
   switch (bmrt_arch_info::get_bmtpu_arch()) {
   case BM1682:
@@ -299,8 +433,8 @@ static uint32_t get_bdc_cmd_len(const u8 *bdc_buffer, u64 start_offset,
   return len;
 }
 
-static uint32_t get_gdma_cmd_len(const u8 *gdma_buffer, u64 start_offset,
-                                 bool last_cmd) {
+uint32_t get_gdma_cmd_len(const u8 *gdma_buffer, u64 start_offset,
+                          bool last_cmd) {
   uint32_t len = 96; // default: common gdma instrution size
 
   bmtpu_arch_t arch = bmrt_arch_info::get_bmtpu_arch();
@@ -326,6 +460,216 @@ static uint32_t get_gdma_cmd_len(const u8 *gdma_buffer, u64 start_offset,
   return len;
 }
 
+void index_cmd_group(const u8* buffer, u32 cmd_num, int engine_id, vector<u32>* offset_v)
+{
+  offset_v->resize(cmd_num + 1);
+  u64 offset = 0;
+  for (u32 cmd_idx = 0; cmd_idx < cmd_num; cmd_idx++) {
+    (*offset_v)[cmd_idx] = offset;
+    bool last_cmd = cmd_idx == cmd_num - 1;
+    offset += engine_id == ENGINE_BD ? get_bdc_cmd_len(buffer, offset, last_cmd)
+                                     : get_gdma_cmd_len(buffer, offset, last_cmd);
+  }
+  (*offset_v)[cmd_num] = offset;
+}
+
+/* copy a whole command group at once, it is relocated later by relocate_cmd_groups */
+static u32* copy_cmd_group(const u8* buffer, u32 cmd_num, int engine_id, u32* dst, const u32* dst_end,
+                           vector<cmd_group_reloc_t>& group_v)
+{
+  group_v.emplace_back();
+  auto& group = group_v.back();
+  group.cmd_buf = dst;
+  index_cmd_group(buffer, cmd_num, engine_id, &group.offset_v);
+  u32 byte_size = group.offset_v.back();
+  BMRT_ASSERT_INFO(dst + byte_size / sizeof(u32) <= dst_end,
+                   "command group of %u bytes overflows the command buffer", byte_size);
+  memcpy(dst, buffer, byte_size);
+  return dst + byte_size / sizeof(u32);
+}
+
+#define RELOC_CACHE_MAGIC "BMRELOC"
+#define RELOC_CACHE_VERSION 2
+
+/* BMRUNTIME_RELOC_CACHE_DIR keeps relocated bdc/gdma commands across processes.
+ * The flatbuffer records the compile time and the place of every binary,
+ * so its digest changes whenever the bmodel is rebuilt. */
+static string get_reloc_cache_prefix(ModelCtx* model_ctx)
+{
+  const char* dir = getenv("BMRUNTIME_RELOC_CACHE_DIR");
+  if (dir == NULL || dir[0] == '\0') {
+    return "";
+  }
+  u8 sha[bmodel::SHA256_LEN];
+  bmodel::CalcSha256((const uint8_t*)model_ctx->data(), model_ctx->data_size(), sha);
+  char hex[bmodel::SHA256_LEN * 2 + 1];
+  for (int i = 0; i < bmodel::SHA256_LEN; i++) {
+    snprintf(hex + i * 2, 3, "%02x", sha[i]);
+  }
+  return string(dir) + "/" + hex + "_" + bmrt_arch_info::get_bmtpu_name();
+}
+
+static u64 reloc_cache_checksum(const u32* buf, u64 word_num)
+{
+  u64 hash = 0xcbf29ce484222325ull;
+  for (u64 i = 0; i < word_num; i++) {
+    hash = (hash ^ buf[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+static u64 reloc_cache_checksum(const u8* buf, u64 byte_num)
+{
+  u64 hash = 0xcbf29ce484222325ull;
+  for (u64 i = 0; i < byte_num; i++) {
+    hash = (hash ^ buf[i]) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+/* the command groups of one core, in the subnet for multi-core bmodels */
+static const flatbuffers::Vector<flatbuffers::Offset<bmodel::CmdGroup>>*
+get_core_cmd_group(const bmodel::NetParameter* param, u32 core_idx)
+{
+  auto cmd_group = param->cmd_group();
+  if (param->sub_net()) {
+    auto core_commands = param->sub_net()->Get(0)->core_commands();
+    if (core_commands) {
+      cmd_group = core_commands->Get(core_idx)->gdma_tiu_commands();
+    }
+  }
+  return cmd_group;
+}
+
+/* everything the relocation result depends on, the command binaries
+ * included: the flatbuffer only records where they are, not their bytes */
+static vector<u64> get_reloc_cache_key(ModelCtx* model_ctx, const bmodel::NetParameter* param,
+                                       u64 param_offset, const net_stage_t* stage)
+{
+  vector<u64> key = {RELOC_CACHE_VERSION, (u64)bmrt_arch_info::is_soc_mode(),
+                     model_ctx->header().binary_size, param_offset,
+                     stage->coeff_offset, stage->io_start, stage->io_size, stage->io_offset,
+                     stage->ctx_start, stage->ctx_borders.size(), stage->ctx_offset.size()};
+  key.insert(key.end(), stage->ctx_borders.begin(), stage->ctx_borders.end());
+  key.insert(key.end(), stage->ctx_offset.begin(), stage->ctx_offset.end());
+  for (u32 core_idx = 0; core_idx < stage->core_commands.size(); core_idx++) {
+    auto cmd_group = get_core_cmd_group(param, core_idx);
+    if (!cmd_group) {
+      continue;
+    }
+    for (u32 i = 0; i < cmd_group->size(); i++) {
+      auto cur_cmd_group = cmd_group->Get(i);
+      const bmodel::Binary* binaries[] = {cur_cmd_group->binary_bdc(), cur_cmd_group->binary_gdma()};
+      for (auto binary : binaries) {
+        if (binary == NULL || binary->size() == 0) {
+          key.push_back(0);
+          continue;
+        }
+        vector<u8> holder;
+        const u8* data = get_binary_data(model_ctx, binary, holder);
+        key.push_back(binary->size());
+        key.push_back(reloc_cache_checksum(data, binary->size()));
+      }
+    }
+  }
+  return key;
+}
+
+struct reloc_cache_entry_t {
+  u32 core_idx;
+  u32 engine_id;
+  u64 start_address;
+  u64 word_num;
+  std::shared_ptr<u32> buf;
+};
+
+/* false on any mismatch or damage, the stage is relocated again then */
+static bool load_reloc_cache(const string& path, const vector<u64>& key,
+                             vector<reloc_cache_entry_t>& entry_v)
+{
+  FILE* fp = fopen(path.c_str(), "rb");
+  if (fp == NULL) {
+    return false;
+  }
+  std::shared_ptr<FILE> fp_sp(fp, fclose);
+  char magic[8];
+  u64 key_len = 0, entry_num = 0;
+  if (fread(magic, sizeof(magic), 1, fp) != 1 || memcmp(magic, RELOC_CACHE_MAGIC, sizeof(magic)) != 0 ||
+      fread(&key_len, sizeof(key_len), 1, fp) != 1 || key_len != key.size()) {
+    return false;
+  }
+  vector<u64> file_key(key_len);
+  if (fread(file_key.data(), sizeof(u64), key_len, fp) != key_len || file_key != key ||
+      fread(&entry_num, sizeof(entry_num), 1, fp) != 1 || entry_num > 1024) {
+    return false;
+  }
+  for (u64 i = 0; i < entry_num; i++) {
+    reloc_cache_entry_t entry;
+    u64 checksum;
+    if (fread(&entry.core_idx, sizeof(entry.core_idx), 1, fp) != 1 ||
+        fread(&entry.engine_id, sizeof(entry.engine_id), 1, fp) != 1 ||
+        fread(&entry.start_address, sizeof(entry.start_address), 1, fp) != 1 ||
+        fread(&entry.word_num, sizeof(entry.word_num), 1, fp) != 1 ||
+        fread(&checksum, sizeof(checksum), 1, fp) != 1 || entry.word_num > UINT32_MAX) {
+      return false;
+    }
+    entry.buf = SP(new u32[entry.word_num], u32);
+    if (fread(entry.buf.get(), sizeof(u32), entry.word_num, fp) != entry.word_num ||
+        reloc_cache_checksum(entry.buf.get(), entry.word_num) != checksum) {
+      return false;
+    }
+    entry_v.push_back(std::move(entry));
+  }
+  // trailing bytes mean the file is not what we wrote
+  return fgetc(fp) == EOF;
+}
+
+static void save_reloc_cache(const string& path, const vector<u64>& key,
+                             const vector<reloc_cache_entry_t>& entry_v)
+{
+  // written aside and renamed, so that a reader never sees a partial file
+  std::ostringstream tmp_path;
+  tmp_path << path << ".tmp." << getpid() << "." << std::this_thread::get_id();
+  FILE* fp = fopen(tmp_path.str().c_str(), "wb");
+  if (fp == NULL) {
+    BMRT_LOG(WARNING, "cannot write relocation cache %s", tmp_path.str().c_str());
+    return;
+  }
+  u64 key_len = key.size(), entry_num = entry_v.size();
+  bool ok = fwrite(RELOC_CACHE_MAGIC, 8, 1, fp) == 1 &&
+            fwrite(&key_len, sizeof(key_len), 1, fp) == 1 &&
+            fwrite(key.data(), sizeof(u64), key_len, fp) == key_len &&
+            fwrite(&entry_num, sizeof(entry_num), 1, fp) == 1;
+  for (auto& entry : entry_v) {
+    u64 checksum = reloc_cache_checksum(entry.buf.get(), entry.word_num);
+    ok = ok && fwrite(&entry.core_idx, sizeof(entry.core_idx), 1, fp) == 1 &&
+         fwrite(&entry.engine_id, sizeof(entry.engine_id), 1, fp) == 1 &&
+         fwrite(&entry.start_address, sizeof(entry.start_address), 1, fp) == 1 &&
+         fwrite(&entry.word_num, sizeof(entry.word_num), 1, fp) == 1 &&
+         fwrite(&checksum, sizeof(checksum), 1, fp) == 1 &&
+         fwrite(entry.buf.get(), sizeof(u32), entry.word_num, fp) == entry.word_num;
+  }
+  ok = (fclose(fp) == 0) && ok;
+  if (!ok || rename(tmp_path.str().c_str(), path.c_str()) != 0) {
+    BMRT_LOG(WARNING, "cannot write relocation cache %s", path.c_str());
+    remove(tmp_path.str().c_str());
+  }
+}
+
+/* convert_cmd only reads the command buffer address on BM1682 */
+static std::shared_ptr<u32> find_reloc_cache_entry(const vector<reloc_cache_entry_t>& entry_v,
+                                                   u32 core_idx, u32 engine_id, u64 word_num,
+                                                   u64 start_address)
+{
+  for (auto& entry : entry_v) {
+    if (entry.core_idx == core_idx && entry.engine_id == engine_id && entry.word_num == word_num &&
+        (bmrt_arch_info::get_bmtpu_arch() != BM1682 || entry.start_address == start_address)) {
+      return entry.buf;
+    }
+  }
+  return nullptr;
+}
+
 /* Read BDC/GDMA cmd context from file, alloc device memory,
  * S2D download to DDR, save CMD_TENSOR in dev_mem_info_v.
  */
@@ -336,20 +680,30 @@ bool Bmruntime::setup_cmd_context(ModelCtx* model_ctx,
   u32 cmd_word_num;
   u32 *cmd_buf, *p_cmd_buf;
   bm_device_mem_t pmem;
+  cmd_reloc_table_t reloc_table;
+  build_cmd_reloc_table(stage, &reloc_table);
+
+  // relocated commands of the last run with the same bmodel and memory layout,
+  // a NetParameter is told apart by its place in the flatbuffer
+  string reloc_cache_path;
+  vector<u64> reloc_cache_key;
+  vector<reloc_cache_entry_t> cached_entry_v, reloc_entry_v;
+  bool reloc_cache_miss = false;
+  if (!m_reloc_cache_prefix.empty()) {
+    u64 param_offset = (const u8*)param - (const u8*)model_ctx->data();
+    reloc_cache_path = m_reloc_cache_prefix + "_" + std::to_string(param_offset) + ".reloc";
+    reloc_cache_key = get_reloc_cache_key(model_ctx, param, param_offset, stage);
+    if (!load_reloc_cache(reloc_cache_path, reloc_cache_key, cached_entry_v)) {
+      cached_entry_v.clear();
+    }
+  }
 
   const auto core_num = stage->core_commands.size();
   for (uint32_t core_idx = 0; core_idx < core_num; core_idx++) {
       u32 bdc_total_id = 0, gdma_total_id = 0;
       u32 bdc_total_cmd_byte = 0, gdam_total_cmd_byte = 0;
       // TODO: Here is a huge problem, if have one more subnets in 1688 or sg2260
-      auto subnet = param->sub_net();
-      auto cmd_group = param->cmd_group();
-      if (subnet) {
-        auto core_commands = param->sub_net()->Get(0)->core_commands();
-        if (core_commands) {
-          cmd_group = core_commands->Get(core_idx)->gdma_tiu_commands();
-        }
-      }
+      auto cmd_group = get_core_cmd_group(param, core_idx);
       if (!cmd_group || cmd_group->size() == 0)
         continue;
       for (u32 i = 0; i < cmd_group->size(); i++) {
@@ -371,29 +725,46 @@ bool Bmruntime::setup_cmd_context(ModelCtx* model_ctx,
       }
       if (cmd_word_num != 0) {
         u64 cmd_buf_addr = alloc_device_mem(devid, pmem, cmd_word_num, "bd_cmd_mem", 4);
-        cmd_buf = new u32[cmd_word_num];
-        auto cmd_buf_sp = SP(cmd_buf, u32);
-        p_cmd_buf = cmd_buf;
-        for (u32 group_idx = 0; group_idx < cmd_group->size(); group_idx++) {
-          u64 bdc_offset = 0;
-          auto cur_cmd_group = cmd_group->Get(group_idx);
-          if (0 == cur_cmd_group->bdc_num()) {
-            continue;
-          }
-          u8 *bdc_buffer = new u8[cur_cmd_group->binary_bdc()->size()];
-          model_ctx->read_binary(cur_cmd_group->binary_bdc(), bdc_buffer);
-          for (u32 cmd_idx = 0; cmd_idx < cur_cmd_group->bdc_num(); cmd_idx++) {
-            uint32_t read_size =
-                get_bdc_cmd_len(bdc_buffer, bdc_offset,
-                                (cmd_idx == cur_cmd_group->bdc_num() - 1));
-            memcpy(p_cmd_buf, bdc_buffer + bdc_offset, read_size);
-            convert_cmd(p_cmd_buf, ENGINE_BD,
-                        cmd_idx == (cur_cmd_group->bdc_num() - 1),
-                        cmd_buf_addr + GLOBAL_MEM_CMD_START_OFFSET, stage);
-            p_cmd_buf += read_size / sizeof(uint32_t);
-            bdc_offset += read_size;
+        u64 start_address = cmd_buf_addr + GLOBAL_MEM_CMD_START_OFFSET;
+        auto cmd_buf_sp = find_reloc_cache_entry(cached_entry_v, core_idx, ENGINE_BD, cmd_word_num, start_address);
+        if (!cmd_buf_sp) {
+          reloc_cache_miss = true;
+          cmd_buf_sp = SP(new u32[cmd_word_num], u32);
+          cmd_buf = cmd_buf_sp.get();
+          p_cmd_buf = cmd_buf;
+          bool batched = can_relocate_cmd_group(ENGINE_BD, reloc_table);
+          vector<cmd_group_reloc_t> reloc_group_v;
+          for (u32 group_idx = 0; group_idx < cmd_group->size(); group_idx++) {
+            u64 bdc_offset = 0;
+            auto cur_cmd_group = cmd_group->Get(group_idx);
+            if (0 == cur_cmd_group->bdc_num()) {
+              continue;
+            }
+            vector<u8> bdc_holder;
+            const u8 *bdc_buffer = get_binary_data(model_ctx, cur_cmd_group->binary_bdc(), bdc_holder);
+            if (batched) {
+              p_cmd_buf = copy_cmd_group(bdc_buffer, cur_cmd_group->bdc_num(), ENGINE_BD,
+                                         p_cmd_buf, cmd_buf + cmd_word_num, reloc_group_v);
+              continue;
+            }
+            for (u32 cmd_idx = 0; cmd_idx < cur_cmd_group->bdc_num(); cmd_idx++) {
+              uint32_t read_size =
+                  get_bdc_cmd_len(bdc_buffer, bdc_offset,
+                                  (cmd_idx == cur_cmd_group->bdc_num() - 1));
+              memcpy(p_cmd_buf, bdc_buffer + bdc_offset, read_size);
+              convert_cmd(p_cmd_buf, ENGINE_BD,
+                          cmd_idx == (cur_cmd_group->bdc_num() - 1),
+                          cmd_buf_addr + GLOBAL_MEM_CMD_START_OFFSET, stage);
+              p_cmd_buf += read_size / sizeof(uint32_t);
+              bdc_offset += read_size;
+            }
           }
-          delete[] bdc_buffer;
+          relocate_cmd_groups(reloc_group_v, ENGINE_BD, start_address, stage, reloc_table,
+                              m_cmd_reloc_threads);
+        }
+        cmd_buf = cmd_buf_sp.get();
+        if (!reloc_cache_path.empty()) {
+          reloc_entry_v.push_back({core_idx, ENGINE_BD, start_address, cmd_word_num, cmd_buf_sp});
         }
         m_profile->record_cmd_data(core_idx, ENGINE_BD, cmd_buf, cmd_word_num * 4,
                                    cmd_buf_addr);
@@ -408,30 +779,47 @@ bool Bmruntime::setup_cmd_context(ModelCtx* model_ctx,
       }
       if (cmd_word_num != 0) {
         u64 cmd_buf_addr = alloc_device_mem(devid, pmem, cmd_word_num, "gdma_cmd_mem", 4);
-        cmd_buf = new u32[cmd_word_num];
-        auto cmd_buf_sp = SP(cmd_buf, u32);
-        p_cmd_buf = cmd_buf;
-        for (u32 group_idx = 0; group_idx < cmd_group->size(); group_idx++) {
-          u64 gdma_offset = 0;
-          auto cur_cmd_group = cmd_group->Get(group_idx);
-          if (0 == cur_cmd_group->gdma_num()) {
-            continue;
-          }
-          u8 *gdma_buffer = new u8[cur_cmd_group->binary_gdma()->size()];
-          model_ctx->read_binary(cur_cmd_group->binary_gdma(), gdma_buffer);
-          for (u32 cmd_idx = 0; cmd_idx < cur_cmd_group->gdma_num();
-               cmd_idx++) {
-            u32 gdma_size =
-                get_gdma_cmd_len(gdma_buffer, gdma_offset,
-                                 (cmd_idx == cur_cmd_group->gdma_num() - 1));
-            memcpy(p_cmd_buf, gdma_buffer + gdma_offset, gdma_size);
-            convert_cmd(p_cmd_buf, ENGINE_GDMA,
-                        cmd_idx == cur_cmd_group->gdma_num() - 1,
-                        cmd_buf_addr + GLOBAL_MEM_CMD_START_OFFSET, stage);
-            p_cmd_buf += gdma_size / sizeof(u32);
-            gdma_offset += gdma_size;
+        u64 start_address = cmd_buf_addr + GLOBAL_MEM_CMD_START_OFFSET;
+        auto cmd_buf_sp = find_reloc_cache_entry(cached_entry_v, core_idx, ENGINE_GDMA, cmd_word_num, start_address);
+        if (!cmd_buf_sp) {
+          reloc_cache_miss = true;
+          cmd_buf_sp = SP(new u32[cmd_word_num], u32);
+          cmd_buf = cmd_buf_sp.get();
+          p_cmd_buf = cmd_buf;
+          bool batched = can_relocate_cmd_group(ENGINE_GDMA, reloc_table);
+          vector<cmd_group_reloc_t> reloc_group_v;
+          for (u32 group_idx = 0; group_idx < cmd_group->size(); group_idx++) {
+            u64 gdma_offset = 0;
+            auto cur_cmd_group = cmd_group->Get(group_idx);
+            if (0 == cur_cmd_group->gdma_num()) {
+              continue;
+            }
+            vector<u8> gdma_holder;
+            const u8 *gdma_buffer = get_binary_data(model_ctx, cur_cmd_group->binary_gdma(), gdma_holder);
+            if (batched) {
+              p_cmd_buf = copy_cmd_group(gdma_buffer, cur_cmd_group->gdma_num(), ENGINE_GDMA,
+                                         p_cmd_buf, cmd_buf + cmd_word_num, reloc_group_v);
+              continue;
+            }
+            for (u32 cmd_idx = 0; cmd_idx < cur_cmd_group->gdma_num();
+                 cmd_idx++) {
+              u32 gdma_size =
+                  get_gdma_cmd_len(gdma_buffer, gdma_offset,
+                                   (cmd_idx == cur_cmd_group->gdma_num() - 1));
+              memcpy(p_cmd_buf, gdma_buffer + gdma_offset, gdma_size);
+              convert_cmd(p_cmd_buf, ENGINE_GDMA,
+                          cmd_idx == cur_cmd_group->gdma_num() - 1,
+                          cmd_buf_addr + GLOBAL_MEM_CMD_START_OFFSET, stage);
+              p_cmd_buf += gdma_size / sizeof(u32);
+              gdma_offset += gdma_size;
+            }
           }
-          delete[] gdma_buffer;
+          relocate_cmd_groups(reloc_group_v, ENGINE_GDMA, start_address, stage, reloc_table,
+                              m_cmd_reloc_threads);
+        }
+        cmd_buf = cmd_buf_sp.get();
+        if (!reloc_cache_path.empty()) {
+          reloc_entry_v.push_back({core_idx, ENGINE_GDMA, start_address, cmd_word_num, cmd_buf_sp});
         }
         m_profile->record_cmd_data(core_idx, ENGINE_GDMA, cmd_buf, cmd_word_num * 4,
                                    cmd_buf_addr);
@@ -439,6 +827,10 @@ bool Bmruntime::setup_cmd_context(ModelCtx* model_ctx,
       }
   }
 
+  if (!reloc_cache_path.empty() && reloc_cache_miss) {
+    save_reloc_cache(reloc_cache_path, reloc_cache_key, reloc_entry_v);
+  }
+
   for (uint32_t core_idx = 0; core_idx < core_num; core_idx++) {
     auto core_commands = param->sub_net()->Get(0)->core_commands();
     if(!core_commands) continue;
@@ -889,6 +1281,12 @@ void Bmruntime::fill_sub_net(ModelCtx* model_ctx, const Vector<Offset<bmodel::Su
     }
     net_stage->subnet_v.push_back(subnet);
   }
+
+  // resolve subnet tensor names to slots once, launch only indexes them
+  compile_subnet_plan(net_stage);
+  if (m_flags & BM_RUNTIME_SHARE_MEM) {
+    bind_subnet_plan(net_stage, &net_stage->subnet_tensor_v, &net_stage->subnet_binding);
+  }
 }
 
 bool Bmruntime::setup_profile_context(ModelCtx * model_ctx, net_stage_t* net_stage,
@@ -1445,125 +1843,185 @@ bool Bmruntime::cascade_net_init(const Net* net, int net_idx, net_ctx_t* net_ctx
   return true;
 }
 
-bool Bmruntime::load_bmodel_net(ModelCtx* model_ctx, int net_idx, net_ctx_t* net_ctx)
+bool Bmruntime::prepare_bmodel_net(ModelCtx* model_ctx, int net_idx, net_ctx_t* net_ctx,
+                                   vector<vector<u64>>& stage_ctx_sizes, net_load_time_t* load_time)
 {
+  auto start = std::chrono::steady_clock::now();
   auto net = model_ctx->model()->net()->Get(net_idx);
   net_ctx->addr_mode = net->addr_mode();
   if (cascade_net_init(net, net_idx, net_ctx) == false) {
     return false;
   }
-  auto devid = net_ctx->device_id;
   auto net_params = net->parameter();
-  std::vector<std::vector<u64>> stage_ctx_sizes;
   auto stages = new net_stage_t[net_params->size()];
   if (false == fill_net_ctx(model_ctx, net_ctx, net_params, stage_ctx_sizes, stages)) {
       BMRT_LOG(WRONG, "fill net[%s] context failed", net_ctx->net_name.c_str());
     return false;
   }
-
-  // fill stage
   for (u32 stage_idx = 0; stage_idx < net_params->size(); stage_idx++) {
-    auto param = net_params->Get(stage_idx);
-    auto net_stage = stages + stage_idx;
-    net_ctx->stage_v.push_back(net_stage);
-
-    // fill ctx and coeff
-    net_stage->ctx_start = param->ctx_addr();
-    net_stage->dynamic_ctx_start = param->dynamic_ctx_addr() ? param->dynamic_ctx_addr() : param->ctx_addr();
-
-    // Use relative address since 1688.
-    auto ctx_start = net_stage->ctx_start & bmrt_arch_info::addr_mask();
-    auto dynamic_ctx_start = net_stage->dynamic_ctx_start & bmrt_arch_info::addr_mask();
-    auto &ctx_sizes = stage_ctx_sizes[stage_idx];
-    if (!ctx_sizes.empty())
+    net_ctx->stage_v.push_back(stages + stage_idx);
+  }
+  load_time->ctx_us += elapsed_us(start);
+  return true;
+}
+
+/* everything here only touches the stage itself, so stages of different nets
+ * can be loaded by several threads once prepare_bmodel_net is done */
+void Bmruntime::load_bmodel_stage(ModelCtx* model_ctx, const NetParameter* param, net_ctx_t* net_ctx,
+                                  net_stage_t* net_stage, const vector<u64>& ctx_sizes,
+                                  net_load_time_t* load_time)
+{
+  auto start = std::chrono::steady_clock::now();
+  auto devid = net_ctx->device_id;
+
+  // fill ctx and coeff
+  net_stage->ctx_start = param->ctx_addr();
+  net_stage->dynamic_ctx_start = param->dynamic_ctx_addr() ? param->dynamic_ctx_addr() : param->ctx_addr();
+
+  // Use relative address since 1688.
+  auto ctx_start = net_stage->ctx_start & bmrt_arch_info::addr_mask();
+  auto dynamic_ctx_start = net_stage->dynamic_ctx_start & bmrt_arch_info::addr_mask();
+  if (!ctx_sizes.empty())
+  {
+    net_stage->ctx_offset.resize(ctx_sizes.size());
+    net_stage->dynamic_ctx_offset.resize(ctx_sizes.size());
+    net_stage->ctx_borders.resize(ctx_sizes.size());
+    net_stage->ctx_borders[0] = ctx_sizes[0];
+    for (size_t i = 1; i < ctx_sizes.size(); ++i)
     {
-      net_stage->ctx_offset.resize(ctx_sizes.size());
-      net_stage->dynamic_ctx_offset.resize(ctx_sizes.size());
-      net_stage->ctx_borders.resize(ctx_sizes.size());
-      net_stage->ctx_borders[0] = ctx_sizes[0];
-      for (size_t i = 1; i < ctx_sizes.size(); ++i)
+      net_stage->ctx_borders[i] = net_stage->ctx_borders[i - 1] + ctx_sizes[i];
+    }
+    /*
+      Multi-core runtime not set ctx_offset in load bmodel stage,
+      set ctx_offset in launch tensor stage
+    */
+    if (m_flags & BM_RUNTIME_SHARE_MEM) {
+      for (size_t i = 0; i < ctx_sizes.size(); ++i)
       {
-        net_stage->ctx_borders[i] = net_stage->ctx_borders[i - 1] + ctx_sizes[i];
-      }
-      /*
-        Multi-core runtime not set ctx_offset in load bmodel stage,
-        set ctx_offset in launch tensor stage
-      */
-      if (m_flags & BM_RUNTIME_SHARE_MEM) {
-        for (size_t i = 0; i < ctx_sizes.size(); ++i)
-        {
-          if (net_stage->neuron_mem[i].size > 0) {
-            u64 ctx_addr = bm_mem_get_device_addr_u64(net_stage->neuron_mem[i]);
-            net_stage->ctx_offset[i] = ctx_addr - ctx_start;
-            net_stage->dynamic_ctx_offset[i] = ctx_addr - dynamic_ctx_start;
-          } else {
-            net_stage->ctx_offset[i] = 0;
-            net_stage->dynamic_ctx_offset[i] = 0;
-          }
-          if (i > 0)  {
-            net_stage->ctx_offset[i] -= net_stage->ctx_borders[i - 1];
-            net_stage->dynamic_ctx_offset[i] -= net_stage->ctx_borders[i - 1];
-          }
+        if (net_stage->neuron_mem[i].size > 0) {
+          u64 ctx_addr = bm_mem_get_device_addr_u64(net_stage->neuron_mem[i]);
+          net_stage->ctx_offset[i] = ctx_addr - ctx_start;
+          net_stage->dynamic_ctx_offset[i] = ctx_addr - dynamic_ctx_start;
+        } else {
+          net_stage->ctx_offset[i] = 0;
+          net_stage->dynamic_ctx_offset[i] = 0;
+        }
+        if (i > 0)  {
+          net_stage->ctx_offset[i] -= net_stage->ctx_borders[i - 1];
+          net_stage->dynamic_ctx_offset[i] -= net_stage->ctx_borders[i - 1];
         }
       }
-    } else {
-      // No neuron memory
-      // No relocation required
-      net_stage->ctx_borders.push_back(-1); // Max unsigned
-      net_stage->ctx_offset.push_back(0);
-      net_stage->dynamic_ctx_offset.push_back(0);
-    }
-
-    net_stage->cpu_mem_size = param->cpu_mem_size();
-    net_stage->cpu_addr = nullptr;
-
-    mem_pair_t mem_pair = {
-        bm_mem_get_device_addr_u64(m_local_coeffs[devid]->GetCoeffDeviceMem()),
-        bm_mem_get_device_size_u64(m_local_coeffs[devid]->GetCoeffDeviceMem())};
-    m_profile->record_alloc_device_mem(mem_pair, "coeff");
-
-    // setup input and output tensor info
-    if (net_ctx->addr_mode == ADDR_MODE_IO_ALONE) {
-      fill_io_attr(param->input_tensor(), net_stage->input_v,
-                   net_stage->io_offset);
-      fill_io_attr(param->output_tensor(), net_stage->output_v,
-                   net_stage->io_offset);
-    } else if (net_ctx->addr_mode == ADDR_MODE_IO_TAG) {
-      fill_io_tag_attr(param->input_tensor(), net_stage->input_v,
-                       net_stage->ctx_start, net_stage->ctx_borders,
-                       net_stage->ctx_offset, m_flags);
-      fill_io_tag_attr(param->output_tensor(), net_stage->output_v,
-                       net_stage->ctx_start, net_stage->ctx_borders,
-                       net_stage->ctx_offset, m_flags);
-    } else if (net_ctx->addr_mode == ADDR_MODE_IO_TAG_FUSE) {
-      fill_io_tag_fuse_attr(param->input_tensor(), net_stage->input_v);
-      fill_io_tag_fuse_attr(param->output_tensor(), net_stage->output_v);
-    } else {
-      fill_tensor_attr(param->input_tensor(), net_stage->input_v,
-                       net_stage->ctx_start, net_stage->ctx_borders,
-                       net_stage->ctx_offset, m_flags);
-      fill_tensor_attr(param->output_tensor(), net_stage->output_v,
-                       net_stage->ctx_start, net_stage->ctx_borders,
-                       net_stage->ctx_offset, m_flags);
     }
+  } else {
+    // No neuron memory
+    // No relocation required
+    net_stage->ctx_borders.push_back(-1); // Max unsigned
+    net_stage->ctx_offset.push_back(0);
+    net_stage->dynamic_ctx_offset.push_back(0);
+  }
+
+  net_stage->cpu_mem_size = param->cpu_mem_size();
+  net_stage->cpu_addr = nullptr;
+
+  mem_pair_t mem_pair = {
+      bm_mem_get_device_addr_u64(m_local_coeffs[devid]->GetCoeffDeviceMem()),
+      bm_mem_get_device_size_u64(m_local_coeffs[devid]->GetCoeffDeviceMem())};
+  m_profile->record_alloc_device_mem(mem_pair, "coeff");
+
+  // setup input and output tensor info
+  if (net_ctx->addr_mode == ADDR_MODE_IO_ALONE) {
+    fill_io_attr(param->input_tensor(), net_stage->input_v,
+                 net_stage->io_offset);
+    fill_io_attr(param->output_tensor(), net_stage->output_v,
+                 net_stage->io_offset);
+  } else if (net_ctx->addr_mode == ADDR_MODE_IO_TAG) {
+    fill_io_tag_attr(param->input_tensor(), net_stage->input_v,
+                     net_stage->ctx_start, net_stage->ctx_borders,
+                     net_stage->ctx_offset, m_flags);
+    fill_io_tag_attr(param->output_tensor(), net_stage->output_v,
+                     net_stage->ctx_start, net_stage->ctx_borders,
+                     net_stage->ctx_offset, m_flags);
+  } else if (net_ctx->addr_mode == ADDR_MODE_IO_TAG_FUSE) {
+    fill_io_tag_fuse_attr(param->input_tensor(), net_stage->input_v);
+    fill_io_tag_fuse_attr(param->output_tensor(), net_stage->output_v);
+  } else {
+    fill_tensor_attr(param->input_tensor(), net_stage->input_v,
+                     net_stage->ctx_start, net_stage->ctx_borders,
+                     net_stage->ctx_offset, m_flags);
+    fill_tensor_attr(param->output_tensor(), net_stage->output_v,
+                     net_stage->ctx_start, net_stage->ctx_borders,
+                     net_stage->ctx_offset, m_flags);
+  }
 
-    // setup subnet
-    const auto core_num = param->core_num() != 0 ? param->core_num() : 1;
-    net_stage->core_commands.resize(core_num);
-    fill_sub_net(model_ctx, param->sub_net(), net_ctx, net_stage);
+  // setup subnet
+  const auto core_num = param->core_num() != 0 ? param->core_num() : 1;
+  net_stage->core_commands.resize(core_num);
+  fill_sub_net(model_ctx, param->sub_net(), net_ctx, net_stage);
+  load_time->subnet_us += elapsed_us(start);
 
-    // setup gdma/bdc, or ir
-    setup_ir_context(model_ctx, param->binary_ir(), param->stage_ir(), net_stage, devid);
-    setup_cmd_context(model_ctx, param, net_stage, devid);
+  // setup gdma/bdc, or ir
+  start = std::chrono::steady_clock::now();
+  setup_ir_context(model_ctx, param->binary_ir(), param->stage_ir(), net_stage, devid);
+  load_time->ir_us += elapsed_us(start);
+  start = std::chrono::steady_clock::now();
+  setup_cmd_context(model_ctx, param, net_stage, devid);
+  load_time->cmd_us += elapsed_us(start);
+
+  // setup profile info
+  if (m_profile->is_enabled()) {
+    setup_profile_context(model_ctx, net_stage, param->net_profile(), param->net_stat());
+  }
+}
+
+bool Bmruntime::load_bmodel_net(ModelCtx* model_ctx, int net_idx, net_ctx_t* net_ctx,
+                                net_load_time_t* load_time)
+{
+  std::vector<std::vector<u64>> stage_ctx_sizes;
+  if (false == prepare_bmodel_net(model_ctx, net_idx, net_ctx, stage_ctx_sizes, load_time)) {
+    return false;
+  }
+  auto net_params = model_ctx->model()->net()->Get(net_idx)->parameter();
+  for (u32 stage_idx = 0; stage_idx < net_params->size(); stage_idx++) {
+    load_bmodel_stage(model_ctx, net_params->Get(stage_idx), net_ctx, net_ctx->stage_v[stage_idx],
+                      stage_ctx_sizes[stage_idx], load_time);
+  }
+  return true;
+}
 
-    // setup profile info
-    if (m_profile->is_enabled()) {
-      setup_profile_context(model_ctx, net_stage, param->net_profile(), param->net_stat());
+bool Bmruntime::is_net_loaded(const string& net_name)
+{
+  for (auto each_net : m_net_ctx_v) {
+    if (each_net->net_name == net_name) {
+      BMRT_LOG(WARNING, "Warning: Net[%s] exist, does not load again", net_name.c_str());
+      return true;
     }
   }
+  return false;
+}
+
+bool Bmruntime::load_bmodel_net(ModelCtx* model_ctx, int net_idx, const bmodel::bmodel_mem_info_t& bmem_info)
+{
+  auto net = model_ctx->model()->net()->Get(net_idx);
+  if (is_net_loaded(net->name()->str())) {
+    return true;
+  }
+  net_ctx_t* net_ctx = new net_ctx_t();
+  net_ctx->net_name = net->name()->str();
+
+  // fill each stage info
+  net_load_time_t load_time;
+  if (false == load_bmodel_net(model_ctx, net_idx, net_ctx, &load_time)) {
+      BMRT_LOG(WRONG, "Error: load net[%s] failed", net_ctx->net_name.c_str());
+    return false;
+  }
+  add_loaded_net(net_ctx, bmem_info, load_time);
+  return true;
+}
 
+void Bmruntime::add_loaded_net(net_ctx_t* net_ctx, const bmodel::bmodel_mem_info_t& bmem_info,
+                               const net_load_time_t& load_time)
+{
   // fill mem info
-  bmodel::bmodel_mem_info_t bmem_info = model_ctx->get_bmodel_mem_info();
   net_ctx->mem_info_dict.emplace("bd_cmd_mem", bmem_info.bd_cmd_mem_size);
   net_ctx->mem_info_dict.emplace("gdma_cmd_mem", bmem_info.gdma_cmd_mem_size);
   net_ctx->mem_info_dict.emplace("hau_cmd_mem", bmem_info.hau_cmd_mem_size);
@@ -1576,31 +2034,116 @@ bool Bmruntime::load_bmodel_net(ModelCtx* model_ctx, int net_idx, net_ctx_t* net
   net_ctx->mem_info_dict.emplace("host_coeff_mem", bmem_info.host_coeff_mem_size);
   net_ctx->mem_info_dict.emplace("hidden_buffer", bmem_info.hidden_buffer_size);
   net_ctx->mem_info_dict.emplace("middle_buffer", bmem_info.middle_buffer_size);
-  return true;
+
+  net_ctx->kernel_module_ = kernel_modules[net_ctx->device_id];
+  update_max_middlebuf_size(net_ctx);
+  fill_net_info(net_ctx);
+  m_net_ctx_v.push_back(net_ctx);
+  BMRT_LOG(DEBUG, "net[%s] load time: ctx/coeff %.3fms, subnet %.3fms, ir %.3fms, cmd %.3fms",
+           net_ctx->net_name.c_str(), load_time.ctx_us / 1000, load_time.subnet_us / 1000,
+           load_time.ir_us / 1000, load_time.cmd_us / 1000);
+}
+
+/* BMRUNTIME_LOAD_THREADS sets the number of threads loading the stages of a bmodel,
+ * 0 means one per cpu core. Loading is sequential by default. */
+static int get_load_thread_num() {
+  const char *env = getenv("BMRUNTIME_LOAD_THREADS");
+  int thread_num = env ? atoi(env) : 1;
+  if (thread_num <= 0) {
+    thread_num = std::thread::hardware_concurrency();
+  }
+  return std::max(1, std::min(thread_num, LOAD_MAX_THREADS));
 }
 
-bool Bmruntime::load_bmodel_net(ModelCtx* model_ctx, int net_idx)
+bool Bmruntime::load_bmodel_nets_parallel(ModelCtx* model_ctx, u32 load_net_num, int thread_num,
+                                          const bmodel::bmodel_mem_info_t& bmem_info)
 {
-  auto net = model_ctx->model()->net()->Get(net_idx);
-  for (auto each_net : m_net_ctx_v) {
-    if (each_net->net_name == net->name()->str()) {
-      BMRT_LOG(WARNING, "Warning: Net[%s] exist, does not load again", net->name()->c_str());
-      return true;
+  struct net_job_t {
+    net_ctx_t* net_ctx;
+    const Vector<Offset<NetParameter>>* params;
+    vector<vector<u64>> stage_ctx_sizes;
+    vector<net_load_time_t> stage_time_v;
+    net_load_time_t load_time;
+  };
+  /* cascade info, coeff dedup and the shared neuron size depend on the net order,
+   * so nets are prepared one by one and only their stages go to the workers */
+  bool ret = true;
+  vector<net_job_t> job_v;
+  job_v.reserve(load_net_num);
+  for (u32 net_idx = 0; net_idx < load_net_num; net_idx++) {
+    auto net = model_ctx->model()->net()->Get(net_idx);
+    auto net_name = net->name()->str();
+    if (is_net_loaded(net_name) ||
+        std::any_of(job_v.begin(), job_v.end(),
+                    [&](const net_job_t& job) { return job.net_ctx->net_name == net_name; })) {
+      continue;
+    }
+    job_v.emplace_back();
+    auto& job = job_v.back();
+    job.net_ctx = new net_ctx_t();
+    job.net_ctx->net_name = net_name;
+    job.params = net->parameter();
+    if (false == prepare_bmodel_net(model_ctx, net_idx, job.net_ctx, job.stage_ctx_sizes, &job.load_time)) {
+        BMRT_LOG(WRONG, "Error: load net[%s] failed", net_name.c_str());
+      job_v.pop_back();
+      ret = false;
+      break;
     }
+    job.stage_time_v.resize(job.params->size());
+  }
+
+  vector<std::pair<u32, u32>> stage_job_v;
+  for (u32 i = 0; i < job_v.size(); i++) {
+    for (u32 stage_idx = 0; stage_idx < job_v[i].params->size(); stage_idx++) {
+      stage_job_v.emplace_back(i, stage_idx);
+    }
+  }
+  std::atomic<size_t> next_job(0);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+  auto worker = [&]() {
+    size_t idx;
+    while ((idx = next_job++) < stage_job_v.size()) {
+      auto& job = job_v[stage_job_v[idx].first];
+      auto stage_idx = stage_job_v[idx].second;
+      try {
+        load_bmodel_stage(model_ctx, job.params->Get(stage_idx), job.net_ctx,
+                          job.net_ctx->stage_v[stage_idx], job.stage_ctx_sizes[stage_idx],
+                          &job.stage_time_v[stage_idx]);
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(error_mutex);
+        if (!error) {
+          error = std::current_exception();
+        }
+        next_job = stage_job_v.size();
+      }
+    }
+  };
+  // spare threads go to the command groups of each stage
+  m_cmd_reloc_threads = std::max<int>(1, thread_num / std::max<size_t>(1, stage_job_v.size()));
+  thread_num = std::min<int>(thread_num, stage_job_v.size());
+  vector<std::thread> threads;
+  for (int i = 1; i < thread_num; i++) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& t : threads) {
+    t.join();
+  }
+  m_cmd_reloc_threads = 1;
+  if (error) {
+    std::rethrow_exception(error);
   }
-  net_ctx_t* net_ctx = new net_ctx_t();
-  net_ctx->net_name = net->name()->str();
 
-  // fill each stage info
-  if (false == load_bmodel_net(model_ctx, net_idx, net_ctx)) {
-      BMRT_LOG(WRONG, "Error: load net[%s] failed", net_ctx->net_name.c_str());
-    return false;
+  for (auto& job : job_v) {
+    for (auto& stage_time : job.stage_time_v) {
+      job.load_time.subnet_us += stage_time.subnet_us;
+      job.load_time.ir_us += stage_time.ir_us;
+      job.load_time.cmd_us += stage_time.cmd_us;
+    }
+    add_loaded_net(job.net_ctx, bmem_info, job.load_time);
   }
-  net_ctx->kernel_module_ = kernel_modules[net_ctx->device_id];
-  update_max_middlebuf_size(net_ctx);
-  fill_net_info(net_ctx);
-  m_net_ctx_v.push_back(net_ctx);
-  return true;
+  return ret;
 }
 
 static void fill_middlebuff_size(const vector<tensor_attr_t>& attr_v,
@@ -1912,12 +2455,28 @@ bool Bmruntime::load_bmodel(ModelCtx* model_ctx)
   load_cpu_module(model_ctx);
 
   u32 cur_net_idx = m_net_ctx_v.size();
-  for (u32 net_idx = 0; net_idx < load_net_num; net_idx++) {
-    ret = load_bmodel_net(model_ctx, net_idx);
-    if (!ret) {
-      break;
+  // the same for every net of the bmodel, so only compute it once
+  bmodel::bmodel_mem_info_t bmem_info = model_ctx->get_bmodel_mem_info();
+  int thread_num = get_load_thread_num();
+  m_reloc_cache_prefix = get_reloc_cache_prefix(model_ctx);
+  if (thread_num > 1 && (!alloc_mem || m_profile->is_enabled())) {
+    BMRT_LOG(WARNING, "BMRUNTIME_LOAD_THREADS is ignored when loading with given memory or profiling");
+    thread_num = 1;
+  }
+  auto load_start = std::chrono::steady_clock::now();
+  if (thread_num > 1) {
+    ret = load_bmodel_nets_parallel(model_ctx, load_net_num, thread_num, bmem_info);
+  } else {
+    for (u32 net_idx = 0; net_idx < load_net_num; net_idx++) {
+      ret = load_bmodel_net(model_ctx, net_idx, bmem_info);
+      if (!ret) {
+        break;
+      }
     }
   }
+  BMRT_LOG(INFO, "%lu nets loaded in %.3fms with %d thread(s)",
+           static_cast<unsigned long>(m_net_ctx_v.size() - cur_net_idx),
+           elapsed_us(load_start) / 1000, thread_num);
   cascade_update_all_info();
   /* Although ret may be false, but we need to set middle buffer and neuron_mem
    * for the net that had beed loaded successfully.
@@ -2305,7 +2864,7 @@ void Bmruntime::load_cpu_module(ModelCtx* model_ctx) {
 bool Bmruntime::load_bmodel(const string& filepath)
 {
   BMRT_LOG(INFO, "Loading bmodel from [%s]. Thanks for your patience...", filepath.c_str());
-  ModelCtx model_ctx(filepath);
+  ModelCtx model_ctx(filepath, "", nullptr, m_flags & BM_RUNTIME_MMAP_BMODEL);
   if (!model_ctx) {
       BMRT_LOG(WRONG, "Load model failed.");
       return false;
@@ -2318,7 +2877,7 @@ bool Bmruntime::load_bmodel(const string& filepath)
 bool Bmruntime::load_bmodel_with_mem(const string& filepath, mem_info_t* mem_info)
 {
   BMRT_LOG(INFO, "Loading bmodel from [%s]. Thanks for your patience...", filepath.c_str());
-  ModelCtx model_ctx(filepath);
+  ModelCtx model_ctx(filepath, "", nullptr, m_flags & BM_RUNTIME_MMAP_BMODEL);
   if (!model_ctx) {
       BMRT_LOG(WRONG, "Load model failed.");
       return false;
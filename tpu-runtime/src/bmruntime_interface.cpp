@@ -6,6 +6,9 @@
 
 using bmruntime::bmfunc;
 using bmruntime::Bmruntime;
+using bmruntime::launch_handle_t;
+using bmruntime::io_binding_t;
+using bmruntime::BMEventTrace;
 
 /* get data type byte size */
 size_t bmrt_data_type_size(bm_data_type_t dtype)
@@ -534,6 +537,53 @@ bool bmrt_launch_tensor_ex(void* p_bmrt, const char* net_name, const bm_tensor_t
                user_stmode);
 }
 
+void* bmrt_get_launch_handle(void* p_bmrt, const char* net_name,
+                             const bm_shape_t stage_shapes[], int input_num)
+{
+  if (p_bmrt == NULL || net_name == NULL) {
+    BMRT_LOG(WRONG, "parameter invalid p_bmrt is NULL or net_name is NULL");
+    return NULL;
+  }
+  if (((Bmruntime*)p_bmrt)->get_net_cascade(net_name)) {
+    BMRT_LOG(WRONG, "net name:%s is a cascade net, launch handle is not supported", net_name);
+    return NULL;
+  }
+  int net_idx = ((Bmruntime*)p_bmrt)->get_net_idx(net_name);
+  if (net_idx < 0) {
+    BMRT_LOG(WRONG, "net name:%s invalid", net_name);
+    return NULL;
+  }
+  auto net_info = ((Bmruntime*)p_bmrt)->get_net_info(net_idx);
+  if (stage_shapes != NULL && input_num != net_info->input_num) {
+    BMRT_LOG(WRONG, "input num should be:%d, not %d", net_info->input_num, input_num);
+    return NULL;
+  }
+  return (void*)((Bmruntime*)p_bmrt)->get_launch_handle(net_idx, stage_shapes);
+}
+
+bool bmrt_launch_tensor_with_handle(void* p_bmrt, const void* launch_handle,
+                                    const bm_tensor_t input_tensors[], int input_num,
+                                    bm_tensor_t output_tensors[], int output_num,
+                                    bool user_mem, bool user_stmode)
+{
+  if (p_bmrt == NULL || launch_handle == NULL) {
+    BMRT_LOG(WRONG, "parameter invalid p_bmrt is NULL or launch_handle is NULL");
+    return false;
+  }
+  return ((Bmruntime*)p_bmrt)
+      ->launch((const launch_handle_t*)launch_handle, input_tensors, input_num, output_tensors,
+               output_num, user_mem, user_stmode);
+}
+
+void bmrt_release_launch_handle(void* p_bmrt, const void* launch_handle)
+{
+  if (p_bmrt == NULL || launch_handle == NULL) {
+    BMRT_LOG(WRONG, "parameter invalid p_bmrt is NULL or launch_handle is NULL");
+    return;
+  }
+  ((Bmruntime*)p_bmrt)->release_launch_handle((const launch_handle_t*)launch_handle);
+}
+
 bool bmrt_launch_tensor_multi_cores(void *p_bmrt, const char *net_name,
                                     const bm_tensor_t input_tensors[],
                                     int input_num, bm_tensor_t output_tensors[],
@@ -697,6 +747,108 @@ bool bmrt_launch_data(void* p_bmrt, const char* net_name, void* const input_data
                                       user_mem, NULL, 0);
 }
 
+uint64_t bmrt_launch_tensor_async(void* p_bmrt, const char* net_name,
+                                  const bm_tensor_t input_tensors[], int input_num,
+                                  bm_tensor_t output_tensors[], int output_num,
+                                  bool user_mem, bool user_stmode,
+                                  const int* core_list, int core_num,
+                                  bmrt_launch_callback_t callback, void* user_data)
+{
+  if (p_bmrt == NULL || net_name == NULL) {
+    BMRT_LOG(WRONG, "parameter invalid p_bmrt is NULL or net_name is NULL");
+    return 0;
+  }
+  if (input_tensors == NULL || input_num <= 0 || output_tensors == NULL || output_num <= 0) {
+    BMRT_LOG(WRONG, "launch parameter is not correct");
+    return 0;
+  }
+  if (((Bmruntime*)p_bmrt)->get_net_cascade(net_name)) {
+    BMRT_LOG(WRONG, "net name:%s is a cascade net, async launch is not supported", net_name);
+    return 0;
+  }
+  int net_idx = ((Bmruntime*)p_bmrt)->get_net_idx(net_name);
+  if (net_idx < 0) {
+    BMRT_LOG(WRONG, "net name:%s invalid", net_name);
+    return 0;
+  }
+  if (core_list != NULL && core_num < 0) {
+    BMRT_LOG(WRONG, "core num:%d invalid", core_num);
+    return 0;
+  }
+  std::vector<int> core_vector;
+  if (core_list != NULL) {
+    core_vector.assign(core_list, core_list + core_num);
+  }
+  return ((Bmruntime*)p_bmrt)
+      ->launch_async(net_idx, input_tensors, input_num, output_tensors, output_num, user_mem,
+                     user_stmode, core_vector, callback, user_data);
+}
+
+bool bmrt_wait_launch(void* p_bmrt, uint64_t ticket)
+{
+  if (p_bmrt == NULL) {
+    BMRT_LOG(WRONG, "parameter invalid p_bmrt is NULL");
+    return false;
+  }
+  return ((Bmruntime*)p_bmrt)->wait_launch(ticket);
+}
+
+void* bmrt_create_io_binding(void* p_bmrt, const char* net_name)
+{
+  if (p_bmrt == NULL || net_name == NULL) {
+    BMRT_LOG(WRONG, "parameter invalid p_bmrt is NULL or net_name is NULL");
+    return NULL;
+  }
+  if (((Bmruntime*)p_bmrt)->get_net_cascade(net_name)) {
+    BMRT_LOG(WRONG, "net name:%s is a cascade net, io binding is not supported", net_name);
+    return NULL;
+  }
+  int net_idx = ((Bmruntime*)p_bmrt)->get_net_idx(net_name);
+  if (net_idx < 0) {
+    BMRT_LOG(WRONG, "net name:%s invalid", net_name);
+    return NULL;
+  }
+  return ((Bmruntime*)p_bmrt)->create_io_binding(net_idx);
+}
+
+bool bmrt_io_binding_set_output(void* p_bmrt, void* io_binding, int output_idx, void* data,
+                                size_t size)
+{
+  if (p_bmrt == NULL || io_binding == NULL) {
+    BMRT_LOG(WRONG, "parameter invalid p_bmrt is NULL or io_binding is NULL");
+    return false;
+  }
+  return ((Bmruntime*)p_bmrt)->bind_output((io_binding_t*)io_binding, output_idx, data, size);
+}
+
+bool bmrt_launch_data_with_binding(void* p_bmrt, void* io_binding, void* const input_datas[],
+                                   const bm_shape_t input_shapes[], int input_num,
+                                   void* output_datas[], bm_shape_t output_shapes[],
+                                   int output_num, bool user_mem, const int* core_list,
+                                   int core_num)
+{
+  if (p_bmrt == NULL || io_binding == NULL) {
+    BMRT_LOG(WRONG, "parameter invalid p_bmrt is NULL or io_binding is NULL");
+    return false;
+  }
+  std::vector<int> core_vector;
+  if (core_list != NULL) {
+    core_vector.assign(core_list, core_list + core_num);
+  }
+  return ((Bmruntime*)p_bmrt)
+      ->launch_data((io_binding_t*)io_binding, input_datas, input_shapes, input_num,
+                    output_datas, output_shapes, output_num, user_mem, core_vector);
+}
+
+void bmrt_destroy_io_binding(void* p_bmrt, void* io_binding)
+{
+  if (p_bmrt == NULL || io_binding == NULL) {
+    BMRT_LOG(WRONG, "parameter invalid p_bmrt is NULL or io_binding is NULL");
+    return;
+  }
+  ((Bmruntime*)p_bmrt)->destroy_io_binding((io_binding_t*)io_binding);
+}
+
 void bmrt_show_neuron_network(void* p_bmrt)
 {
   if (p_bmrt == NULL) {
@@ -798,6 +950,20 @@ void bmrt_trace(void* p_bmrt)
   ((Bmruntime*)p_bmrt)->trace();
 }
 
+void bmrt_enable_event_trace(bool enable)
+{
+  BMEventTrace::set_enable(enable);
+}
+
+bool bmrt_dump_event_trace(const char* filename)
+{
+  if (filename == NULL) {
+    BMRT_LOG(WRONG, "parameter invalid filename is NULL");
+    return false;
+  }
+  return BMEventTrace::dump(filename);
+}
+
 bool bmrt_memcpy_s2d_parallel(void *p_bmrt,
                               bm_tensor_t tensors[],
                               void* datas[],
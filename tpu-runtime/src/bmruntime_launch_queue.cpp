@@ -0,0 +1,146 @@
+#include <set>
+#include "bmruntime.h"
+
+namespace bmruntime {
+
+LaunchQueue::LaunchQueue(Bmruntime *rt, bm_handle_t handle, int device_idx)
+    : m_rt(rt), m_handle(handle), m_device_idx(device_idx),
+      m_next_seq(1), m_done_seq(0), m_stop(false)
+{
+  m_worker = std::thread(&LaunchQueue::threadFunction, this);
+}
+
+LaunchQueue::~LaunchQueue()
+{
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    m_stop = true;
+  }
+  m_submit_cond.notify_all();
+  if (m_worker.joinable()) {
+    m_worker.join();
+  }
+}
+
+uint64_t LaunchQueue::submit(int net_idx, const bm_tensor_t *input_tensors, int input_num,
+                             bm_tensor_t *output_tensors, int output_num, bool user_mem,
+                             bool user_stmode, const std::vector<int> &core_list,
+                             callback_t callback, void *user_data)
+{
+  request_t req;
+  req.net_idx = net_idx;
+  req.input_tensors.assign(input_tensors, input_tensors + input_num);
+  req.output_tensors = output_tensors;
+  req.output_num = output_num;
+  req.user_mem = user_mem;
+  req.user_stmode = user_stmode;
+  req.core_list = core_list;
+  req.callback = callback;
+  req.user_data = user_data;
+  req.ok = false;
+  uint64_t ticket;
+  {
+    std::lock_guard<std::mutex> guard(m_mutex);
+    req.seq = m_next_seq++;
+    ticket = (req.seq << DEVICE_BITS) | m_device_idx;
+    m_pending.push_back(std::move(req));
+  }
+  m_submit_cond.notify_one();
+  return ticket;
+}
+
+bool LaunchQueue::wait(uint64_t ticket)
+{
+  uint64_t seq = ticket >> DEVICE_BITS;
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (seq == 0 || seq >= m_next_seq) {
+    BMRT_LOG(WRONG, "launch ticket %llu is not submitted", (unsigned long long)ticket);
+    return false;
+  }
+  m_done_cond.wait(lock, [&]() { return m_done_seq >= seq; });
+  auto iter = m_results.find(seq);
+  if (iter == m_results.end()) {
+    BMRT_LOG(WRONG, "launch ticket %llu has a callback or is already waited",
+             (unsigned long long)ticket);
+    return false;
+  }
+  bool ok = iter->second;
+  m_results.erase(iter);
+  return ok;
+}
+
+void LaunchQueue::threadFunction()
+{
+  while (true) {
+    vector<request_t> batch;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_submit_cond.wait(lock, [this]() { return m_stop || !m_pending.empty(); });
+      if (m_pending.empty()) {
+        return;
+      }
+      batch.swap(m_pending);
+    }
+
+    // the launches are sent from this thread, so its sync covers all of them
+    std::set<int> cores;
+    bool whole_device = false;
+    for (auto &req : batch) {
+      // BMRT_LOG(FATAL) throws, which must not leave this thread
+      try {
+        if (req.core_list.empty()) {
+          req.ok = m_rt->launch(req.net_idx, req.input_tensors.data(), req.input_tensors.size(),
+                                req.output_tensors, req.output_num, req.user_mem, req.user_stmode);
+          whole_device = true;
+        } else {
+          req.ok = m_rt->launch_multi_cores(req.net_idx, req.input_tensors.data(),
+                                            req.input_tensors.size(), req.output_tensors,
+                                            req.output_num, 0, req.core_list, req.user_mem,
+                                            req.user_stmode);
+          cores.insert(req.core_list.begin(), req.core_list.end());
+        }
+      } catch (const std::exception &e) {
+        BMRT_LOG(WRONG, "async launch of net idx:%d failed: %s", req.net_idx, e.what());
+        req.ok = false;
+      }
+    }
+    bool synced = true;
+    if (whole_device) {
+      BMEventTraceScope trace_scope(TRACE_SYNC, "bm_thread_sync", -1);
+      synced = BM_SUCCESS == bm_thread_sync(m_handle);
+    }
+    for (auto core_id : cores) {
+      BMEventTraceScope trace_scope(TRACE_SYNC, "bm_thread_sync_from_core", core_id);
+      synced = BM_SUCCESS == bm_thread_sync_from_core(m_handle, core_id) && synced;
+    }
+    if (!synced) {
+      BMRT_LOG(WRONG, "sync of %zu async launches failed", batch.size());
+    }
+
+    {
+      std::lock_guard<std::mutex> guard(m_mutex);
+      for (auto &req : batch) {
+        req.ok = req.ok && synced;
+        // a ticket with a callback is never waited, so it keeps no result
+        if (req.callback == NULL) {
+          m_results[req.seq] = req.ok;
+        }
+      }
+      // tickets that are never waited must not grow the map for the life of the queue
+      while (m_results.size() > MAX_RESULTS) {
+        BMRT_LOG(WRONG, "result of launch seq %llu is dropped, it is never waited",
+                 (unsigned long long)m_results.begin()->first);
+        m_results.erase(m_results.begin());
+      }
+      m_done_seq = batch.back().seq;
+    }
+    m_done_cond.notify_all();
+    for (auto &req : batch) {
+      if (req.callback != NULL) {
+        req.callback(req.user_data, req.ok);
+      }
+    }
+  }
+}
+
+}  // namespace bmruntime
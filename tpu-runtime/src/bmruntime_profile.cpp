@@ -1,5 +1,14 @@
 #include <sys/stat.h>
 #include <stdlib.h>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#ifdef __linux__
+#include <signal.h>
+#include <semaphore.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
 #include "bmruntime.h"
 #include "bm1682_profile.h"
 #include "bm1684_profile.h"
@@ -53,6 +62,7 @@ int bm_mkdir(const char *dirname, bool must_new)
 }
 
 BMProfile::BMProfile(Bmruntime* p_bmrt): p_bmrt(p_bmrt), enabled(false) {
+    BMEventTrace::setup();
     set_save_dir("bmprofile_data");
     handle = p_bmrt->get_bm_handle();
     devid = p_bmrt->get_devid();
@@ -397,4 +407,230 @@ void BMProfile::end_profile(net_ctx_t* net_ctx)
     close_file();
 }
 
+/* ---------------- event trace ---------------- */
+
+#define EVENT_TRACE_NAME_LEN 40
+
+typedef struct {
+    std::atomic<u64> seq; // index+1 of the event held in the slot, 0 while it is written
+    u64 begin_ns;
+    u64 end_ns;
+    long long arg;
+    u32 type;
+    char name[EVENT_TRACE_NAME_LEN];
+} trace_slot_t;
+
+typedef struct {
+    u32 tid;
+    bool in_use;
+    u64 mask;
+    std::atomic<u64> head;
+    trace_slot_t* slots;
+} trace_ring_t;
+
+// rings are never freed, the ring of an exited thread is kept for dump until a new thread takes it
+static std::mutex trace_rings_mutex;
+static vector<trace_ring_t*> trace_rings;
+
+static bool trace_env_enabled()
+{
+    auto value_str = getenv(ENV_ENABLE_EVENT_TRACE);
+    return value_str && (value_str[0] == 'T' || value_str[0] == 't' || atoi(value_str) != 0);
+}
+
+std::atomic<bool> BMEventTrace::s_enabled(trace_env_enabled());
+
+static u64 trace_ring_size()
+{
+    static u64 size = [] {
+        auto value_str = getenv(ENV_EVENT_TRACE_SIZE);
+        u64 want = value_str ? strtoull(value_str, NULL, 0) : 4096;
+        u64 size = 16;
+        while (size < want) size <<= 1;
+        return size;
+    }();
+    return size;
+}
+
+static u32 trace_thread_id()
+{
+#ifdef __linux__
+    return (u32)syscall(SYS_gettid);
+#else
+    return (u32)std::hash<std::thread::id>()(std::this_thread::get_id());
+#endif
+}
+
+struct trace_ring_holder_t {
+    trace_ring_t* ring = nullptr;
+    ~trace_ring_holder_t() {
+        if (!ring) return;
+        std::lock_guard<std::mutex> guard(trace_rings_mutex);
+        ring->in_use = false;
+    }
+};
+static thread_local trace_ring_holder_t trace_ring_holder;
+
+static trace_ring_t* trace_get_ring()
+{
+    if (trace_ring_holder.ring) return trace_ring_holder.ring;
+    std::lock_guard<std::mutex> guard(trace_rings_mutex);
+    trace_ring_t* ring = nullptr;
+    for (auto r : trace_rings) {
+        if (!r->in_use) {
+            ring = r;
+            break;
+        }
+    }
+    if (ring) {
+        for (u64 i = 0; i <= ring->mask; i++) {
+            ring->slots[i].seq.store(0, std::memory_order_relaxed);
+        }
+    } else {
+        u64 size = trace_ring_size();
+        ring = new trace_ring_t;
+        ring->mask = size - 1;
+        ring->slots = new trace_slot_t[size];
+        for (u64 i = 0; i < size; i++) {
+            ring->slots[i].seq.store(0, std::memory_order_relaxed);
+        }
+        trace_rings.push_back(ring);
+    }
+    ring->head.store(0, std::memory_order_relaxed);
+    ring->tid = trace_thread_id();
+    ring->in_use = true;
+    trace_ring_holder.ring = ring;
+    return ring;
+}
+
+void BMEventTrace::set_enable(bool is_enable)
+{
+    s_enabled.store(is_enable, std::memory_order_relaxed);
+}
+
+u64 BMEventTrace::now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void BMEventTrace::record(trace_event_type_t type, const char* name, u64 begin_ns, long long arg)
+{
+    u64 end_ns = now_ns();
+    trace_ring_t* ring = trace_get_ring();
+    // single writer, a reader drops the slot if seq changes while it is copied
+    u64 idx = ring->head.load(std::memory_order_relaxed);
+    trace_slot_t& slot = ring->slots[idx & ring->mask];
+    slot.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.begin_ns = begin_ns;
+    slot.end_ns = end_ns;
+    slot.arg = arg;
+    slot.type = type;
+    strncpy(slot.name, name ? name : "", EVENT_TRACE_NAME_LEN - 1);
+    slot.name[EVENT_TRACE_NAME_LEN - 1] = '\0';
+    slot.seq.store(idx + 1, std::memory_order_release);
+    ring->head.store(idx + 1, std::memory_order_release);
+}
+
+bool BMEventTrace::dump(const char* filename)
+{
+    static const char* type_names[] = {"launch", "subnet", "memcpy", "sync"};
+    static const char* arg_names[] = {"stage", "subnet_id", "bytes", "core"};
+    FILE* fp = fopen(filename, "w");
+    if (!fp) {
+        BMRT_LOG(WRONG, "writing file %s failed!", filename);
+        return false;
+    }
+#ifdef __linux__
+    int pid = getpid();
+#else
+    int pid = 0;
+#endif
+    fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(fp, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":0,\"args\":{\"name\":\"bmruntime\"}}", pid);
+    size_t event_num = 0;
+    std::lock_guard<std::mutex> guard(trace_rings_mutex);
+    for (auto ring : trace_rings) {
+        u64 head = ring->head.load(std::memory_order_acquire);
+        u64 begin = head > ring->mask + 1 ? head - (ring->mask + 1) : 0;
+        for (u64 i = begin; i < head; i++) {
+            trace_slot_t& slot = ring->slots[i & ring->mask];
+            u64 seq = slot.seq.load(std::memory_order_acquire);
+            u64 begin_ns = slot.begin_ns;
+            u64 end_ns = slot.end_ns;
+            long long arg = slot.arg;
+            u32 type = slot.type;
+            char name[EVENT_TRACE_NAME_LEN];
+            memcpy(name, slot.name, EVENT_TRACE_NAME_LEN);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq != i + 1 || slot.seq.load(std::memory_order_relaxed) != seq || type > TRACE_SYNC) {
+                continue;
+            }
+            name[EVENT_TRACE_NAME_LEN - 1] = '\0';
+            for (char* c = name; *c; c++) {
+                if (*c == '"' || *c == '\\' || (unsigned char)*c < 0x20) *c = '_';
+            }
+            fprintf(fp, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                        "\"pid\":%d,\"tid\":%u,\"args\":{\"%s\":%lld}}",
+                    name, type_names[type], begin_ns / 1000.0, (end_ns - begin_ns) / 1000.0,
+                    pid, ring->tid, arg_names[type], arg);
+            event_num++;
+        }
+    }
+    fprintf(fp, "\n]}\n");
+    fclose(fp);
+    BMRT_LOG(INFO, "dump %zu trace events to %s", event_num, filename);
+    return true;
+}
+
+#ifdef __linux__
+static sem_t trace_dump_sem;
+
+static void trace_signal_handler(int)
+{
+    // sem_post is async-signal-safe, the dump itself runs on trace_dump_thread
+    sem_post(&trace_dump_sem);
+}
+
+static void trace_dump_thread()
+{
+    for (int dump_idx = 0; ; dump_idx++) {
+        while (sem_wait(&trace_dump_sem) != 0) {}
+        auto filename = "bmrt_event_trace_" + std::to_string(getpid()) + "_" +
+                        std::to_string(dump_idx) + ".json";
+        BMEventTrace::dump(filename.c_str());
+    }
+}
+#endif
+
+void BMEventTrace::setup()
+{
+    static std::once_flag once;
+    std::call_once(once, [] {
+#ifdef __linux__
+        auto value_str = getenv(ENV_EVENT_TRACE_SIGNAL);
+        if (!value_str) return;
+        int signum = atoi(value_str);
+        if (signum <= 0 || signum >= NSIG) {
+            BMRT_LOG(WRONG, "invalid %s=%s", ENV_EVENT_TRACE_SIGNAL, value_str);
+            return;
+        }
+        sem_init(&trace_dump_sem, 0, 0);
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = trace_signal_handler;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        if (sigaction(signum, &action, NULL) != 0) {
+            BMRT_LOG(WRONG, "install handler of signal %d failed", signum);
+            return;
+        }
+        std::thread(trace_dump_thread).detach();
+        BMRT_LOG(INFO, "event trace is dumped to bmrt_event_trace_%d_*.json on signal %d",
+                 getpid(), signum);
+#endif
+    });
+}
+
 }
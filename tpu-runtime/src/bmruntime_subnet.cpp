@@ -131,13 +131,12 @@ void Bmruntime::subnet_clear(net_ctx_t* net_ctx)
   }
 }
 
-void Bmruntime::subnet_tensor_s2d(uint32_t devid, map<string, tensor_ext_t> *subnet_tensor_v, const string& tensor_name,
+void Bmruntime::subnet_tensor_s2d(uint32_t devid, tensor_ext_t& tensor_ext, const string& tensor_name,
                                   bm_device_mem_t *out_dev_mem, u64 offset, u64 size)
 {
-    auto iter = subnet_tensor_v->find(tensor_name);
-    BMRT_ASSERT_INFO(iter != subnet_tensor_v->end(), \
-      "Wrong subnet_tensor_v named:%s",  tensor_name.c_str());
-    auto &tensor_ext = iter->second;
+    BMEventTraceScope trace_scope(TRACE_MEMCPY, "subnet_s2d",
+                                  (size > 0 ? size : bmrt_shape_count(&tensor_ext.tensor_info.shape)) *
+                                  bmrt_data_type_size(tensor_ext.tensor_info.dtype));
 
     switch (tensor_ext.host_mem.type) {
         case HOST_MEM_MMAP:  /* flush cache */
@@ -186,22 +185,15 @@ void Bmruntime::subnet_tensor_s2d(uint32_t devid, map<string, tensor_ext_t> *sub
     }
 }
 
-static tensor_ext_t& must_get_tensor_in_subnet(map<string, tensor_ext_t> *subnet_tensor_v, const string& name){
-    auto iter = subnet_tensor_v->find(name);
-    BMRT_ASSERT_INFO(iter != subnet_tensor_v->end(), \
-      "Wrong tensor named:%s",  name.c_str());
-    return iter->second;
-}
-void Bmruntime::subnet_tensor_forward(uint32_t devid, map<string, tensor_ext_t> *subnet_tensor_v, const string& src_name, const string& dst_name, const bm_tensor_t* output_tensors){
-    auto &src_tensor = must_get_tensor_in_subnet(subnet_tensor_v, src_name);
-    auto &dst_tensor = must_get_tensor_in_subnet(subnet_tensor_v, dst_name);
+void Bmruntime::subnet_tensor_forward(uint32_t devid, tensor_ext_t& src_tensor, const string& src_name,
+                                      tensor_ext_t& dst_tensor, const bm_tensor_t* output_tensors){
     auto src_mem = src_tensor.tensor_info.device_mem;
     auto dst_mem = dst_tensor.tensor_info.device_mem;
     if(dst_tensor.io_type == TENSOR_TYPE_NET_OUTPUT){
         dst_mem = output_tensors[dst_tensor.io_index].device_mem;
     }
     if (src_tensor.src_subnet && src_tensor.src_subnet->subnet_mode == SUBNET_MODE_CPU) {
-        subnet_tensor_s2d(devid, subnet_tensor_v, src_name, &dst_mem);
+        subnet_tensor_s2d(devid, src_tensor, src_name, &dst_mem);
     } else {
         //copy or move src_tensor data to dst_tensor
         BMRT_DEBUG("%s D2D from=0x%llx, to=0x%llx, len=%d",
@@ -210,19 +202,19 @@ void Bmruntime::subnet_tensor_forward(uint32_t devid, map<string, tensor_ext_t>
                    (u64)dst_mem.u.device.device_addr,
                    src_mem.size
                    );
+        BMEventTraceScope trace_scope(TRACE_MEMCPY, "subnet_d2d", src_mem.size);
         bm_memcpy_d2d_byte(m_handles[devid], dst_mem, 0, src_mem, 0, src_mem.size);
     }
     dst_tensor.tensor_info.shape = src_tensor.tensor_info.shape;
 }
 
-void* Bmruntime::subnet_tensor_d2s(uint32_t devid, map<string, tensor_ext_t> *subnet_tensor_v, const string& tensor_name,
+void* Bmruntime::subnet_tensor_d2s(uint32_t devid, tensor_ext_t& tensor_ext, const string& tensor_name,
                                   bm_device_mem_t *out_dev_mem,
                                   u64 offset, u64 size) // offset is out_dev_mem offset
 {
-    auto iter = subnet_tensor_v->find(tensor_name);
-    BMRT_ASSERT_INFO(iter != subnet_tensor_v->end(), \
-      "Wrong subnet_tensor_v named:%s",  tensor_name.c_str());
-    auto &tensor_ext = iter->second;
+    BMEventTraceScope trace_scope(TRACE_MEMCPY, "subnet_d2s",
+                                  (size > 0 ? size : bmrt_shape_count(&tensor_ext.tensor_info.shape)) *
+                                  bmrt_data_type_size(tensor_ext.tensor_info.dtype));
 
     switch (tensor_ext.host_mem.type) {
         case HOST_MEM_MMAP:  /* invalidate cache */
@@ -273,7 +265,8 @@ void* Bmruntime::subnet_tensor_d2s(uint32_t devid, map<string, tensor_ext_t> *su
 }
 
 /* TODO : refactor by launch_ir */
-bool Bmruntime::launch_tpu_ir_subnet(net_ctx_t* net_ctx, net_stage_t* stage, const SUBNET_INFO_T* subnet,
+bool Bmruntime::launch_tpu_ir_subnet(net_ctx_t* net_ctx, net_stage_t* stage, const subnet_binding_t* binding,
+                                     const SUBNET_INFO_T* subnet,
                                      const bm_tensor_t* input_tensors, const int* input_elem_num, int input_num,
                                      bm_tensor_t* output_tensors, int* output_elem_num, int output_num,
                                      const std::vector<int32_t> &real_core_list, const uint32_t dyn_core_mask)
@@ -368,15 +361,12 @@ bool Bmruntime::launch_tpu_ir_subnet(net_ctx_t* net_ctx, net_stage_t* stage, con
   u32* output_need_middle_buff_flag = output_need_middle_buff_flag_.get();
   #endif
   if (arch == BM1684) {
-    map<string, tensor_ext_t> *subnet_tensor_v;
     vector<tensor_attr_t> *input_v;
     vector<tensor_attr_t> *output_v;
     if (m_flags & BM_RUNTIME_SHARE_MEM) {
-      subnet_tensor_v = &(stage->subnet_tensor_v);
       input_v = &(stage->input_v);
       output_v = &(stage->output_v);
     } else {
-      subnet_tensor_v = &(net_ctx->dyn_neuron_stage_dict[dyn_core_mask]->subnet_tensor_v);
       input_v = &(net_ctx->dyn_neuron_stage_dict[dyn_core_mask]->input_v);
       output_v = &(net_ctx->dyn_neuron_stage_dict[dyn_core_mask]->output_v);
     }
@@ -384,10 +374,10 @@ bool Bmruntime::launch_tpu_ir_subnet(net_ctx_t* net_ctx, net_stage_t* stage, con
     // input, only 1N will switch to 4N
     int stmode_flag = ST_NO_CHANGE;
     for (int idx = 0; idx < input_num; idx++) {
-      auto& tensor_name = subnet->input_tensor_name_v[idx];
-      auto& tensor_ext  = subnet_tensor_v->find(tensor_name)->second;
+      auto& tensor_ext  = *binding->tensor_v[subnet->input_slot_v[idx]];
       if (tensor_ext.io_type != TENSOR_TYPE_NET_INPUT) {
-        BMRT_DEBUG("subnet immediate tensor %s do not need input middle buffer", tensor_name.c_str());
+        BMRT_DEBUG("subnet immediate tensor %s do not need input middle buffer",
+                   subnet->input_tensor_name_v[idx].c_str());
         user_input_global_addr_middle[idx] = 0;
         continue;
       }
@@ -410,8 +400,7 @@ bool Bmruntime::launch_tpu_ir_subnet(net_ctx_t* net_ctx, net_stage_t* stage, con
     }
     // output
     for (int idx = 0; idx < output_num; idx++) {
-      auto& tensor_name = subnet->output_tensor_name_v[idx];
-      auto& tensor_ext  = subnet_tensor_v->find(tensor_name)->second;
+      auto& tensor_ext  = *binding->tensor_v[subnet->output_slot_v[idx]];
       /* TODO: net output tensor could be also imm input tensor of subnet.
        *       (1) as net output tensor, need middlebuffer for 1N/4N convert.
        *       (2) as imm tensor, do not need stmode convert..
@@ -419,7 +408,8 @@ bool Bmruntime::launch_tpu_ir_subnet(net_ctx_t* net_ctx, net_stage_t* stage, con
       //if (tensor_ext.io_type != TENSOR_TYPE_NET_OUTPUT) {
       if (!(tensor_ext.io_type & TENSOR_TYPE_NET_OUTPUT)) {
         /* subnet imm tensor do not need middle buffer */
-        BMRT_DEBUG("subnet immediate tensor %s do not need output middle buffer", tensor_name.c_str());
+        BMRT_DEBUG("subnet immediate tensor %s do not need output middle buffer",
+                   subnet->output_tensor_name_v[idx].c_str());
         user_output_global_addr_middle[idx] = 0;
         output_need_middle_buff_flag[idx] = ST_NO_CHANGE;
         continue;
@@ -590,12 +580,10 @@ bool Bmruntime::launch_tpu_ir_subnet(net_ctx_t* net_ctx, net_stage_t* stage, con
   return BM_SUCCESS == status;
 }
 
-template <typename T_stage>
-void Bmruntime::get_tensor_attr(const T_stage *stage,
-    const vector<string> &tensor_name_v, vector<tensor_attr_t> &input_v) {
-  for (int idx = 0; idx < tensor_name_v.size(); ++idx) {
-    const auto &tensor_name = tensor_name_v.at(idx);
-    const tensor_ext_t &cmd_input = stage->subnet_tensor_v.find(tensor_name)->second;
+static void get_tensor_attr(const subnet_binding_t *binding,
+    const vector<int> &slot_v, vector<tensor_attr_t> &input_v) {
+  for (size_t idx = 0; idx < slot_v.size(); ++idx) {
+    const tensor_ext_t &cmd_input = *binding->tensor_v[slot_v[idx]];
     input_v[idx].dev_mem = cmd_input.tensor_info.device_mem;
     input_v[idx].pad_h = cmd_input.pad_h;
     input_v[idx].shape = cmd_input.tensor_info.shape;
@@ -644,15 +632,14 @@ void Bmruntime::fill_tpu_tensor_info(
   }
 }
 
-template <typename T_stage>
 void Bmruntime::fill_tpu_tensor_info(
-    std::vector<tpu_tensor_info_t> &tensor_info, const T_stage *stage,
+    std::vector<tpu_tensor_info_t> &tensor_info, const subnet_binding_t *binding,
     const SUBNET_INFO_T *subnet, const bm_tensor_t *user_tensors,
     bool is_input) {
-  const auto &ref_tensors =
-      is_input ? subnet->input_tensor_name_v : subnet->output_tensor_name_v;
-  std::vector<tensor_attr_t> tensor_attr_v(ref_tensors.size());
-  get_tensor_attr(stage, ref_tensors, tensor_attr_v);
+  const auto &ref_slots =
+      is_input ? subnet->input_slot_v : subnet->output_slot_v;
+  std::vector<tensor_attr_t> tensor_attr_v(ref_slots.size());
+  get_tensor_attr(binding, ref_slots, tensor_attr_v);
   return fill_tpu_tensor_info(tensor_info, tensor_attr_v, user_tensors, is_input);
 }
 
@@ -671,7 +658,8 @@ void Bmruntime::fill_tpu_cmd_info(std::vector<tpu_cmd_info_t> &cmd_info,
   }
 }
 /* TODO : refactor by launch_static */
-bool Bmruntime::launch_tpu_subnet(net_ctx_t* net_ctx, net_stage_t* stage, const SUBNET_INFO_T* subnet,
+bool Bmruntime::launch_tpu_subnet(net_ctx_t* net_ctx, net_stage_t* stage, const subnet_binding_t* binding,
+                                  const SUBNET_INFO_T* subnet,
                                   const bm_tensor_t* input_tensors, int input_num,
                                   bm_tensor_t* output_tensors, int output_num,
                                   const std::vector<int32_t> &core_list, const uint32_t dyn_core_mask, bool force_sync)
@@ -679,13 +667,8 @@ bool Bmruntime::launch_tpu_subnet(net_ctx_t* net_ctx, net_stage_t* stage, const
   auto devid = net_ctx->device_id;
   std::vector<tpu_tensor_info_t> input_info;
   std::vector<tpu_tensor_info_t> output_info;
-  if (m_flags & BM_RUNTIME_SHARE_MEM) {
-    fill_tpu_tensor_info(input_info, stage, subnet, input_tensors, true);
-    fill_tpu_tensor_info(output_info, stage, subnet, output_tensors, false);
-  } else {
-    fill_tpu_tensor_info(input_info, net_ctx->dyn_neuron_stage_dict[dyn_core_mask], subnet, input_tensors, true);
-    fill_tpu_tensor_info(output_info, net_ctx->dyn_neuron_stage_dict[dyn_core_mask], subnet, output_tensors, false);
-  }
+  fill_tpu_tensor_info(input_info, binding, subnet, input_tensors, true);
+  fill_tpu_tensor_info(output_info, binding, subnet, output_tensors, false);
 
   // auto core_list = get_core_list_from_core_mask(dyn_core_mask);
   std::vector<tpu_single_core_cmd_t> core_command(core_list.size());
@@ -749,6 +732,7 @@ bool Bmruntime::launch_tpu_subnet(net_ctx_t* net_ctx, net_stage_t* stage, const
     bool need_sync = m_profile->is_enabled() | force_sync;
     if (need_sync && BM_SUCCESS == status) {
       for (auto core_id : core_list) {
+        BMEventTraceScope trace_scope(TRACE_SYNC, "bm_thread_sync_from_core", core_id);
         bm_status_t core_status = bm_thread_sync_from_core(m_handles[devid], core_id);
         status = core_status == BM_SUCCESS ? status : core_status;
       }
@@ -798,7 +782,7 @@ bool Bmruntime::launch_tpu_subnet(net_ctx_t* net_ctx, net_stage_t* stage, const
 }
 
 /* launch static net, no n/h/w specified */
-bool Bmruntime::launch_cpu_subnet(net_ctx_t* net_ctx, map<string, tensor_ext_t> *subnet_tensor_v, const SUBNET_INFO_T* subnet,
+bool Bmruntime::launch_cpu_subnet(net_ctx_t* net_ctx, subnet_binding_t* binding, const SUBNET_INFO_T* subnet,
                                   const bm_tensor_t* input_tensors, bm_shape_t real_out_shape[])
 {
   if (bmcpu_process_ == NULL) {
@@ -810,44 +794,47 @@ bool Bmruntime::launch_cpu_subnet(net_ctx_t* net_ctx, map<string, tensor_ext_t>
   void *user_param = subnet->cpu_info.user_param;
   int param_size = subnet->cpu_info.param_size;
 
-  int input_num  = subnet->input_tensor_name_v.size();
-  int output_num = subnet->output_tensor_name_v.size();
+  int input_num  = subnet->input_slot_v.size();
+  int output_num = subnet->output_slot_v.size();
 
-  vector<float *> input_tensor_data_v(input_num);
-  vector<float *> output_tensor_data_v(output_num);
-  vector<vector<int>> input_shapes_v;
-  vector<vector<int>> output_shapes_v;
+  /* launch arguments are sized when binding, only contents are refreshed here */
+  auto& cpu_args = binding->cpu_args_v[subnet->id];
+  auto& input_tensor_data_v = cpu_args.input_data_v;
+  auto& output_tensor_data_v = cpu_args.output_data_v;
+  auto& input_shapes_v = cpu_args.input_shape_v;
+  auto& output_shapes_v = cpu_args.output_shape_v;
 
   bm_device_mem_t dev_mem;
   bm_shape_t shape;
-  std::vector<bm_data_type_t> input_dtypes;
-  std::vector<bm_data_type_t> output_dtypes;
-  int tensor_idx = 0;
-  for (auto& tensor_name: subnet->input_tensor_name_v) {
+#ifdef DEBUG
+  std::vector<bm_data_type_t> input_dtypes(input_num);
+#endif
+  for (int tensor_idx = 0; tensor_idx < input_num; tensor_idx++) {
     bool need_d2s = false;
-
-    auto iter = subnet_tensor_v->find(tensor_name);
-    BMRT_ASSERT_INFO(iter != subnet_tensor_v->end(), "Wrong subnet_tensor_v named:%s",  tensor_name.c_str());
-    // BMRT_ASSERT(stage->subnet_tensor_v.find(tensor_name) != stage->subnet_tensor_v.end());
-    auto& tensor_ext = subnet_tensor_v->find(tensor_name)->second;
+    auto& tensor_name = subnet->input_tensor_name_v[tensor_idx];
+    auto& tensor_ext = *binding->tensor_v[subnet->input_slot_v[tensor_idx]];
 
     switch(tensor_ext.io_type) {
         case TENSOR_TYPE_NET_INPUT:
             /* subnet input tensor is also net input tensor, using user input */
             shape = input_tensors[tensor_ext.io_index].shape;
-            input_dtypes.push_back(input_tensors[tensor_ext.io_index].dtype);
-            input_shapes_v.push_back(vector<int>(shape.dims, shape.dims + shape.num_dims));
+#ifdef DEBUG
+            input_dtypes[tensor_idx] = input_tensors[tensor_ext.io_index].dtype;
+#endif
+            input_shapes_v[tensor_idx].assign(shape.dims, shape.dims + shape.num_dims);
 
             /* now net inputs are always device memory, TOBE REFINE !! */
             dev_mem = input_tensors[tensor_ext.io_index].device_mem;
             need_d2s = true;
-            subnet_tensor_d2s(devid, subnet_tensor_v, tensor_name, &dev_mem, 0, bmrt_shape_count(&shape));
+            subnet_tensor_d2s(devid, tensor_ext, tensor_name, &dev_mem, 0, bmrt_shape_count(&shape));
             break;
         case TENSOR_TYPE_NET_OUTPUT:
         case TENSOR_TYPE_IMM_IO:
             shape = tensor_ext.tensor_info.shape;
-            input_dtypes.push_back(tensor_ext.tensor_info.dtype);
-            input_shapes_v.push_back(vector<int>(shape.dims, shape.dims + shape.num_dims));
+#ifdef DEBUG
+            input_dtypes[tensor_idx] = tensor_ext.tensor_info.dtype;
+#endif
+            input_shapes_v[tensor_idx].assign(shape.dims, shape.dims + shape.num_dims);
 
             // tensor_ext.src_subnet is nullptr, means the tensor is coeff
             if ((!tensor_ext.src_subnet || tensor_ext.src_subnet->subnet_mode != SUBNET_MODE_CPU) &&
@@ -855,7 +842,7 @@ bool Bmruntime::launch_cpu_subnet(net_ctx_t* net_ctx, map<string, tensor_ext_t>
                 /* for cpu subnet, if input tensor is from tpu subnet : d2s */
                 dev_mem = tensor_ext.tensor_info.device_mem;
                 need_d2s = true;
-                subnet_tensor_d2s(devid, subnet_tensor_v, tensor_name);
+                subnet_tensor_d2s(devid, tensor_ext, tensor_name);
             }
 
             break;
@@ -869,20 +856,13 @@ bool Bmruntime::launch_cpu_subnet(net_ctx_t* net_ctx, map<string, tensor_ext_t>
       BMRT_DEBUG("CPU SUBNET TENSOR %s D2S FROM %llx TO %p", tensor_name.c_str(),
                bm_mem_get_device_addr(dev_mem), input_tensor_data_v[tensor_idx]);
     }
-
-    tensor_idx++;
   }
 
-  tensor_idx = 0;
-  for (auto& tensor_name: subnet->output_tensor_name_v) {
-    auto& tensor_ext = subnet_tensor_v->find(tensor_name)->second;
+  for (int tensor_idx = 0; tensor_idx < output_num; tensor_idx++) {
+    auto& tensor_ext = *binding->tensor_v[subnet->output_slot_v[tensor_idx]];
     auto& shape = tensor_ext.tensor_info.shape;
-    output_dtypes.push_back(tensor_ext.tensor_info.dtype);
-    vector<int> output_shape(shape.dims, shape.dims + shape.num_dims);
-    output_shapes_v.push_back(output_shape);
-
+    output_shapes_v[tensor_idx].assign(shape.dims, shape.dims + shape.num_dims);
     output_tensor_data_v[tensor_idx] = (float *)tensor_ext.host_mem.addr;
-    tensor_idx++;
   }
 
   BMRT_DEBUG("CPU SUBNET TYPE %d LAUNCH START", op_type);
@@ -904,8 +884,6 @@ bool Bmruntime::launch_cpu_subnet(net_ctx_t* net_ctx, map<string, tensor_ext_t>
     }
   }
 #endif
-  (void)(input_dtypes);
-  (void)(output_dtypes);
 
   /* NOTE: need keep input/output tensor order accordingly with bmcpu */
   if (op_type < 10000) {
@@ -931,7 +909,7 @@ bool Bmruntime::launch_cpu_subnet(net_ctx_t* net_ctx, map<string, tensor_ext_t>
       auto data_fp32 = reinterpret_cast<float *>(output_tensor_data_v[i]);
       auto data_int = reinterpret_cast<int *>(output_tensor_data_v[i]);
       for (int idx = 0; idx < std::min(10, shape_count(output_shapes_v[i])); idx++) {
-          if (input_dtypes[i] == bm_data_type_t::BM_INT32)
+          if (i < input_num && input_dtypes[i] == bm_data_type_t::BM_INT32)
             debug_msg <<"  "<< data_int[idx];
           else
           // if (input_dtypes[i] == bm_data_type_t::BM_FLOAT32)
@@ -954,6 +932,72 @@ bool Bmruntime::launch_cpu_subnet(net_ctx_t* net_ctx, map<string, tensor_ext_t>
   return true;
 }
 
+void compile_subnet_plan(net_stage_t* stage)
+{
+  std::unordered_map<string, int> slot_dict;
+  auto get_slot = [&](const string& name) {
+    auto iter = slot_dict.find(name);
+    if (iter != slot_dict.end()) {
+      return iter->second;
+    }
+    BMRT_ASSERT_INFO(stage->subnet_tensor_v.find(name) != stage->subnet_tensor_v.end(),
+                     "Wrong subnet_tensor_v named:%s", name.c_str());
+    int slot = stage->subnet_slot_name_v.size();
+    stage->subnet_slot_name_v.push_back(name);
+    slot_dict[name] = slot;
+    return slot;
+  };
+
+  stage->subnet_slot_name_v.clear();
+  for (auto subnet : stage->subnet_v) {
+    subnet->input_slot_v.clear();
+    subnet->output_slot_v.clear();
+    for (auto& name : subnet->input_tensor_name_v) {
+      subnet->input_slot_v.push_back(get_slot(name));
+    }
+    for (auto& name : subnet->output_tensor_name_v) {
+      subnet->output_slot_v.push_back(get_slot(name));
+    }
+    /* compatible switch mode tells the branch by the ":1" suffix of the output name */
+    if (subnet->subnet_mode == SUBNET_MODE_SWITCH && !subnet->switch_info.valid) {
+      subnet->switch_info.output_branch.clear();
+      for (auto& name : subnet->output_tensor_name_v) {
+        bool is_true_name = name.size() >= 2 && name.substr(name.size() - 2) == ":1";
+        subnet->switch_info.output_branch.push_back(is_true_name);
+      }
+    }
+  }
+}
+
+void bind_subnet_plan(const net_stage_t* stage, map<string, tensor_ext_t>* tensor_v,
+                      subnet_binding_t* binding)
+{
+  binding->tensor_v.resize(stage->subnet_slot_name_v.size());
+  for (size_t slot = 0; slot < stage->subnet_slot_name_v.size(); slot++) {
+    auto& name = stage->subnet_slot_name_v[slot];
+    auto iter = tensor_v->find(name);
+    BMRT_ASSERT_INFO(iter != tensor_v->end(), "Wrong subnet_tensor_v named:%s", name.c_str());
+    binding->tensor_v[slot] = &iter->second;
+  }
+
+  binding->cpu_args_v.clear();
+  binding->cpu_args_v.resize(stage->subnet_v.size());
+  for (auto subnet : stage->subnet_v) {
+    if (subnet->subnet_mode != SUBNET_MODE_CPU) {
+      continue;
+    }
+    BMRT_ASSERT_INFO(subnet->id >= 0 && subnet->id < (int)stage->subnet_v.size(),
+                     "subnet id:%d out of range", subnet->id);
+    auto& cpu_args = binding->cpu_args_v[subnet->id];
+    cpu_args.input_data_v.resize(subnet->input_slot_v.size());
+    cpu_args.output_data_v.resize(subnet->output_slot_v.size());
+    cpu_args.input_shape_v.resize(subnet->input_slot_v.size());
+    cpu_args.output_shape_v.resize(subnet->output_slot_v.size());
+    for (auto& shape : cpu_args.input_shape_v) shape.reserve(BM_MAX_DIMS_NUM);
+    for (auto& shape : cpu_args.output_shape_v) shape.reserve(BM_MAX_DIMS_NUM);
+  }
+}
+
 bool Bmruntime::launch_multi_subnet(
     net_ctx_t* net_ctx, net_stage_t* stage,
     const bm_tensor_t* input_tensors,
@@ -973,22 +1017,34 @@ bool Bmruntime::launch_multi_subnet(
     auto devid = net_ctx->device_id;
     const SUBNET_INFO_T *subnet = stage->subnet_v.front();
     std::unique_lock<std::mutex> lock(net_ctx->neuron_mutex);
-    map<string, tensor_ext_t> *subnet_tensor_v;
+    subnet_binding_t *binding;
     if (m_flags & BM_RUNTIME_SHARE_MEM) {
-      subnet_tensor_v = &(stage->subnet_tensor_v);
+      binding = &(stage->subnet_binding);
     } else {
-      subnet_tensor_v = &(net_ctx->dyn_neuron_stage_dict[dyn_core_mask]->subnet_tensor_v);
+      auto dyn_neuron_stage = net_ctx->dyn_neuron_stage_dict[dyn_core_mask];
+      binding = &(dyn_neuron_stage->subnet_binding_dict[stage]);
+      if (binding->tensor_v.size() != stage->subnet_slot_name_v.size()) {
+        bind_subnet_plan(stage, &(dyn_neuron_stage->subnet_tensor_v), binding);
+      }
     }
+    auto& slot_tensor_v = binding->tensor_v;
     int iteration = 0;
-    map<string, int> tensor_iteration;
+    /* for merge, the iteration each slot is latest written */
+    #ifdef __linux__
+    int tensor_iteration[slot_tensor_v.size() + 1];
+    #else
+    std::shared_ptr<int> tensor_iteration_(new int[slot_tensor_v.size() + 1], std::default_delete<int[]>());
+    int* tensor_iteration = tensor_iteration_.get();
+    #endif
+    memset(tensor_iteration, 0, sizeof(int) * (slot_tensor_v.size() + 1));
     while(subnet){
         BMRT_DEBUG("iteration=%d, subnet_id=%d, subnet_mode=%d", iteration, subnet->id, subnet->subnet_mode);
         //for merge, use tensor with max iteration as input
         iteration++;
         int next_id = -1;
         if(subnet->subnet_mode != SUBNET_MODE_SWITCH){
-            for(auto out_name: subnet->output_tensor_name_v){
-                tensor_iteration[out_name] = iteration;
+            for(auto out_slot: subnet->output_slot_v){
+                tensor_iteration[out_slot] = iteration;
             }
             if(!subnet->next_subnet_ids.empty()){
                 next_id = subnet->next_subnet_ids[0];
@@ -997,9 +1053,10 @@ bool Bmruntime::launch_multi_subnet(
         if (m_subnet_time_print) {
             start_time(time);
         }
+        BMEventTraceScope subnet_trace_scope(TRACE_SUBNET, net_ctx->net_name.c_str(), subnet->id);
         m_profile->begin_subnet(net_ctx, iteration-1, subnet->id, subnet->subnet_mode);
         if(subnet->subnet_mode == SUBNET_MODE_MERGE){
-            output_num = subnet->output_tensor_name_v.size();
+            output_num = subnet->output_slot_v.size();
             auto& output_from = subnet->merge_info.output_from;
             for(int idx = 0; idx<output_num; idx++){
                 auto& indice = output_from[idx];
@@ -1007,51 +1064,44 @@ bool Bmruntime::launch_multi_subnet(
                 int max_iteration = -1;
                 //select a lastest input as output
                 for(auto from_index: indice){
-                    auto in_name = subnet->input_tensor_name_v[from_index];
-                    if(max_iteration<tensor_iteration[in_name]){
-                        max_iteration = tensor_iteration[in_name];
+                    int in_slot = subnet->input_slot_v[from_index];
+                    if(max_iteration<tensor_iteration[in_slot]){
+                        max_iteration = tensor_iteration[in_slot];
                         in_idx = from_index;
                     }
                 }
                 BMRT_ASSERT_INFO(in_idx>=0, "in_idx:%d shouldn't less than 0", in_idx);
                 //forward tensor to output
-                auto in_name = subnet->input_tensor_name_v[in_idx];
-                subnet_tensor_forward(devid, subnet_tensor_v, in_name, subnet->output_tensor_name_v[idx], output_tensors);
+                subnet_tensor_forward(devid, *slot_tensor_v[subnet->input_slot_v[in_idx]],
+                                      subnet->input_tensor_name_v[in_idx],
+                                      *slot_tensor_v[subnet->output_slot_v[idx]], output_tensors);
             }
         } else if (subnet->subnet_mode == SUBNET_MODE_SWITCH) {
             int subnet_id_size = subnet->next_subnet_ids.size();
             BMRT_ASSERT_INFO(subnet_id_size == 2, "subnet->next_subnet_ids.size():%d should be 2",subnet_id_size);
-            int tensor_name_size = subnet->input_tensor_name_v.size();
+            int tensor_name_size = subnet->input_slot_v.size();
             BMRT_ASSERT_INFO(tensor_name_size >= 1, "subnet->input_tensor_name_v.size():%d shouldn't less than 1", tensor_name_size);
 
             //get condition data
             bool run_true_subnet = false;
-            auto cond_name = subnet->input_tensor_name_v.back();
             const bm_device_mem_t* cond_mem = nullptr;
-            auto& tensor_ext = subnet_tensor_v->find(cond_name)->second;
+            auto& tensor_ext = *slot_tensor_v[subnet->input_slot_v.back()];
             if(tensor_ext.io_type == TENSOR_TYPE_NET_INPUT){
                 cond_mem = &(input_tensors[tensor_ext.io_index].device_mem);
             }
-            auto data_ptr = (int*)subnet_tensor_d2s(devid, subnet_tensor_v, cond_name, const_cast<bm_device_mem_t*>(cond_mem));
+            auto data_ptr = (int*)subnet_tensor_d2s(devid, tensor_ext, subnet->input_tensor_name_v.back(),
+                                                    const_cast<bm_device_mem_t*>(cond_mem));
             run_true_subnet = data_ptr[0] != 0;
 
-            if(!subnet->switch_info.valid){
-                for(auto out_name: subnet->output_tensor_name_v){
-                    bool is_true_name = out_name.substr(out_name.size()-2) == ":1";
-                    if((run_true_subnet && is_true_name) || (!run_true_subnet && !is_true_name)){
-                        tensor_iteration[out_name] = iteration;
-                    }
-                }
-            } else {
-                for(size_t out_idx=0; out_idx<subnet->output_tensor_name_v.size(); out_idx++){
-                    bool is_true_output = subnet->switch_info.output_branch[out_idx];
-                    if((run_true_subnet && is_true_output) || (!run_true_subnet && !is_true_output)){
-                        auto out_name = subnet->output_tensor_name_v[out_idx];
-                        auto in_name = subnet->input_tensor_name_v[subnet->switch_info.output_from[out_idx]];
-                        tensor_iteration[out_name] = iteration;
-                        auto &src_tensor = must_get_tensor_in_subnet(subnet_tensor_v, in_name);
-                        auto &dst_tensor = must_get_tensor_in_subnet(subnet_tensor_v, out_name);
-                        dst_tensor.tensor_info.shape = src_tensor.tensor_info.shape;
+            /* output_branch of compatible mode is compiled from output names */
+            for(size_t out_idx=0; out_idx<subnet->output_slot_v.size(); out_idx++){
+                bool is_true_output = subnet->switch_info.output_branch[out_idx];
+                if((run_true_subnet && is_true_output) || (!run_true_subnet && !is_true_output)){
+                    int out_slot = subnet->output_slot_v[out_idx];
+                    tensor_iteration[out_slot] = iteration;
+                    if(subnet->switch_info.valid){
+                        int in_slot = subnet->input_slot_v[subnet->switch_info.output_from[out_idx]];
+                        slot_tensor_v[out_slot]->tensor_info.shape = slot_tensor_v[in_slot]->tensor_info.shape;
                     }
                 }
             }
@@ -1060,17 +1110,17 @@ bool Bmruntime::launch_multi_subnet(
         } else if (subnet->subnet_mode == SUBNET_MODE_CPU) {
             m_profile->set_extra_data(subnet->cpu_info.op_type);
             #ifdef __linux__
-            bm_shape_t real_out_shape[subnet->output_tensor_name_v.size()];
+            bm_shape_t real_out_shape[subnet->output_slot_v.size()];
             #else
-            std::shared_ptr<bm_shape_t> real_out_shape_(new bm_shape_t[subnet->output_tensor_name_v.size()], std::default_delete<bm_shape_t[]>());
+            std::shared_ptr<bm_shape_t> real_out_shape_(new bm_shape_t[subnet->output_slot_v.size()], std::default_delete<bm_shape_t[]>());
             bm_shape_t* real_out_shape = real_out_shape_.get();
             #endif
-            ret = launch_cpu_subnet(net_ctx, subnet_tensor_v, subnet, input_tensors, real_out_shape);
+            ret = launch_cpu_subnet(net_ctx, binding, subnet, input_tensors, real_out_shape);
             BMRT_ASSERT_INFO(ret == true, "launch_cpu_subnet return false");
 
-            tensor_idx = 0;
-            for (auto& tensor_name: subnet->output_tensor_name_v) {
-                auto& tensor_ext  = subnet_tensor_v->find(tensor_name)->second;
+            for (tensor_idx = 0; tensor_idx < (int)subnet->output_slot_v.size(); tensor_idx++) {
+                auto& tensor_name = subnet->output_tensor_name_v[tensor_idx];
+                auto& tensor_ext  = *slot_tensor_v[subnet->output_slot_v[tensor_idx]];
 #if 0
                 if (!bmrt_shape_is_same(&tensor_ext.max_shape, &real_out_shape[tensor_idx]) &&
                     (tensor_ext.mem_type & MEM_TYPE_TPU)) {
@@ -1095,7 +1145,7 @@ bool Bmruntime::launch_multi_subnet(
                 /* update net output shape/data */
                 if (tensor_ext.io_type == TENSOR_TYPE_NET_OUTPUT) {
                     output_tensors[tensor_ext.io_index].shape = real_out_shape[tensor_idx];
-                    subnet_tensor_s2d(devid, subnet_tensor_v, tensor_name, &output_tensors[tensor_ext.io_index].device_mem);
+                    subnet_tensor_s2d(devid, tensor_ext, tensor_name, &output_tensors[tensor_ext.io_index].device_mem);
                 }
 
                 #ifdef DEBUG
@@ -1108,16 +1158,14 @@ bool Bmruntime::launch_multi_subnet(
                   BMRT_DEBUG("%s", debug_msg.str().c_str());
                 }
                 #endif
-
-                tensor_idx++;
             }
 
         } else if(subnet->subnet_mode == SUBNET_MODE_TPU) {
             if (!(m_flags & BM_RUNTIME_SHARE_MEM)) {
               lock.unlock();
             }
-            int subnet_input_num  = subnet->input_tensor_name_v.size();
-            int subnet_output_num = subnet->output_tensor_name_v.size();
+            int subnet_input_num  = subnet->input_slot_v.size();
+            int subnet_output_num = subnet->output_slot_v.size();
             #ifdef __linux__
             bm_tensor_t subnet_input_tensors[subnet_input_num];
             bm_tensor_t subnet_output_tensors[subnet_output_num];
@@ -1135,9 +1183,8 @@ bool Bmruntime::launch_multi_subnet(
             #endif
 
             /* set user input */
-            tensor_idx = 0;
-            for (auto& tensor_name: subnet->input_tensor_name_v) {
-                auto& tensor_ext  = subnet_tensor_v->find(tensor_name)->second;
+            for (tensor_idx = 0; tensor_idx < subnet_input_num; tensor_idx++) {
+                auto& tensor_ext  = *slot_tensor_v[subnet->input_slot_v[tensor_idx]];
                 switch(tensor_ext.io_type) {
                     case TENSOR_TYPE_NET_INPUT:
                         /* subnet input tensor is also net input tensor, using user input */
@@ -1155,7 +1202,8 @@ bool Bmruntime::launch_multi_subnet(
                         subnet_input_elem_nums[tensor_idx] = tensor_ext.record_elem_num;
                         /* for tpu subnet, if input tensor is from cpu subnet : s2d */
                         if (tensor_ext.src_subnet && tensor_ext.src_subnet->subnet_mode == SUBNET_MODE_CPU) {
-                          subnet_tensor_s2d(devid, subnet_tensor_v, tensor_name);
+                          auto& tensor_name = subnet->input_tensor_name_v[tensor_idx];
+                          subnet_tensor_s2d(devid, tensor_ext, tensor_name);
                           BMRT_DEBUG("TPU SUBNET TENSOR %s S2D FROM %p TO %llx",
                               tensor_name.c_str(), tensor_ext.host_mem.addr,
                               bm_mem_get_device_addr(subnet_input_tensors[tensor_idx].device_mem));
@@ -1165,13 +1213,11 @@ bool Bmruntime::launch_multi_subnet(
                         BMRT_LOG(FATAL, "error io tensor type!");
                         break;
                 }
-                tensor_idx++;
             }
 
             /* set user output */
-            tensor_idx = 0;
-            for (auto& tensor_name: subnet->output_tensor_name_v) {
-                auto& tensor_ext  = subnet_tensor_v->find(tensor_name)->second;
+            for (tensor_idx = 0; tensor_idx < subnet_output_num; tensor_idx++) {
+                auto& tensor_ext  = *slot_tensor_v[subnet->output_slot_v[tensor_idx]];
                 switch(tensor_ext.io_type) {
                     case TENSOR_TYPE_NET_OUTPUT:
                         /* subnet input tensor is also net output tensor, using user input */
@@ -1186,20 +1232,18 @@ bool Bmruntime::launch_multi_subnet(
                         BMRT_LOG(FATAL, "error io tensor type!");
                         break;
                 }
-                tensor_idx++;
             }
 
             m_profile->set_extra_data(subnet->tpu_info.is_dynamic);
             if (subnet->tpu_info.is_dynamic) {
-                ret = launch_tpu_ir_subnet(net_ctx, stage, subnet,
+                ret = launch_tpu_ir_subnet(net_ctx, stage, binding, subnet,
                                      subnet_input_tensors, subnet_input_elem_nums, subnet_input_num,
                                      subnet_output_tensors, subnet_output_elem_nums, subnet_output_num, core_list, dyn_core_mask);
                 BMRT_ASSERT_INFO(ret == true, "launch_tpu_ir_subnet return false");
 
                 /* reshape output tensors */
-                tensor_idx = 0;
-                for (auto& tensor_name: subnet->output_tensor_name_v) {
-                    auto& tensor_ext  = subnet_tensor_v->find(tensor_name)->second;
+                for (tensor_idx = 0; tensor_idx < subnet_output_num; tensor_idx++) {
+                    auto& tensor_ext  = *slot_tensor_v[subnet->output_slot_v[tensor_idx]];
                     switch(tensor_ext.io_type) {
                         case TENSOR_TYPE_NET_OUTPUT:
                             /* subnet input tensor is also net output tensor, using user input */
@@ -1219,7 +1263,7 @@ bool Bmruntime::launch_multi_subnet(
 
                     #ifdef DEBUG
                     {
-                      BMRT_DEBUG("tensor %s shape [ ", tensor_name.c_str());
+                      BMRT_DEBUG("tensor %s shape [ ", subnet->output_tensor_name_v[tensor_idx].c_str());
                       std::stringstream debug_msg;
                       for (int i = 0; i < subnet_output_tensors[tensor_idx].shape.num_dims; i++)
                           debug_msg << subnet_output_tensors[tensor_idx].shape.dims[i] << " ";
@@ -1227,12 +1271,10 @@ bool Bmruntime::launch_multi_subnet(
                       BMRT_DEBUG("%s", debug_msg.str().c_str());
                     }
                     #endif
-
-                    tensor_idx++;
                 }
 
             } else {
-                ret = launch_tpu_subnet(net_ctx, stage, subnet,
+                ret = launch_tpu_subnet(net_ctx, stage, binding, subnet,
                                         subnet_input_tensors, subnet_input_num,
                                         subnet_output_tensors, subnet_output_num,
                                         core_list, dyn_core_mask, next_id >=0);
@@ -275,6 +275,24 @@ Network::~Network()
 }
 
 bm_status_t Network::Forward(bool sync) const
+{
+  return Forward(NULL, sync);
+}
+
+const void *Network::GetLaunchHandle(const bm_shape_t *shapes) const
+{
+  Bmruntime *p_bmrt = (Bmruntime *)ctx_->body_;
+  std::vector<bm_shape_t> input_shapes;
+  if (shapes == NULL) {
+    for (int idx = 0; idx < info()->input_num; idx++) {
+      input_shapes.push_back(input_tensors_[idx].shape);
+    }
+    shapes = input_shapes.data();
+  }
+  return p_bmrt->get_launch_handle(net_id_, shapes);
+}
+
+bm_status_t Network::Forward(const void *launch_handle, bool sync) const
 {
   Bmruntime *p_bmrt = (Bmruntime *)ctx_->body_;
   // check whether all inputs ready
@@ -286,8 +304,11 @@ bm_status_t Network::Forward(bool sync) const
     }
   }
 
-  bool bRet = p_bmrt->launch(net_id_, input_tensors_, info()->input_num, output_tensors_,
-                             info()->output_num, true, true);
+  bool bRet = launch_handle == NULL
+      ? p_bmrt->launch(net_id_, input_tensors_, info()->input_num, output_tensors_,
+                       info()->output_num, true, true)
+      : p_bmrt->launch((const launch_handle_t *)launch_handle, input_tensors_,
+                       info()->input_num, output_tensors_, info()->output_num, true, true);
   if (bRet == false) {
     BMRT_LOG(WRONG, "launch net[%s] failed", info()->name);
     return BM_ERR_FAILURE;